@@ -0,0 +1,656 @@
+#include "AABBTree.h"
+#include <cmath>
+#include <cassert>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+#pragma region AABB Helpers
+
+static AABB Union(const AABB & a, const AABB & b)
+{
+	AABB result;
+	result.Min.x = a.Min.x < b.Min.x ? a.Min.x : b.Min.x;
+	result.Min.y = a.Min.y < b.Min.y ? a.Min.y : b.Min.y;
+	result.Min.z = a.Min.z < b.Min.z ? a.Min.z : b.Min.z;
+	result.Max.x = a.Max.x > b.Max.x ? a.Max.x : b.Max.x;
+	result.Max.y = a.Max.y > b.Max.y ? a.Max.y : b.Max.y;
+	result.Max.z = a.Max.z > b.Max.z ? a.Max.z : b.Max.z;
+	return result;
+}
+
+// Half the surface area - only ever compared, so the 2 doesn't matter
+static float Area(const AABB & box)
+{
+	float x = box.Max.x - box.Min.x;
+	float y = box.Max.y - box.Min.y;
+	float z = box.Max.z - box.Min.z;
+	return x * y + y * z + z * x;
+}
+
+static bool Contains(const AABB & outer, const AABB & inner)
+{
+	return
+		outer.Min.x <= inner.Min.x && outer.Min.y <= inner.Min.y && outer.Min.z <= inner.Min.z &&
+		outer.Max.x >= inner.Max.x && outer.Max.y >= inner.Max.y && outer.Max.z >= inner.Max.z;
+}
+
+static bool Overlaps(const AABB & a, const AABB & b)
+{
+	return
+		a.Min.x <= b.Max.x && a.Min.y <= b.Max.y && a.Min.z <= b.Max.z &&
+		a.Max.x >= b.Min.x && a.Max.y >= b.Min.y && a.Max.z >= b.Min.z;
+}
+
+static int Larger(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+#pragma endregion
+
+AABBTree::AABBTree(float _margin)
+{
+	margin = _margin;
+	root = AABB_NULL_NODE;
+	freeList = AABB_NULL_NODE;
+	proxyCount = 0;
+}
+
+AABBTree::~AABBTree()
+{
+}
+
+#pragma region Proxies
+
+int AABBTree::CreateProxy(const AABB & box, unsigned int userData)
+{
+	int proxyId = AllocateNode();
+
+	AABBTreeNode & node = nodes[proxyId];
+	node.Box.Min = XMFLOAT3(box.Min.x - margin, box.Min.y - margin, box.Min.z - margin);
+	node.Box.Max = XMFLOAT3(box.Max.x + margin, box.Max.y + margin, box.Max.z + margin);
+	node.UserData = userData;
+	node.Height = 0;
+
+	InsertLeaf(proxyId);
+	proxyCount++;
+	return proxyId;
+}
+
+void AABBTree::DestroyProxy(int proxyId)
+{
+	assert(proxyId >= 0 && proxyId < (int)nodes.size() && nodes[proxyId].IsLeaf());
+
+	RemoveLeaf(proxyId);
+	FreeNode(proxyId);
+	proxyCount--;
+}
+
+bool AABBTree::MoveProxy(int proxyId, const AABB & box)
+{
+	assert(proxyId >= 0 && proxyId < (int)nodes.size() && nodes[proxyId].IsLeaf());
+
+	// Still inside the fat box - nothing to do
+	if (Contains(nodes[proxyId].Box, box))
+		return false;
+
+	RemoveLeaf(proxyId);
+
+	AABBTreeNode & node = nodes[proxyId];
+	node.Box.Min = XMFLOAT3(box.Min.x - margin, box.Min.y - margin, box.Min.z - margin);
+	node.Box.Max = XMFLOAT3(box.Max.x + margin, box.Max.y + margin, box.Max.z + margin);
+
+	InsertLeaf(proxyId);
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Queries
+
+void AABBTree::Query(const AABB & box, std::vector<unsigned int> & results)
+{
+	if (root == AABB_NULL_NODE)
+		return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		stack.pop_back();
+
+		const AABBTreeNode & node = nodes[index];
+		if (!Overlaps(node.Box, box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			results.push_back(node.UserData);
+		}
+		else
+		{
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Each node carries a mask of the planes its parent wasn't
+// already fully inside of.  A node completely in front of a
+// plane drops it from the mask, and once the mask is empty
+// the whole subtree is accepted without further tests.
+// --------------------------------------------------------
+void AABBTree::QueryFrustum(const XMFLOAT4 * planes, std::vector<unsigned int> & inside, std::vector<unsigned int> & intersecting)
+{
+	if (root == AABB_NULL_NODE)
+		return;
+
+	stack.clear();
+	planeMaskStack.clear();
+	stack.push_back(root);
+	planeMaskStack.push_back(0x3F);
+
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		int planeMask = planeMaskStack.back();
+		stack.pop_back();
+		planeMaskStack.pop_back();
+
+		const AABBTreeNode & node = nodes[index];
+		float centerX = (node.Box.Min.x + node.Box.Max.x) * 0.5f;
+		float centerY = (node.Box.Min.y + node.Box.Max.y) * 0.5f;
+		float centerZ = (node.Box.Min.z + node.Box.Max.z) * 0.5f;
+		float extentX = (node.Box.Max.x - node.Box.Min.x) * 0.5f;
+		float extentY = (node.Box.Max.y - node.Box.Min.y) * 0.5f;
+		float extentZ = (node.Box.Max.z - node.Box.Min.z) * 0.5f;
+
+		bool outside = false;
+		for (int p = 0; p < 6; p++)
+		{
+			if (!(planeMask & (1 << p)))
+				continue;
+
+			const XMFLOAT4 & plane = planes[p];
+			float distance = plane.x * centerX + plane.y * centerY + plane.z * centerZ + plane.w;
+			float radius = fabsf(plane.x) * extentX + fabsf(plane.y) * extentY + fabsf(plane.z) * extentZ;
+
+			if (distance + radius < 0.0f)
+			{
+				outside = true;
+				break;
+			}
+
+			// Entirely in front, so no descendant needs this plane
+			if (distance - radius >= 0.0f)
+				planeMask &= ~(1 << p);
+		}
+
+		if (outside)
+			continue;
+
+		if (planeMask == 0)
+		{
+			CollectLeaves(index, inside);
+		}
+		else if (node.IsLeaf())
+		{
+			intersecting.push_back(node.UserData);
+		}
+		else
+		{
+			stack.push_back(node.Child1);
+			planeMaskStack.push_back(planeMask);
+			stack.push_back(node.Child2);
+			planeMaskStack.push_back(planeMask);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Same plane tests as QueryFrustum(), but with one SIMD lane
+// per view.  Every stack entry carries a bit per view still
+// testing it; a view drops out of a subtree once it rejects
+// or fully accepts it, and the walk stops descending once no
+// view is left testing
+// --------------------------------------------------------
+void AABBTree::QueryFrustums(const XMFLOAT4 * const * planeSets, int viewCount, std::vector<MultiViewResult> & results)
+{
+	if (root == AABB_NULL_NODE || viewCount <= 0)
+		return;
+	if (viewCount > MAX_CULL_VIEWS)
+		viewCount = MAX_CULL_VIEWS;
+
+	// Transpose the planes into groups of four views.  Unused
+	// lanes get a plane nothing is behind, and are masked off
+	int groupCount = (viewCount + 3) / 4;
+	viewPlanes.resize(groupCount * 6 * 4);
+	for (int g = 0; g < groupCount; g++)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			XMFLOAT4 * dest = &viewPlanes[(g * 6 + p) * 4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int v = g * 4 + lane;
+				XMFLOAT4 plane = v < viewCount ? planeSets[v][p] : XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+				(&dest[0].x)[lane] = plane.x;
+				(&dest[1].x)[lane] = plane.y;
+				(&dest[2].x)[lane] = plane.z;
+				(&dest[3].x)[lane] = plane.w;
+			}
+		}
+	}
+
+	MultiViewEntry start;
+	start.Node = root;
+	start.Pending = viewCount == 32 ? 0xFFFFFFFF : ((1u << viewCount) - 1);
+	start.Inside = 0;
+
+	multiViewStack.clear();
+	multiViewStack.push_back(start);
+
+	while (!multiViewStack.empty())
+	{
+		MultiViewEntry entry = multiViewStack.back();
+		multiViewStack.pop_back();
+
+		// Load the box once for every view
+		const AABBTreeNode & node = nodes[entry.Node];
+		XMVECTOR boxMin = XMLoadFloat3(&node.Box.Min);
+		XMVECTOR boxMax = XMLoadFloat3(&node.Box.Max);
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f);
+		XMVECTOR extent = XMVectorScale(XMVectorSubtract(boxMax, boxMin), 0.5f);
+		XMVECTOR cx = XMVectorSplatX(center);
+		XMVECTOR cy = XMVectorSplatY(center);
+		XMVECTOR cz = XMVectorSplatZ(center);
+		XMVECTOR ex = XMVectorSplatX(extent);
+		XMVECTOR ey = XMVectorSplatY(extent);
+		XMVECTOR ez = XMVectorSplatZ(extent);
+
+		uint32_t outsideMask = 0;
+		uint32_t insideMask = 0;
+		for (int g = 0; g < groupCount; g++)
+		{
+			int groupPending = (entry.Pending >> (g * 4)) & 0xF;
+			if (groupPending == 0)
+				continue;
+
+			XMVECTOR outside = XMVectorFalseInt();
+			XMVECTOR inside = XMVectorTrueInt();
+			const XMFLOAT4 * planes = &viewPlanes[g * 6 * 4];
+			for (int p = 0; p < 6; p++)
+			{
+				XMVECTOR nx = XMLoadFloat4(&planes[p * 4 + 0]);
+				XMVECTOR ny = XMLoadFloat4(&planes[p * 4 + 1]);
+				XMVECTOR nz = XMLoadFloat4(&planes[p * 4 + 2]);
+				XMVECTOR nd = XMLoadFloat4(&planes[p * 4 + 3]);
+				XMVECTOR distance = XMVectorMultiplyAdd(cx, nx, XMVectorMultiplyAdd(cy, ny, XMVectorMultiplyAdd(cz, nz, nd)));
+				XMVECTOR radius = XMVectorMultiplyAdd(ex, XMVectorAbs(nx), XMVectorMultiplyAdd(ey, XMVectorAbs(ny), XMVectorMultiply(ez, XMVectorAbs(nz))));
+				outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorSubtract(distance, radius), XMVectorZero()));
+
+				// Most nodes visited are outside every view, usually
+				// found within the first plane or two
+				if ((_mm_movemask_ps(outside) & groupPending) == groupPending)
+					break;
+			}
+
+			outsideMask |= (uint32_t)_mm_movemask_ps(outside) << (g * 4);
+			insideMask |= (uint32_t)_mm_movemask_ps(inside) << (g * 4);
+		}
+
+		// Views that just accepted the box stop testing, along with
+		// ones that rejected it
+		insideMask &= entry.Pending;
+		uint32_t pending = entry.Pending & ~outsideMask & ~insideMask;
+		entry.Inside |= insideMask;
+
+		if (pending == 0)
+		{
+			// Every view has made up its mind about this subtree
+			if (entry.Inside != 0)
+				CollectLeaves(entry.Node, entry.Inside, results);
+		}
+		else if (node.IsLeaf())
+		{
+			MultiViewResult result;
+			result.UserData = node.UserData;
+			result.InsideMask = entry.Inside;
+			result.IntersectMask = pending;
+			results.push_back(result);
+		}
+		else
+		{
+			entry.Pending = pending;
+			entry.Node = node.Child1;
+			multiViewStack.push_back(entry);
+			entry.Node = node.Child2;
+			multiViewStack.push_back(entry);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Appends every leaf below a node.  The tree is balanced,
+// so the recursion depth stays around 2 * log2(proxies)
+// --------------------------------------------------------
+void AABBTree::CollectLeaves(int index, std::vector<unsigned int> & results)
+{
+	const AABBTreeNode & node = nodes[index];
+	if (node.IsLeaf())
+	{
+		results.push_back(node.UserData);
+		return;
+	}
+
+	CollectLeaves(node.Child1, results);
+	CollectLeaves(node.Child2, results);
+}
+
+void AABBTree::CollectLeaves(int index, uint32_t insideMask, std::vector<MultiViewResult> & results)
+{
+	const AABBTreeNode & node = nodes[index];
+	if (node.IsLeaf())
+	{
+		MultiViewResult result;
+		result.UserData = node.UserData;
+		result.InsideMask = insideMask;
+		result.IntersectMask = 0;
+		results.push_back(result);
+		return;
+	}
+
+	CollectLeaves(node.Child1, insideMask, results);
+	CollectLeaves(node.Child2, insideMask, results);
+}
+
+#pragma endregion
+
+#pragma region Tree Structure
+
+int AABBTree::AllocateNode()
+{
+	int index;
+	if (freeList != AABB_NULL_NODE)
+	{
+		index = freeList;
+		freeList = nodes[index].Parent;
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.push_back(AABBTreeNode());
+	}
+
+	AABBTreeNode & node = nodes[index];
+	node.Parent = AABB_NULL_NODE;
+	node.Child1 = AABB_NULL_NODE;
+	node.Child2 = AABB_NULL_NODE;
+	node.Height = 0;
+	node.UserData = 0;
+	return index;
+}
+
+void AABBTree::FreeNode(int index)
+{
+	nodes[index].Parent = freeList;
+	nodes[index].Height = -1;
+	freeList = index;
+}
+
+// --------------------------------------------------------
+// Walks down from the root towards whichever child would
+// grow the least by taking the new leaf, pairs the leaf with
+// the node it stops at, then refits and rebalances upwards
+// --------------------------------------------------------
+void AABBTree::InsertLeaf(int leaf)
+{
+	if (root == AABB_NULL_NODE)
+	{
+		root = leaf;
+		nodes[root].Parent = AABB_NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling
+	AABB leafBox = nodes[leaf].Box;
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		int child1 = nodes[index].Child1;
+		int child2 = nodes[index].Child2;
+
+		float area = Area(nodes[index].Box);
+		float combinedArea = Area(Union(nodes[index].Box, leafBox));
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float cost1 = Area(Union(leafBox, nodes[child1].Box)) + inheritanceCost;
+		if (!nodes[child1].IsLeaf())
+			cost1 -= Area(nodes[child1].Box);
+
+		float cost2 = Area(Union(leafBox, nodes[child2].Box)) + inheritanceCost;
+		if (!nodes[child2].IsLeaf())
+			cost2 -= Area(nodes[child2].Box);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? child1 : child2;
+	}
+	int sibling = index;
+
+	// New parent for the sibling and the leaf
+	int oldParent = nodes[sibling].Parent;
+	int newParent = AllocateNode();
+	nodes[newParent].Parent = oldParent;
+	nodes[newParent].Box = Union(leafBox, nodes[sibling].Box);
+	nodes[newParent].Height = nodes[sibling].Height + 1;
+	nodes[newParent].Child1 = sibling;
+	nodes[newParent].Child2 = leaf;
+	nodes[sibling].Parent = newParent;
+	nodes[leaf].Parent = newParent;
+
+	if (oldParent != AABB_NULL_NODE)
+	{
+		if (nodes[oldParent].Child1 == sibling)
+			nodes[oldParent].Child1 = newParent;
+		else
+			nodes[oldParent].Child2 = newParent;
+	}
+	else
+	{
+		root = newParent;
+	}
+
+	// Refit and rebalance the ancestors
+	index = nodes[leaf].Parent;
+	while (index != AABB_NULL_NODE)
+	{
+		index = Balance(index);
+
+		int child1 = nodes[index].Child1;
+		int child2 = nodes[index].Child2;
+		nodes[index].Height = 1 + Larger(nodes[child1].Height, nodes[child2].Height);
+		nodes[index].Box = Union(nodes[child1].Box, nodes[child2].Box);
+
+		index = nodes[index].Parent;
+	}
+}
+
+// --------------------------------------------------------
+// Replaces the leaf's parent with the leaf's sibling, then
+// refits and rebalances upwards
+// --------------------------------------------------------
+void AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = AABB_NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].Parent;
+	int grandParent = nodes[parent].Parent;
+	int sibling = nodes[parent].Child1 == leaf ? nodes[parent].Child2 : nodes[parent].Child1;
+
+	if (grandParent == AABB_NULL_NODE)
+	{
+		root = sibling;
+		nodes[sibling].Parent = AABB_NULL_NODE;
+		FreeNode(parent);
+		return;
+	}
+
+	if (nodes[grandParent].Child1 == parent)
+		nodes[grandParent].Child1 = sibling;
+	else
+		nodes[grandParent].Child2 = sibling;
+	nodes[sibling].Parent = grandParent;
+	FreeNode(parent);
+
+	int index = grandParent;
+	while (index != AABB_NULL_NODE)
+	{
+		index = Balance(index);
+
+		int child1 = nodes[index].Child1;
+		int child2 = nodes[index].Child2;
+		nodes[index].Box = Union(nodes[child1].Box, nodes[child2].Box);
+		nodes[index].Height = 1 + Larger(nodes[child1].Height, nodes[child2].Height);
+
+		index = nodes[index].Parent;
+	}
+}
+
+// --------------------------------------------------------
+// If one child of A is more than one level taller than the
+// other, rotates that child up to take A's place.  With C
+// the taller child and F its taller grandchild:
+//
+//   A(B, C(F, G))   ->   C(A(B, G), F)
+//
+// (the shorter grandchild moves down).  Returns the index of
+// the node now at A's position.
+// --------------------------------------------------------
+int AABBTree::Balance(int iA)
+{
+	AABBTreeNode * A = &nodes[iA];
+	if (A->IsLeaf() || A->Height < 2)
+		return iA;
+
+	int iB = A->Child1;
+	int iC = A->Child2;
+	AABBTreeNode * B = &nodes[iB];
+	AABBTreeNode * C = &nodes[iC];
+
+	int balance = C->Height - B->Height;
+
+	// Rotate C up
+	if (balance > 1)
+	{
+		int iF = C->Child1;
+		int iG = C->Child2;
+		AABBTreeNode * F = &nodes[iF];
+		AABBTreeNode * G = &nodes[iG];
+
+		C->Child1 = iA;
+		C->Parent = A->Parent;
+		A->Parent = iC;
+
+		if (C->Parent != AABB_NULL_NODE)
+		{
+			if (nodes[C->Parent].Child1 == iA)
+				nodes[C->Parent].Child1 = iC;
+			else
+				nodes[C->Parent].Child2 = iC;
+		}
+		else
+		{
+			root = iC;
+		}
+
+		if (F->Height > G->Height)
+		{
+			C->Child2 = iF;
+			A->Child2 = iG;
+			G->Parent = iA;
+			A->Box = Union(B->Box, G->Box);
+			C->Box = Union(A->Box, F->Box);
+			A->Height = 1 + Larger(B->Height, G->Height);
+			C->Height = 1 + Larger(A->Height, F->Height);
+		}
+		else
+		{
+			C->Child2 = iG;
+			A->Child2 = iF;
+			F->Parent = iA;
+			A->Box = Union(B->Box, F->Box);
+			C->Box = Union(A->Box, G->Box);
+			A->Height = 1 + Larger(B->Height, F->Height);
+			C->Height = 1 + Larger(A->Height, G->Height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1)
+	{
+		int iD = B->Child1;
+		int iE = B->Child2;
+		AABBTreeNode * D = &nodes[iD];
+		AABBTreeNode * E = &nodes[iE];
+
+		B->Child1 = iA;
+		B->Parent = A->Parent;
+		A->Parent = iB;
+
+		if (B->Parent != AABB_NULL_NODE)
+		{
+			if (nodes[B->Parent].Child1 == iA)
+				nodes[B->Parent].Child1 = iB;
+			else
+				nodes[B->Parent].Child2 = iB;
+		}
+		else
+		{
+			root = iB;
+		}
+
+		if (D->Height > E->Height)
+		{
+			B->Child2 = iD;
+			A->Child1 = iE;
+			E->Parent = iA;
+			A->Box = Union(C->Box, E->Box);
+			B->Box = Union(A->Box, D->Box);
+			A->Height = 1 + Larger(C->Height, E->Height);
+			B->Height = 1 + Larger(A->Height, D->Height);
+		}
+		else
+		{
+			B->Child2 = iE;
+			A->Child1 = iD;
+			D->Parent = iA;
+			A->Box = Union(C->Box, D->Box);
+			B->Box = Union(A->Box, E->Box);
+			A->Height = 1 + Larger(C->Height, D->Height);
+			B->Height = 1 + Larger(A->Height, E->Height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+#pragma endregion
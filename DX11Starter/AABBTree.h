@@ -0,0 +1,135 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+// Index used for "no node"
+const int AABB_NULL_NODE = -1;
+
+// Most views QueryFrustums() can handle, one bit each
+const int MAX_CULL_VIEWS = 32;
+
+// --------------------------------------------------------
+// Axis aligned bounding box
+// --------------------------------------------------------
+struct AABB
+{
+	DirectX::XMFLOAT3 Min;
+	DirectX::XMFLOAT3 Max;
+};
+
+// --------------------------------------------------------
+// A node in the tree.  Leaves hold one proxy each, internal
+// nodes always have exactly two children
+// --------------------------------------------------------
+struct AABBTreeNode
+{
+	AABB Box;					// Fattened box for leaves, union of children otherwise
+	unsigned int UserData;		// What the proxy stands for (leaves only)
+	int Parent;					// Parent node, or next free node when unused
+	int Child1;
+	int Child2;
+	int Height;					// 0 for leaves, -1 for free nodes
+
+	bool IsLeaf() const { return Child1 == AABB_NULL_NODE; }
+};
+
+// --------------------------------------------------------
+// A proxy found by QueryFrustums(), with one bit per view
+// --------------------------------------------------------
+struct MultiViewResult
+{
+	unsigned int UserData;
+	uint32_t InsideMask;		// Views the fattened box is fully inside
+	uint32_t IntersectMask;		// Views whose planes the fattened box crosses
+};
+
+// --------------------------------------------------------
+// Dynamic bounding volume tree, in the style of Box2D's.
+// Each proxy's box is fattened by a margin, so small moves
+// don't touch the tree at all.  Inserts pick the cheapest
+// sibling by surface area, and rotations keep it balanced.
+// --------------------------------------------------------
+class AABBTree
+{
+public:
+	/// @param _margin: how far boxes are fattened on each side
+	AABBTree(float _margin);
+	~AABBTree();
+
+	/// Adds a proxy to the tree
+	/// @param box: tight world space box of the object
+	/// @param userData: value handed back by queries
+	/// @return: the proxy id
+	int CreateProxy(const AABB & box, unsigned int userData);
+
+	/// Removes a proxy from the tree
+	void DestroyProxy(int proxyId);
+
+	/// Updates a proxy's box.  Only touches the tree when the
+	/// new box has left the proxy's fattened box
+	/// @return: true if the proxy was reinserted
+	bool MoveProxy(int proxyId, const AABB & box);
+
+	/// Finds every proxy whose fattened box overlaps the given box
+	/// @param box: world space box to test
+	/// @param results: user data of overlapping proxies is appended here
+	void Query(const AABB & box, std::vector<unsigned int> & results);
+
+	/// Walks the tree against a frustum, rejecting or accepting
+	/// whole subtrees at a time
+	/// @param planes: six normalized planes with inward facing normals
+	/// @param inside: proxies fully inside the frustum are appended here
+	/// @param intersecting: proxies whose fattened box crosses a plane
+	/// are appended here, so callers can test their tight bounds
+	void QueryFrustum(const DirectX::XMFLOAT4 * planes, std::vector<unsigned int> & inside, std::vector<unsigned int> & intersecting);
+
+	/// Walks the tree once against several frustums (split-screen
+	/// cameras, shadow views, ...).  Each node's box is loaded once
+	/// and tested against four views at a time, skipping views that
+	/// have already rejected or fully accepted its subtree
+	/// @param planeSets: six planes per view, as for QueryFrustum()
+	/// @param viewCount: number of views, at most MAX_CULL_VIEWS
+	/// @param results: proxies seen by at least one view are appended
+	/// here, with which views see them
+	void QueryFrustums(const DirectX::XMFLOAT4 * const * planeSets, int viewCount, std::vector<MultiViewResult> & results);
+
+	// Getters
+	const AABB & GetFatAABB(int proxyId) { return nodes[proxyId].Box; }
+	unsigned int GetUserData(int proxyId) { return nodes[proxyId].UserData; }
+	int GetHeight() { return root == AABB_NULL_NODE ? 0 : nodes[root].Height; }
+	int GetProxyCount() { return proxyCount; }
+
+private:
+	std::vector<AABBTreeNode> nodes;
+	int root;
+	int freeList;
+	int proxyCount;
+	float margin;
+
+	// Scratch stacks for traversals
+	std::vector<int> stack;
+	std::vector<int> planeMaskStack;
+
+	// Traversal state for QueryFrustums()
+	struct MultiViewEntry
+	{
+		int Node;
+		uint32_t Pending;		// Views still testing this subtree
+		uint32_t Inside;		// Views that accepted the whole subtree
+	};
+	std::vector<MultiViewEntry> multiViewStack;
+
+	// Planes regrouped so one register holds the same plane of
+	// four views: (x, y, z, w) of plane p for views 4g..4g+3 are
+	// at [(g * 6 + p) * 4 + 0..3]
+	std::vector<DirectX::XMFLOAT4> viewPlanes;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int node);
+	void CollectLeaves(int node, std::vector<unsigned int> & results);
+	void CollectLeaves(int node, uint32_t insideMask, std::vector<MultiViewResult> & results);
+};
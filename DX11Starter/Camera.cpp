@@ -14,6 +14,10 @@ Camera::Camera(XMFLOAT3 _camPos, XMFLOAT3 _camDir, DirectX::XMFLOAT4X4 _viewMatr
 	camDir = _camDir;
 
 	rotScale = .002f;
+
+	// No projection until the screen size is known
+	XMStoreFloat4x4(&projectionMatrix, XMMatrixIdentity());
+	UpdateFrustum();
 }
 
 Camera::~Camera()
@@ -30,6 +34,28 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix()
 	return projectionMatrix;
 }
 
+XMFLOAT3 Camera::GetPosition()
+{
+	return camPos;
+}
+
+XMFLOAT4 Camera::GetRotation()
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(xRot, yRot, 0));
+	return rotation;
+}
+
+DirectX::XMFLOAT4X4 Camera::GetViewProjectionMatrix()
+{
+	return viewProjectionMatrix;
+}
+
+const DirectX::XMFLOAT4 * Camera::GetFrustumPlanes()
+{
+	return frustumPlanes;
+}
+
 void Camera::Update(float deltaTime)
 {
 	// Camera rotation
@@ -40,7 +66,6 @@ void Camera::Update(float deltaTime)
 	//XMVECTOR upDirection = XMVector3Rotate(XMLoadFloat3(&defaultUp), rotQuaternion);
 
 	XMStoreFloat3(&camDir, XMVector3Rotate(XMLoadFloat3(&defaultForward), rotQuaternion));
-	XMStoreFloat4x4(&viewMatrix, XMMatrixTranspose(XMMatrixLookToLH(XMLoadFloat3(&camPos), XMLoadFloat3(&camDir), XMLoadFloat3(&defaultUp))));
 
 	// Camera controls
 	if (GetAsyncKeyState('W') & 0x8000) // Move forward
@@ -67,6 +92,22 @@ void Camera::Update(float deltaTime)
 	{
 		camPos.y += 1.0f * deltaTime;
 	}
+
+	// Built after moving, so the view, frustum and position agree
+	viewMatrix = BuildViewMatrix(camPos, GetRotation());
+	UpdateFrustum();
+}
+
+XMFLOAT4X4 Camera::BuildViewMatrix(XMFLOAT3 position, XMFLOAT4 rotation)
+{
+	XMFLOAT3 defaultForward = XMFLOAT3(0, 0, 1);
+	XMFLOAT3 defaultUp = XMFLOAT3(0, 1, 0);
+
+	XMVECTOR direction = XMVector3Rotate(XMLoadFloat3(&defaultForward), XMLoadFloat4(&rotation));
+
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookToLH(XMLoadFloat3(&position), direction, XMLoadFloat3(&defaultUp))));
+	return view;
 }
 
 void Camera::UpdateProjectionMatrix(float width, float height)
@@ -80,6 +121,8 @@ void Camera::UpdateProjectionMatrix(float width, float height)
 		0.1f,						// Near clip plane distance
 		100.0f);					// Far clip plane distance
 	XMStoreFloat4x4(&projectionMatrix, XMMatrixTranspose(P)); // Transpose for HLSL!
+
+	UpdateFrustum();
 }
 
 void Camera::RotateY(float amount)
@@ -93,3 +136,40 @@ void Camera::RotateX(float amount)
 	(amount > 100) ? amount = 100 : (amount < -100) ? amount = -100 : amount = amount;
 	xRot += amount * rotScale;
 }
+
+// --------------------------------------------------------
+// Rebuilds the cached view-projection and its planes
+// --------------------------------------------------------
+void Camera::UpdateFrustum()
+{
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX proj = XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix));
+	XMStoreFloat4x4(&viewProjectionMatrix, XMMatrixTranspose(view * proj));
+
+	ExtractFrustumPlanes(viewProjectionMatrix, frustumPlanes);
+}
+
+// --------------------------------------------------------
+// Pulls the frustum planes straight out of the combined
+// view-projection matrix (Gribb/Hartmann).  The stored matrix
+// is transposed, so its rows are the columns the planes are
+// built from.  D3D clip space depth runs 0 to w, so the near
+// plane is just the third column.
+// --------------------------------------------------------
+void Camera::ExtractFrustumPlanes(const XMFLOAT4X4 & viewProjection, XMFLOAT4 * planes)
+{
+	XMMATRIX viewProj = XMLoadFloat4x4(&viewProjection);
+
+	XMVECTOR unnormalized[6];
+	unnormalized[0] = viewProj.r[3] + viewProj.r[0];	// Left
+	unnormalized[1] = viewProj.r[3] - viewProj.r[0];	// Right
+	unnormalized[2] = viewProj.r[3] + viewProj.r[1];	// Bottom
+	unnormalized[3] = viewProj.r[3] - viewProj.r[1];	// Top
+	unnormalized[4] = viewProj.r[2];					// Near
+	unnormalized[5] = viewProj.r[3] - viewProj.r[2];	// Far
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(unnormalized[i]));
+	}
+}
@@ -11,6 +11,30 @@ public:
 	// Getters
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
+	DirectX::XMFLOAT4X4 GetViewProjectionMatrix();
+
+	/// The six world space frustum planes (left, right, bottom,
+	/// top, near, far) as normalized (a, b, c, d) with the normals
+	/// pointing inwards, matching the cached view-projection
+	const DirectX::XMFLOAT4 * GetFrustumPlanes();
+	DirectX::XMFLOAT3 GetPosition();
+
+	/// The camera's orientation as a quaternion
+	DirectX::XMFLOAT4 GetRotation();
+
+	/// Builds the view matrix for a camera placement, so views
+	/// between two placements can be made the same way
+	/// @param position: world space camera position
+	/// @param rotation: orientation quaternion, turning +Z to the
+	/// view direction
+	/// @return: the view matrix, transposed for HLSL
+	static DirectX::XMFLOAT4X4 BuildViewMatrix(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation);
+
+	/// Extracts frustum planes from any view-projection matrix
+	/// @param viewProjection: the matrix, transposed for HLSL
+	/// @param planes: receives six planes, in the same order and
+	/// form as GetFrustumPlanes()
+	static void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4 & viewProjection, DirectX::XMFLOAT4 * planes);
 
 	/// Will update the camera's position and rotation with
 	/// a given delta time
@@ -35,6 +59,15 @@ private:
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projectionMatrix;
 
+	// Combined view and projection (transposed like the others),
+	// and the culling planes taken from it
+	DirectX::XMFLOAT4X4 viewProjectionMatrix;
+	DirectX::XMFLOAT4 frustumPlanes[6];
+
+	/// Rebuilds the view-projection matrix and frustum planes,
+	/// called whenever the view or projection changes
+	void UpdateFrustum();
+
 	// Required for a look-to camera
 	DirectX::XMFLOAT3 camPos;
 	DirectX::XMFLOAT3 camDir;
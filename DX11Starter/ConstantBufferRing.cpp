@@ -0,0 +1,119 @@
+#include "ConstantBufferRing.h"
+#include <cstring>
+
+ConstantBufferRing::ConstantBufferRing(ID3D11Device * device, ID3D11DeviceContext * _context, unsigned int size)
+	: allocator(size, CONSTANT_RING_ALIGNMENT)
+{
+	context = _context;
+	buffer = 0;
+	discarded = false;
+	frameNumber = 0;
+	firstQuery = 0;
+	for (unsigned int i = 0; i < RING_MAX_FRAMES; i++)
+	{
+		frameQueries[i] = 0;
+	}
+
+	// Offsets need the D3D11.1 binding calls, and writing to a
+	// dynamic constant buffer without discarding it needs driver
+	// support as well
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+		!options.ConstantBufferOffsetting ||
+		!options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (unsigned int i = 0; i < RING_MAX_FRAMES; i++)
+	{
+		if (FAILED(device->CreateQuery(&queryDesc, &frameQueries[i])))
+			return;
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(device->CreateBuffer(&desc, 0, &buffer)))
+		buffer = 0;
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+	if (buffer) { buffer->Release(); }
+	for (unsigned int i = 0; i < RING_MAX_FRAMES; i++)
+	{
+		if (frameQueries[i]) { frameQueries[i]->Release(); }
+	}
+}
+
+void ConstantBufferRing::BeginFrame()
+{
+	while (RetireOldestFrame(false))
+	{
+	}
+
+	// Every slot still in flight, so the oldest has to finish
+	// before this frame can get a query of its own
+	if (allocator.GetPendingFrames() == RING_MAX_FRAMES)
+		RetireOldestFrame(true);
+}
+
+void ConstantBufferRing::EndFrame()
+{
+	unsigned int query = (firstQuery + allocator.GetPendingFrames()) % RING_MAX_FRAMES;
+	context->End(frameQueries[query]);
+	allocator.EndFrame();
+	frameNumber++;
+}
+
+bool ConstantBufferRing::Upload(const void * data, unsigned int size, unsigned int * firstConstant, unsigned int * constantCount)
+{
+	unsigned int offset = allocator.Allocate(size);
+	while (offset == RING_ALLOCATION_FAILED)
+	{
+		// Only earlier frames can give memory back - if this
+		// frame alone filled the ring, waiting won't help
+		if (!RetireOldestFrame(true))
+			return false;
+		offset = allocator.Allocate(size);
+	}
+
+	// The very first map has to discard, after that the fences
+	// keep regions the GPU may still read from being written
+	D3D11_MAP mapType = discarded ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped)))
+		return false;
+	discarded = true;
+
+	memcpy((unsigned char *)mapped.pData + offset, data, size);
+	context->Unmap(buffer, 0);
+
+	*firstConstant = offset / 16;
+	*constantCount = allocator.AlignSize(size) / 16;
+	return true;
+}
+
+bool ConstantBufferRing::RetireOldestFrame(bool wait)
+{
+	if (allocator.GetPendingFrames() == 0)
+		return false;
+
+	// S_FALSE means the GPU hasn't got there yet.  Anything else
+	// (including a lost device) is as done as it will ever be
+	ID3D11Query * query = frameQueries[firstQuery];
+	HRESULT result = context->GetData(query, 0, 0, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	while (wait && result == S_FALSE)
+	{
+		result = context->GetData(query, 0, 0, 0);
+	}
+	if (result == S_FALSE)
+		return false;
+
+	allocator.RetireFrame();
+	firstQuery = (firstQuery + 1) % RING_MAX_FRAMES;
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <d3d11_1.h>
+#include "RingAllocator.h"
+
+// Constant buffer offsets are in 16 byte constants, and must be
+// a multiple of 16 of them
+const unsigned int CONSTANT_RING_ALIGNMENT = 256;
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that shaders' constant
+// data is written into each time it changes, bound at an
+// offset with the D3D11.1 *SetConstantBuffers1 calls.
+//
+// Writes use no-overwrite maps, so nothing already handed
+// to the GPU gets renamed or copied.  An event query is
+// issued at the end of each frame, and a frame's regions
+// are only reused once its query has completed.
+//
+// Needs a D3D11.1 runtime and driver support for constant
+// buffer offsets - check IsAvailable().
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	/// @param device: device to create the buffer and queries with
+	/// @param _context: context used to map the buffer
+	/// @param size: size of the ring in bytes
+	ConstantBufferRing(ID3D11Device * device, ID3D11DeviceContext * _context, unsigned int size);
+	~ConstantBufferRing();
+
+	/// Whether the device supports binding at offsets, and the
+	/// buffer was created.  If not, nothing else should be called
+	bool IsAvailable() { return buffer != 0; }
+
+	/// Frees the regions of frames the GPU has finished with,
+	/// waiting on the oldest if every frame slot is in use
+	void BeginFrame();
+
+	/// Marks the end of the frame's uploads
+	void EndFrame();
+
+	/// Copies data into a fresh region of the ring
+	/// @param data: bytes to copy
+	/// @param size: number of bytes
+	/// @param firstConstant: receives the offset to bind at
+	/// @param constantCount: receives the number of constants to bind
+	/// @return: false if the ring is full even after waiting for
+	/// the GPU, so the caller needs to upload some other way
+	bool Upload(const void * data, unsigned int size, unsigned int * firstConstant, unsigned int * constantCount);
+
+	ID3D11Buffer * GetBuffer() { return buffer; }
+
+	/// Number of the frame uploads are going to right now
+	unsigned int GetFrame() { return frameNumber; }
+
+	/// Whether data uploaded during a frame is still in the ring
+	/// @param frame: what GetFrame() returned at the time
+	bool IsLive(unsigned int frame) { return frameNumber - frame <= allocator.GetPendingFrames(); }
+
+private:
+	ID3D11DeviceContext * context;
+	ID3D11Buffer * buffer;
+	RingAllocator allocator;
+	bool discarded;
+	unsigned int frameNumber;
+
+	// One per outstanding frame, oldest first from firstQuery
+	ID3D11Query * frameQueries[RING_MAX_FRAMES];
+	unsigned int firstQuery;
+
+	/// Frees the oldest outstanding frame if the GPU is done with it
+	/// @param wait: whether to wait for the GPU to finish
+	/// @return: whether a frame was freed
+	bool RetireOldestFrame(bool wait);
+};
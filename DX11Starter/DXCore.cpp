@@ -2,6 +2,7 @@
 
 #include <WindowsX.h>
 #include <sstream>
+#include <future>
 
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
@@ -46,6 +47,16 @@ DXCore::DXCore(
 	this->width = windowWidth;
 	this->height = windowHeight;
 	this->titleBarStats = debugTitleBarStats;
+	this->overlapUpdateAndDraw = false;
+	this->interpolationAlpha = 1.0f;
+
+	// Simulate at 60 ticks per second, and never more
+	// than 5 ticks in a single frame
+	fixedTimeStep = 1.0f / 60.0f;
+	maxTicksPerFrame = 5;
+	tickAccumulator = 0.0f;
+	simulationTime = 0.0f;
+	nextInterpolationAlpha = 1.0f;
 
 	// Initialize fields
 	fpsFrameCount = 0;
@@ -373,8 +384,23 @@ HRESULT DXCore::Run()
 				UpdateTitleBarStats();
 
 			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			if (overlapUpdateAndDraw)
+			{
+				// Simulate the next frame while the current one is submitted
+				std::future<void> update = std::async(std::launch::async,
+					[this]() { Simulate(); });
+				Draw(deltaTime, totalTime);
+				update.wait();
+				interpolationAlpha = nextInterpolationAlpha;
+				SyncFrame();
+			}
+			else
+			{
+				Simulate();
+				interpolationAlpha = nextInterpolationAlpha;
+				SyncFrame();
+				Draw(deltaTime, totalTime);
+			}
 		}
 	}
 
@@ -384,6 +410,65 @@ HRESULT DXCore::Run()
 }
 
 
+// --------------------------------------------------------
+// Runs the simulation for this frame.  With a fixed timestep,
+// Update() is called once per whole tick of accumulated time,
+// so simulation cost no longer scales with frame rate.  The
+// leftover fraction of a tick becomes the interpolation alpha.
+// PrepareFrame() follows the last tick, if there was one.
+// --------------------------------------------------------
+void DXCore::Simulate()
+{
+	// Variable timestep - one update per frame, nothing to interpolate
+	if (fixedTimeStep <= 0.0f)
+	{
+		Update(deltaTime, totalTime);
+		PrepareFrame();
+		nextInterpolationAlpha = 1.0f;
+		return;
+	}
+
+	tickAccumulator += deltaTime;
+
+	// If we've fallen too far behind (breakpoint, long hitch, or
+	// ticks costing more than they simulate), drop the extra time
+	// rather than trying to catch up and falling further behind
+	float maxAccumulated = fixedTimeStep * maxTicksPerFrame;
+	if (tickAccumulator > maxAccumulated)
+		tickAccumulator = maxAccumulated;
+
+	bool ticked = false;
+	while (tickAccumulator >= fixedTimeStep)
+	{
+		simulationTime += fixedTimeStep;
+		Update(fixedTimeStep, simulationTime);
+		tickAccumulator -= fixedTimeStep;
+		ticked = true;
+	}
+
+	// Nothing changed if there was no tick, so Draw() keeps
+	// the last prepared frame
+	if (ticked)
+		PrepareFrame();
+
+	nextInterpolationAlpha = tickAccumulator / fixedTimeStep;
+}
+
+// --------------------------------------------------------
+// Sets the simulation tick rate
+//
+// ticksPerSecond   - Update() calls per second, or 0 to call
+//                    Update() once per frame with a variable delta
+// maxTicksPerFrame - Most ticks to run in one frame before
+//                    dropping time
+// --------------------------------------------------------
+void DXCore::SetFixedTickRate(float ticksPerSecond, int maxTicksPerFrame)
+{
+	this->fixedTimeStep = ticksPerSecond > 0.0f ? 1.0f / ticksPerSecond : 0.0f;
+	this->maxTicksPerFrame = maxTicksPerFrame > 0 ? maxTicksPerFrame : 1;
+	tickAccumulator = 0.0f;
+}
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
@@ -37,12 +37,26 @@ public:
 	HRESULT Run();				
 	void Quit();
 	virtual void OnResize();
+
+	// Switches Update() to a fixed tick rate, or back to one
+	// variable-length update per frame when ticksPerSecond is 0
+	void SetFixedTickRate(float ticksPerSecond, int maxTicksPerFrame);
 	
 	// Pure virtual methods for setup and game functionality
 	virtual void Init()										= 0;
 	virtual void Update(float deltaTime, float totalTime)	= 0;
 	virtual void Draw(float deltaTime, float totalTime)		= 0;
 
+	// Called once per frame after the frame's last Update(), on
+	// the same thread, if any Update() ran.  Build what Draw()
+	// needs from the simulation here rather than in Update(), so
+	// frames that run several ticks to catch up only do it once
+	virtual void PrepareFrame() { }
+
+	// Called once per frame after both Update() and Draw() have
+	// finished, so state shared between them can be handed over
+	virtual void SyncFrame() { }
+
 	// Convenience methods for handling mouse input, since we
 	// can easily grab mouse input from OS-level messages
 	virtual void OnMouseDown (WPARAM buttonState, int x, int y) { }
@@ -55,6 +69,15 @@ protected:
 	HWND		hWnd;			// The handle to the window itself
 	std::string titleBarText;	// Custom text in window's title bar
 	bool		titleBarStats;	// Show extra stats in title bar?
+
+	// Run Update() for the next frame on a worker thread while
+	// Draw() submits the current one.  Only safe if Update() and
+	// Draw() share nothing except what is handed over in SyncFrame()
+	bool		overlapUpdateAndDraw;
+
+	// How far (0-1) the current frame is between the last two
+	// simulation ticks - Draw() uses this to interpolate
+	float		interpolationAlpha;
 	
 	// Size of the window's client area
 	unsigned int width;
@@ -81,11 +104,19 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	// Fixed timestep simulation
+	float fixedTimeStep;		// Seconds per tick, or 0 for variable
+	int maxTicksPerFrame;		// Clamp against the "spiral of death"
+	float tickAccumulator;		// Unsimulated time carried between frames
+	float simulationTime;		// Total simulated time
+	float nextInterpolationAlpha;	// Alpha for the frame being simulated
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 	
 	void UpdateTimer();			// Updates the timer for this frame
+	void Simulate();			// Runs this frame's update tick(s)
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
 };
 
@@ -1,4 +1,5 @@
 #include "Entity.h"
+#include <cmath>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -9,13 +10,21 @@ Entity::Entity(Mesh * _mesh, Material * _material, XMFLOAT4X4 _matrix, XMFLOAT3
 	mesh = _mesh;
 	material = _material;
 	worldMatrix = _matrix;
+	previousWorldMatrix = _matrix;
 	position = _pos;
 	rotation = _rot;
 	scale = _scale;
+	visible = true;
+	occluder = false;
+	staticId = NO_STATIC_ID;
+	lod = 0;
+	tree = 0;
+	proxyId = AABB_NULL_NODE;
 }
 
 Entity::~Entity()
 {
+	DetachFromTree();
 }
 
 #pragma region Getters
@@ -25,6 +34,11 @@ XMFLOAT4X4 Entity::GetWorldMatrix()
 	return worldMatrix;
 }
 
+XMFLOAT4X4 Entity::GetPreviousWorldMatrix()
+{
+	return previousWorldMatrix;
+}
+
 XMFLOAT3 Entity::GetPosition()
 {
 	return position;
@@ -39,12 +53,48 @@ XMFLOAT3 Entity::GetScale()
 {
 	return scale;
 }
+
+Mesh * Entity::GetMesh()
+{
+	return mesh;
+}
+
+Material * Entity::GetMaterial()
+{
+	return material;
+}
+
+bool Entity::GetVisible()
+{
+	return visible;
+}
+
+bool Entity::GetOccluder()
+{
+	return occluder;
+}
+
+bool Entity::GetStatic()
+{
+	return staticId != NO_STATIC_ID;
+}
+
+unsigned int Entity::GetStaticId()
+{
+	return staticId;
+}
+
+int Entity::GetLOD()
+{
+	return lod;
+}
 #pragma endregion
 
 #pragma region Setters
 void Entity::SetWorldMatrix(XMFLOAT4X4 value)
 {
 	worldMatrix = value;
+	UpdateProxy();
 }
 
 void Entity::SetPosition(XMFLOAT3 value)
@@ -61,6 +111,37 @@ void Entity::SetScale(XMFLOAT3 value)
 {
 	scale = value;
 }
+
+void Entity::SetMesh(Mesh * value)
+{
+	mesh = value;
+	UpdateProxy();
+}
+
+void Entity::SetMaterial(Material * value)
+{
+	material = value;
+}
+
+void Entity::SetVisible(bool value)
+{
+	visible = value;
+}
+
+void Entity::SetOccluder(bool value)
+{
+	occluder = value;
+}
+
+void Entity::SetStaticId(unsigned int value)
+{
+	staticId = value;
+}
+
+void Entity::SetLOD(int value)
+{
+	lod = value;
+}
 #pragma endregion
 
 // Movement
@@ -80,56 +161,111 @@ void Entity::Move(float translateX, float translateY, float translateZ, float ro
 	XMMATRIX rotation = rotationX * rotationY * rotationZ;
 
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(translate * rotation));
+	UpdateProxy();
+}
+
+void Entity::UpdateWorldMatrix()
+{
+	XMMATRIX scaling = XMMatrixScaling(scale.x, scale.y, scale.z);
+	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+	XMMATRIX translate = XMMatrixTranslation(position.x, position.y, position.z);
+
+	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(scaling * rotationMatrix * translate));
+	UpdateProxy();
+}
+
+void Entity::StorePreviousWorldMatrix()
+{
+	previousWorldMatrix = worldMatrix;
+}
+
+// --------------------------------------------------------
+// Transforms the mesh's local box by the world matrix and
+// boxes the result (Arvo's method - the extents pick up the
+// absolute value of each rotation/scale term)
+// --------------------------------------------------------
+void Entity::GetWorldBounds(XMFLOAT3 & center, XMFLOAT3 & extents)
+{
+	XMFLOAT3 localMin = mesh->GetBoundsMin();
+	XMFLOAT3 localMax = mesh->GetBoundsMax();
+	float localCenter[3] = { (localMin.x + localMax.x) * 0.5f, (localMin.y + localMax.y) * 0.5f, (localMin.z + localMax.z) * 0.5f };
+	float localExtents[3] = { (localMax.x - localMin.x) * 0.5f, (localMax.y - localMin.y) * 0.5f, (localMax.z - localMin.z) * 0.5f };
+
+	// The world matrix is transposed, so row r holds output axis r
+	float worldCenter[3];
+	float worldExtents[3];
+	for (int r = 0; r < 3; r++)
+	{
+		worldCenter[r] = worldMatrix.m[r][3];
+		worldExtents[r] = 0.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			worldCenter[r] += worldMatrix.m[r][c] * localCenter[c];
+			worldExtents[r] += fabsf(worldMatrix.m[r][c]) * localExtents[c];
+		}
+	}
+
+	center = XMFLOAT3(worldCenter[0], worldCenter[1], worldCenter[2]);
+	extents = XMFLOAT3(worldExtents[0], worldExtents[1], worldExtents[2]);
+}
+
+AABB Entity::GetWorldBox()
+{
+	XMFLOAT3 center;
+	XMFLOAT3 extents;
+	GetWorldBounds(center, extents);
+
+	AABB box;
+	box.Min = XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+	box.Max = XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+	return box;
+}
+
+void Entity::AttachToTree(AABBTree * _tree, unsigned int userData)
+{
+	DetachFromTree();
+
+	tree = _tree;
+	proxyId = tree->CreateProxy(GetWorldBox(), userData);
 }
 
-// Drawing
-
-void Entity::Draw(ID3D11DeviceContext * context)
-{
-	// Set buffers in the input assembler
-	//  - Do this ONCE PER OBJECT you're drawing, since each object might
-	//    have different geometry.
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-
-	ID3D11Buffer * vertBuffer = mesh->GetVertexBuffer();
-	context->IASetVertexBuffers(0, 1, &vertBuffer, &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Finally do the actual drawing
-	//  - Do this ONCE PER OBJECT you intend to draw
-	//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-	//     vertices in the currently set VERTEX BUFFER
-	context->DrawIndexed(
-		mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
-}
-
-void Entity::PrepareMaterial(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projectionMatrix)
-{
-	// Send data to shader variables
-	//  - Do this ONCE PER OBJECT you're drawing
-	//  - This is actually a complex process of copying data to a local buffer
-	//    and then copying that entire buffer to the GPU.  
-	//  - The "SimpleShader" class handles all of that for you.
-	material->GetVertexShader()->SetMatrix4x4("world", worldMatrix);
-	material->GetVertexShader()->SetMatrix4x4("view", viewMatrix);
-	material->GetVertexShader()->SetMatrix4x4("projection", projectionMatrix);
-	material->GetPixelShader()->SetShaderResourceView("diffuseTexture", material->getShaderResourceView());
-	material->GetPixelShader()->SetSamplerState("basicSampler", material->getSamplerState());
-
-	// Once you've set all of the data you care to change for
-	// the next draw call, you need to actually send it to the GPU
-	//  - If you skip this, the "SetMatrix" calls above won't make it to the GPU!
-	material->GetVertexShader()->CopyAllBufferData();
-	material->GetPixelShader()->CopyAllBufferData();
-
-	// Set the vertex and pixel shaders to use for the next Draw() command
-	//  - These don't technically need to be set every frame...YET
-	//  - Once you start applying different shaders to different objects,
-	//    you'll need to swap the current shaders before each draw
-	material->GetVertexShader()->SetShader();
-	material->GetPixelShader()->SetShader();
+void Entity::DetachFromTree()
+{
+	if (!tree)
+		return;
+
+	tree->DestroyProxy(proxyId);
+	tree = 0;
+	proxyId = AABB_NULL_NODE;
+}
+
+// --------------------------------------------------------
+// Called whenever the world matrix or mesh changes.  Cheap
+// when the entity hasn't left its fattened box in the tree
+// --------------------------------------------------------
+void Entity::UpdateProxy()
+{
+	// Whatever was baked for it no longer holds
+	staticId = NO_STATIC_ID;
+
+	if (!tree)
+		return;
+
+	tree->MoveProxy(proxyId, GetWorldBox());
+}
+
+void Entity::SetLODMeshes(Mesh ** meshes, int count)
+{
+	lodMeshes.assign(meshes, meshes + count);
+}
+
+Mesh * Entity::GetMeshForLOD(int level)
+{
+	if (level <= 0 || lodMeshes.empty())
+		return mesh;
+
+	size_t index = (size_t)level - 1;
+	if (index >= lodMeshes.size())
+		index = lodMeshes.size() - 1;
+	return lodMeshes[index];
 }
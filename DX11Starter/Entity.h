@@ -2,7 +2,12 @@
 #include "DXCore.h"
 #include "Mesh.h"
 #include "Material.h"
+#include "AABBTree.h"
 #include <DirectXMath.h>
+#include <vector>
+
+// Static id of an entity that isn't static
+const unsigned int NO_STATIC_ID = 0xFFFFFFFF;
 
 class Entity
 {
@@ -12,15 +17,36 @@ public:
 
 	// Getters
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	DirectX::XMFLOAT4X4 GetPreviousWorldMatrix();
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
+	Mesh * GetMesh();
+	Material * GetMaterial();
+	bool GetVisible();
+	bool GetOccluder();
+	bool GetStatic();
+	unsigned int GetStaticId();
+	int GetLOD();
 
 	// Setters 
 	void SetWorldMatrix(DirectX::XMFLOAT4X4 value);
 	void SetPosition(DirectX::XMFLOAT3 value);
 	void SetRotation(DirectX::XMFLOAT3 value);
 	void SetScale(DirectX::XMFLOAT3 value);
+	void SetMesh(Mesh * value);
+	void SetMaterial(Material * value);
+	void SetVisible(bool value);
+	void SetOccluder(bool value);
+	void SetLOD(int value);
+
+	/// Marks the entity as part of the level, which never moves.
+	/// Changing its world matrix or mesh afterwards makes it
+	/// dynamic again, since anything baked about it is then wrong
+	/// @param value: an id that's the same every time the level
+	/// loads, which baked data refers to the entity by, or
+	/// NO_STATIC_ID to make the entity dynamic
+	void SetStaticId(unsigned int value);
 
 	// Movement
 
@@ -33,22 +59,44 @@ public:
 	/// @param rotZ: Amount to rotate in the Z direction
 	void Move(float translateX, float translateY, float translateZ, float rotX, float rotY, float rotZ);
 
-	// Drawing
+	/// Rebuilds the world matrix from the current position,
+	/// rotation and scale
+	void UpdateWorldMatrix();
+
+	/// Remembers the current world matrix as the previous one,
+	/// called at the start of each simulation tick so rendering
+	/// can interpolate between ticks
+	void StorePreviousWorldMatrix();
+
+	/// Computes a world space box around the entity's mesh
+	/// @param center: receives the center of the box
+	/// @param extents: receives the half size of the box on each axis
+	void GetWorldBounds(DirectX::XMFLOAT3 & center, DirectX::XMFLOAT3 & extents);
+
+	/// Adds the entity to a spatial tree.  From then on any change
+	/// to its world matrix or mesh updates its proxy automatically
+	/// @param _tree: the tree to add to
+	/// @param userData: value the tree hands back from queries
+	void AttachToTree(AABBTree * _tree, unsigned int userData);
+
+	/// Removes the entity from its spatial tree, if it's in one
+	void DetachFromTree();
 
-	/// Will draw the entity to the screen, potentially will
-	/// be moved to a Renderer class at a later date
-	/// @param device: Pointer to the DirectX device context
-	/// used for drawing
-	void Draw(ID3D11DeviceContext * context);
+	/// Sets simplified meshes to draw when the entity is small on
+	/// screen.  The entity's own mesh is always LOD 0
+	/// @param meshes: meshes for LOD 1, 2, ... in order
+	/// @param count: number of meshes
+	void SetLODMeshes(Mesh ** meshes, int count);
 
-	/// Responsible for setting up the shaders prior to drawing
-	/// @param viewMatrix: the camera's view matrix
-	/// @param projectionMatrix: the camera's projection matrix
-	void PrepareMaterial(DirectX::XMFLOAT4X4 viewMatrix, DirectX::XMFLOAT4X4 projectionMatrix);
+	/// The mesh to draw at a given LOD.  Levels past the last LOD
+	/// mesh reuse it
+	/// @param level: LOD picked by a LODSelector
+	Mesh * GetMeshForLOD(int level);
 
 private:
 	// Transform data
 	DirectX::XMFLOAT4X4 worldMatrix;
+	DirectX::XMFLOAT4X4 previousWorldMatrix;
 	DirectX::XMFLOAT3 position;
 	DirectX::XMFLOAT3 rotation;
 	DirectX::XMFLOAT3 scale;
@@ -56,5 +104,27 @@ private:
 	// Mesh data
 	Mesh * mesh;
 	Material * material;
+	std::vector<Mesh *> lodMeshes;
+
+	// LOD used last frame, so switches can lag behind a bit
+	int lod;
+
+	// Whether the entity should be drawn at all
+	bool visible;
+
+	// Whether the entity hides things behind it, for occlusion culling
+	bool occluder;
+
+	// Id the level gave the entity, if it's static
+	unsigned int staticId;
+
+	// Spatial tree the entity is in, if any
+	AABBTree * tree;
+	int proxyId;
+
+	/// Pushes the current world bounds to the spatial tree, and
+	/// ends the entity being static
+	void UpdateProxy();
+	AABB GetWorldBox();
 };
 
@@ -0,0 +1,171 @@
+#include "EntityCommandBuffer.h"
+#include <algorithm>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Orders commands by type first, so every create happens
+// before changes and every destroy happens last, then by
+// handle so each entity is touched in one run, then by
+// recording order
+// --------------------------------------------------------
+static bool CommandLess(const EntityCommand & a, const EntityCommand & b)
+{
+	if (a.CommandType != b.CommandType) return a.CommandType < b.CommandType;
+	if (a.Handle != b.Handle) return a.Handle < b.Handle;
+	return a.Sequence < b.Sequence;
+}
+
+EntityCommandBuffer::EntityCommandBuffer(EntityPool * _pool)
+{
+	pool = _pool;
+	nextSequence = 0;
+}
+
+EntityCommandBuffer::~EntityCommandBuffer()
+{
+}
+
+#pragma region Recording
+
+EntityHandle EntityCommandBuffer::Create(Mesh * mesh, Material * material)
+{
+	EntityCommand command = {};
+	command.CommandType = EntityCommand::Create;
+	command.Handle = pool->ReserveHandle();
+	command.CommandMesh = mesh;
+	command.CommandMaterial = material;
+	Record(command);
+
+	return command.Handle;
+}
+
+void EntityCommandBuffer::Destroy(EntityHandle handle)
+{
+	EntityCommand command = {};
+	command.CommandType = EntityCommand::Destroy;
+	command.Handle = handle;
+	Record(command);
+}
+
+void EntityCommandBuffer::SetTransform(EntityHandle handle, XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale)
+{
+	EntityCommand command = {};
+	command.CommandType = EntityCommand::SetTransform;
+	command.Handle = handle;
+	command.Position = position;
+	command.Rotation = rotation;
+	command.Scale = scale;
+	Record(command);
+}
+
+void EntityCommandBuffer::SetMesh(EntityHandle handle, Mesh * mesh)
+{
+	EntityCommand command = {};
+	command.CommandType = EntityCommand::SetMesh;
+	command.Handle = handle;
+	command.CommandMesh = mesh;
+	Record(command);
+}
+
+void EntityCommandBuffer::SetMaterial(EntityHandle handle, Material * material)
+{
+	EntityCommand command = {};
+	command.CommandType = EntityCommand::SetMaterial;
+	command.Handle = handle;
+	command.CommandMaterial = material;
+	Record(command);
+}
+
+void EntityCommandBuffer::Record(EntityCommand & command)
+{
+	std::lock_guard<std::mutex> lock(commandMutex);
+	command.Sequence = nextSequence++;
+	commands.push_back(command);
+}
+
+size_t EntityCommandBuffer::GetCommandCount()
+{
+	std::lock_guard<std::mutex> lock(commandMutex);
+	return commands.size();
+}
+
+#pragma endregion
+
+// --------------------------------------------------------
+// Sorts and applies all recorded commands
+// --------------------------------------------------------
+void EntityCommandBuffer::Playback()
+{
+	// Take the recorded commands so recording can continue
+	// into an empty buffer while we apply these
+	std::vector<EntityCommand> pending;
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		pending.swap(commands);
+		nextSequence = 0;
+	}
+
+	std::sort(pending.begin(), pending.end(), CommandLess);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	std::vector<EntityHandle> destroyed;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		EntityCommand & command = pending[i];
+
+		// Destroys are batched so the pool compacts once
+		if (command.CommandType == EntityCommand::Destroy)
+		{
+			destroyed.push_back(command.Handle);
+			continue;
+		}
+
+		if (command.CommandType == EntityCommand::Create)
+		{
+			pool->Add(command.Handle, new Entity(
+				command.CommandMesh,
+				command.CommandMaterial,
+				identity,
+				XMFLOAT3(0, 0, 0),
+				XMFLOAT3(0, 0, 0),
+				XMFLOAT3(1, 1, 1)));
+			continue;
+		}
+
+		// Component changes, skipping entities that no longer exist
+		Entity * entity = pool->Get(command.Handle);
+		if (!entity)
+			continue;
+
+		switch (command.CommandType)
+		{
+		case EntityCommand::SetTransform:
+			entity->SetPosition(command.Position);
+			entity->SetRotation(command.Rotation);
+			entity->SetScale(command.Scale);
+			entity->UpdateWorldMatrix();
+
+			// Placed, not moved - don't sweep from where it was
+			// (or from the identity a new entity starts with)
+			entity->StorePreviousWorldMatrix();
+			break;
+
+		case EntityCommand::SetMesh:
+			entity->SetMesh(command.CommandMesh);
+			break;
+
+		case EntityCommand::SetMaterial:
+			entity->SetMaterial(command.CommandMaterial);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	pool->Remove(destroyed);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "EntityPool.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <mutex>
+
+// --------------------------------------------------------
+// A single deferred structural or component change
+// --------------------------------------------------------
+struct EntityCommand
+{
+	// Declared in playback order: creates run first, then
+	// component changes, then destroys
+	enum Type
+	{
+		Create,
+		SetTransform,
+		SetMesh,
+		SetMaterial,
+		Destroy
+	};
+
+	Type CommandType;
+	EntityHandle Handle;
+	unsigned int Sequence;	// Recording order, keeps playback deterministic
+
+	Mesh * CommandMesh;
+	Material * CommandMaterial;
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Rotation;
+	DirectX::XMFLOAT3 Scale;
+};
+
+// --------------------------------------------------------
+// Records entity creation, destruction and component changes
+// from any thread, then applies them all at once at a sync
+// point where nothing is iterating the pool
+// --------------------------------------------------------
+class EntityCommandBuffer
+{
+public:
+	EntityCommandBuffer(EntityPool * _pool);
+	~EntityCommandBuffer();
+
+	/// Records the creation of a new entity
+	/// @param mesh: the entity's mesh
+	/// @param material: the entity's material
+	/// @return: the handle the entity will have once played back
+	EntityHandle Create(Mesh * mesh, Material * material);
+
+	/// Records the destruction of an entity
+	/// @param handle: the entity to destroy
+	void Destroy(EntityHandle handle);
+
+	/// Records a change to an entity's transform, rebuilding its
+	/// world matrix on playback
+	/// @param handle: the entity to change
+	/// @param position: the new position
+	/// @param rotation: the new rotation (pitch, yaw, roll)
+	/// @param scale: the new scale
+	void SetTransform(EntityHandle handle, DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 rotation, DirectX::XMFLOAT3 scale);
+
+	/// Records a change to an entity's mesh
+	void SetMesh(EntityHandle handle, Mesh * mesh);
+
+	/// Records a change to an entity's material
+	void SetMaterial(EntityHandle handle, Material * material);
+
+	/// Applies every recorded command to the pool in one sorted
+	/// pass and empties the buffer.  Must only be called when no
+	/// other code is iterating or recording
+	void Playback();
+
+	/// Number of commands recorded since the last playback.
+	/// Safe to call while other threads are recording
+	size_t GetCommandCount();
+
+private:
+	EntityPool * pool;
+
+	std::vector<EntityCommand> commands;
+	unsigned int nextSequence;
+	std::mutex commandMutex;
+
+	void Record(EntityCommand & command);
+};
@@ -0,0 +1,148 @@
+#include "EntityPool.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// How far entity boxes are fattened in the spatial tree,
+// in world units.  Entities moving less than this between
+// updates never restructure the tree
+static const float TREE_MARGIN = 0.5f;
+
+EntityPool::EntityPool()
+	: tree(TREE_MARGIN)
+{
+	nextSlot = 0;
+}
+
+EntityPool::~EntityPool()
+{
+	Clear();
+}
+
+// --------------------------------------------------------
+// Hands out a free handle.  The slot table itself is only
+// touched by Add(), so readers on the main thread are safe
+// --------------------------------------------------------
+EntityHandle EntityPool::ReserveHandle()
+{
+	std::lock_guard<std::mutex> lock(handleMutex);
+
+	// Reuse a released slot if there is one
+	if (!freeHandles.empty())
+	{
+		EntityHandle handle = freeHandles.back();
+		freeHandles.pop_back();
+		return handle;
+	}
+
+	if (nextSlot >= MAX_ENTITY_SLOTS)
+		return INVALID_ENTITY_HANDLE;
+
+	// Fresh slots start at generation zero
+	return nextSlot++;
+}
+
+// --------------------------------------------------------
+// Appends an entity to the dense array under the given handle
+// --------------------------------------------------------
+void EntityPool::Add(EntityHandle handle, Entity * entity)
+{
+	if (handle == INVALID_ENTITY_HANDLE)
+	{
+		delete entity;
+		return;
+	}
+
+	// Grow the slot table to cover newly reserved handles
+	unsigned int slot = GetEntitySlot(handle);
+	if (slot >= handleToDense.size())
+		handleToDense.resize(slot + 1, -1);
+
+	if (handleToDense[slot] != -1)
+	{
+		delete entity;
+		return;
+	}
+
+	handleToDense[slot] = (int)entities.size();
+	entities.push_back(entity);
+	denseToHandle.push_back(handle);
+
+	// From here on the entity keeps its own proxy up to date
+	entity->AttachToTree(&tree, handle);
+}
+
+// --------------------------------------------------------
+// Removes entities by moving the last live entity into each
+// hole, so the dense array never has gaps.  Each freed slot
+// goes back on the free list one generation on
+// --------------------------------------------------------
+void EntityPool::Remove(const std::vector<EntityHandle> & handles)
+{
+	std::lock_guard<std::mutex> lock(handleMutex);
+
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		EntityHandle handle = handles[i];
+		if (!Get(handle))
+			continue;
+
+		// Delete the entity and fill its slot with the last one
+		unsigned int slot = GetEntitySlot(handle);
+		int dense = handleToDense[slot];
+		int last = (int)entities.size() - 1;
+		delete entities[dense];
+
+		entities[dense] = entities[last];
+		denseToHandle[dense] = denseToHandle[last];
+		handleToDense[GetEntitySlot(denseToHandle[dense])] = dense;
+
+		entities.pop_back();
+		denseToHandle.pop_back();
+
+		// Release the slot for reuse.  The generation wraps
+		// after 4096 reuses of the same slot
+		handleToDense[slot] = -1;
+		freeHandles.push_back(handle + (1u << ENTITY_SLOT_BITS));
+	}
+}
+
+// --------------------------------------------------------
+// Deletes every entity in the pool
+// --------------------------------------------------------
+void EntityPool::Clear()
+{
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		delete entities[i];
+	}
+	entities.clear();
+	denseToHandle.clear();
+	handleToDense.clear();
+
+	std::lock_guard<std::mutex> lock(handleMutex);
+	freeHandles.clear();
+	nextSlot = 0;
+}
+
+Entity * EntityPool::Get(EntityHandle handle)
+{
+	unsigned int slot = GetEntitySlot(handle);
+	if (slot >= handleToDense.size() || handleToDense[slot] == -1)
+		return 0;
+
+	// A different generation means the handle's entity is gone
+	int dense = handleToDense[slot];
+	if (denseToHandle[dense] != handle)
+		return 0;
+
+	return entities[dense];
+}
+
+EntityHandle EntityPool::GetHandle(size_t denseIndex)
+{
+	if (denseIndex >= denseToHandle.size())
+		return INVALID_ENTITY_HANDLE;
+
+	return denseToHandle[denseIndex];
+}
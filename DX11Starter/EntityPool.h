@@ -0,0 +1,82 @@
+#pragma once
+#include "Entity.h"
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// Stable identifier for an entity, independent of where
+// the entity currently lives in the pool's dense array.
+// The low bits pick the entity's slot and the high bits are
+// a generation, bumped each time the slot is freed, so a
+// handle kept past its entity's destruction never finds
+// whatever entity reuses the slot
+typedef unsigned int EntityHandle;
+const EntityHandle INVALID_ENTITY_HANDLE = 0xFFFFFFFF;
+
+const unsigned int ENTITY_SLOT_BITS = 20;
+const EntityHandle ENTITY_SLOT_MASK = (1u << ENTITY_SLOT_BITS) - 1;
+
+// Slots that can be handed out.  The last one is left unused
+// so no live handle can equal INVALID_ENTITY_HANDLE
+const unsigned int MAX_ENTITY_SLOTS = ENTITY_SLOT_MASK;
+
+/// The slot part of a handle, for indexing per-entity tables
+inline unsigned int GetEntitySlot(EntityHandle handle) { return handle & ENTITY_SLOT_MASK; }
+
+class EntityPool
+{
+public:
+	EntityPool();
+	~EntityPool();
+
+	/// Reserves a handle for an entity that will be added later.
+	/// Safe to call from any thread
+	/// @return: a handle not used by any live or reserved entity,
+	/// or INVALID_ENTITY_HANDLE if every slot is taken
+	EntityHandle ReserveHandle();
+
+	/// Places an entity in the pool under a previously reserved
+	/// handle.  The pool takes ownership of the entity, and
+	/// deletes it straight away if the handle is invalid or taken
+	/// @param handle: handle returned from ReserveHandle()
+	/// @param entity: the entity to store
+	void Add(EntityHandle handle, Entity * entity);
+
+	/// Removes and deletes a batch of entities, keeping the dense
+	/// array compact.  Their slots are released for reuse under a
+	/// new generation, so the removed handles stay invalid
+	/// @param handles: the entities to remove, unknown or stale
+	/// handles are ignored
+	void Remove(const std::vector<EntityHandle> & handles);
+
+	/// Deletes every entity and releases every handle
+	void Clear();
+
+	// Lookup.  Get() returns null for handles of removed entities
+	Entity * Get(EntityHandle handle);
+	EntityHandle GetHandle(size_t denseIndex);
+	size_t Size() { return entities.size(); }
+	Entity * operator[](size_t denseIndex) { return entities[denseIndex]; }
+
+	/// Spatial tree over every entity's world bounds.  Queries
+	/// return entity handles
+	AABBTree * GetTree() { return &tree; }
+
+private:
+	// Bounding volume tree the pool's entities live in
+	AABBTree tree;
+
+	// Dense, compact array of live entities (iterated every frame)
+	std::vector<Entity *> entities;
+	std::vector<EntityHandle> denseToHandle;
+
+	// Sparse slot -> dense index table, -1 when not live
+	std::vector<int> handleToDense;
+
+	// Guards handle reservation, which may come from worker threads.
+	// Freed handles are stored with their next generation already
+	// applied, ready to hand out
+	std::mutex handleMutex;
+	std::vector<EntityHandle> freeHandles;
+	unsigned int nextSlot;
+};
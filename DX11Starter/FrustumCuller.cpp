@@ -0,0 +1,292 @@
+#include "FrustumCuller.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Boxes are processed in groups of this many, so arrays are
+// padded up to it (enough for the AVX path)
+static const size_t CULL_BATCH = 8;
+
+FrustumCuller::FrustumCuller()
+{
+	count = 0;
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Clear()
+{
+	count = 0;
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+size_t FrustumCuller::AddBox(XMFLOAT3 center, XMFLOAT3 extents)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+	return count++;
+}
+
+// --------------------------------------------------------
+// Pads the arrays to a whole batch, then runs the widest
+// test this build supports
+// --------------------------------------------------------
+size_t FrustumCuller::Cull(const XMFLOAT4 * planes)
+{
+	Pad();
+	visible.resize(centerX.size());
+
+#if defined(__AVX__)
+	CullAVX(planes);
+#else
+	CullSSE(planes);
+#endif
+
+	Trim();
+
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+// --------------------------------------------------------
+// Like Cull(), with the view loop inside the box loop so each
+// group of boxes is loaded only once
+// --------------------------------------------------------
+void FrustumCuller::CullViews(const XMFLOAT4 * const * planeSets, int viewCount)
+{
+	if (viewCount > 32)
+		viewCount = 32;
+
+	Pad();
+	viewMasks.assign(centerX.size(), 0);
+
+#if defined(__AVX__)
+	CullViewsAVX(planeSets, viewCount);
+#else
+	CullViewsSSE(planeSets, viewCount);
+#endif
+
+	Trim();
+}
+
+void FrustumCuller::Pad()
+{
+	size_t padded = (count + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f);
+	extentY.resize(padded, 0.0f);
+	extentZ.resize(padded, 0.0f);
+}
+
+// --------------------------------------------------------
+// Drops the padding again so AddBox() keeps appending in place
+// --------------------------------------------------------
+void FrustumCuller::Trim()
+{
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	extentX.resize(count);
+	extentY.resize(count);
+	extentZ.resize(count);
+}
+
+// --------------------------------------------------------
+// Four boxes per iteration.  A box is outside if, for any
+// plane, even its corner furthest along the plane normal is
+// behind it:  dot(n, center) + d + dot(|n|, extents) < 0
+// --------------------------------------------------------
+void FrustumCuller::CullSSE(const XMFLOAT4 * planes)
+{
+	// Splat each plane once up front
+	XMVECTOR nx[6], ny[6], nz[6], nd[6];
+	XMVECTOR ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++)
+	{
+		nx[p] = XMVectorReplicate(planes[p].x);
+		ny[p] = XMVectorReplicate(planes[p].y);
+		nz[p] = XMVectorReplicate(planes[p].z);
+		nd[p] = XMVectorReplicate(planes[p].w);
+		ax[p] = XMVectorAbs(nx[p]);
+		ay[p] = XMVectorAbs(ny[p]);
+		az[p] = XMVectorAbs(nz[p]);
+	}
+
+	size_t padded = visible.size();
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4((const XMFLOAT4 *)&centerX[i]);
+		XMVECTOR cy = XMLoadFloat4((const XMFLOAT4 *)&centerY[i]);
+		XMVECTOR cz = XMLoadFloat4((const XMFLOAT4 *)&centerZ[i]);
+		XMVECTOR ex = XMLoadFloat4((const XMFLOAT4 *)&extentX[i]);
+		XMVECTOR ey = XMLoadFloat4((const XMFLOAT4 *)&extentY[i]);
+		XMVECTOR ez = XMLoadFloat4((const XMFLOAT4 *)&extentZ[i]);
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(cx, nx[p], XMVectorMultiplyAdd(cy, ny[p], XMVectorMultiplyAdd(cz, nz[p], nd[p])));
+			XMVECTOR radius = XMVectorMultiplyAdd(ex, ax[p], XMVectorMultiplyAdd(ey, ay[p], XMVectorMultiply(ez, az[p])));
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		visible[i + 0] = (mask & 1) ? 0 : 1;
+		visible[i + 1] = (mask & 2) ? 0 : 1;
+		visible[i + 2] = (mask & 4) ? 0 : 1;
+		visible[i + 3] = (mask & 8) ? 0 : 1;
+	}
+}
+
+// --------------------------------------------------------
+// CullSSE() for several views.  The planes are splatted per
+// group of boxes, since there may be too many views to keep
+// them all in registers
+// --------------------------------------------------------
+void FrustumCuller::CullViewsSSE(const XMFLOAT4 * const * planeSets, int viewCount)
+{
+	size_t padded = viewMasks.size();
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4((const XMFLOAT4 *)&centerX[i]);
+		XMVECTOR cy = XMLoadFloat4((const XMFLOAT4 *)&centerY[i]);
+		XMVECTOR cz = XMLoadFloat4((const XMFLOAT4 *)&centerZ[i]);
+		XMVECTOR ex = XMLoadFloat4((const XMFLOAT4 *)&extentX[i]);
+		XMVECTOR ey = XMLoadFloat4((const XMFLOAT4 *)&extentY[i]);
+		XMVECTOR ez = XMLoadFloat4((const XMFLOAT4 *)&extentZ[i]);
+
+		for (int v = 0; v < viewCount; v++)
+		{
+			const XMFLOAT4 * planes = planeSets[v];
+			XMVECTOR outside = XMVectorFalseInt();
+			for (int p = 0; p < 6; p++)
+			{
+				XMVECTOR n = XMLoadFloat4(&planes[p]);
+				XMVECTOR nx = XMVectorSplatX(n);
+				XMVECTOR ny = XMVectorSplatY(n);
+				XMVECTOR nz = XMVectorSplatZ(n);
+				XMVECTOR distance = XMVectorMultiplyAdd(cx, nx, XMVectorMultiplyAdd(cy, ny, XMVectorMultiplyAdd(cz, nz, XMVectorSplatW(n))));
+				XMVECTOR radius = XMVectorMultiplyAdd(ex, XMVectorAbs(nx), XMVectorMultiplyAdd(ey, XMVectorAbs(ny), XMVectorMultiply(ez, XMVectorAbs(nz))));
+				outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+			}
+
+			int mask = _mm_movemask_ps(outside);
+			uint32_t bit = 1u << v;
+			viewMasks[i + 0] |= (mask & 1) ? 0 : bit;
+			viewMasks[i + 1] |= (mask & 2) ? 0 : bit;
+			viewMasks[i + 2] |= (mask & 4) ? 0 : bit;
+			viewMasks[i + 3] |= (mask & 8) ? 0 : bit;
+		}
+	}
+}
+
+#if defined(__AVX__)
+// --------------------------------------------------------
+// Same test as CullSSE(), eight boxes per iteration
+// --------------------------------------------------------
+void FrustumCuller::CullAVX(const XMFLOAT4 * planes)
+{
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 nx[6], ny[6], nz[6], nd[6];
+	__m256 ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++)
+	{
+		nx[p] = _mm256_set1_ps(planes[p].x);
+		ny[p] = _mm256_set1_ps(planes[p].y);
+		nz[p] = _mm256_set1_ps(planes[p].z);
+		nd[p] = _mm256_set1_ps(planes[p].w);
+		ax[p] = _mm256_andnot_ps(signBit, nx[p]);
+		ay[p] = _mm256_andnot_ps(signBit, ny[p]);
+		az[p] = _mm256_andnot_ps(signBit, nz[p]);
+	}
+
+	size_t padded = visible.size();
+	for (size_t i = 0; i < padded; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&centerY[i]);
+		__m256 cz = _mm256_loadu_ps(&centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&extentZ[i]);
+
+		__m256 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, nx[p]), _mm256_mul_ps(cy, ny[p])), _mm256_add_ps(_mm256_mul_ps(cz, nz[p]), nd[p]));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ax[p]), _mm256_mul_ps(ey, ay[p])), _mm256_mul_ps(ez, az[p]));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(outside);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			visible[i + lane] = ((mask >> lane) & 1) ? 0 : 1;
+		}
+	}
+}
+// --------------------------------------------------------
+// Same test as CullViewsSSE(), eight boxes per iteration
+// --------------------------------------------------------
+void FrustumCuller::CullViewsAVX(const XMFLOAT4 * const * planeSets, int viewCount)
+{
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t padded = viewMasks.size();
+	for (size_t i = 0; i < padded; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&centerY[i]);
+		__m256 cz = _mm256_loadu_ps(&centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&extentZ[i]);
+
+		for (int v = 0; v < viewCount; v++)
+		{
+			const XMFLOAT4 * planes = planeSets[v];
+			__m256 outside = zero;
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 nx = _mm256_broadcast_ss(&planes[p].x);
+				__m256 ny = _mm256_broadcast_ss(&planes[p].y);
+				__m256 nz = _mm256_broadcast_ss(&planes[p].z);
+				__m256 nd = _mm256_broadcast_ss(&planes[p].w);
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, nx), _mm256_mul_ps(cy, ny)), _mm256_add_ps(_mm256_mul_ps(cz, nz), nd));
+				__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_andnot_ps(signBit, nx)), _mm256_mul_ps(ey, _mm256_andnot_ps(signBit, ny))), _mm256_mul_ps(ez, _mm256_andnot_ps(signBit, nz)));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(outside);
+			uint32_t bit = 1u << v;
+			for (int lane = 0; lane < 8; lane++)
+			{
+				viewMasks[i + lane] |= ((mask >> lane) & 1) ? 0 : bit;
+			}
+		}
+	}
+}
+#endif
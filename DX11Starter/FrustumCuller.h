@@ -0,0 +1,68 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Tests batches of world space boxes against a view frustum.
+// Boxes are stored as separate arrays per component (center
+// x, center y, ... extent z) so each SIMD register holds the
+// same component of several boxes - 4 at a time with SSE, or
+// 8 at a time when built with AVX.
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	/// Removes all boxes, keeping allocated memory
+	void Clear();
+
+	/// Adds a box to be tested by the next Cull()
+	/// @param center: world space center of the box
+	/// @param extents: half size of the box on each axis
+	/// @return: index of the box, for IsVisible()
+	size_t AddBox(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+	/// Tests every box against the planes
+	/// @param planes: six normalized planes with inward facing
+	/// normals, like the ones from Camera::GetFrustumPlanes()
+	/// @return: the number of visible boxes
+	size_t Cull(const DirectX::XMFLOAT4 * planes);
+
+	/// Tests every box against several frustums at once, loading
+	/// each group of boxes only once for all of them
+	/// @param planeSets: six planes per view, as for Cull()
+	/// @param viewCount: number of views, at most 32
+	void CullViews(const DirectX::XMFLOAT4 * const * planeSets, int viewCount);
+
+	/// Whether a box touched the frustum in the last Cull()
+	bool IsVisible(size_t index) { return visible[index] != 0; }
+
+	/// Which views (one bit each) a box touched in the last CullViews()
+	uint32_t GetViewMask(size_t index) { return viewMasks[index]; }
+	size_t GetCount() { return count; }
+
+private:
+	size_t count;
+
+	// One array per component, padded to a multiple of 8
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+	std::vector<uint8_t> visible;
+	std::vector<uint32_t> viewMasks;
+
+	void Pad();
+	void Trim();
+	void CullSSE(const DirectX::XMFLOAT4 * planes);
+	void CullViewsSSE(const DirectX::XMFLOAT4 * const * planeSets, int viewCount);
+#if defined(__AVX__)
+	void CullAVX(const DirectX::XMFLOAT4 * planes);
+	void CullViewsAVX(const DirectX::XMFLOAT4 * const * planeSets, int viewCount);
+#endif
+};
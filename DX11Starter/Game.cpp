@@ -1,5 +1,6 @@
 #include "Game.h"
 #include "Vertex.h"
+#include <algorithm>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -7,6 +8,31 @@ using namespace DirectX;
 // For managing entities
 using std::vector;
 
+// Size of the instance buffer.  Longer runs of the same mesh
+// and material are split into several instanced draws
+static const unsigned int MAX_INSTANCES_PER_DRAW = 4096;
+
+// Size of the ring constant data is uploaded into.  Each
+// upload takes at least 256 bytes, so this is room for a few
+// frames of a few thousand separate draws
+static const unsigned int CONSTANT_RING_SIZE = 4 * 1024 * 1024;
+
+// Frames a static entity has to hold still before it's drawn
+// from a buffer of its own, and frames it can go undrawn before
+// that buffer is freed
+static const unsigned int OBJECT_BUFFER_SETTLE_FRAMES = 4;
+static const unsigned int OBJECT_BUFFER_UNUSED_FRAMES = 120;
+
+// Where shaders keep what reflecting them found, so later
+// runs can skip it.  Stale files are simply never matched
+static const char * SHADER_CACHE_FOLDER = "ShaderCache";
+
+// Optional features of PixelShader.hlsl, in key bit order
+static const char * PIXEL_SHADER_DEFINES[] = { "TEXTURED", "SECOND_LIGHT" };
+static const ShaderVariantKey PIXEL_TEXTURED = 1 << 0;
+static const ShaderVariantKey PIXEL_SECOND_LIGHT = 1 << 1;
+static const ShaderVariantKey PIXEL_ALL_FEATURES = PIXEL_TEXTURED | PIXEL_SECOND_LIGHT;
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -27,7 +53,26 @@ Game::Game(HINSTANCE hInstance)
 	vertexBuffer = 0;
 	indexBuffer = 0;
 	vertexShader = 0;
+	instancedVertexShader = 0;
+	instanceBuffer = 0;
+	pixelVariants = 0;
 	pixelShader = 0;
+	inputLayoutCache = 0;
+	shaderLibrary = 0;
+	entityCommands = new EntityCommandBuffer(&entities);
+	staticProps = 0;
+	occlusionCuller = new OcclusionCuller(
+		256,	// Depth buffer width
+		128,	// Depth buffer height
+		2);		// Rasterizer threads
+	occlusionReportTime = 0.0f;
+	pvs = new PotentiallyVisibleSet();
+	stateCache = 0;
+	constantRing = 0;
+	objectBuffers = 0;
+	vertexFrameConstants = 0;
+	instancedFrameConstants = 0;
+	stateReportTime = 0.0f;
 
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -51,8 +96,10 @@ Game::~Game()
 
 	// Delete our simple shader objects, which
 	// will clean up their own internal DirectX stuff
-	delete vertexShader;
-	delete pixelShader;
+	delete shaderLibrary;
+	delete pixelVariants;
+	delete inputLayoutCache;
+	delete instanceBuffer;
 
 	// Free meshes
 	delete triangle;
@@ -66,12 +113,17 @@ Game::~Game()
 	delete torus;
 
 	// Free entities
-	vector<Entity*>::iterator end = entities.end();
-	for (vector<Entity*>::iterator i = entities.begin(); i != end; i++)
-	{
-		delete(*i);
-	}
-	entities.clear();
+	delete entityCommands;
+	entities.Clear();
+	delete staticProps;
+
+	// Free culling
+	delete occlusionCuller;
+	delete pvs;
+
+	delete stateCache;
+	delete constantRing;
+	delete objectBuffers;
 
 	// Free camera
 	delete camera;
@@ -79,6 +131,8 @@ Game::~Game()
 	// Free material
 	delete woodMaterial;
 	delete stoneMaterial;
+	delete woodLevelMaterial;
+	delete stoneLevelMaterial;
 }
 
 // --------------------------------------------------------
@@ -90,6 +144,19 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	stateCache = new StateCache(context);
+
+	// Upload constants into one shared ring where the device can
+	// bind parts of it, or else map each buffer with a discard
+	constantRing = new ConstantBufferRing(device, context, CONSTANT_RING_SIZE);
+	if (!constantRing->IsAvailable() || !stateCache->SupportsBufferRanges())
+	{
+		delete constantRing;
+		constantRing = 0;
+	}
+
+	objectBuffers = new ObjectBufferCache(device, OBJECT_BUFFER_SETTLE_FRAMES, OBJECT_BUFFER_UNUSED_FRAMES);
+
 	LoadShaders();
 	CreateMatrices();
 	CreateBasicGeometry();
@@ -109,29 +176,73 @@ void Game::Init()
 	CreateWICTextureFromFile(device, context, L"../../DX11Starter/Assets/Textures/MossyBricks.jpg", 0, &shaderResourceView2);
 
 	// Create material
-	woodMaterial = new Material(pixelShader, vertexShader, shaderResourceView1, samplerState);
-	stoneMaterial = new Material(pixelShader, vertexShader, shaderResourceView2, samplerState);
+	// Draw with the instanced vertex shader when it loaded properly,
+	// so the static props sharing a mesh and material batch together
+	SimpleVertexShader * materialVertexShader = vertexShader;
+	if (instancedVertexShader->IsShaderValid() && instancedVertexShader->GetPerInstanceCompatible())
+		materialVertexShader = instancedVertexShader;
+
+	woodMaterial = new Material(GetPixelShader(shaderResourceView1), materialVertexShader, shaderResourceView1, samplerState);
+	stoneMaterial = new Material(GetPixelShader(shaderResourceView2), materialVertexShader, shaderResourceView2, samplerState);
+
+	// The level's entities each have a mesh of their own, so
+	// instancing gains them nothing.  The plain vertex shader
+	// lets them draw from persistent buffers once they've
+	// settled instead, uploading nothing (see ObjectBufferCache)
+	woodLevelMaterial = new Material(GetPixelShader(shaderResourceView1), vertexShader, shaderResourceView1, samplerState);
+	stoneLevelMaterial = new Material(GetPixelShader(shaderResourceView2), vertexShader, shaderResourceView2, samplerState);
 
 	// Create game entities
-	entities.push_back(new Entity(cone, woodMaterial, worldMatrix, XMFLOAT3(), XMFLOAT3(), XMFLOAT3()));
-	entities[0]->Move(1.0f, 1.0f, 0, 0, 0, 0);
-
-	entities.push_back(new Entity(cube, woodMaterial, worldMatrix, XMFLOAT3(), XMFLOAT3(), XMFLOAT3()));
-	entities[1]->Move(-1.0f, -1.0f, 0, 0, 2.345f, 0);
+	EntityHandle coneEntity = entityCommands->Create(cone, woodLevelMaterial);
+	EntityHandle cubeEntity = entityCommands->Create(cube, woodLevelMaterial);
+	EntityHandle cylinderEntity = entityCommands->Create(cylinder, woodLevelMaterial);
+	EntityHandle torusEntity = entityCommands->Create(torus, woodLevelMaterial);
+	EntityHandle sphereEntity = entityCommands->Create(sphere, stoneLevelMaterial);
+
+	// Nothing is iterating entities yet, so apply the creates now
+	entityCommands->Playback();
+
+	entities.Get(coneEntity)->Move(1.0f, 1.0f, 0, 0, 0, 0);
+	entities.Get(cubeEntity)->Move(-1.0f, -1.0f, 0, 0, 2.345f, 0);
+	entities.Get(cylinderEntity)->Move(-1.0f, -1.0f, 0, 0, 0, 0);
+	entities.Get(torusEntity)->Move(-1.0f, 1.0f, 0, 0, 0, 0);
+
+	// The cube is solid enough to hide things behind it
+	entities.Get(cubeEntity)->SetOccluder(true);
+
+	// None of the starting entities move, so bake which of them
+	// can be seen from where.  Baked data knows them by static
+	// id, which has to be the same every run, so they're simply
+	// numbered in the order the level creates them.  A real level
+	// would bake this offline and LoadFromFile() it instead
+	EntityHandle levelEntities[] = { coneEntity, cubeEntity, cylinderEntity, torusEntity, sphereEntity };
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		entities.Get(levelEntities[i])->SetStaticId(i);
+	}
+	pvs->Bake(&entities, XMFLOAT3(-10.0f, -5.0f, -15.0f), XMFLOAT3(10.0f, 5.0f, 5.0f), 5.0f);
 
-	entities.push_back(new Entity(cylinder, woodMaterial, worldMatrix, XMFLOAT3(), XMFLOAT3(), XMFLOAT3()));
-	entities[2]->Move(-1.0f, -1.0f, 0, 0, 0, 0);
+	// Screen heights (in pixels) entities drop a level of detail
+	// at, the last being where they stop being drawn at all.  A
+	// 10% margin stops entities flickering between two levels
+	const float lodThresholds[] = { 240.0f, 120.0f, 60.0f, 4.0f };
+	lodSelector.SetThresholds(lodThresholds, 4, 0.1f);
 
-	entities.push_back(new Entity(torus, woodMaterial, worldMatrix, XMFLOAT3(), XMFLOAT3(), XMFLOAT3()));
-	entities[3]->Move(-1.0f, 1.0f, 0, 0, 0, 0);
+	// The torus is the densest mesh, so let it fall back to the
+	// much cheaper hexlis when far away
+	Mesh * farMesh = hexlis;
+	entities.Get(torusEntity)->SetLODMeshes(&farMesh, 1);
 
-	entities.push_back(new Entity(sphere, stoneMaterial, worldMatrix, XMFLOAT3(), XMFLOAT3(), XMFLOAT3()));
+	// Scenery that never moves
+	CreateStaticProps();
 
 	// Create camera
 	camera = new Camera(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1), viewMatrix);
 
 	// Set up initial projection matrix
 	camera->UpdateProjectionMatrix((float)width, (float)height);
+	previousCameraPosition = camera->GetPosition();
+	previousCameraRotation = camera->GetRotation();
 
 	// initialize mouse movement
 	prevMousePos.x = width / 2;
@@ -149,7 +260,7 @@ void Game::Init()
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
 // --------------------------------------------------------
@@ -160,11 +271,78 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = new SimpleVertexShader(device, context);
-	vertexShader->LoadShaderFile(L"VertexShader.cso");
+	// Fails harmlessly if it's already there
+	CreateDirectoryA(SHADER_CACHE_FOLDER, 0);
+
+	// Vertex shaders with the same inputs share one layout
+	inputLayoutCache = new InputLayoutCache(device);
+
+	// The compiled shaders load in the background while the
+	// pixel variants below are set up on this thread
+	shaderLibrary = new ShaderLibrary(device, context);
+	shaderLibrary->SetStateCache(stateCache);
+	shaderLibrary->SetConstantBufferRing(constantRing);
+	shaderLibrary->SetReflectionCacheFolder(SHADER_CACHE_FOLDER);
+	shaderLibrary->SetInputLayoutCache(inputLayoutCache);
+	ShaderHandle vertexHandle = shaderLibrary->Add(SHADER_STAGE_VERTEX, L"VertexShader.cso");
+	ShaderHandle instancedHandle = shaderLibrary->Add(SHADER_STAGE_VERTEX, L"VertexShaderInstanced.cso");
+	shaderLibrary->StartLoading();
+
+	instanceBuffer = new InstanceBuffer(device, MAX_INSTANCES_PER_DRAW);
+
+	// Pixel shader variants are compiled from source as they're
+	// needed, apart from the all-features one the project builds
+	pixelVariants = new ShaderVariants<SimplePixelShader>(
+		device, context, L"../../DX11Starter/PixelShader.hlsl", "ps_5_0",
+		PIXEL_SHADER_DEFINES, sizeof(PIXEL_SHADER_DEFINES) / sizeof(PIXEL_SHADER_DEFINES[0]));
+	pixelVariants->SetStateCache(stateCache);
+	pixelVariants->SetConstantBufferRing(constantRing);
+	pixelVariants->SetReflectionCacheFolder(SHADER_CACHE_FOLDER);
+	pixelVariants->SetPrecompiled(PIXEL_ALL_FEATURES, L"PixelShader.cso");
+
+	// Everything the starting materials can pick, so nothing
+	// has to compile in the middle of a frame
+	const ShaderVariantKey pixelKeys[] = { PIXEL_ALL_FEATURES, PIXEL_SECOND_LIGHT };
+	pixelVariants->Prewarm(pixelKeys, 2);
+	pixelShader = pixelVariants->Get(PIXEL_ALL_FEATURES);
+
+	vertexShader = shaderLibrary->GetVertexShader(vertexHandle);
+	instancedVertexShader = shaderLibrary->GetVertexShader(instancedHandle);
+
+	// Per-frame data is set as whole structs.  A struct that doesn't
+	// match its shader leaves a null handle, and an explanation on
+	// the debug console
+	vertexFrameConstants = vertexShader->BindBufferStruct<VertexPerFrameConstants>(CBUFFER_PER_FRAME);
+	instancedFrameConstants = instancedVertexShader->BindBufferStruct<VertexPerFrameConstants>(CBUFFER_PER_FRAME);
+	BindPixelFrameConstants();
+}
 
-	pixelShader = new SimplePixelShader(device, context);
-	pixelShader->LoadShaderFile(L"PixelShader.cso");
+// --------------------------------------------------------
+// Binds the per-frame struct on any pixel shader variants
+// created since last time
+// --------------------------------------------------------
+void Game::BindPixelFrameConstants()
+{
+	for (unsigned int i = (unsigned int)pixelFrameConstants.size(); i < pixelVariants->GetVariantCount(); i++)
+	{
+		ISimpleShader * variant = pixelVariants->GetVariantByIndex(i);
+		pixelFrameConstants.push_back(variant->BindBufferStruct<PixelPerFrameConstants>(CBUFFER_PER_FRAME));
+	}
+}
+
+// --------------------------------------------------------
+// Picks the pixel shader variant for a material, leaving
+// out texturing when it has no texture
+// --------------------------------------------------------
+SimplePixelShader * Game::GetPixelShader(ID3D11ShaderResourceView * texture)
+{
+	ShaderVariantKey key = PIXEL_SECOND_LIGHT;
+	if (texture)
+		key |= PIXEL_TEXTURED;
+
+	// Fall back on the precompiled shader if this one won't build
+	SimplePixelShader * shader = pixelVariants->Get(key);
+	return shader ? shader : pixelShader;
 }
 
 
@@ -268,6 +446,41 @@ void Game::CreateBasicGeometry()
 }
 
 
+// --------------------------------------------------------
+// Scatters static props around the scene.  These are stored
+// packed (16 bytes each) rather than as full entities
+// --------------------------------------------------------
+void Game::CreateStaticProps()
+{
+	staticProps = new StaticInstanceBuffer(
+		64.0f,		// Cell size - positions are exact to ~1mm at this size
+		0.01f,		// Smallest scale
+		100.0f);	// Largest scale
+
+	uint8_t woodCubes = staticProps->AddGroup(cube, woodMaterial);
+	uint8_t stoneSpheres = staticProps->AddGroup(sphere, stoneMaterial);
+
+	// A ring of alternating cubes and spheres behind the entities
+	const int propCount = 32;
+	for (int i = 0; i < propCount; i++)
+	{
+		float angle = XM_2PI * i / propCount;
+		XMFLOAT3 position(cosf(angle) * 8.0f, -2.0f, 10.0f + sinf(angle) * 8.0f);
+
+		XMFLOAT4 rotation;
+		XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0, angle, 0));
+
+		staticProps->Add(position, rotation, 0.5f, (i % 2) ? stoneSpheres : woodCubes);
+	}
+
+	// Decode props in spatial order
+	staticProps->SortSpatially();
+
+	// Scratch space for decoding props in batches
+	staticPropMatrices.resize(256);
+}
+
+
 // --------------------------------------------------------
 // Handle resizing DirectX "stuff" to match the new window size.
 // For instance, updating our projection matrix's aspect ratio.
@@ -293,14 +506,185 @@ void Game::Update(float deltaTime, float totalTime)
 	//entities[3]->Move(-0.00005f, -0.00005f, 0, 0, 0, 0);
 	//entities[4]->Move(0.00005f, 0.00005f, 0, 0, 0, 0.5f * totalTime);
 
+	// Remember where everything was at the end of the last
+	// tick, so Draw can interpolate towards this tick
+	previousCameraPosition = camera->GetPosition();
+	previousCameraRotation = camera->GetRotation();
+	size_t count = entities.Size();
+	for (size_t i = 0; i < count; i++)
+	{
+		entities[i]->StorePreviousWorldMatrix();
+	}
+
 	// Update camera
 	camera->Update(deltaTime);
 
+	// Sync point - apply any entity creates, destroys and
+	// changes recorded this frame before anything draws
+	entityCommands->Playback();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report how well occlusion culling is doing once a second
+	occlusionReportTime += deltaTime;
+	if (occlusionReportTime >= 1.0f)
+	{
+		const OcclusionStats & stats = occlusionCuller->GetStats();
+		printf("\nOcclusion: %.1f%% of %u culled, %u occluder triangles, %.3fms rasterizing, %.3fms testing",
+			stats.GetCulledPercent(),
+			stats.OccludeesTested,
+			stats.OccluderTriangles,
+			stats.RasterizeMs,
+			stats.TestMs);
+		occlusionReportTime = 0.0f;
+	}
+#endif
+
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 }
 
+// --------------------------------------------------------
+// Culls and snapshots the results of the frame's last tick.
+// Runs once per frame however many ticks there were, since
+// only the last tick's state is ever drawn
+// --------------------------------------------------------
+void Game::PrepareFrame()
+{
+	// Snapshot everything Draw needs, so drawing never
+	// touches entities or the camera directly
+	RenderFrame & frame = renderState.BeginWrite();
+	frame.ViewMatrix = camera->GetViewMatrix();
+	frame.ProjectionMatrix = camera->GetProjectionMatrix();
+	frame.CameraPosition = camera->GetPosition();
+	frame.CameraRotation = camera->GetRotation();
+	frame.PreviousCameraPosition = previousCameraPosition;
+	frame.PreviousCameraRotation = previousCameraRotation;
+
+	// Draw shows the camera anywhere between the previous tick and
+	// this one, so cull against both views - an entity either view
+	// can see is kept.  Blending between them can't see anything
+	// neither end sees unless the camera turns a long way in a tick
+	XMFLOAT4X4 previousView = Camera::BuildViewMatrix(previousCameraPosition, previousCameraRotation);
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&previousView));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&frame.ProjectionMatrix));
+	XMFLOAT4X4 previousViewProjection;
+	XMStoreFloat4x4(&previousViewProjection, XMMatrixTranspose(view * projection));
+
+	XMFLOAT4 previousPlanes[6];
+	Camera::ExtractFrustumPlanes(previousViewProjection, previousPlanes);
+
+	bool cameraMoved =
+		memcmp(&previousCameraPosition, &frame.CameraPosition, sizeof(XMFLOAT3)) != 0 ||
+		memcmp(&previousCameraRotation, &frame.CameraRotation, sizeof(XMFLOAT4)) != 0;
+	const XMFLOAT4 * planeSets[2] = { camera->GetFrustumPlanes(), previousPlanes };
+	int viewCount = cameraMoved ? 2 : 1;
+
+	// Walk the entity tree against the frustums.  Whole subtrees
+	// are accepted or rejected at once, and only entities whose
+	// (fattened) tree box crosses a plane in every view that sees
+	// it are tested again, using their tight bounds
+	cullResults.clear();
+	entities.GetTree()->QueryFrustums(planeSets, viewCount, cullResults);
+
+	// Drop static entities the baked visibility says can't be
+	// seen from the camera's cell - just a bit test each.  An
+	// entity that has moved since baking has lost its static id,
+	// so it's never dropped
+	pvs->SetViewPosition(camera->GetPosition());
+	visibleEntities.clear();
+	visibleViewMasks.clear();
+	partlyVisibleEntities.clear();
+	for (size_t i = 0; i < cullResults.size(); i++)
+	{
+		const MultiViewResult & result = cullResults[i];
+		if (!pvs->IsVisible(entities.Get(result.UserData)->GetStaticId()))
+			continue;
+
+		if (result.InsideMask)
+		{
+			visibleEntities.push_back(result.UserData);
+			visibleViewMasks.push_back(result.InsideMask | result.IntersectMask);
+		}
+		else
+			partlyVisibleEntities.push_back(result.UserData);
+	}
+
+	culler.Clear();
+	for (size_t i = 0; i < partlyVisibleEntities.size(); i++)
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+		entities.Get(partlyVisibleEntities[i])->GetWorldBounds(center, extents);
+		culler.AddBox(center, extents);
+	}
+	culler.CullViews(planeSets, viewCount);
+
+	for (size_t i = 0; i < partlyVisibleEntities.size(); i++)
+	{
+		if (culler.GetViewMask(i))
+		{
+			visibleEntities.push_back(partlyVisibleEntities[i]);
+			visibleViewMasks.push_back(culler.GetViewMask(i));
+		}
+	}
+
+	// Rasterize the visible occluders on the CPU, so anything
+	// they completely hide can be skipped too.  The depth buffer
+	// is from this tick's view, so it only judges entities that
+	// view can see - ones only the previous view sees are kept
+	size_t count = visibleEntities.size();
+	occlusionCuller->BeginFrame(camera->GetViewProjectionMatrix());
+	for (size_t i = 0; i < count; i++)
+	{
+		Entity * entity = entities.Get(visibleEntities[i]);
+		if (entity->GetOccluder())
+			occlusionCuller->AddOccluder(entity->GetMesh(), entity->GetWorldMatrix());
+	}
+	occlusionCuller->RasterizeOccluders();
+
+	// Keep what survives occlusion and measure how big each of
+	// those entities is on screen
+	lodSelector.SetView(camera->GetPosition(), camera->GetProjectionMatrix(), (float)height);
+	lodSelector.Clear();
+	size_t survivors = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		Entity * entity = entities.Get(visibleEntities[i]);
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+		entity->GetWorldBounds(center, extents);
+		bool inCurrentView = (visibleViewMasks[i] & 1) != 0;
+		if (!entity->GetOccluder() && inCurrentView && !occlusionCuller->IsVisible(center, extents))
+			continue;
+
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&extents)));
+		lodSelector.Add(center, radius, entity->GetLOD());
+		visibleEntities[survivors++] = visibleEntities[i];
+	}
+	visibleEntities.resize(survivors);
+	lodSelector.Select();
+
+	for (size_t i = 0; i < survivors; i++)
+	{
+		Entity * entity = entities.Get(visibleEntities[i]);
+		int lod = lodSelector.GetLOD(i);
+		entity->SetLOD(lod);
+		if (lod == LOD_CULLED)
+			continue;
+
+		RenderItem item;
+		item.World = entity->GetWorldMatrix();
+		item.PreviousWorld = entity->GetPreviousWorldMatrix();
+		item.ItemMesh = entity->GetMeshForLOD(lod);
+		item.ItemMaterial = entity->GetMaterial();
+		item.Visible = entity->GetVisible();
+		item.ObjectId = entity->GetStatic() ? visibleEntities[i] : NO_OBJECT_ID;
+		frame.Items.push_back(item);
+	}
+	renderState.EndWrite();
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -318,18 +702,169 @@ void Game::Draw(float deltaTime, float totalTime)
 		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
 		1.0f,
 		0);
+	stateCache->ResetStats();
+	vertexShader->ResetUploadStats();
+	instancedVertexShader->ResetUploadStats();
+	for (unsigned int i = 0; i < pixelVariants->GetVariantCount(); i++)
+	{
+		pixelVariants->GetVariantByIndex(i)->ResetUploadStats();
+	}
+	if (constantRing)
+		constantRing->BeginFrame();
+	objectBuffers->BeginFrame();
+
+	// Draw the most recently published frame, placed between
+	// its last two simulation ticks
+	const RenderFrame & frame = renderState.BeginRead();
+	XMFLOAT4X4 view = RenderStateBuffer::InterpolateView(frame, interpolationAlpha);
+	SetFrameConstants(view, frame.ProjectionMatrix);
+
+	// Turn the items into sort keys.  This is a few nanoseconds
+	// an item, so it stays on this thread - starting threads for
+	// it every frame would cost more than it saves
+	renderQueue.Begin(1);
+	QueueRenderItems(frame);
+	renderQueue.Sort();
+
+	// Walk the sorted draws, only rebinding what actually changed.
+	// Sorting puts draws with the same mesh and material next to
+	// each other, so with an instancing shader each such run is
+	// drawn in one call
+	Material * boundMaterial = 0;
+	Mesh * boundMesh = 0;
+	size_t packetCount = renderQueue.GetCount();
+	for (size_t i = 0; i < packetCount; )
+	{
+		const RenderItem & item = frame.Items[renderQueue.GetPacket(i).Item];
+
+		if (item.ItemMaterial != boundMaterial)
+		{
+			item.BindMaterial();
+			boundMaterial = item.ItemMaterial;
+		}
+
+		if (item.ItemMesh != boundMesh)
+		{
+			item.BindMesh(stateCache);
+			boundMesh = item.ItemMesh;
+		}
+
+		if (item.ItemMaterial->GetVertexShader()->GetPerInstanceCompatible())
+		{
+			instanceMatrices.clear();
+			size_t runEnd = i;
+			for (; runEnd < packetCount; runEnd++)
+			{
+				const RenderItem & instance = frame.Items[renderQueue.GetPacket(runEnd).Item];
+				if (instance.ItemMaterial != item.ItemMaterial || instance.ItemMesh != item.ItemMesh)
+					break;
+
+				instanceMatrices.push_back(RenderStateBuffer::InterpolateMatrix(instance.PreviousWorld, instance.World, interpolationAlpha));
+			}
+
+			DrawInstances(item, instanceMatrices.data(), instanceMatrices.size());
+			i = runEnd;
+			continue;
+		}
+
+		// Static entities that have settled draw from a buffer of
+		// their own.  Anything moving uploads its matrix as usual
+		XMFLOAT4X4 world = RenderStateBuffer::InterpolateMatrix(item.PreviousWorld, item.World, interpolationAlpha);
+		ID3D11Buffer * objectBuffer = 0;
+		if (item.ObjectId != NO_OBJECT_ID && item.ItemMaterial->GetObjectBufferHandle())
+			objectBuffer = objectBuffers->GetBuffer(item.ObjectId, world, stateCache);
+		if (!objectBuffer || !item.BindObjectBuffer(objectBuffer))
+			item.SetWorldMatrix(world);
+		item.Submit(context);
+		i++;
+	}
 
-	size_t end = entities.size();
-	for (int i = 0; i < end; i++) 
+	// Static props never change after Init, so Draw reads them
+	// directly instead of through the render state.  World
+	// matrices are rebuilt a batch at a time and sorted into
+	// their groups, then each group is drawn together
+	size_t groupCount = staticProps->GetGroupCount();
+	staticPropGroupMatrices.resize(groupCount);
+	for (size_t group = 0; group < groupCount; group++)
 	{
-		pixelShader->SetData("light1", &light, sizeof(DirectionalLight));
-		pixelShader->SetData("light2", &light2, sizeof(DirectionalLight));
+		staticPropGroupMatrices[group].clear();
+	}
 
-		entities[i]->PrepareMaterial(camera->GetViewMatrix(), camera->GetProjectionMatrix());
+	size_t propCount = staticProps->GetCount();
+	for (size_t first = 0; first < propCount; first += staticPropMatrices.size())
+	{
+		size_t batch = propCount - first;
+		if (batch > staticPropMatrices.size())
+			batch = staticPropMatrices.size();
+
+		staticProps->Decode(first, batch, &staticPropMatrices[0]);
+
+		for (size_t i = 0; i < batch; i++)
+		{
+			uint8_t group = staticProps->GetInstance(first + i).Group;
+			staticPropGroupMatrices[group].push_back(staticPropMatrices[i]);
+		}
+	}
 
-		entities[i]->Draw(context);
+	for (size_t group = 0; group < groupCount; group++)
+	{
+		const std::vector<XMFLOAT4X4> & matrices = staticPropGroupMatrices[group];
+		if (matrices.empty())
+			continue;
+
+		RenderItem item;
+		item.ItemMesh = staticProps->GetGroupMesh((uint8_t)group);
+		item.ItemMaterial = staticProps->GetGroupMaterial((uint8_t)group);
+
+		item.BindMaterial();
+		item.BindMesh(stateCache);
+
+		if (item.ItemMaterial->GetVertexShader()->GetPerInstanceCompatible())
+		{
+			DrawInstances(item, matrices.data(), matrices.size());
+			continue;
+		}
+
+		for (size_t i = 0; i < matrices.size(); i++)
+		{
+			item.SetWorldMatrix(matrices[i]);
+			item.Submit(context);
+		}
 	}
 
+	renderState.EndRead();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report how many binds the state cache saved, and how much
+	// constant data was sent, once a second
+	stateReportTime += deltaTime;
+	if (stateReportTime >= 1.0f)
+	{
+		const StateCacheStats & stats = stateCache->GetStats();
+		printf("\nState cache: %u binds issued, %u avoided, %u bytes uploaded in %u updates this frame",
+			stats.Issued, stats.Avoided, stats.BytesUploaded, stats.Uploads);
+
+		// Constant data left alone because it hadn't changed
+		unsigned int skipped = 0;
+		ISimpleShader * shaders[] = { vertexShader, instancedVertexShader };
+		for (int i = 0; i < 2; i++)
+		{
+			skipped += shaders[i]->GetUploadStats().BytesSkipped;
+		}
+		for (unsigned int i = 0; i < pixelVariants->GetVariantCount(); i++)
+		{
+			skipped += pixelVariants->GetVariantByIndex(i)->GetUploadStats().BytesSkipped;
+		}
+		printf(", %u bytes skipped", skipped);
+		printf(", %u static entities drawn from their own buffers", objectBuffers->GetBufferCount());
+		stateReportTime = 0.0f;
+	}
+#endif
+
+	// Everything this frame uploaded is fenced off until the GPU is done
+	if (constantRing)
+		constantRing->EndFrame();
+
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
 	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
@@ -337,6 +872,103 @@ void Game::Draw(float deltaTime, float totalTime)
 }
 
 
+// --------------------------------------------------------
+// Sends the data that's the same for every draw this frame -
+// the camera and the lights - once, instead of with each
+// object or material
+// --------------------------------------------------------
+void Game::SetFrameConstants(const XMFLOAT4X4 & view, const XMFLOAT4X4 & projection)
+{
+	VertexPerFrameConstants vertexConstants;
+	vertexConstants.View = view;
+	vertexConstants.Projection = projection;
+
+	vertexShader->SetBufferStruct(vertexFrameConstants, vertexConstants);
+	vertexShader->CopyBufferData(CBUFFER_PER_FRAME);
+	instancedVertexShader->SetBufferStruct(instancedFrameConstants, vertexConstants);
+	instancedVertexShader->CopyBufferData(CBUFFER_PER_FRAME);
+
+	PixelPerFrameConstants pixelConstants = {};
+	pixelConstants.Light1 = light;
+	pixelConstants.Light2 = light2;
+
+	BindPixelFrameConstants();
+	for (unsigned int i = 0; i < pixelVariants->GetVariantCount(); i++)
+	{
+		ISimpleShader * variant = pixelVariants->GetVariantByIndex(i);
+		variant->SetBufferStruct(pixelFrameConstants[i], pixelConstants);
+		variant->CopyBufferData(CBUFFER_PER_FRAME);
+	}
+}
+
+// --------------------------------------------------------
+// Builds sort keys for the frame's visible items
+// --------------------------------------------------------
+void Game::QueueRenderItems(const RenderFrame & frame)
+{
+	const XMFLOAT4X4 & view = frame.ViewMatrix;
+	for (size_t i = 0; i < frame.Items.size(); i++)
+	{
+		const RenderItem & item = frame.Items[i];
+		if (!item.Visible)
+			continue;
+
+		// View space depth of the item's origin.  Both matrices are
+		// transposed, so the translation is the last column and the
+		// view's z axis is its third row
+		const XMFLOAT4X4 & world = item.World;
+		float depth = view._31 * world._14 + view._32 * world._24 + view._33 * world._34 + view._34;
+
+		RenderPass pass = item.ItemMaterial->GetTransparent() ? RENDER_PASS_TRANSPARENT : RENDER_PASS_OPAQUE;
+		uint64_t key = RenderQueue::MakeKey(
+			pass,
+			item.ItemMaterial->GetShaderId(),
+			item.ItemMaterial->GetId(),
+			item.ItemMesh->GetId(),
+			depth);
+		renderQueue.Add(0, key, (uint32_t)i);
+	}
+}
+
+// --------------------------------------------------------
+// Uploads the world matrices to the instance buffer and draws
+// them, splitting runs longer than the buffer holds
+// --------------------------------------------------------
+void Game::DrawInstances(const RenderItem & item, const XMFLOAT4X4 * worldMatrices, size_t count)
+{
+	instanceBuffer->Bind(stateCache);
+
+	unsigned int capacity = instanceBuffer->GetCapacity();
+	for (size_t first = 0; first < count && capacity > 0; first += capacity)
+	{
+		unsigned int batch = (unsigned int)(count - first < capacity ? count - first : capacity);
+		unsigned int startInstance = instanceBuffer->Append(worldMatrices + first, batch, stateCache);
+
+		// Drawing without the matrices would use whatever the
+		// buffer held before, so skip the batch instead
+		if (startInstance == INSTANCE_APPEND_FAILED)
+			continue;
+		item.SubmitInstanced(context, batch, startInstance);
+	}
+}
+
+// --------------------------------------------------------
+// Called once both Update and Draw are done with the frame -
+// publish what Update wrote so the next Draw can read it
+// --------------------------------------------------------
+void Game::SyncFrame()
+{
+	// Both sides are finished here, so a refused swap means the
+	// frame loop is calling this from the wrong place
+	bool swapped = renderState.Swap();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (!swapped)
+		printf("\nRender state swap refused: a frame is still in use");
+#endif
+}
+
+
 #pragma region Mouse Input
 
 // --------------------------------------------------------
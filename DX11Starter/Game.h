@@ -2,12 +2,27 @@
 
 #include "DXCore.h"
 #include "SimpleShader.h"
+#include "ShaderVariants.h"
+#include "ShaderLibrary.h"
 #include "Mesh.h"
 #include "Entity.h"
+#include "EntityPool.h"
+#include "EntityCommandBuffer.h"
 #include "Camera.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "PotentiallyVisibleSet.h"
+#include "LODSelector.h"
+#include "RenderState.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
+#include "ObjectBufferCache.h"
+#include "StaticInstanceBuffer.h"
 #include "Lights.h"
+#include "ShaderConstants.h"
 #include "WICTextureLoader.h"
 #include <DirectXMath.h>
+#include <vector>
 
 class Game 
 	: public DXCore
@@ -22,7 +37,9 @@ public:
 	void Init();
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
+	void PrepareFrame();
 	void Draw(float deltaTime, float totalTime);
+	void SyncFrame();
 
 	// Overridden mouse input helper methods
 	void OnMouseDown (WPARAM buttonState, int x, int y);
@@ -35,6 +52,31 @@ private:
 	void LoadShaders(); 
 	void CreateMatrices();
 	void CreateBasicGeometry();
+	void CreateStaticProps();
+
+	/// Adds sort keys for a frame's visible items to the render queue
+	/// @param frame: the frame being drawn
+	void QueueRenderItems(const RenderFrame & frame);
+
+	/// Draws copies of an item's mesh with one DrawIndexedInstanced
+	/// per instance buffer's worth.  The item's material and mesh
+	/// must already be bound
+	/// @param item: item whose mesh and material to draw with
+	/// @param worldMatrices: transposed world matrix of each copy
+	/// @param count: number of copies
+	void DrawInstances(const RenderItem & item, const DirectX::XMFLOAT4X4 * worldMatrices, size_t count);
+
+	/// Uploads the per-frame constant buffers of the shared shaders
+	/// @param view: the camera's view matrix
+	/// @param projection: the camera's projection matrix
+	void SetFrameConstants(const DirectX::XMFLOAT4X4 & view, const DirectX::XMFLOAT4X4 & projection);
+
+	/// Binds the per-frame struct on pixel shader variants new since last time
+	void BindPixelFrameConstants();
+
+	/// Pixel shader variant for a material, with only the features it uses
+	/// @param texture: the material's texture, or null for an untextured one
+	SimplePixelShader * GetPixelShader(ID3D11ShaderResourceView * texture);
 
 	// Buffers to hold actual geometry data
 	ID3D11Buffer* vertexBuffer;
@@ -42,8 +84,25 @@ private:
 
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
+	InputLayoutCache* inputLayoutCache;
+	ShaderLibrary* shaderLibrary;
+
+	// Pixel shaders built with just the features each material
+	// uses.  pixelShader is the variant with all of them
+	ShaderVariants<SimplePixelShader>* pixelVariants;
 	SimplePixelShader* pixelShader;
 
+	// Takes world matrices from an instance buffer instead of a
+	// constant buffer, so many entities draw in one call
+	SimpleVertexShader* instancedVertexShader;
+	InstanceBuffer* instanceBuffer;
+	std::vector<DirectX::XMFLOAT4X4> instanceMatrices;
+
+	// Handles for setting each shader's per-frame buffer as a struct
+	const SimpleConstantBuffer* vertexFrameConstants;
+	const SimpleConstantBuffer* instancedFrameConstants;
+	std::vector<const SimpleConstantBuffer*> pixelFrameConstants; // One per pixel shader variant
+
 	// The matrices to go from model space to screen space
 	DirectX::XMFLOAT4X4 worldMatrix;
 	DirectX::XMFLOAT4X4 viewMatrix;
@@ -64,15 +123,65 @@ private:
 	Mesh * sphere;
 	Mesh * torus;
 
-	// Vector to store various game entities
-	std::vector<Entity *> entities;
+	// Pool to store various game entities
+	EntityPool entities;
+
+	// Deferred entity changes, applied once per frame
+	EntityCommandBuffer * entityCommands;
+
+	// Render-relevant entity state, written by Update and read by Draw
+	RenderStateBuffer renderState;
 
-	// Simple camera
+	// Draw order for the frame being drawn, sorted to cut state changes
+	RenderQueue renderQueue;
+
+	// Drops binds that match what the context already has
+	StateCache * stateCache;
+	float stateReportTime;
+
+	// Where shader constant data is written, if the device supports it
+	ConstantBufferRing * constantRing;
+
+	// World matrices of static entities that have stopped moving,
+	// bound per draw instead of uploaded
+	ObjectBufferCache * objectBuffers;
+
+	// Props that never move, stored packed instead of as entities
+	StaticInstanceBuffer * staticProps;
+	std::vector<DirectX::XMFLOAT4X4> staticPropMatrices;
+	std::vector<std::vector<DirectX::XMFLOAT4X4>> staticPropGroupMatrices;
+
+	// Simple camera, and where it was at the start of the last
+	// tick so Draw can interpolate from there
 	Camera * camera;
+	DirectX::XMFLOAT3 previousCameraPosition;
+	DirectX::XMFLOAT4 previousCameraRotation;
+
+	// Tests entity bounds against the camera before drawing.  Draw
+	// places the camera anywhere between the last two ticks, so
+	// both ticks' views are culled against (one bit each in the
+	// view masks, current view first)
+	FrustumCuller culler;
+	std::vector<MultiViewResult> cullResults;
+	std::vector<EntityHandle> visibleEntities;
+	std::vector<uint32_t> visibleViewMasks;
+	std::vector<EntityHandle> partlyVisibleEntities;
+
+	// Baked visibility between static entities and camera cells
+	PotentiallyVisibleSet * pvs;
+
+	// CPU depth buffer of occluder entities, to skip what they hide
+	OcclusionCuller * occlusionCuller;
+	float occlusionReportTime;
+
+	// Picks mesh detail from on-screen size, and drops tiny entities
+	LODSelector lodSelector;
 
 	// Material
 	Material * woodMaterial;
 	Material * stoneMaterial;
+	Material * woodLevelMaterial;	// Static level entities, drawn one at a time
+	Material * stoneLevelMaterial;
 
 	// Lighting
 	DirectionalLight light;
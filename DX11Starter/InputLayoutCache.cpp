@@ -0,0 +1,117 @@
+#include "InputLayoutCache.h"
+#include <cctype>
+
+InputLayoutCache::InputLayoutCache(ID3D11Device * _device)
+{
+	device = _device;
+	sharedCount = 0;
+}
+
+InputLayoutCache::~InputLayoutCache()
+{
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i]->Layout->Release();
+		delete entries[i];
+	}
+}
+
+ID3D11InputLayout * InputLayoutCache::GetLayout(const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count, const void * shaderCode, size_t codeSize)
+{
+	uint32_t hash = Hash(elements, count);
+	std::lock_guard<std::mutex> guard(lock);
+
+	typedef std::unordered_multimap<uint32_t, Entry *>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = lookup.equal_range(hash);
+	for (Iterator i = range.first; i != range.second; ++i)
+	{
+		if (Matches(i->second, elements, count))
+		{
+			sharedCount++;
+			i->second->Layout->AddRef();
+			return i->second->Layout;
+		}
+	}
+
+	ID3D11InputLayout * layout = 0;
+	if (FAILED(device->CreateInputLayout(elements, count, shaderCode, codeSize, &layout)))
+		return 0;
+
+	// Keep a copy of the elements to compare against, with
+	// names of our own since the caller's may not last
+	Entry * entry = new Entry();
+	entry->Elements.assign(elements, elements + count);
+	entry->SemanticNames.resize(count);
+	for (unsigned int e = 0; e < count; e++)
+	{
+		entry->SemanticNames[e] = elements[e].SemanticName;
+		entry->Elements[e].SemanticName = entry->SemanticNames[e].c_str();
+	}
+	entry->Layout = layout;
+	entries.push_back(entry);
+	lookup.insert(std::pair<uint32_t, Entry *>(hash, entry));
+
+	layout->AddRef();
+	return layout;
+}
+
+// --------------------------------------------------------
+// FNV-1a over every field, with semantic names folded to
+// lower case since D3D compares them ignoring case
+// --------------------------------------------------------
+uint32_t InputLayoutCache::Hash(const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count)
+{
+	uint32_t hash = 2166136261u;
+	for (unsigned int e = 0; e < count; e++)
+	{
+		const D3D11_INPUT_ELEMENT_DESC & element = elements[e];
+		for (const char * c = element.SemanticName; *c; c++)
+		{
+			hash = (hash ^ (uint8_t)tolower((unsigned char)*c)) * 16777619u;
+		}
+
+		uint32_t fields[] = {
+			element.SemanticIndex,
+			(uint32_t)element.Format,
+			element.InputSlot,
+			element.AlignedByteOffset,
+			(uint32_t)element.InputSlotClass,
+			element.InstanceDataStepRate
+		};
+		for (int f = 0; f < 6; f++)
+		{
+			hash = (hash ^ fields[f]) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+bool InputLayoutCache::Matches(const Entry * entry, const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count)
+{
+	if (entry->Elements.size() != count)
+		return false;
+
+	for (unsigned int e = 0; e < count; e++)
+	{
+		const D3D11_INPUT_ELEMENT_DESC & a = entry->Elements[e];
+		const D3D11_INPUT_ELEMENT_DESC & b = elements[e];
+		if (a.SemanticIndex != b.SemanticIndex ||
+			a.Format != b.Format ||
+			a.InputSlot != b.InputSlot ||
+			a.AlignedByteOffset != b.AlignedByteOffset ||
+			a.InputSlotClass != b.InputSlotClass ||
+			a.InstanceDataStepRate != b.InstanceDataStepRate)
+			return false;
+
+		const char * x = a.SemanticName;
+		const char * y = b.SemanticName;
+		while (*x && tolower((unsigned char)*x) == tolower((unsigned char)*y))
+		{
+			x++;
+			y++;
+		}
+		if (tolower((unsigned char)*x) != tolower((unsigned char)*y))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <d3d11.h>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <mutex>
+
+// --------------------------------------------------------
+// Hands out one input layout per distinct set of input
+// elements, however many vertex shaders ask for it.  Shaders
+// with the same inputs then share a layout, so switching
+// between them doesn't rebind it (see StateCache).
+//
+// Layouts are only created against the first shader that
+// asks; a layout works with any shader whose input signature
+// it matches, which identical elements guarantee here.
+// Safe to call from several threads at once.
+// --------------------------------------------------------
+class InputLayoutCache
+{
+public:
+	/// @param _device: device to create layouts with
+	InputLayoutCache(ID3D11Device * _device);
+	~InputLayoutCache();
+
+	/// Finds or creates the layout for a set of elements
+	/// @param elements: the input elements
+	/// @param count: number of elements
+	/// @param shaderCode: compiled vertex shader the elements came from
+	/// @param codeSize: size of the compiled code
+	/// @return: the layout with a reference added for the caller
+	/// to release, or null if it couldn't be created
+	ID3D11InputLayout * GetLayout(const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count, const void * shaderCode, size_t codeSize);
+
+	/// Number of distinct layouts created
+	unsigned int GetLayoutCount() { return (unsigned int)entries.size(); }
+
+	/// Number of GetLayout() calls that shared an existing layout
+	unsigned int GetSharedCount() { return sharedCount; }
+
+private:
+	struct Entry
+	{
+		std::vector<D3D11_INPUT_ELEMENT_DESC> Elements;
+		std::vector<std::string> SemanticNames; // Elements point into these
+		ID3D11InputLayout * Layout;
+	};
+
+	ID3D11Device * device;
+	std::vector<Entry *> entries;
+	std::unordered_multimap<uint32_t, Entry *> lookup;
+	unsigned int sharedCount;
+	std::mutex lock;
+
+	static uint32_t Hash(const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count);
+	static bool Matches(const Entry * entry, const D3D11_INPUT_ELEMENT_DESC * elements, unsigned int count);
+};
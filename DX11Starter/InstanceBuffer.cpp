@@ -0,0 +1,66 @@
+#include "InstanceBuffer.h"
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+InstanceBuffer::InstanceBuffer(ID3D11Device * _device, unsigned int _capacity)
+{
+	buffer = 0;
+	capacity = _capacity;
+	used = 0;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = sizeof(XMFLOAT4X4) * capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(_device->CreateBuffer(&desc, 0, &buffer)))
+	{
+		buffer = 0;
+		capacity = 0;
+	}
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	if (buffer) { buffer->Release(); }
+}
+
+unsigned int InstanceBuffer::Append(const XMFLOAT4X4 * worldMatrices, unsigned int count, StateCache * stateCache)
+{
+	if (!buffer)
+		return INSTANCE_APPEND_FAILED;
+	if (count == 0)
+		return used;
+	if (count > capacity)
+		count = capacity;
+
+	// Out of room, so start over in a fresh buffer.  The GPU keeps
+	// the old contents alive for draws that still need them
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (used == 0 || used + count > capacity)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		used = 0;
+	}
+
+	ID3D11DeviceContext * context = stateCache->GetContext();
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped)))
+		return INSTANCE_APPEND_FAILED;
+
+	XMFLOAT4X4 * dest = (XMFLOAT4X4 *)mapped.pData + used;
+	memcpy(dest, worldMatrices, sizeof(XMFLOAT4X4) * count);
+	context->Unmap(buffer, 0);
+	stateCache->RecordUpload(sizeof(XMFLOAT4X4) * count);
+
+	unsigned int first = used;
+	used += count;
+	return first;
+}
+
+void InstanceBuffer::Bind(StateCache * stateCache)
+{
+	stateCache->SetVertexBuffer(1, buffer, sizeof(XMFLOAT4X4), 0);
+}
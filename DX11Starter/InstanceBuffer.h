@@ -0,0 +1,42 @@
+#pragma once
+#include "DXCore.h"
+#include "StateCache.h"
+#include <DirectXMath.h>
+
+// Returned by InstanceBuffer::Append() when nothing was copied
+const unsigned int INSTANCE_APPEND_FAILED = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Dynamic vertex buffer of per-instance world matrices for
+// instanced draws.  Matrices are appended with no-overwrite
+// maps, so draws earlier in the frame keep their data, and
+// the buffer is only discarded once it wraps around.
+// --------------------------------------------------------
+class InstanceBuffer
+{
+public:
+	/// @param _device: device to create the buffer with
+	/// @param _capacity: most instances the buffer holds at once
+	InstanceBuffer(ID3D11Device * _device, unsigned int _capacity);
+	~InstanceBuffer();
+
+	/// Copies matrices into the buffer
+	/// @param worldMatrices: transposed world matrices, one per instance
+	/// @param count: number of matrices, at most GetCapacity()
+	/// @param stateCache: cache in front of the context to map the
+	/// buffer with, which counts the upload
+	/// @return: the instance index of the first matrix, to pass as
+	/// the start instance of the draw, or INSTANCE_APPEND_FAILED if
+	/// the buffer couldn't be written (don't draw then)
+	unsigned int Append(const DirectX::XMFLOAT4X4 * worldMatrices, unsigned int count, StateCache * stateCache);
+
+	/// Binds the buffer as the per-instance vertex stream (slot 1)
+	void Bind(StateCache * stateCache);
+
+	unsigned int GetCapacity() { return capacity; }
+
+private:
+	ID3D11Buffer * buffer;
+	unsigned int capacity;
+	unsigned int used;
+};
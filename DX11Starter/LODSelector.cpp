@@ -0,0 +1,291 @@
+#include "LODSelector.h"
+#include <cfloat>
+#include <cstring>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Objects are processed in groups of this many, so arrays are
+// padded up to it (enough for the AVX path)
+static const size_t LOD_BATCH = 8;
+
+LODSelector::LODSelector()
+{
+	count = 0;
+	viewPosition = XMFLOAT3(0, 0, 0);
+	pixelScale = 1.0f;
+	SetThresholds(0, 0, 0.0f);
+}
+
+LODSelector::~LODSelector()
+{
+}
+
+void LODSelector::SetThresholds(const float * pixelThresholds, int _count, float _hysteresis)
+{
+	thresholdCount = _count > MAX_LOD_THRESHOLDS ? MAX_LOD_THRESHOLDS : _count;
+	hysteresis = _hysteresis;
+
+	for (int i = 0; i < thresholdCount; i++)
+	{
+		float coarser = pixelThresholds[i] * (1.0f - hysteresis);
+		float finer = pixelThresholds[i] * (1.0f + hysteresis);
+		coarserThresholdsSq[i] = coarser * coarser;
+		finerThresholdsSq[i] = finer * finer;
+	}
+
+	// An object keeps its LOD until it shrinks past the coarser
+	// version of the threshold below it, or grows past the finer
+	// version of the one above it
+	for (int lod = 0; lod <= MAX_LOD_THRESHOLDS; lod++)
+	{
+		holdMinSq[lod] = lod < thresholdCount ? coarserThresholdsSq[lod] : 0.0f;
+		holdMaxSq[lod] = (lod > 0 && lod <= thresholdCount) ? finerThresholdsSq[lod - 1] : FLT_MAX;
+	}
+}
+
+// --------------------------------------------------------
+// A sphere of radius r at distance d covers about
+// 2 * r * proj[1][1] / d of the screen's -1 to 1 height, so
+// r / d * proj[1][1] * screenHeight pixels
+// --------------------------------------------------------
+void LODSelector::SetView(XMFLOAT3 cameraPosition, const XMFLOAT4X4 & projectionMatrix, float screenHeight)
+{
+	viewPosition = cameraPosition;
+	pixelScale = projectionMatrix._22 * screenHeight;
+}
+
+void LODSelector::Clear()
+{
+	count = 0;
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radii.clear();
+	lods.clear();
+}
+
+size_t LODSelector::Add(XMFLOAT3 center, float radius, int currentLOD)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radii.push_back(radius);
+	lods.push_back((uint8_t)((currentLOD == LOD_CULLED || currentLOD > thresholdCount) ? thresholdCount : currentLOD));
+	return count++;
+}
+
+// --------------------------------------------------------
+// For each object, counts how many thresholds its screen
+// size is under - with the thresholds shrunk a little (the
+// level it would drop to) and grown a little (the level it
+// would climb to).  It only moves when one of those is past
+// its current level, which leaves a dead band around each
+// threshold.
+// --------------------------------------------------------
+void LODSelector::Select()
+{
+	if (count == 0)
+		return;
+
+	// Pad to whole groups.  Padding has no size and is culled,
+	// which it stays
+	size_t padded = (count + LOD_BATCH - 1) / LOD_BATCH * LOD_BATCH;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	radii.resize(padded, 0.0f);
+	lods.resize(padded, (uint8_t)thresholdCount);
+
+#if defined(__AVX__)
+	SelectAVX(padded);
+#else
+	SelectSSE(padded);
+#endif
+
+	// Drop the padding again so Add() keeps appending in place
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	radii.resize(count);
+	lods.resize(count);
+}
+
+// --------------------------------------------------------
+// Four objects per iteration.  Screen sizes are compared
+// squared - (radius * scale)^2 / distance^2 against the
+// squared thresholds - so there's no square root
+// --------------------------------------------------------
+void LODSelector::SelectSSE(size_t padded)
+{
+	XMVECTOR camX = XMVectorReplicate(viewPosition.x);
+	XMVECTOR camY = XMVectorReplicate(viewPosition.y);
+	XMVECTOR camZ = XMVectorReplicate(viewPosition.z);
+	XMVECTOR scale = XMVectorReplicate(pixelScale);
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR minDistanceSq = XMVectorReplicate(1e-6f);
+
+	XMVECTOR coarser[MAX_LOD_THRESHOLDS];
+	XMVECTOR finer[MAX_LOD_THRESHOLDS];
+	for (int t = 0; t < thresholdCount; t++)
+	{
+		coarser[t] = XMVectorReplicate(coarserThresholdsSq[t]);
+		finer[t] = XMVectorReplicate(finerThresholdsSq[t]);
+	}
+
+	// Locals, so stores to lods can't be taken as changing them
+	const float * x = &centerX[0];
+	const float * y = &centerY[0];
+	const float * z = &centerZ[0];
+	const float * r = &radii[0];
+	uint8_t * l = &lods[0];
+	const int thresholds = thresholdCount;
+
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		XMVECTOR dx = XMVectorSubtract(XMLoadFloat4((const XMFLOAT4 *)(x + i)), camX);
+		XMVECTOR dy = XMVectorSubtract(XMLoadFloat4((const XMFLOAT4 *)(y + i)), camY);
+		XMVECTOR dz = XMVectorSubtract(XMLoadFloat4((const XMFLOAT4 *)(z + i)), camZ);
+		XMVECTOR distanceSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+		distanceSq = XMVectorMax(distanceSq, minDistanceSq);
+
+		XMVECTOR size = XMVectorMultiply(XMLoadFloat4((const XMFLOAT4 *)(r + i)), scale);
+		XMVECTOR sizeSq = XMVectorDivide(XMVectorMultiply(size, size), distanceSq);
+
+		// Comparison masks are all ones bits, so masking 1.0 with
+		// them adds one for each threshold passed
+		XMVECTOR coarserLOD = zero;
+		XMVECTOR finerLOD = zero;
+		for (int t = 0; t < thresholds; t++)
+		{
+			coarserLOD = XMVectorAdd(coarserLOD, XMVectorAndInt(XMVectorLess(sizeSq, coarser[t]), one));
+			finerLOD = XMVectorAdd(finerLOD, XMVectorAndInt(XMVectorLess(sizeSq, finer[t]), one));
+		}
+
+		// coarserLOD <= finerLOD always, so keeping the current LOD
+		// unless it's outside that range is just a clamp.  LODs are
+		// widened from bytes for it and narrowed back after
+		int packed;
+		memcpy(&packed, l + i, sizeof(packed));
+		__m128i bytes = _mm_cvtsi32_si128(packed);
+		__m128i zeroBytes = _mm_setzero_si128();
+		XMVECTOR lod = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zeroBytes), zeroBytes));
+		__m128i picked = _mm_cvttps_epi32(XMVectorMin(XMVectorMax(lod, coarserLOD), finerLOD));
+		picked = _mm_packs_epi32(picked, picked);
+		packed = _mm_cvtsi128_si32(_mm_packus_epi16(picked, picked));
+		memcpy(l + i, &packed, sizeof(packed));
+	}
+}
+
+#if defined(__AVX__)
+static inline __m256 SelectLanes(__m256 a, __m256 b, __m256 mask)
+{
+	return _mm256_or_ps(_mm256_andnot_ps(mask, a), _mm256_and_ps(mask, b));
+}
+
+// --------------------------------------------------------
+// Same test as SelectSSE(), eight objects per iteration.
+// Most objects stay inside their LOD's hold range from one
+// frame to the next, so each group first checks that, and
+// skips the counting and the store if nothing in it changes.
+// Neighbouring objects often share a LOD, which needs only
+// one range; otherwise each object's is looked up in a table
+// (_mm256_permutevar_ps() indexes four entries, so two
+// lookups cover eight levels)
+// --------------------------------------------------------
+void LODSelector::SelectAVX(size_t padded)
+{
+	const __m256 camX = _mm256_set1_ps(viewPosition.x);
+	const __m256 camY = _mm256_set1_ps(viewPosition.y);
+	const __m256 camZ = _mm256_set1_ps(viewPosition.z);
+	const __m256 scale = _mm256_set1_ps(pixelScale);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 minDistanceSq = _mm256_set1_ps(1e-6f);
+
+	__m256 coarser[MAX_LOD_THRESHOLDS];
+	__m256 finer[MAX_LOD_THRESHOLDS];
+	for (int t = 0; t < thresholdCount; t++)
+	{
+		coarser[t] = _mm256_set1_ps(coarserThresholdsSq[t]);
+		finer[t] = _mm256_set1_ps(finerThresholdsSq[t]);
+	}
+
+	const __m256 holdMinLow = _mm256_broadcast_ps((const __m128 *)&holdMinSq[0]);
+	const __m256 holdMinHigh = _mm256_broadcast_ps((const __m128 *)&holdMinSq[4]);
+	const __m256 holdMaxLow = _mm256_broadcast_ps((const __m128 *)&holdMaxSq[0]);
+	const __m256 holdMaxHigh = _mm256_broadcast_ps((const __m128 *)&holdMaxSq[4]);
+	const __m256 four = _mm256_set1_ps(4.0f);
+
+	// The lookup tables only go up to LOD 7, so with every
+	// threshold in use the culled level can't be looked up
+	const bool canLookUp = thresholdCount < MAX_LOD_THRESHOLDS;
+
+	const float * x = &centerX[0];
+	const float * y = &centerY[0];
+	const float * z = &centerZ[0];
+	const float * r = &radii[0];
+	uint8_t * l = &lods[0];
+	const int thresholds = thresholdCount;
+
+	for (size_t i = 0; i < padded; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), camX);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), camY);
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), camZ);
+		__m256 distanceSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		distanceSq = _mm256_max_ps(distanceSq, minDistanceSq);
+
+		__m256 size = _mm256_mul_ps(_mm256_loadu_ps(r + i), scale);
+		__m256 sizeSq = _mm256_div_ps(_mm256_mul_ps(size, size), distanceSq);
+
+		// All eight at the same LOD
+		uint64_t groupLODs;
+		memcpy(&groupLODs, l + i, sizeof(groupLODs));
+		uint64_t firstLOD = groupLODs & 0xFF;
+		if (groupLODs == firstLOD * 0x0101010101010101ull)
+		{
+			__m256 sameHolds = _mm256_and_ps(
+				_mm256_cmp_ps(sizeSq, _mm256_broadcast_ss(&holdMinSq[firstLOD]), _CMP_GE_OQ),
+				_mm256_cmp_ps(sizeSq, _mm256_broadcast_ss(&holdMaxSq[firstLOD]), _CMP_LT_OQ));
+			if (_mm256_movemask_ps(sameHolds) == 0xFF)
+				continue;
+		}
+
+		// Otherwise widen the LOD bytes to look each one up
+		__m128i bytes = _mm_loadl_epi64((const __m128i *)(l + i));
+		__m256i index = _mm256_insertf128_si256(_mm256_castsi128_si256(_mm_cvtepu8_epi32(bytes)), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)), 1);
+		__m256 lod = _mm256_cvtepi32_ps(index);
+
+		__m256 upper = _mm256_cmp_ps(lod, four, _CMP_GE_OQ);
+		__m256 holdMin = SelectLanes(_mm256_permutevar_ps(holdMinLow, index), _mm256_permutevar_ps(holdMinHigh, index), upper);
+		__m256 holdMax = SelectLanes(_mm256_permutevar_ps(holdMaxLow, index), _mm256_permutevar_ps(holdMaxHigh, index), upper);
+		__m256 holds = _mm256_and_ps(_mm256_cmp_ps(sizeSq, holdMin, _CMP_GE_OQ), _mm256_cmp_ps(sizeSq, holdMax, _CMP_LT_OQ));
+		if (canLookUp && _mm256_movemask_ps(holds) == 0xFF)
+			continue;
+
+		__m256 coarserLOD = zero;
+		__m256 finerLOD = zero;
+		for (int t = 0; t < thresholds; t++)
+		{
+			coarserLOD = _mm256_add_ps(coarserLOD, _mm256_and_ps(_mm256_cmp_ps(sizeSq, coarser[t], _CMP_LT_OQ), one));
+			finerLOD = _mm256_add_ps(finerLOD, _mm256_and_ps(_mm256_cmp_ps(sizeSq, finer[t], _CMP_LT_OQ), one));
+		}
+
+		// Narrow back to bytes
+		__m256i picked = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(lod, coarserLOD), finerLOD));
+		__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(picked), _mm256_extractf128_si256(picked, 1));
+		_mm_storel_epi64((__m128i *)(l + i), _mm_packus_epi16(words, words));
+	}
+}
+#endif
+
+int LODSelector::GetLOD(size_t index)
+{
+	int lod = lods[index];
+	return lod >= thresholdCount ? LOD_CULLED : lod;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <vector>
+
+// Most LOD thresholds (including the cull threshold) supported
+const int MAX_LOD_THRESHOLDS = 8;
+
+// LOD index given to objects too small to draw
+const int LOD_CULLED = -1;
+
+// --------------------------------------------------------
+// Picks a level of detail for each object from how tall its
+// bounding sphere is on screen, in pixels.  Objects need to
+// get a margin past a threshold before switching, so ones
+// sitting right on a threshold don't flicker between levels.
+//
+// Spheres are stored as separate component arrays and
+// selected four (or with AVX, eight) at a time with SIMD.
+// --------------------------------------------------------
+class LODSelector
+{
+public:
+	LODSelector();
+	~LODSelector();
+
+	/// Sets the screen heights LODs switch at
+	/// @param pixelThresholds: heights in pixels, largest first.  Below
+	/// the first an object uses LOD 1, below the second LOD 2, and so
+	/// on - below the last one it is culled
+	/// @param count: number of thresholds
+	/// @param _hysteresis: fraction (e.g. 0.1) an object must pass a
+	/// threshold by before its LOD changes
+	void SetThresholds(const float * pixelThresholds, int count, float _hysteresis);
+
+	/// Sets the view objects are measured from
+	/// @param cameraPosition: world space camera position
+	/// @param projectionMatrix: the camera's projection matrix
+	/// @param screenHeight: height of the render target in pixels
+	void SetView(DirectX::XMFLOAT3 cameraPosition, const DirectX::XMFLOAT4X4 & projectionMatrix, float screenHeight);
+
+	/// Removes all objects, keeping allocated memory
+	void Clear();
+
+	/// Adds an object to the next Select()
+	/// @param center: world space center of the bounding sphere
+	/// @param radius: radius of the bounding sphere
+	/// @param currentLOD: the LOD the object used last frame
+	/// @return: index of the object, for GetLOD()
+	size_t Add(DirectX::XMFLOAT3 center, float radius, int currentLOD);
+
+	/// Picks a LOD for every object
+	void Select();
+
+	/// The LOD picked for an object, or LOD_CULLED
+	int GetLOD(size_t index);
+	size_t GetCount() { return count; }
+
+private:
+	size_t count;
+	int thresholdCount;
+	float hysteresis;
+
+	// Thresholds, pre-scaled for switching to coarser and finer
+	// levels.  Squared, so screen sizes can be compared without a
+	// square root per object
+	float coarserThresholdsSq[MAX_LOD_THRESHOLDS];
+	float finerThresholdsSq[MAX_LOD_THRESHOLDS];
+
+	// The range of squared screen sizes each LOD (culled being
+	// thresholdCount) holds over.  Groups of objects that are all
+	// still inside theirs can be skipped
+	float holdMinSq[MAX_LOD_THRESHOLDS + 1];
+	float holdMaxSq[MAX_LOD_THRESHOLDS + 1];
+
+	DirectX::XMFLOAT3 viewPosition;
+	float pixelScale;	// Screen height in pixels of a sphere of radius 1 at distance 1
+
+	// One array per component, padded during Select()
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radii;
+	std::vector<uint8_t> lods;	// Bytes, to keep the arrays small enough to stay in cache
+
+	void SelectSSE(size_t padded);
+#if defined(__AVX__)
+	void SelectAVX(size_t padded);
+#endif
+};
@@ -1,6 +1,19 @@
 #include "Material.h"
+#include "RenderState.h"
+#include "ShaderConstants.h"
+#include <vector>
+#include <utility>
 
+// Names of the shader variables and resources materials set
+static constexpr SimpleNameHash WORLD_NAME("world");
+static constexpr SimpleNameHash TEXTURE_NAME("diffuseTexture");
+static constexpr SimpleNameHash SAMPLER_NAME("basicSampler");
 
+// Next id handed to a new material
+static unsigned int nextMaterialId = 0;
+
+// Every shader pair seen so far, indexed by shader id
+static std::vector<std::pair<SimpleVertexShader *, SimplePixelShader *>> shaderPairs;
 
 Material::Material(SimplePixelShader * _pixelShader, SimpleVertexShader * _vertexShader, ID3D11ShaderResourceView * _shaderResourceView, ID3D11SamplerState * _samplerState)
 {
@@ -9,6 +22,26 @@ Material::Material(SimplePixelShader * _pixelShader, SimpleVertexShader * _verte
 
 	samplerState = _samplerState;
 	shaderResourceView = _shaderResourceView;
+	transparent = false;
+
+	worldHandle = vertexShader->GetVariableInfo(WORLD_NAME);
+	textureHandle = pixelShader->GetShaderResourceViewInfo(TEXTURE_NAME);
+	samplerHandle = pixelShader->GetSamplerInfo(SAMPLER_NAME);
+
+	// Instancing shaders have no per-object buffer to check
+	objectBufferHandle = 0;
+	if (vertexShader->GetBufferInfo(CBUFFER_PER_OBJECT))
+		objectBufferHandle = vertexShader->BindBufferStruct<VertexPerObjectConstants>(CBUFFER_PER_OBJECT);
+
+	id = nextMaterialId++;
+
+	// Materials sharing shaders share a shader id, so they sort together
+	std::pair<SimpleVertexShader *, SimplePixelShader *> shaders(vertexShader, pixelShader);
+	shaderId = 0;
+	while (shaderId < shaderPairs.size() && shaderPairs[shaderId] != shaders)
+		shaderId++;
+	if (shaderId == shaderPairs.size())
+		shaderPairs.push_back(shaders);
 }
 
 
@@ -35,3 +68,23 @@ ID3D11SamplerState * Material::getSamplerState()
 {
 	return samplerState;
 }
+
+unsigned int Material::GetId()
+{
+	return id;
+}
+
+unsigned int Material::GetShaderId()
+{
+	return shaderId;
+}
+
+bool Material::GetTransparent()
+{
+	return transparent;
+}
+
+void Material::SetTransparent(bool value)
+{
+	transparent = value;
+}
@@ -14,6 +14,29 @@ public:
 	SimpleVertexShader * GetVertexShader();
 	ID3D11ShaderResourceView * getShaderResourceView();
 	ID3D11SamplerState * getSamplerState();
+
+	/// Small number unique to this material, used in render sort keys
+	unsigned int GetId();
+
+	/// Small number shared by every material using the same vertex
+	/// and pixel shader pair, used in render sort keys
+	unsigned int GetShaderId();
+
+	/// Shader handles for what's set per draw and per material,
+	/// looked up once here rather than by name every time
+	const SimpleShaderVariable * GetWorldHandle() { return worldHandle; }
+	const SimpleSRV * GetTextureHandle() { return textureHandle; }
+	const SimpleSampler * GetSamplerHandle() { return samplerHandle; }
+
+	/// The vertex shader's per-object buffer, if its layout is
+	/// VertexPerObjectConstants - needed to bind an ObjectBufferCache
+	/// buffer in its place.  Null otherwise
+	const SimpleConstantBuffer * GetObjectBufferHandle() { return objectBufferHandle; }
+
+	/// Whether the material is blended over what's behind it, so
+	/// needs drawing back to front after everything opaque
+	bool GetTransparent();
+	void SetTransparent(bool value);
 private:
 	SimplePixelShader * pixelShader;
 	SimpleVertexShader * vertexShader;
@@ -21,5 +44,14 @@ private:
 	// Shader samplers
 	ID3D11ShaderResourceView * shaderResourceView;
 	ID3D11SamplerState * samplerState;
+
+	const SimpleShaderVariable * worldHandle;
+	const SimpleSRV * textureHandle;
+	const SimpleSampler * samplerHandle;
+	const SimpleConstantBuffer * objectBufferHandle;
+
+	unsigned int id;
+	unsigned int shaderId;
+	bool transparent;
 };
 
@@ -3,13 +3,23 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+// Next id handed to a new mesh
+static unsigned int nextMeshId = 0;
+
 Mesh::Mesh(Vertex * vertices, int vertCount, unsigned int * indices, int indCount, ID3D11Device * device)
 {
+	id = nextMeshId++;
 	CreateBuffers(vertices, vertCount, indices, indCount, device);
 }
 
 Mesh::Mesh(char * objFile, ID3D11Device * device)
 {
+	id = nextMeshId++;
+
+	// Empty bounds in case the file can't be read
+	boundsMin = XMFLOAT3(0, 0, 0);
+	boundsMax = XMFLOAT3(0, 0, 0);
+
 	// File input object
 	std::ifstream obj(objFile);
 
@@ -203,6 +213,31 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
+unsigned int Mesh::GetId()
+{
+	return id;
+}
+
+XMFLOAT3 Mesh::GetBoundsMin()
+{
+	return boundsMin;
+}
+
+XMFLOAT3 Mesh::GetBoundsMax()
+{
+	return boundsMax;
+}
+
+const std::vector<XMFLOAT3> & Mesh::GetPositions()
+{
+	return cpuPositions;
+}
+
+const std::vector<unsigned int> & Mesh::GetIndices()
+{
+	return cpuIndices;
+}
+
 void Mesh::CreateBuffers(Vertex * vertices, int vertCount, unsigned int * indices, int indCount, ID3D11Device * device)
 {
 	// Initialize buffers
@@ -212,6 +247,28 @@ void Mesh::CreateBuffers(Vertex * vertices, int vertCount, unsigned int * indice
 	// assign variables
 	indexCount = indCount;
 
+	// Keep the geometry around for CPU rasterization
+	cpuPositions.resize(vertCount);
+	for (int i = 0; i < vertCount; i++)
+	{
+		cpuPositions[i] = vertices[i].Position;
+	}
+	cpuIndices.assign(indices, indices + indCount);
+
+	// Find the bounding box of all vertices
+	boundsMin = vertCount > 0 ? vertices[0].Position : XMFLOAT3(0, 0, 0);
+	boundsMax = boundsMin;
+	for (int i = 1; i < vertCount; i++)
+	{
+		XMFLOAT3 pos = vertices[i].Position;
+		boundsMin.x = pos.x < boundsMin.x ? pos.x : boundsMin.x;
+		boundsMin.y = pos.y < boundsMin.y ? pos.y : boundsMin.y;
+		boundsMin.z = pos.z < boundsMin.z ? pos.z : boundsMin.z;
+		boundsMax.x = pos.x > boundsMax.x ? pos.x : boundsMax.x;
+		boundsMax.y = pos.y > boundsMax.y ? pos.y : boundsMax.y;
+		boundsMax.z = pos.z > boundsMax.z ? pos.z : boundsMax.z;
+	}
+
 	// Create the VERTEX BUFFER description -----------------------------------
 	// - The description is created on the stack because we only need
 	//    it to create the buffer.  The description is then useless.
@@ -17,6 +17,18 @@ public:
 	ID3D11Buffer * GetVertexBuffer();
 	ID3D11Buffer * GetIndexBuffer();
 	int GetIndexCount();
+
+	/// Small number unique to this mesh, used in render sort keys
+	unsigned int GetId();
+
+	/// Corners of the mesh's local space bounding box
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+
+	/// CPU side copies of the geometry, used when the mesh is
+	/// rasterized on the CPU as an occluder
+	const std::vector<DirectX::XMFLOAT3> & GetPositions();
+	const std::vector<unsigned int> & GetIndices();
 private:
 	// Vertex and Index buffers
 	ID3D11Buffer * vertexBuffer;
@@ -26,5 +38,16 @@ private:
 
 	// index count for the index buffer
 	int indexCount;
+
+	// Assigned in creation order
+	unsigned int id;
+
+	// Local space bounding box, used for culling
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+
+	// Vertex positions and indices kept on the CPU
+	std::vector<DirectX::XMFLOAT3> cpuPositions;
+	std::vector<unsigned int> cpuIndices;
 };
 
@@ -0,0 +1,45 @@
+#include "Morton.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Spreads 10 bits out so there are two zero bits between
+// each of them (the standard "magic numbers" bit twiddle)
+// --------------------------------------------------------
+static uint32_t SpreadBits(uint32_t value)
+{
+	value &= 0x000003FF;
+	value = (value | (value << 16)) & 0xFF0000FF;
+	value = (value | (value << 8)) & 0x0300F00F;
+	value = (value | (value << 4)) & 0x030C30C3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+// --------------------------------------------------------
+// Maps a coordinate into [0, 1023] across the given range
+// --------------------------------------------------------
+static uint32_t Quantize(float value, float min, float max)
+{
+	float range = max - min;
+	if (range <= 0.0f)
+		return 0;
+
+	float scaled = (value - min) / range * 1023.0f;
+	scaled = scaled < 0.0f ? 0.0f : (scaled > 1023.0f ? 1023.0f : scaled);
+	return (uint32_t)scaled;
+}
+
+uint32_t MortonEncode(uint32_t x, uint32_t y, uint32_t z)
+{
+	return SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2);
+}
+
+uint32_t MortonEncode(XMFLOAT3 position, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	return MortonEncode(
+		Quantize(position.x, boundsMin.x, boundsMax.x),
+		Quantize(position.y, boundsMin.y, boundsMax.y),
+		Quantize(position.z, boundsMin.z, boundsMax.z));
+}
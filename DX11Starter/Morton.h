@@ -0,0 +1,21 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Morton (Z-order) codes for sorting objects by location.
+// Objects with nearby codes are nearby in space, so sorting
+// arrays by code keeps spatial neighbours close in memory.
+// --------------------------------------------------------
+
+/// Interleaves the low 10 bits of each coordinate into a
+/// 30 bit code (x in bit 0, y in bit 1, z in bit 2, ...)
+uint32_t MortonEncode(uint32_t x, uint32_t y, uint32_t z);
+
+/// Quantizes a position to a 1024^3 grid over the given
+/// bounds and returns its Morton code.  Positions outside
+/// the bounds are clamped to the edge.
+/// @param position: world space position
+/// @param boundsMin: smallest corner of the sorted region
+/// @param boundsMax: largest corner of the sorted region
+uint32_t MortonEncode(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
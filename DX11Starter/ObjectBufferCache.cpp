@@ -0,0 +1,115 @@
+#include "ObjectBufferCache.h"
+#include "ShaderConstants.h"
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+ObjectBufferCache::ObjectBufferCache(ID3D11Device * _device, unsigned int _settleFrames, unsigned int _unusedFrames)
+{
+	device = _device;
+	settleFrames = _settleFrames;
+	unusedFrames = _unusedFrames > 0 ? _unusedFrames : 1;
+	frame = 0;
+	bufferCount = 0;
+	createdCount = 0;
+	releasedCount = 0;
+}
+
+ObjectBufferCache::~ObjectBufferCache()
+{
+	for (std::unordered_map<unsigned int, Entry>::iterator i = entries.begin(); i != entries.end(); ++i)
+	{
+		if (i->second.Buffer)
+			i->second.Buffer->Release();
+	}
+}
+
+// --------------------------------------------------------
+// Objects that stop being drawn (destroyed, culled, or no
+// longer static) are swept up every unusedFrames frames,
+// rather than walking every entry every frame
+// --------------------------------------------------------
+void ObjectBufferCache::BeginFrame()
+{
+	frame++;
+	createdCount = 0;
+	releasedCount = 0;
+
+	if (frame % unusedFrames != 0)
+		return;
+
+	for (std::unordered_map<unsigned int, Entry>::iterator i = entries.begin(); i != entries.end(); )
+	{
+		if (frame - i->second.LastFrame < unusedFrames)
+		{
+			++i;
+			continue;
+		}
+
+		ReleaseBuffer(i->second);
+		i = entries.erase(i);
+	}
+}
+
+ID3D11Buffer * ObjectBufferCache::GetBuffer(unsigned int objectId, const XMFLOAT4X4 & world, StateCache * stateCache)
+{
+	std::pair<std::unordered_map<unsigned int, Entry>::iterator, bool> found =
+		entries.insert(std::pair<unsigned int, Entry>(objectId, Entry()));
+	Entry & entry = found.first->second;
+	entry.LastFrame = frame;
+
+	// Moving (or new) - back to uploading every draw
+	if (found.second || memcmp(&entry.World, &world, sizeof(XMFLOAT4X4)) != 0)
+	{
+		entry.World = world;
+		entry.StillFrames = 0;
+		if (found.second)
+			entry.Buffer = 0;
+		else
+			ReleaseBuffer(entry);
+		return 0;
+	}
+
+	if (entry.Buffer)
+		return entry.Buffer;
+
+	if (++entry.StillFrames < settleFrames)
+		return 0;
+
+	// Settled, so the matrix goes up once and stays
+	VertexPerObjectConstants constants;
+	constants.World = world;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = sizeof(constants);
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = &constants;
+
+	if (FAILED(device->CreateBuffer(&desc, &data, &entry.Buffer)))
+	{
+		// Try again once it's held still a while longer
+		entry.Buffer = 0;
+		entry.StillFrames = 0;
+		return 0;
+	}
+
+	stateCache->RecordUpload(sizeof(constants));
+	bufferCount++;
+	createdCount++;
+	return entry.Buffer;
+}
+
+void ObjectBufferCache::ReleaseBuffer(Entry & entry)
+{
+	if (!entry.Buffer)
+		return;
+
+	entry.Buffer->Release();
+	entry.Buffer = 0;
+	bufferCount--;
+	releasedCount++;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "StateCache.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Immutable per-object constant buffers for objects that
+// have stopped moving.  An object's world matrix is uploaded
+// once, into a buffer of its own, and after that drawing it
+// only binds that buffer.
+//
+// Objects migrate on their own: one whose matrix has held
+// still for a few frames gets a buffer, and one whose matrix
+// changes loses it and goes back to uploading every draw
+// until it settles again.  Buffers hold a
+// VertexPerObjectConstants.
+// --------------------------------------------------------
+class ObjectBufferCache
+{
+public:
+	/// @param _device: device to create buffers with
+	/// @param _settleFrames: frames an object's matrix must stay
+	/// the same before it gets a buffer
+	/// @param _unusedFrames: frames an object can go undrawn before
+	/// its buffer is released
+	ObjectBufferCache(ID3D11Device * _device, unsigned int _settleFrames, unsigned int _unusedFrames);
+	~ObjectBufferCache();
+
+	/// Starts a frame, now and then releasing buffers of objects
+	/// that haven't been drawn for a while
+	void BeginFrame();
+
+	/// Finds the buffer to draw an object with
+	/// @param objectId: stays the same for the object from frame to
+	/// frame, e.g. its entity handle
+	/// @param world: the (transposed) world matrix it's drawn with
+	/// this frame
+	/// @param stateCache: counts the matrix when a buffer is created
+	/// @return: the object's buffer, already holding the matrix, or
+	/// null if it hasn't settled - upload the matrix as usual then
+	ID3D11Buffer * GetBuffer(unsigned int objectId, const DirectX::XMFLOAT4X4 & world, StateCache * stateCache);
+
+	/// Number of objects that have a buffer
+	unsigned int GetBufferCount() { return bufferCount; }
+
+	/// Buffers created and released since the last BeginFrame(),
+	/// as objects stopped and started moving
+	unsigned int GetCreatedCount() { return createdCount; }
+	unsigned int GetReleasedCount() { return releasedCount; }
+
+private:
+	struct Entry
+	{
+		DirectX::XMFLOAT4X4 World;
+		ID3D11Buffer * Buffer;
+		unsigned int StillFrames;
+		unsigned int LastFrame;
+	};
+
+	ID3D11Device * device;
+	unsigned int settleFrames;
+	unsigned int unusedFrames;
+	unsigned int frame;
+	std::unordered_map<unsigned int, Entry> entries;
+
+	unsigned int bufferCount;
+	unsigned int createdCount;
+	unsigned int releasedCount;
+
+	void ReleaseBuffer(Entry & entry);
+};
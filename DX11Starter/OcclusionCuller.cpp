@@ -0,0 +1,411 @@
+#include "OcclusionCuller.h"
+#include <chrono>
+#include <future>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Tiles are the unit of work handed to threads
+static const int TILE_WIDTH = 64;
+static const int TILE_HEIGHT = 32;
+
+// Max-depth blocks for quick occludee rejection
+static const int BLOCK_SIZE = 8;
+
+// Vertices this close to (or behind) the camera plane can't
+// be projected safely
+static const float MIN_CLIP_W = 0.0001f;
+
+static float ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+OcclusionCuller::OcclusionCuller(int _width, int _height, int _threadCount)
+{
+	assert(_width % BLOCK_SIZE == 0 && _height % BLOCK_SIZE == 0);
+
+	width = _width;
+	height = _height;
+	threadCount = _threadCount < 1 ? 1 : _threadCount;
+
+	tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	blocksX = width / BLOCK_SIZE;
+	blocksY = height / BLOCK_SIZE;
+
+	depth.resize(width * height, 1.0f);
+	blockMaxDepth.resize(blocksX * blocksY, 1.0f);
+	tileBins.resize(tilesX * tilesY);
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	stats = {};
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4 & _viewProjection)
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMLoadFloat4x4(&_viewProjection)));
+
+	triangles.clear();
+	for (size_t i = 0; i < tileBins.size(); i++)
+	{
+		tileBins[i].clear();
+	}
+
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(blockMaxDepth.begin(), blockMaxDepth.end(), 1.0f);
+	stats = {};
+}
+
+#pragma region Occluders
+
+void OcclusionCuller::AddOccluder(Mesh * mesh, const XMFLOAT4X4 & worldMatrix)
+{
+	AddOccluder(mesh->GetPositions(), mesh->GetIndices(), worldMatrix);
+}
+
+// --------------------------------------------------------
+// Projects the occluder's vertices, sets up each triangle
+// that's on screen and adds it to the bin of every tile its
+// bounding box touches
+// --------------------------------------------------------
+void OcclusionCuller::AddOccluder(const std::vector<XMFLOAT3> & positions, const std::vector<unsigned int> & indices, const XMFLOAT4X4 & worldMatrix)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	XMMATRIX worldViewProj = XMMatrixMultiply(
+		XMMatrixTranspose(XMLoadFloat4x4(&worldMatrix)),
+		XMLoadFloat4x4(&viewProjection));
+
+	clipVertices.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		XMStoreFloat4(&clipVertices[i], XMVector3Transform(XMLoadFloat3(&positions[i]), worldViewProj));
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const XMFLOAT4 * clip[3] = { &clipVertices[indices[i]], &clipVertices[indices[i + 1]], &clipVertices[indices[i + 2]] };
+
+		// Triangles crossing the near plane are skipped rather than
+		// clipped.  That only ever loses occlusion, never adds it
+		if (clip[0]->w < MIN_CLIP_W || clip[1]->w < MIN_CLIP_W || clip[2]->w < MIN_CLIP_W ||
+			clip[0]->z < 0.0f || clip[1]->z < 0.0f || clip[2]->z < 0.0f)
+			continue;
+
+		// To pixels (y down) and depth
+		float x[3], y[3], z[3];
+		for (int v = 0; v < 3; v++)
+		{
+			float invW = 1.0f / clip[v]->w;
+			x[v] = (clip[v]->x * invW * 0.5f + 0.5f) * width;
+			y[v] = (0.5f - clip[v]->y * invW * 0.5f) * height;
+			z[v] = clip[v]->z * invW;
+		}
+
+		ScreenTriangle tri;
+		tri.MinX = (int)floorf(fminf(x[0], fminf(x[1], x[2])));
+		tri.MinY = (int)floorf(fminf(y[0], fminf(y[1], y[2])));
+		tri.MaxX = (int)floorf(fmaxf(x[0], fmaxf(x[1], x[2])));
+		tri.MaxY = (int)floorf(fmaxf(y[0], fmaxf(y[1], y[2])));
+
+		tri.MinX = tri.MinX < 0 ? 0 : tri.MinX;
+		tri.MinY = tri.MinY < 0 ? 0 : tri.MinY;
+		tri.MaxX = tri.MaxX > width - 1 ? width - 1 : tri.MaxX;
+		tri.MaxY = tri.MaxY > height - 1 ? height - 1 : tri.MaxY;
+		if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+			continue;
+
+		// Edge function for the edge opposite each vertex
+		for (int e = 0; e < 3; e++)
+		{
+			int a = (e + 1) % 3;
+			int b = (e + 2) % 3;
+			tri.EdgeA[e] = y[a] - y[b];
+			tri.EdgeB[e] = x[b] - x[a];
+			tri.EdgeC[e] = x[a] * y[b] - y[a] * x[b];
+		}
+
+		// Twice the signed area.  Flip back facing triangles so
+		// "inside" is always positive - occluders are two sided
+		float area = tri.EdgeA[0] * x[0] + tri.EdgeB[0] * y[0] + tri.EdgeC[0];
+		if (fabsf(area) < 1e-6f)
+			continue;
+
+		if (area < 0.0f)
+		{
+			area = -area;
+			for (int e = 0; e < 3; e++)
+			{
+				tri.EdgeA[e] = -tri.EdgeA[e];
+				tri.EdgeB[e] = -tri.EdgeB[e];
+				tri.EdgeC[e] = -tri.EdgeC[e];
+			}
+		}
+
+		// Depth is linear in screen space, so it's a plane built
+		// from the barycentric weights (edge value / area)
+		float invArea = 1.0f / area;
+		tri.DepthA = (tri.EdgeA[0] * z[0] + tri.EdgeA[1] * z[1] + tri.EdgeA[2] * z[2]) * invArea;
+		tri.DepthB = (tri.EdgeB[0] * z[0] + tri.EdgeB[1] * z[1] + tri.EdgeB[2] * z[2]) * invArea;
+		tri.DepthC = (tri.EdgeC[0] * z[0] + tri.EdgeC[1] * z[1] + tri.EdgeC[2] * z[2]) * invArea;
+
+		unsigned int index = (unsigned int)triangles.size();
+		triangles.push_back(tri);
+		stats.OccluderTriangles++;
+
+		for (int ty = tri.MinY / TILE_HEIGHT; ty <= tri.MaxY / TILE_HEIGHT; ty++)
+		{
+			for (int tx = tri.MinX / TILE_WIDTH; tx <= tri.MaxX / TILE_WIDTH; tx++)
+			{
+				tileBins[ty * tilesX + tx].push_back(index);
+			}
+		}
+	}
+
+	stats.RasterizeMs += ElapsedMs(start);
+}
+
+// --------------------------------------------------------
+// Every tile only writes its own pixels, so tiles can be
+// split across threads with no locking
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeOccluders()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	if (threadCount == 1 || triangles.empty())
+	{
+		RasterizeTiles(0, 1);
+	}
+	else
+	{
+		// This thread takes a share of the tiles too
+		std::vector<std::future<void>> workers;
+		for (int i = 1; i < threadCount; i++)
+		{
+			workers.push_back(std::async(std::launch::async, &OcclusionCuller::RasterizeTiles, this, i, threadCount));
+		}
+
+		RasterizeTiles(0, threadCount);
+
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i].wait();
+		}
+	}
+
+	stats.RasterizeMs += ElapsedMs(start);
+}
+
+void OcclusionCuller::RasterizeTiles(int firstTile, int tileStride)
+{
+	int tileCount = tilesX * tilesY;
+	for (int tile = firstTile; tile < tileCount; tile += tileStride)
+	{
+		RasterizeTile(tile);
+		BuildBlockDepths(tile);
+	}
+}
+
+// --------------------------------------------------------
+// Rasterizes a tile's triangles four pixels at a time,
+// keeping the nearest depth
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTile(int tile)
+{
+	int tileX0 = (tile % tilesX) * TILE_WIDTH;
+	int tileY0 = (tile / tilesX) * TILE_HEIGHT;
+	int tileX1 = tileX0 + TILE_WIDTH > width ? width : tileX0 + TILE_WIDTH;
+	int tileY1 = tileY0 + TILE_HEIGHT > height ? height : tileY0 + TILE_HEIGHT;
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+
+	const std::vector<unsigned int> & bin = tileBins[tile];
+	for (size_t i = 0; i < bin.size(); i++)
+	{
+		const ScreenTriangle & tri = triangles[bin[i]];
+
+		// Clip the bounding box to the tile, starting on a 4 pixel
+		// boundary.  Tiles are a multiple of 4 wide, so the last
+		// group of 4 never crosses the tile's edge
+		int x0 = (tri.MinX > tileX0 ? tri.MinX : tileX0) & ~3;
+		int x1 = tri.MaxX + 1 < tileX1 ? tri.MaxX + 1 : tileX1;
+		int y0 = tri.MinY > tileY0 ? tri.MinY : tileY0;
+		int y1 = tri.MaxY + 1 < tileY1 ? tri.MaxY + 1 : tileY1;
+
+		XMVECTOR edgeA0 = XMVectorReplicate(tri.EdgeA[0]);
+		XMVECTOR edgeA1 = XMVectorReplicate(tri.EdgeA[1]);
+		XMVECTOR edgeA2 = XMVectorReplicate(tri.EdgeA[2]);
+		XMVECTOR depthA = XMVectorReplicate(tri.DepthA);
+
+		for (int y = y0; y < y1; y++)
+		{
+			float py = y + 0.5f;
+			XMVECTOR row0 = XMVectorReplicate(tri.EdgeB[0] * py + tri.EdgeC[0]);
+			XMVECTOR row1 = XMVectorReplicate(tri.EdgeB[1] * py + tri.EdgeC[1]);
+			XMVECTOR row2 = XMVectorReplicate(tri.EdgeB[2] * py + tri.EdgeC[2]);
+			XMVECTOR rowDepth = XMVectorReplicate(tri.DepthB * py + tri.DepthC);
+
+			float * depthRow = &depth[y * width];
+			for (int x = x0; x < x1; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				XMVECTOR inside = XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA0, px, row0), zero);
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA1, px, row1), zero));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA2, px, row2), zero));
+
+				XMVECTOR z = XMVectorMultiplyAdd(depthA, px, rowDepth);
+				XMVECTOR current = XMLoadFloat4((const XMFLOAT4 *)&depthRow[x]);
+				XMVECTOR closer = XMVectorAndInt(inside, XMVectorLess(z, current));
+
+				XMStoreFloat4((XMFLOAT4 *)&depthRow[x], XMVectorSelect(current, z, closer));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Records the farthest depth in each 8x8 block of a tile.
+// If a box is nearer than that everywhere it covers, it's
+// definitely in front of something
+// --------------------------------------------------------
+void OcclusionCuller::BuildBlockDepths(int tile)
+{
+	int tileX0 = (tile % tilesX) * TILE_WIDTH;
+	int tileY0 = (tile / tilesX) * TILE_HEIGHT;
+	int tileX1 = tileX0 + TILE_WIDTH > width ? width : tileX0 + TILE_WIDTH;
+	int tileY1 = tileY0 + TILE_HEIGHT > height ? height : tileY0 + TILE_HEIGHT;
+
+	for (int by = tileY0 / BLOCK_SIZE; by < tileY1 / BLOCK_SIZE; by++)
+	{
+		for (int bx = tileX0 / BLOCK_SIZE; bx < tileX1 / BLOCK_SIZE; bx++)
+		{
+			XMVECTOR farthest = XMVectorZero();
+			for (int y = by * BLOCK_SIZE; y < (by + 1) * BLOCK_SIZE; y++)
+			{
+				const float * depthRow = &depth[y * width + bx * BLOCK_SIZE];
+				farthest = XMVectorMax(farthest, XMLoadFloat4((const XMFLOAT4 *)&depthRow[0]));
+				farthest = XMVectorMax(farthest, XMLoadFloat4((const XMFLOAT4 *)&depthRow[4]));
+			}
+
+			XMFLOAT4 lanes;
+			XMStoreFloat4(&lanes, farthest);
+			blockMaxDepth[by * blocksX + bx] = fmaxf(fmaxf(lanes.x, lanes.y), fmaxf(lanes.z, lanes.w));
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region Occludees
+
+// --------------------------------------------------------
+// Projects the box's corners to a screen rectangle and its
+// nearest depth.  The box is hidden if every pixel in that
+// rectangle has an occluder nearer than the box's nearest
+// point.  Blocks are checked first, pixels only where a
+// block's farthest depth doesn't already decide it.
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(XMFLOAT3 center, XMFLOAT3 extents)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	stats.OccludeesTested++;
+
+	XMMATRIX viewProj = XMLoadFloat4x4(&viewProjection);
+
+	float minX = (float)width;
+	float minY = (float)height;
+	float maxX = 0.0f;
+	float maxY = 0.0f;
+	float minZ = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 corner(
+			center.x + ((i & 1) ? extents.x : -extents.x),
+			center.y + ((i & 2) ? extents.y : -extents.y),
+			center.z + ((i & 4) ? extents.z : -extents.z));
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&corner), viewProj));
+
+		// Reaches the camera - can't be hidden
+		if (clip.w < MIN_CLIP_W || clip.z < 0.0f)
+		{
+			stats.TestMs += ElapsedMs(start);
+			return true;
+		}
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * invW * 0.5f) * height;
+		float z = clip.z * invW;
+
+		minX = fminf(minX, x);
+		minY = fminf(minY, y);
+		maxX = fmaxf(maxX, x);
+		maxY = fmaxf(maxY, y);
+		minZ = fminf(minZ, z);
+	}
+
+	int x0 = (int)floorf(minX);
+	int y0 = (int)floorf(minY);
+	int x1 = (int)floorf(maxX);
+	int y1 = (int)floorf(maxY);
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 > width - 1 ? width - 1 : x1;
+	y1 = y1 > height - 1 ? height - 1 : y1;
+
+	// Off screen entirely - that's for frustum culling to decide
+	if (x0 > x1 || y0 > y1)
+	{
+		stats.TestMs += ElapsedMs(start);
+		return true;
+	}
+
+	bool visible = false;
+	for (int by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE && !visible; by++)
+	{
+		for (int bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE && !visible; bx++)
+		{
+			// Everything in this block is nearer than the box
+			if (blockMaxDepth[by * blocksX + bx] < minZ)
+				continue;
+
+			// Check the block's pixels that the box covers
+			int px0 = bx * BLOCK_SIZE > x0 ? bx * BLOCK_SIZE : x0;
+			int py0 = by * BLOCK_SIZE > y0 ? by * BLOCK_SIZE : y0;
+			int px1 = (bx + 1) * BLOCK_SIZE - 1 < x1 ? (bx + 1) * BLOCK_SIZE - 1 : x1;
+			int py1 = (by + 1) * BLOCK_SIZE - 1 < y1 ? (by + 1) * BLOCK_SIZE - 1 : y1;
+			for (int y = py0; y <= py1 && !visible; y++)
+			{
+				for (int x = px0; x <= px1; x++)
+				{
+					if (depth[y * width + x] >= minZ)
+					{
+						visible = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (!visible)
+		stats.OccludeesCulled++;
+
+	stats.TestMs += ElapsedMs(start);
+	return visible;
+}
+
+#pragma endregion
@@ -0,0 +1,113 @@
+#pragma once
+#include "Mesh.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Per frame numbers from the occlusion culler
+// --------------------------------------------------------
+struct OcclusionStats
+{
+	unsigned int OccluderTriangles;	// Triangles that reached the rasterizer
+	unsigned int OccludeesTested;
+	unsigned int OccludeesCulled;
+	float RasterizeMs;				// Transforming, binning and rasterizing occluders
+	float TestMs;					// Testing occludee boxes
+
+	float GetCulledPercent() const { return OccludeesTested ? 100.0f * OccludeesCulled / OccludeesTested : 0.0f; }
+};
+
+// --------------------------------------------------------
+// Software occlusion culling.  Chosen occluder meshes are
+// rasterized on the CPU into a small depth buffer, then the
+// screen space bounds of other objects are tested against it.
+//
+//  - The screen is split into tiles, and triangles are binned
+//    per tile, so tiles can be rasterized on separate threads
+//  - Pixels are rasterized four at a time with SIMD
+//  - A max-depth buffer of 8x8 blocks (the hierarchical part)
+//    lets most occludee tests finish without reading pixels
+//
+// Depth runs 0 (near) to 1 (far), like D3D's.  Everything is
+// plain CPU code, so it doesn't need a device to run.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	/// @param _width: depth buffer width, a multiple of 8
+	/// @param _height: depth buffer height, a multiple of 8
+	/// @param _threadCount: threads used to rasterize, 1 for none
+	OcclusionCuller(int _width, int _height, int _threadCount);
+	~OcclusionCuller();
+
+	/// Clears the depth buffer and stats for a new view
+	/// @param viewProjection: the view-projection matrix, transposed
+	/// like Camera::GetViewProjectionMatrix()
+	void BeginFrame(const DirectX::XMFLOAT4X4 & viewProjection);
+
+	/// Transforms and bins an occluder's triangles
+	/// @param mesh: mesh to rasterize
+	/// @param worldMatrix: the mesh's (transposed) world matrix
+	void AddOccluder(Mesh * mesh, const DirectX::XMFLOAT4X4 & worldMatrix);
+
+	/// Same as above, for geometry that isn't a Mesh
+	void AddOccluder(const std::vector<DirectX::XMFLOAT3> & positions, const std::vector<unsigned int> & indices, const DirectX::XMFLOAT4X4 & worldMatrix);
+
+	/// Rasterizes all added occluders.  Call once after the
+	/// last AddOccluder() and before any IsVisible()
+	void RasterizeOccluders();
+
+	/// Tests a world space box against the rasterized occluders
+	/// @param center: center of the box
+	/// @param extents: half size of the box on each axis
+	/// @return: false only if the box is completely hidden
+	bool IsVisible(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+	// Getters
+	const OcclusionStats & GetStats() { return stats; }
+	const float * GetDepthBuffer() { return &depth[0]; }
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+
+private:
+	// An occluder triangle set up for rasterizing: three edge
+	// functions (ax + by + c >= 0 inside), a depth plane and
+	// a pixel bounding box
+	struct ScreenTriangle
+	{
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		float DepthA;
+		float DepthB;
+		float DepthC;
+		int MinX;
+		int MinY;
+		int MaxX;
+		int MaxY;
+	};
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	int blocksX;
+	int blocksY;
+	int threadCount;
+
+	// Untransposed, for transforming on the CPU
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	std::vector<float> depth;
+	std::vector<float> blockMaxDepth;
+
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int>> tileBins;
+	std::vector<DirectX::XMFLOAT4> clipVertices;
+
+	OcclusionStats stats;
+
+	void RasterizeTiles(int firstTile, int tileStride);
+	void RasterizeTile(int tile);
+	void BuildBlockDepths(int tile);
+};
@@ -1,5 +1,13 @@
+// Optional features.  Game compiles variants with any mix
+// of these defined through ShaderVariants - keep its list of
+// them in step.  The project's own build defines them all
+//  - TEXTURED: surface color comes from diffuseTexture
+//  - SECOND_LIGHT: light2 is added to light1
+
+#ifdef TEXTURED
 Texture2D diffuseTexture  : register(t0);
 SamplerState basicSampler : register(s0);
+#endif
 
 struct DirectionalLight
 {
@@ -8,7 +16,10 @@ struct DirectionalLight
 	float3 Direction;
 };
 
-cbuffer lightBuffer : register(b0)
+// Lights only change once per frame
+// - Mirrored by PixelPerFrameConstants in ShaderConstants.h
+// - Both lights stay in every variant, so the layout matches
+cbuffer perFrame : register(b0)
 {
 	DirectionalLight light1;
 	DirectionalLight light2;
@@ -51,8 +62,16 @@ float4 calculateLight(DirectionalLight light, VertexToPixel input)
 float4 main(VertexToPixel input) : SV_TARGET
 {
 	// Calculate surface color of textures
+#ifdef TEXTURED
 	float4 surfaceColor = diffuseTexture.Sample(basicSampler, input.uv);
+#else
+	float4 surfaceColor = float4(1, 1, 1, 1);
+#endif
 
 	// Calculate lighting direction based on values from the vertex shader and cbuffer
-	return float4((surfaceColor.rgb * calculateLight(light1, input)) + (surfaceColor.rgb * calculateLight(light2, input)), 1);
+	float3 color = surfaceColor.rgb * calculateLight(light1, input);
+#ifdef SECOND_LIGHT
+	color += surfaceColor.rgb * calculateLight(light2, input);
+#endif
+	return float4(color, 1);
 }
\ No newline at end of file
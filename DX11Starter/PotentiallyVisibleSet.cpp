@@ -0,0 +1,462 @@
+#include "PotentiallyVisibleSet.h"
+#include "OcclusionCuller.h"
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include <fstream>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Size of each cube face rendered while baking
+static const int BAKE_FACE_SIZE = 64;
+
+// Identifies baked files, and changes whenever the layout does
+static const uint32_t PVS_FILE_MAGIC = 0x32535650;	// "PVS2"
+
+PotentiallyVisibleSet::PotentiallyVisibleSet()
+{
+	boundsMin = XMFLOAT3(0, 0, 0);
+	cellSize = 1.0f;
+	cellsX = 0;
+	cellsY = 0;
+	cellsZ = 0;
+	currentCell = -1;
+}
+
+PotentiallyVisibleSet::~PotentiallyVisibleSet()
+{
+}
+
+#pragma region Baking
+
+// --------------------------------------------------------
+// For every cell, renders the static occluders from nine
+// points (the center and eight points near the corners) in
+// six directions each, and marks every static entity that
+// passes both the frustum and the occlusion test in any of
+// those views.  Sampling means a sliver seen only from
+// between samples can be missed, so keep cells small
+// --------------------------------------------------------
+void PotentiallyVisibleSet::Bake(EntityPool * entities, XMFLOAT3 _boundsMin, XMFLOAT3 _boundsMax, float _cellSize)
+{
+	boundsMin = _boundsMin;
+	cellSize = _cellSize;
+	cellsX = (int)ceilf((_boundsMax.x - _boundsMin.x) / cellSize);
+	cellsY = (int)ceilf((_boundsMax.y - _boundsMin.y) / cellSize);
+	cellsZ = (int)ceilf((_boundsMax.z - _boundsMin.z) / cellSize);
+	cellsX = cellsX < 1 ? 1 : cellsX;
+	cellsY = cellsY < 1 ? 1 : cellsY;
+	cellsZ = cellsZ < 1 ? 1 : cellsZ;
+
+	// Gather the static entities and their bounds
+	objects.clear();
+	idToObject.clear();
+	FrustumCuller frustumCuller;
+	std::vector<Entity *> bakedEntities;
+	std::vector<XMFLOAT3> centers;
+	std::vector<XMFLOAT3> extents;
+	for (size_t i = 0; i < entities->Size(); i++)
+	{
+		Entity * entity = (*entities)[i];
+		if (!entity->GetStatic())
+			continue;
+
+		// An id the set can't tell apart from another entity's
+		unsigned int id = entity->GetStaticId();
+		if (id >= PVS_MAX_STATIC_IDS || (id < idToObject.size() && idToObject[id] != -1))
+			continue;
+
+		XMFLOAT3 center;
+		XMFLOAT3 extent;
+		entity->GetWorldBounds(center, extent);
+
+		if (id >= idToObject.size())
+			idToObject.resize(id + 1, -1);
+		idToObject[id] = (int)objects.size();
+
+		objects.push_back(id);
+		bakedEntities.push_back(entity);
+		centers.push_back(center);
+		extents.push_back(extent);
+		frustumCuller.AddBox(center, extent);
+	}
+
+	// Views down each axis, 90 degrees wide so they cover everything
+	const XMFLOAT3 faceDirections[6] = { XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1) };
+	const XMFLOAT3 faceUps[6] = { XMFLOAT3(0, 1, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 1, 0) };
+	XMMATRIX faceProjection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.05f, 1000.0f);
+
+	OcclusionCuller occlusionCuller(BAKE_FACE_SIZE, BAKE_FACE_SIZE, 1);
+	std::vector<uint8_t> bits((objects.size() + 7) / 8);
+	XMFLOAT4 planes[6];
+
+	compressed.clear();
+	cellOffsets.clear();
+	for (int z = 0; z < cellsZ; z++)
+	{
+		for (int y = 0; y < cellsY; y++)
+		{
+			for (int x = 0; x < cellsX; x++)
+			{
+				std::fill(bits.begin(), bits.end(), (uint8_t)0);
+
+				XMFLOAT3 cellMin(
+					boundsMin.x + x * cellSize,
+					boundsMin.y + y * cellSize,
+					boundsMin.z + z * cellSize);
+
+				for (int sample = 0; sample < 9; sample++)
+				{
+					// Center, then the corners pulled 10% towards it
+					XMFLOAT3 eye(cellMin.x + cellSize * 0.5f, cellMin.y + cellSize * 0.5f, cellMin.z + cellSize * 0.5f);
+					if (sample > 0)
+					{
+						int corner = sample - 1;
+						eye.x = cellMin.x + cellSize * ((corner & 1) ? 0.9f : 0.1f);
+						eye.y = cellMin.y + cellSize * ((corner & 2) ? 0.9f : 0.1f);
+						eye.z = cellMin.z + cellSize * ((corner & 4) ? 0.9f : 0.1f);
+					}
+
+					for (int face = 0; face < 6; face++)
+					{
+						XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&faceDirections[face]), XMLoadFloat3(&faceUps[face]));
+						XMFLOAT4X4 viewProjection;
+						XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(view * faceProjection));
+
+						Camera::ExtractFrustumPlanes(viewProjection, planes);
+						frustumCuller.Cull(planes);
+
+						occlusionCuller.BeginFrame(viewProjection);
+						for (size_t i = 0; i < objects.size(); i++)
+						{
+							Entity * entity = bakedEntities[i];
+							if (entity->GetOccluder() && frustumCuller.IsVisible(i))
+								occlusionCuller.AddOccluder(entity->GetMesh(), entity->GetWorldMatrix());
+						}
+						occlusionCuller.RasterizeOccluders();
+
+						for (size_t i = 0; i < objects.size(); i++)
+						{
+							if (bits[i / 8] & (1 << (i % 8)))
+								continue;
+
+							if (frustumCuller.IsVisible(i) && occlusionCuller.IsVisible(centers[i], extents[i]))
+								bits[i / 8] |= (uint8_t)(1 << (i % 8));
+						}
+					}
+				}
+
+				cellOffsets.push_back((uint32_t)compressed.size());
+				Compress(bits, compressed);
+			}
+		}
+	}
+	cellOffsets.push_back((uint32_t)compressed.size());
+
+	currentCell = -1;
+}
+
+#pragma endregion
+
+#pragma region Files
+
+// --------------------------------------------------------
+// Layout: magic, grid (min corner, cell size, counts), then
+// the objects' static ids, cell offsets and compressed bits, each
+// prefixed by their count
+// --------------------------------------------------------
+bool PotentiallyVisibleSet::SaveToFile(const char * fileName)
+{
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	uint32_t objectCount = (uint32_t)objects.size();
+	uint32_t offsetCount = (uint32_t)cellOffsets.size();
+	uint32_t compressedSize = (uint32_t)compressed.size();
+
+	file.write((const char *)&PVS_FILE_MAGIC, sizeof(uint32_t));
+	file.write((const char *)&boundsMin, sizeof(XMFLOAT3));
+	file.write((const char *)&cellSize, sizeof(float));
+	file.write((const char *)&cellsX, sizeof(int));
+	file.write((const char *)&cellsY, sizeof(int));
+	file.write((const char *)&cellsZ, sizeof(int));
+
+	file.write((const char *)&objectCount, sizeof(uint32_t));
+	if (objectCount) file.write((const char *)&objects[0], objectCount * sizeof(uint32_t));
+	file.write((const char *)&offsetCount, sizeof(uint32_t));
+	if (offsetCount) file.write((const char *)&cellOffsets[0], offsetCount * sizeof(uint32_t));
+	file.write((const char *)&compressedSize, sizeof(uint32_t));
+	if (compressedSize) file.write((const char *)&compressed[0], compressedSize);
+
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Reads values back in the order SaveToFile() wrote them.
+// Reading past the end (or a count that can't possibly fit in
+// what's left) marks it failed and returns zeroes from then on
+// --------------------------------------------------------
+struct PVSReader
+{
+	const uint8_t * data;
+	size_t size;
+	size_t position;
+	bool failed;
+
+	bool Has(size_t bytes)
+	{
+		if (!failed && bytes <= size - position)
+			return true;
+		failed = true;
+		return false;
+	}
+
+	void Bytes(void * destination, size_t bytes)
+	{
+		if (!Has(bytes))
+		{
+			memset(destination, 0, bytes);
+			return;
+		}
+		memcpy(destination, data + position, bytes);
+		position += bytes;
+	}
+
+	uint32_t U32()
+	{
+		uint32_t value = 0;
+		Bytes(&value, sizeof(uint32_t));
+		return value;
+	}
+
+	// Every element takes elementSize bytes, so a count bigger
+	// than that allows for is corrupt
+	uint32_t Count(size_t elementSize)
+	{
+		uint32_t count = U32();
+		if (!Has((size_t)count * elementSize))
+			return 0;
+		return count;
+	}
+};
+
+bool PotentiallyVisibleSet::LoadFromFile(const char * fileName)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<uint8_t> bytes((size_t)size);
+	file.seekg(0);
+	file.read((char *)&bytes[0], size);
+	if (!file.good())
+		return false;
+
+	return Deserialize(&bytes[0], bytes.size());
+}
+
+// --------------------------------------------------------
+// Everything in a file is checked before it's used: the grid
+// has to be sane, every static id has to be in range and
+// used only once, and every cell's range has to lie inside the
+// compressed data.  Anything else leaves the set empty
+// --------------------------------------------------------
+bool PotentiallyVisibleSet::Deserialize(const uint8_t * data, size_t size)
+{
+	objects.clear();
+	idToObject.clear();
+	cellOffsets.clear();
+	compressed.clear();
+	currentCell = -1;
+
+	PVSReader reader = { data, size, 0, false };
+	if (reader.U32() != PVS_FILE_MAGIC)
+		return false;
+
+	reader.Bytes(&boundsMin, sizeof(XMFLOAT3));
+	reader.Bytes(&cellSize, sizeof(float));
+	reader.Bytes(&cellsX, sizeof(int));
+	reader.Bytes(&cellsY, sizeof(int));
+	reader.Bytes(&cellsZ, sizeof(int));
+
+	// Read into locals first, so nothing is kept from a bad file
+	std::vector<unsigned int> fileObjects(reader.Count(sizeof(uint32_t)));
+	if (!fileObjects.empty())
+		reader.Bytes(&fileObjects[0], fileObjects.size() * sizeof(uint32_t));
+
+	std::vector<uint32_t> fileOffsets(reader.Count(sizeof(uint32_t)));
+	if (!fileOffsets.empty())
+		reader.Bytes(&fileOffsets[0], fileOffsets.size() * sizeof(uint32_t));
+
+	std::vector<uint8_t> fileCompressed(reader.Count(1));
+	if (!fileCompressed.empty())
+		reader.Bytes(&fileCompressed[0], fileCompressed.size());
+
+	bool valid = !reader.failed && reader.position == size;
+
+	// A grid whose cell count matches the offsets
+	valid = valid && cellSize > 0.0f && cellSize < FLT_MAX;
+	valid = valid && cellsX > 0 && cellsY > 0 && cellsZ > 0;
+	valid = valid && (uint64_t)cellsX * cellsY * cellsZ + 1 == fileOffsets.size();
+
+	// Ids in range, each naming a single object
+	std::vector<int> fileLookup;
+	for (size_t i = 0; valid && i < fileObjects.size(); i++)
+	{
+		unsigned int id = fileObjects[i];
+		if (id >= PVS_MAX_STATIC_IDS || (id < fileLookup.size() && fileLookup[id] != -1))
+		{
+			valid = false;
+			break;
+		}
+
+		if (id >= fileLookup.size())
+			fileLookup.resize(id + 1, -1);
+		fileLookup[id] = (int)i;
+	}
+
+	// Cell ranges in order and inside the compressed data
+	for (size_t i = 0; valid && i < fileOffsets.size(); i++)
+	{
+		if (fileOffsets[i] > fileCompressed.size() || (i > 0 && fileOffsets[i] < fileOffsets[i - 1]))
+			valid = false;
+	}
+
+	if (!valid)
+	{
+		cellsX = 0;
+		cellsY = 0;
+		cellsZ = 0;
+		return false;
+	}
+
+	objects.swap(fileObjects);
+	idToObject.swap(fileLookup);
+	cellOffsets.swap(fileOffsets);
+	compressed.swap(fileCompressed);
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Runtime
+
+void PotentiallyVisibleSet::SetViewPosition(XMFLOAT3 position)
+{
+	int x = (int)floorf((position.x - boundsMin.x) / cellSize);
+	int y = (int)floorf((position.y - boundsMin.y) / cellSize);
+	int z = (int)floorf((position.z - boundsMin.z) / cellSize);
+
+	int cell = -1;
+	if (x >= 0 && y >= 0 && z >= 0 && x < cellsX && y < cellsY && z < cellsZ && !cellOffsets.empty())
+		cell = (z * cellsY + y) * cellsX + x;
+
+	if (cell == currentCell)
+		return;
+
+	currentCell = cell;
+	if (cell != -1)
+	{
+		currentBits.resize((objects.size() + 7) / 8);
+		Decompress(compressed.data() + cellOffsets[cell], cellOffsets[cell + 1] - cellOffsets[cell], currentBits);
+	}
+}
+
+bool PotentiallyVisibleSet::IsVisible(unsigned int staticId)
+{
+	if (currentCell == -1 || staticId >= idToObject.size() || idToObject[staticId] == -1)
+		return true;
+
+	int object = idToObject[staticId];
+	return (currentBits[object / 8] & (1 << (object % 8))) != 0;
+}
+
+#pragma endregion
+
+#pragma region Compression
+
+// --------------------------------------------------------
+// PackBits style run length encoding.  Each control byte is
+// either a run (high bit set: repeat the next byte 2-129
+// times) or a literal (copy the next 1-128 bytes).  Mostly
+// empty or mostly full sets shrink to a few bytes
+// --------------------------------------------------------
+void PotentiallyVisibleSet::Compress(const std::vector<uint8_t> & bits, std::vector<uint8_t> & output)
+{
+	size_t i = 0;
+	while (i < bits.size())
+	{
+		// Measure the run starting here
+		size_t run = 1;
+		while (i + run < bits.size() && bits[i + run] == bits[i] && run < 129)
+			run++;
+
+		if (run >= 2)
+		{
+			output.push_back((uint8_t)(0x80 | (run - 2)));
+			output.push_back(bits[i]);
+			i += run;
+			continue;
+		}
+
+		// Gather literals until the next run of 2 or more
+		size_t start = i;
+		while (i < bits.size() && i - start < 128)
+		{
+			if (i + 1 < bits.size() && bits[i + 1] == bits[i])
+				break;
+			i++;
+		}
+
+		output.push_back((uint8_t)(i - start - 1));
+		output.insert(output.end(), bits.begin() + start, bits.begin() + i);
+	}
+}
+
+void PotentiallyVisibleSet::Decompress(const uint8_t * data, size_t size, std::vector<uint8_t> & bits)
+{
+	size_t out = 0;
+	size_t i = 0;
+	while (i < size && out < bits.size())
+	{
+		uint8_t control = data[i++];
+		if (control & 0x80)
+		{
+			// A run cut off by the end of the data has no value
+			if (i >= size)
+				break;
+
+			size_t run = (control & 0x7F) + 2;
+			for (size_t r = 0; r < run && out < bits.size(); r++)
+			{
+				bits[out++] = data[i];
+			}
+			i++;
+		}
+		else
+		{
+			size_t literals = control + 1;
+			for (size_t l = 0; l < literals && out < bits.size() && i < size; l++)
+			{
+				bits[out++] = data[i++];
+			}
+		}
+	}
+
+	// Whatever corrupt data didn't cover counts as visible
+	while (out < bits.size())
+	{
+		bits[out++] = 0xFF;
+	}
+}
+
+#pragma endregion
@@ -0,0 +1,89 @@
+#pragma once
+#include "EntityPool.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+// Static ids a baked set can refer to, which bounds the size
+// of its id lookup table
+const unsigned int PVS_MAX_STATIC_IDS = 1 << 20;
+
+// --------------------------------------------------------
+// Baked visibility for static entities.  The level is split
+// into a grid of cells, and each cell stores a (compressed)
+// bitset of the static entities that can be seen from
+// anywhere in it.  At runtime the camera's cell is looked up
+// and everything outside its set is skipped.
+//
+// Entities are known by their static id rather than their
+// handle, so a baked file still matches when the level is
+// loaded again and its entities get different handles.
+// Entities that weren't static when baked, or have moved
+// since, are unknown to the set and always count as visible.
+// --------------------------------------------------------
+class PotentiallyVisibleSet
+{
+public:
+	PotentiallyVisibleSet();
+	~PotentiallyVisibleSet();
+
+	/// Computes visibility for every cell by rendering the static
+	/// occluders on the CPU from sample points in the cell, looking
+	/// in all six directions.  Slow - meant for load time or tools.
+	/// Only the first static entity with a given id is baked, and
+	/// ids from PVS_MAX_STATIC_IDS up aren't baked at all
+	/// @param entities: pool holding the static entities
+	/// @param _boundsMin: smallest corner of the space the camera can be in
+	/// @param _boundsMax: largest corner of the space the camera can be in
+	/// @param _cellSize: size of each cell
+	void Bake(EntityPool * entities, DirectX::XMFLOAT3 _boundsMin, DirectX::XMFLOAT3 _boundsMax, float _cellSize);
+
+	/// Saves or loads baked data, so it only has to be baked once
+	/// @return: false if the file couldn't be written or read
+	bool SaveToFile(const char * fileName);
+	bool LoadFromFile(const char * fileName);
+
+	/// Loads baked data from memory, in the file layout.  Corrupt
+	/// or truncated data is rejected, leaving the set empty
+	/// @return: false if the data isn't a valid baked set
+	bool Deserialize(const uint8_t * data, size_t size);
+
+	/// Picks the cell the camera is in.  Only does real work
+	/// (decompressing a set) when the cell changes
+	/// @param position: world space camera position
+	void SetViewPosition(DirectX::XMFLOAT3 position);
+
+	/// Whether a static entity might be visible from the current
+	/// cell.  Always true outside the baked region, and for ids
+	/// the set doesn't know (including NO_STATIC_ID)
+	/// @param staticId: the entity's Entity::GetStaticId()
+	bool IsVisible(unsigned int staticId);
+
+	// Getters
+	size_t GetCellCount() { return cellOffsets.empty() ? 0 : cellOffsets.size() - 1; }
+	size_t GetObjectCount() { return objects.size(); }
+	size_t GetCompressedSize() { return compressed.size(); }
+
+private:
+	// Grid layout
+	DirectX::XMFLOAT3 boundsMin;
+	float cellSize;
+	int cellsX;
+	int cellsY;
+	int cellsZ;
+
+	// Static ids of the entities baked into the set, by bit index
+	std::vector<unsigned int> objects;
+	std::vector<int> idToObject;	// By static id, -1 if not baked
+
+	// Every cell's compressed bitset back to back
+	std::vector<uint8_t> compressed;
+	std::vector<uint32_t> cellOffsets;
+
+	// Decompressed set for the camera's cell, or -1 if outside
+	int currentCell;
+	std::vector<uint8_t> currentBits;
+
+	static void Compress(const std::vector<uint8_t> & bits, std::vector<uint8_t> & output);
+	static void Decompress(const uint8_t * data, size_t size, std::vector<uint8_t> & bits);
+};
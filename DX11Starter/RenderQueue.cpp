@@ -0,0 +1,125 @@
+#include "RenderQueue.h"
+#include <cstring>
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Begin(int threadCount)
+{
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Keep the old lists (and their capacity) around
+	if ((int)threadPackets.size() < threadCount)
+		threadPackets.resize(threadCount);
+	for (size_t i = 0; i < threadPackets.size(); i++)
+	{
+		threadPackets[i].clear();
+	}
+	packets.clear();
+}
+
+void RenderQueue::Add(int thread, uint64_t key, uint32_t item)
+{
+	RenderPacket packet;
+	packet.Key = key;
+	packet.Item = item;
+	threadPackets[thread].push_back(packet);
+}
+
+// --------------------------------------------------------
+// Least significant digit radix sort, a byte per pass.  All
+// eight histograms are built in one read of the keys, and
+// passes where every key has the same byte (common in the
+// high bits, with few shaders and materials) are skipped
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	for (size_t i = 0; i < threadPackets.size(); i++)
+	{
+		packets.insert(packets.end(), threadPackets[i].begin(), threadPackets[i].end());
+	}
+
+	size_t count = packets.size();
+	if (count < 2)
+		return;
+
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = packets[i].Key;
+		for (int pass = 0; pass < 8; pass++)
+		{
+			histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	scratch.resize(count);
+	RenderPacket * source = packets.data();
+	RenderPacket * dest = scratch.data();
+
+	for (int pass = 0; pass < 8; pass++)
+	{
+		uint32_t * histogram = histograms[pass];
+		int shift = pass * 8;
+
+		// Already sorted on this byte if it's the same everywhere
+		if (histogram[(source[0].Key >> shift) & 0xFF] == count)
+			continue;
+
+		// Counts to starting offsets
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			dest[histogram[(source[i].Key >> shift) & 0xFF]++] = source[i];
+		}
+
+		RenderPacket * swap = source;
+		source = dest;
+		dest = swap;
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer
+	if (source != packets.data())
+		packets.swap(scratch);
+}
+
+// --------------------------------------------------------
+// Positive floats order the same way as their bit patterns,
+// so the top 24 bits of the depth work as a quantized depth
+// with no near/far range needed
+// --------------------------------------------------------
+uint64_t RenderQueue::MakeKey(RenderPass pass, unsigned int shaderId, unsigned int materialId, unsigned int meshId, float depth)
+{
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t quantizedDepth = depthBits >> 8;
+
+	uint64_t state =
+		((uint64_t)(shaderId & RENDER_KEY_MAX_SHADER) << 24) |
+		((uint64_t)(materialId & RENDER_KEY_MAX_MATERIAL) << 12) |
+		(uint64_t)(meshId & RENDER_KEY_MAX_MESH);
+
+	uint64_t key = (uint64_t)pass << 62;
+	if (pass == RENDER_PASS_TRANSPARENT)
+		key |= ((~quantizedDepth & 0xFFFFFF) << 38) | (state << 4);
+	else
+		key |= (state << 28) | (quantizedDepth << 4);
+	return key;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Passes are the highest bits of a sort key, so every
+// opaque draw comes before every transparent one
+// --------------------------------------------------------
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_TRANSPARENT = 1
+};
+
+// Largest ids that fit in a sort key
+const unsigned int RENDER_KEY_MAX_SHADER = (1 << 10) - 1;
+const unsigned int RENDER_KEY_MAX_MATERIAL = (1 << 12) - 1;
+const unsigned int RENDER_KEY_MAX_MESH = (1 << 12) - 1;
+
+// --------------------------------------------------------
+// One draw: its sort key and the index of the render item
+// it came from
+// --------------------------------------------------------
+struct RenderPacket
+{
+	uint64_t Key;
+	uint32_t Item;
+};
+
+// --------------------------------------------------------
+// Collects draws as 64 bit sort keys and radix sorts them,
+// so submission can walk them in an order that changes
+// state as little as possible.
+//
+// Opaque keys (high bits to low):
+//   pass (2) | shader (10) | material (12) | mesh (12) | depth (24)
+// so opaque draws are grouped by state, then front to back.
+// Transparent keys put inverted depth right after the pass:
+//   pass (2) | ~depth (24) | shader (10) | material (12) | mesh (12)
+// so they are drawn back to front regardless of state.
+//
+// Several threads may add draws at once, each to its own
+// list - Sort() merges them.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	/// Empties the queue, keeping allocated memory
+	/// @param threadCount: how many threads will call Add()
+	void Begin(int threadCount);
+
+	/// Adds a draw.  Threads must use different thread indices
+	/// @param thread: index of the calling thread, below the count
+	/// given to Begin()
+	/// @param key: sort key from MakeKey()
+	/// @param item: index of the render item to draw
+	void Add(int thread, uint64_t key, uint32_t item);
+
+	/// Merges every thread's draws and sorts them by key
+	void Sort();
+
+	// Getters (valid after Sort())
+	size_t GetCount() { return packets.size(); }
+	const RenderPacket & GetPacket(size_t index) { return packets[index]; }
+
+	/// Builds a sort key.  Ids past the largest that fit are wrapped
+	/// @param pass: which pass the draw belongs to
+	/// @param shaderId: id of the shader pair, see Material::GetShaderId()
+	/// @param materialId: id of the material, see Material::GetId()
+	/// @param meshId: id of the mesh, see Mesh::GetId()
+	/// @param depth: view space distance from the camera
+	static uint64_t MakeKey(RenderPass pass, unsigned int shaderId, unsigned int materialId, unsigned int meshId, float depth);
+
+private:
+	std::vector<std::vector<RenderPacket>> threadPackets;
+	std::vector<RenderPacket> packets;
+	std::vector<RenderPacket> scratch;
+};
@@ -0,0 +1,220 @@
+#include "RenderState.h"
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+#pragma region RenderItem
+
+void RenderItem::SetWorldMatrix(XMFLOAT4X4 worldMatrix) const
+{
+	// Send data to shader variables
+	//  - Do this ONCE PER OBJECT you're drawing
+	//  - This is actually a complex process of copying data to a local buffer
+	//    and then copying that entire buffer to the GPU.
+	//  - The "SimpleShader" class handles all of that for you.
+	//  - The material looked up where "world" lives already, so
+	//    this is just a copy
+	ItemMaterial->GetVertexShader()->SetMatrix4x4(ItemMaterial->GetWorldHandle(), worldMatrix);
+
+	// Once you've set all of the data you care to change for
+	// the next draw call, you need to actually send it to the GPU
+	//  - If you skip this, the "SetMatrix" call above won't make it to the GPU!
+	//  - Only the per-object buffer changes between draws, so
+	//    that's the only one copied here
+	ItemMaterial->GetVertexShader()->CopyBufferData(CBUFFER_PER_OBJECT);
+}
+
+bool RenderItem::BindObjectBuffer(ID3D11Buffer * objectBuffer) const
+{
+	// The buffer takes the per-object buffer's slot until the next
+	// SetWorldMatrix() puts the shader's own back
+	return ItemMaterial->GetVertexShader()->BindExternalBuffer(ItemMaterial->GetObjectBufferHandle(), objectBuffer);
+}
+
+void RenderItem::BindMaterial() const
+{
+	ItemMaterial->GetPixelShader()->SetShaderResourceView(ItemMaterial->GetTextureHandle(), ItemMaterial->getShaderResourceView());
+	ItemMaterial->GetPixelShader()->SetSamplerState(ItemMaterial->GetSamplerHandle(), ItemMaterial->getSamplerState());
+	ItemMaterial->GetVertexShader()->CopyBufferData(CBUFFER_PER_MATERIAL);
+	ItemMaterial->GetPixelShader()->CopyBufferData(CBUFFER_PER_MATERIAL);
+
+	// Set the vertex and pixel shaders to use for the next Draw() command
+	//  - Once you start applying different shaders to different objects,
+	//    you'll need to swap the current shaders before each draw
+	ItemMaterial->GetVertexShader()->SetShader();
+	ItemMaterial->GetPixelShader()->SetShader();
+}
+
+void RenderItem::BindMesh(StateCache * stateCache) const
+{
+	// Set buffers in the input assembler
+	//  - Each object might have different geometry, but the
+	//    cache skips the binds when it's the same as the last
+	stateCache->SetVertexBuffer(0, ItemMesh->GetVertexBuffer(), sizeof(Vertex), 0);
+	stateCache->SetIndexBuffer(ItemMesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void RenderItem::Draw(StateCache * stateCache) const
+{
+	BindMesh(stateCache);
+	Submit(stateCache->GetContext());
+}
+
+void RenderItem::Submit(ID3D11DeviceContext * context) const
+{
+	// Finally do the actual drawing
+	//  - Do this ONCE PER OBJECT you intend to draw
+	//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
+	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
+	//     vertices in the currently set VERTEX BUFFER
+	context->DrawIndexed(
+		ItemMesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
+		0,     // Offset to the first index we want to use
+		0);    // Offset to add to each index when looking up vertices
+}
+
+void RenderItem::SubmitInstanced(ID3D11DeviceContext * context, unsigned int instanceCount, unsigned int startInstance) const
+{
+	context->DrawIndexedInstanced(
+		ItemMesh->GetIndexCount(),	// Indices per copy
+		instanceCount,				// Number of copies
+		0,							// Offset to the first index
+		0,							// Offset to add to each index
+		startInstance);				// Offset to the first instance's data
+}
+
+#pragma endregion
+
+#pragma region RenderStateBuffer
+
+RenderStateBuffer::RenderStateBuffer()
+{
+	writeIndex = 0;
+	readIndex = 1;
+	frameCounter = 0;
+	framePending = false;
+
+	for (int i = 0; i < 2; i++)
+	{
+		frames[i].FrameNumber = 0;
+		XMStoreFloat4x4(&frames[i].ViewMatrix, XMMatrixIdentity());
+		XMStoreFloat4x4(&frames[i].ProjectionMatrix, XMMatrixIdentity());
+		frames[i].CameraPosition = XMFLOAT3(0, 0, 0);
+		frames[i].PreviousCameraPosition = XMFLOAT3(0, 0, 0);
+		XMStoreFloat4(&frames[i].CameraRotation, XMQuaternionIdentity());
+		XMStoreFloat4(&frames[i].PreviousCameraRotation, XMQuaternionIdentity());
+		activeReaders[i] = 0;
+		activeWriter[i] = false;
+	}
+}
+
+RenderStateBuffer::~RenderStateBuffer()
+{
+}
+
+// --------------------------------------------------------
+// Hands out the write frame.  The items vector keeps its
+// capacity, so steady-state frames don't allocate
+// --------------------------------------------------------
+RenderFrame & RenderStateBuffer::BeginWrite()
+{
+	std::lock_guard<std::mutex> lock(accessMutex);
+	activeWriter[writeIndex] = true;
+
+	RenderFrame & frame = frames[writeIndex];
+	frame.Items.clear();
+	frame.FrameNumber = ++frameCounter;
+	return frame;
+}
+
+void RenderStateBuffer::EndWrite()
+{
+	std::lock_guard<std::mutex> lock(accessMutex);
+	activeWriter[writeIndex] = false;
+	framePending = true;
+}
+
+const RenderFrame & RenderStateBuffer::BeginRead()
+{
+	std::lock_guard<std::mutex> lock(accessMutex);
+	readIndex = 1 - writeIndex;
+	activeReaders[readIndex]++;
+
+	return frames[readIndex];
+}
+
+void RenderStateBuffer::EndRead()
+{
+	std::lock_guard<std::mutex> lock(accessMutex);
+	activeReaders[readIndex]--;
+}
+
+// --------------------------------------------------------
+// Flips which frame is written and which is read
+// --------------------------------------------------------
+bool RenderStateBuffer::Swap()
+{
+	std::lock_guard<std::mutex> lock(accessMutex);
+
+	// Swapping under an active reader or writer would let one
+	// side see a half-updated frame
+	if (activeReaders[0] || activeReaders[1] || activeWriter[0] || activeWriter[1])
+		return false;
+
+	// Keep showing the last frame if the simulation didn't
+	// tick this frame, rather than flipping back to an old one
+	if (!framePending)
+		return true;
+
+	writeIndex = 1 - writeIndex;
+	framePending = false;
+	return true;
+}
+
+// --------------------------------------------------------
+// Decomposes both transforms and blends them piecewise
+// (lerp for scale and translation, slerp for rotation), so
+// rotating objects don't shear between ticks
+// --------------------------------------------------------
+XMFLOAT4X4 RenderStateBuffer::InterpolateMatrix(const XMFLOAT4X4 & previous, const XMFLOAT4X4 & current, float alpha)
+{
+	// Most objects don't move, so skip the math for them
+	if (alpha >= 1.0f || memcmp(&previous, &current, sizeof(XMFLOAT4X4)) == 0)
+		return current;
+
+	// Stored transposed for HLSL, so undo that first
+	XMVECTOR prevScale, prevRot, prevPos;
+	XMVECTOR currScale, currRot, currPos;
+	if (!XMMatrixDecompose(&prevScale, &prevRot, &prevPos, XMMatrixTranspose(XMLoadFloat4x4(&previous))) ||
+		!XMMatrixDecompose(&currScale, &currRot, &currPos, XMMatrixTranspose(XMLoadFloat4x4(&current))))
+		return current;
+
+	XMMATRIX blended = XMMatrixAffineTransformation(
+		XMVectorLerp(prevScale, currScale, alpha),
+		XMVectorZero(),
+		XMQuaternionSlerp(prevRot, currRot, alpha),
+		XMVectorLerp(prevPos, currPos, alpha));
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMMatrixTranspose(blended));
+	return result;
+}
+
+// --------------------------------------------------------
+// Lerps the camera position and slerps its orientation, then
+// builds the view from those like the camera itself does
+// --------------------------------------------------------
+XMFLOAT4X4 RenderStateBuffer::InterpolateView(const RenderFrame & frame, float alpha)
+{
+	if (alpha >= 1.0f)
+		return frame.ViewMatrix;
+
+	XMFLOAT3 position;
+	XMFLOAT4 rotation;
+	XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&frame.PreviousCameraPosition), XMLoadFloat3(&frame.CameraPosition), alpha));
+	XMStoreFloat4(&rotation, XMQuaternionSlerp(XMLoadFloat4(&frame.PreviousCameraRotation), XMLoadFloat4(&frame.CameraRotation), alpha));
+	return Camera::BuildViewMatrix(position, rotation);
+}
+
+#pragma endregion
@@ -0,0 +1,149 @@
+#pragma once
+#include "DXCore.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "StateCache.h"
+#include "Camera.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <mutex>
+
+// Constant buffer names shared with the shaders, grouped by how
+// often their contents change
+#define CBUFFER_PER_FRAME "perFrame"
+#define CBUFFER_PER_MATERIAL "perMaterial"
+#define CBUFFER_PER_OBJECT "perObject"
+
+// RenderItem::ObjectId of items that always upload their world matrix
+const unsigned int NO_OBJECT_ID = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Snapshot of everything the renderer needs to draw one
+// entity, copied out of the simulation once per frame
+// --------------------------------------------------------
+struct RenderItem
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 PreviousWorld;	// World matrix as of the previous tick
+	Mesh * ItemMesh;
+	Material * ItemMaterial;
+	bool Visible;
+
+	// Stable id (the entity handle) of a static entity, so it can
+	// be drawn from a persistent buffer once it stops moving (see
+	// ObjectBufferCache), or NO_OBJECT_ID
+	unsigned int ObjectId;
+
+	/// Sends the item's world matrix to its vertex shader.  Only
+	/// the per-object buffer is uploaded - per-frame data like the
+	/// camera is set once a frame, see Game::SetFrameConstants()
+	/// @param worldMatrix: the world matrix to draw with
+	void SetWorldMatrix(DirectX::XMFLOAT4X4 worldMatrix) const;
+
+	/// Binds a persistent buffer holding the item's world matrix
+	/// instead, so nothing is uploaded.  Must come after BindMaterial()
+	/// @param objectBuffer: buffer from an ObjectBufferCache
+	/// @return: false if the material's vertex shader can't take it,
+	/// in which case use SetWorldMatrix()
+	bool BindObjectBuffer(ID3D11Buffer * objectBuffer) const;
+
+	/// Binds the material's shaders, texture and sampler, and sends
+	/// its per-material data.  Only needed when the material changes
+	void BindMaterial() const;
+
+	/// Binds the item's vertex and index buffers.  Only needed when
+	/// the mesh changes
+	/// @param stateCache: cache in front of the device context
+	void BindMesh(StateCache * stateCache) const;
+
+	/// Draws the item's mesh, binding it first
+	/// @param stateCache: cache in front of the device context
+	/// used for drawing
+	void Draw(StateCache * stateCache) const;
+
+	/// Draws the item's mesh with whatever is currently bound
+	/// @param context: Pointer to the DirectX device context
+	void Submit(ID3D11DeviceContext * context) const;
+
+	/// Draws several copies of the item's mesh, taking their world
+	/// matrices from the bound instance buffer
+	/// @param context: Pointer to the DirectX device context
+	/// @param instanceCount: number of copies to draw
+	/// @param startInstance: instance buffer index of the first copy
+	void SubmitInstanced(ID3D11DeviceContext * context, unsigned int instanceCount, unsigned int startInstance) const;
+};
+
+// --------------------------------------------------------
+// Everything drawn in a single frame
+// --------------------------------------------------------
+struct RenderFrame
+{
+	std::vector<RenderItem> Items;
+	DirectX::XMFLOAT4X4 ViewMatrix;
+	DirectX::XMFLOAT4X4 ProjectionMatrix;
+
+	// Camera placement at this tick and the previous one, so the
+	// view can be rebuilt anywhere in between
+	DirectX::XMFLOAT3 CameraPosition;
+	DirectX::XMFLOAT4 CameraRotation;
+	DirectX::XMFLOAT3 PreviousCameraPosition;
+	DirectX::XMFLOAT4 PreviousCameraRotation;
+	unsigned int FrameNumber;
+};
+
+// --------------------------------------------------------
+// Two render frames: update writes one while draw reads the
+// other, and Swap() exchanges them at the frame sync point.
+// Swap() refuses to flip while either frame is in use, in
+// every build, so a misplaced swap can't tear a frame
+// --------------------------------------------------------
+class RenderStateBuffer
+{
+public:
+	RenderStateBuffer();
+	~RenderStateBuffer();
+
+	/// Starts writing the next frame, clearing its old items
+	/// @return: the frame the simulation should fill in
+	RenderFrame & BeginWrite();
+	void EndWrite();
+
+	/// Starts reading the most recently published frame
+	/// @return: the frame the renderer should draw
+	const RenderFrame & BeginRead();
+	void EndRead();
+
+	/// Publishes the written frame for reading.  Only an index
+	/// flip.  Does nothing if no frame was written since the
+	/// last swap
+	/// @return: false if a frame was still being read or written,
+	/// in which case nothing was swapped
+	bool Swap();
+
+	/// Blends between two rigid (transposed) transforms, used to
+	/// draw between simulation ticks
+	/// @param previous: the transform at the previous tick
+	/// @param current: the transform at the latest tick
+	/// @param alpha: 0 for previous, 1 for current
+	static DirectX::XMFLOAT4X4 InterpolateMatrix(const DirectX::XMFLOAT4X4 & previous, const DirectX::XMFLOAT4X4 & current, float alpha);
+
+	/// Builds the view between a frame's last two ticks from the
+	/// blended camera position and orientation.  Blending the view
+	/// matrices instead would swing the camera along an arc
+	/// @param frame: the frame being drawn
+	/// @param alpha: 0 for the previous tick, 1 for the latest
+	static DirectX::XMFLOAT4X4 InterpolateView(const RenderFrame & frame, float alpha);
+
+private:
+	RenderFrame frames[2];
+	int writeIndex;
+	unsigned int frameCounter;
+	bool framePending;
+
+	// Who is using which frame, so Swap() can refuse to flip
+	// under them.  Guarded by accessMutex
+	std::mutex accessMutex;
+	int activeReaders[2];
+	bool activeWriter[2];
+	int readIndex;
+};
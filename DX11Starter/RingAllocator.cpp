@@ -0,0 +1,83 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(unsigned int _capacity, unsigned int _alignment)
+{
+	alignment = _alignment > 0 ? _alignment : 1;
+	capacity = _capacity / alignment * alignment;
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+	firstFrame = 0;
+	frameCount = 0;
+	for (unsigned int i = 0; i < RING_MAX_FRAMES; i++)
+	{
+		frameSizes[i] = 0;
+	}
+}
+
+RingAllocator::~RingAllocator()
+{
+}
+
+// --------------------------------------------------------
+// Regions never straddle the end of the buffer - if one
+// doesn't fit, the rest of the buffer is skipped and counted
+// as used by this frame, so it's freed along with it
+// --------------------------------------------------------
+unsigned int RingAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		size = 1;
+	size = AlignSize(size);
+	if (size > capacity)
+		return RING_ALLOCATION_FAILED;
+
+	// Nothing live, so start from the beginning and skip nothing
+	if (used == 0)
+		head = 0;
+
+	unsigned int skipped = 0;
+	if (size > capacity - head)
+		skipped = capacity - head;
+
+	if (used + skipped + size > capacity)
+		return RING_ALLOCATION_FAILED;
+
+	if (skipped > 0)
+		head = 0;
+
+	unsigned int offset = head;
+	head += size;
+	if (head == capacity)
+		head = 0;
+
+	used += skipped + size;
+	frameBytes += skipped + size;
+	return offset;
+}
+
+void RingAllocator::EndFrame()
+{
+	if (frameCount == RING_MAX_FRAMES)
+	{
+		frameSizes[(firstFrame + frameCount - 1) % RING_MAX_FRAMES] += frameBytes;
+	}
+	else
+	{
+		frameSizes[(firstFrame + frameCount) % RING_MAX_FRAMES] = frameBytes;
+		frameCount++;
+	}
+	frameBytes = 0;
+}
+
+bool RingAllocator::RetireFrame()
+{
+	if (frameCount == 0)
+		return false;
+
+	used -= frameSizes[firstFrame];
+	frameSizes[firstFrame] = 0;
+	firstFrame = (firstFrame + 1) % RING_MAX_FRAMES;
+	frameCount--;
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Returned by RingAllocator::Allocate() when there's no room
+const unsigned int RING_ALLOCATION_FAILED = 0xFFFFFFFF;
+
+// Most frames a ring can have allocations outstanding from
+const unsigned int RING_MAX_FRAMES = 4;
+
+// --------------------------------------------------------
+// Hands out aligned regions of a fixed size buffer in order,
+// wrapping around at the end.  Regions are freed a whole
+// frame at a time: EndFrame() closes off what the current
+// frame allocated, and RetireFrame() frees the oldest closed
+// frame once whoever reads the memory (the GPU) is done.
+//
+// Only does the bookkeeping - the memory itself lives
+// elsewhere, see ConstantBufferRing.
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	/// @param _capacity: size of the buffer in bytes
+	/// @param _alignment: every region starts at and is rounded
+	/// up to a multiple of this
+	RingAllocator(unsigned int _capacity, unsigned int _alignment);
+	~RingAllocator();
+
+	/// Reserves a region for the current frame
+	/// @param size: bytes needed
+	/// @return: offset of the region, or RING_ALLOCATION_FAILED
+	/// if freeing more frames is needed first
+	unsigned int Allocate(unsigned int size);
+
+	/// Closes the current frame's allocations.  If RING_MAX_FRAMES
+	/// are already outstanding they join the newest one instead
+	void EndFrame();
+
+	/// Frees the oldest closed frame's allocations
+	/// @return: false if no frame was outstanding
+	bool RetireFrame();
+
+	/// Rounds a size up to the alignment
+	unsigned int AlignSize(unsigned int size) { return (size + alignment - 1) / alignment * alignment; }
+
+	// Getters
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetUsed() { return used; }
+	unsigned int GetPendingFrames() { return frameCount; }
+
+private:
+	unsigned int capacity;
+	unsigned int alignment;
+
+	// Next free byte, and bytes in use (including any skipped at the
+	// end when wrapping) - the oldest live byte is head - used
+	unsigned int head;
+	unsigned int used;
+
+	// Bytes used by the open frame, and by each closed one
+	unsigned int frameBytes;
+	unsigned int frameSizes[RING_MAX_FRAMES];
+	unsigned int firstFrame;
+	unsigned int frameCount;
+};
@@ -0,0 +1,21 @@
+#include "ShaderConstants.h"
+
+const SimpleBufferField VertexPerFrameConstants::Fields[] =
+{
+	SIMPLE_BUFFER_FIELD("view", VertexPerFrameConstants, View),
+	SIMPLE_BUFFER_FIELD("projection", VertexPerFrameConstants, Projection),
+};
+const unsigned int VertexPerFrameConstants::FieldCount = sizeof(Fields) / sizeof(Fields[0]);
+
+const SimpleBufferField VertexPerObjectConstants::Fields[] =
+{
+	SIMPLE_BUFFER_FIELD("world", VertexPerObjectConstants, World),
+};
+const unsigned int VertexPerObjectConstants::FieldCount = sizeof(Fields) / sizeof(Fields[0]);
+
+const SimpleBufferField PixelPerFrameConstants::Fields[] =
+{
+	SIMPLE_BUFFER_FIELD("light1", PixelPerFrameConstants, Light1),
+	SIMPLE_BUFFER_FIELD("light2", PixelPerFrameConstants, Light2),
+};
+const unsigned int PixelPerFrameConstants::FieldCount = sizeof(Fields) / sizeof(Fields[0]);
@@ -0,0 +1,47 @@
+#pragma once
+#include "SimpleShader.h"
+#include "Lights.h"
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// C++ mirrors of the shaders' constant buffers, so each can
+// be filled in and copied with one SetBufferStruct().
+// Member order, offsets and sizes must match the HLSL -
+// ISimpleShader::BindBufferStruct() checks them against the
+// compiled shader when it's loaded.
+//
+// HLSL packs variables into 16 byte rows and never lets one
+// straddle two, so C++ needs explicit padding where that
+// leaves gaps.
+// --------------------------------------------------------
+
+// "perFrame" in VertexShader.hlsl and VertexShaderInstanced.hlsl
+struct VertexPerFrameConstants
+{
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+
+	static const SimpleBufferField Fields[];
+	static const unsigned int FieldCount;
+};
+
+// "perObject" in VertexShader.hlsl, also the contents of the
+// persistent buffers ObjectBufferCache keeps
+struct VertexPerObjectConstants
+{
+	DirectX::XMFLOAT4X4 World;
+
+	static const SimpleBufferField Fields[];
+	static const unsigned int FieldCount;
+};
+
+// "perFrame" in PixelShader.hlsl
+struct PixelPerFrameConstants
+{
+	DirectionalLight Light1;
+	float Padding1;	// Light1 ends on a float3, so Light2 starts a new row
+	DirectionalLight Light2;
+
+	static const SimpleBufferField Fields[];
+	static const unsigned int FieldCount;
+};
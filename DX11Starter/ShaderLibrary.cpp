@@ -0,0 +1,178 @@
+#include "ShaderLibrary.h"
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+static float ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+ShaderLibrary::ShaderLibrary(ID3D11Device * _device, ID3D11DeviceContext * _context)
+{
+	device = _device;
+	context = _context;
+	stateCache = 0;
+	constantRing = 0;
+	inputLayoutCache = 0;
+	firstToLoad = 0;
+	lastToLoad = 0;
+	nextToLoad = 0;
+	totalLoadTime = 0.0f;
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	Wait();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		delete entries[i].Shader;
+	}
+}
+
+ShaderHandle ShaderLibrary::Add(ShaderStage stage, std::wstring file)
+{
+	// Workers index into the entries, so they can't move now
+	Wait();
+
+	Entry entry;
+	entry.Stage = stage;
+	entry.File = file;
+	entry.LoadTime = 0.0f;
+
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX: entry.Shader = new SimpleVertexShader(device, context); break;
+	case SHADER_STAGE_PIXEL: entry.Shader = new SimplePixelShader(device, context); break;
+	case SHADER_STAGE_DOMAIN: entry.Shader = new SimpleDomainShader(device, context); break;
+	case SHADER_STAGE_HULL: entry.Shader = new SimpleHullShader(device, context); break;
+	case SHADER_STAGE_GEOMETRY: entry.Shader = new SimpleGeometryShader(device, context); break;
+	default: entry.Shader = new SimpleComputeShader(device, context); break;
+	}
+
+	entry.Shader->SetStateCache(stateCache);
+	entry.Shader->SetConstantBufferRing(constantRing);
+	entry.Shader->SetReflectionCacheFolder(reflectionCacheFolder);
+	if (stage == SHADER_STAGE_VERTEX)
+		static_cast<SimpleVertexShader *>(entry.Shader)->SetInputLayoutCache(inputLayoutCache);
+
+	entries.push_back(entry);
+	return (ShaderHandle)(entries.size() - 1);
+}
+
+void ShaderLibrary::StartLoading(unsigned int threadCount)
+{
+	Wait();
+
+	firstToLoad = lastToLoad;
+	lastToLoad = (unsigned int)entries.size();
+	nextToLoad = firstToLoad;
+	loadStart = std::chrono::high_resolution_clock::now();
+
+	// hardware_concurrency() is 0 when it can't tell, and with no
+	// workers nothing would ever load
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+	if (threadCount > lastToLoad - firstToLoad)
+		threadCount = lastToLoad - firstToLoad;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::async(std::launch::async, &ShaderLibrary::LoadShaders, this));
+	}
+}
+
+void ShaderLibrary::Wait()
+{
+	if (workers.empty())
+		return;
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].wait();
+	}
+	workers.clear();
+	totalLoadTime = ElapsedMs(loadStart);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Loaded %u shaders in %.2f ms\n", lastToLoad - firstToLoad, totalLoadTime);
+	for (unsigned int i = firstToLoad; i < lastToLoad; i++)
+	{
+		printf("  %ls: %.2f ms%s\n", entries[i].File.c_str(), entries[i].LoadTime,
+			entries[i].Shader->IsShaderValid() ? "" : " (failed)");
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Each worker takes the next unloaded shader until they've
+// all been taken, so slow shaders don't hold up the rest
+// --------------------------------------------------------
+void ShaderLibrary::LoadShaders()
+{
+	for (unsigned int i = nextToLoad++; i < lastToLoad; i = nextToLoad++)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		entries[i].Shader->LoadShaderFile(entries[i].File.c_str());
+		entries[i].LoadTime = ElapsedMs(start);
+	}
+}
+
+ISimpleShader * ShaderLibrary::Get(ShaderHandle handle)
+{
+	if (handle >= entries.size())
+		return 0;
+
+	// Only the newest batch can still be loading
+	if (handle >= firstToLoad)
+		Wait();
+	return entries[handle].Shader;
+}
+
+ISimpleShader * ShaderLibrary::Get(ShaderHandle handle, ShaderStage stage)
+{
+	if (handle >= entries.size() || entries[handle].Stage != stage)
+		return 0;
+	return Get(handle);
+}
+
+SimpleVertexShader * ShaderLibrary::GetVertexShader(ShaderHandle handle)
+{
+	return static_cast<SimpleVertexShader *>(Get(handle, SHADER_STAGE_VERTEX));
+}
+
+SimplePixelShader * ShaderLibrary::GetPixelShader(ShaderHandle handle)
+{
+	return static_cast<SimplePixelShader *>(Get(handle, SHADER_STAGE_PIXEL));
+}
+
+SimpleDomainShader * ShaderLibrary::GetDomainShader(ShaderHandle handle)
+{
+	return static_cast<SimpleDomainShader *>(Get(handle, SHADER_STAGE_DOMAIN));
+}
+
+SimpleHullShader * ShaderLibrary::GetHullShader(ShaderHandle handle)
+{
+	return static_cast<SimpleHullShader *>(Get(handle, SHADER_STAGE_HULL));
+}
+
+SimpleGeometryShader * ShaderLibrary::GetGeometryShader(ShaderHandle handle)
+{
+	return static_cast<SimpleGeometryShader *>(Get(handle, SHADER_STAGE_GEOMETRY));
+}
+
+SimpleComputeShader * ShaderLibrary::GetComputeShader(ShaderHandle handle)
+{
+	return static_cast<SimpleComputeShader *>(Get(handle, SHADER_STAGE_COMPUTE));
+}
+
+float ShaderLibrary::GetLoadTime(ShaderHandle handle)
+{
+	if (handle >= entries.size())
+		return 0.0f;
+	if (handle >= firstToLoad)
+		Wait();
+	return entries[handle].LoadTime;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "SimpleShader.h"
+#include <future>
+#include <atomic>
+#include <vector>
+#include <string>
+
+// --------------------------------------------------------
+// The kinds of simple shader a library can load
+// --------------------------------------------------------
+enum ShaderStage
+{
+	SHADER_STAGE_VERTEX,
+	SHADER_STAGE_PIXEL,
+	SHADER_STAGE_DOMAIN,
+	SHADER_STAGE_HULL,
+	SHADER_STAGE_GEOMETRY,
+	SHADER_STAGE_COMPUTE
+};
+
+// Identifies a shader added to a library
+typedef unsigned int ShaderHandle;
+
+// --------------------------------------------------------
+// Loads a list of compiled shaders on several threads at
+// once.  Reading, reflecting and creating shaders only needs
+// the device, which is free threaded, so each load is
+// independent of the others.
+//
+// Add() everything, StartLoading(), do something else, then
+// Wait() (or just Get() a shader, which waits).  The library
+// owns the shaders and deletes them with itself.
+// --------------------------------------------------------
+class ShaderLibrary
+{
+public:
+	/// @param _device: device to create shaders with
+	/// @param _context: context the shaders will be used with
+	ShaderLibrary(ID3D11Device * _device, ID3D11DeviceContext * _context);
+	~ShaderLibrary();
+
+	/// Passed on to each shader before it loads.  Anything shared
+	/// between shaders here has to cope with loads in parallel
+	void SetStateCache(StateCache * cache) { stateCache = cache; }
+	void SetConstantBufferRing(ConstantBufferRing * ring) { constantRing = ring; }
+	void SetReflectionCacheFolder(std::string folder) { reflectionCacheFolder = folder; }
+	void SetInputLayoutCache(InputLayoutCache * cache) { inputLayoutCache = cache; }
+
+	/// Adds a shader to be loaded by the next StartLoading()
+	/// @param stage: which kind of shader it is
+	/// @param file: the compiled shader
+	/// @return: handle to get the shader with once it's loaded
+	ShaderHandle Add(ShaderStage stage, std::wstring file);
+
+	/// Starts loading everything added since the last call, returning
+	/// straight away
+	/// @param threadCount: threads to load on, or 0 for one per core
+	void StartLoading(unsigned int threadCount = 0);
+
+	/// Waits until everything started has loaded
+	void Wait();
+
+	/// The shader for a handle, waiting for it to load if need be
+	/// @return: the shader, even if it failed to load (check
+	/// IsShaderValid()), or null for the wrong type of shader
+	ISimpleShader * Get(ShaderHandle handle);
+	SimpleVertexShader * GetVertexShader(ShaderHandle handle);
+	SimplePixelShader * GetPixelShader(ShaderHandle handle);
+	SimpleDomainShader * GetDomainShader(ShaderHandle handle);
+	SimpleHullShader * GetHullShader(ShaderHandle handle);
+	SimpleGeometryShader * GetGeometryShader(ShaderHandle handle);
+	SimpleComputeShader * GetComputeShader(ShaderHandle handle);
+
+	/// Milliseconds a shader took to load on its thread
+	float GetLoadTime(ShaderHandle handle);
+
+	/// Milliseconds from the last StartLoading() until everything
+	/// had loaded
+	float GetTotalLoadTime() { return totalLoadTime; }
+
+	unsigned int GetShaderCount() { return (unsigned int)entries.size(); }
+
+private:
+	struct Entry
+	{
+		ShaderStage Stage;
+		std::wstring File;
+		ISimpleShader * Shader;
+		float LoadTime;
+	};
+
+	ID3D11Device * device;
+	ID3D11DeviceContext * context;
+	StateCache * stateCache;
+	ConstantBufferRing * constantRing;
+	std::string reflectionCacheFolder;
+	InputLayoutCache * inputLayoutCache;
+
+	// Not resized while loading, so workers can index it freely
+	std::vector<Entry> entries;
+
+	// Entries from firstToLoad up are shared out by nextToLoad
+	unsigned int firstToLoad;
+	unsigned int lastToLoad;
+	std::atomic<unsigned int> nextToLoad;
+	std::vector<std::future<void>> workers;
+	std::chrono::high_resolution_clock::time_point loadStart;
+	float totalLoadTime;
+
+	/// Loads entries until there are none left
+	void LoadShaders();
+
+	ISimpleShader * Get(ShaderHandle handle, ShaderStage stage);
+};
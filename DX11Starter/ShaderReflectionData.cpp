@@ -0,0 +1,283 @@
+#include "ShaderReflectionData.h"
+#include <fstream>
+
+static const uint32_t REFLECTION_FILE_MAGIC = 0x4c464552;	// "REFL"
+static const uint32_t REFLECTION_FILE_VERSION = 1;
+
+#pragma region Writing
+
+static void WriteU32(std::vector<uint8_t> & out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		out.push_back((uint8_t)(value >> (i * 8)));
+	}
+}
+
+static void WriteU64(std::vector<uint8_t> & out, uint64_t value)
+{
+	WriteU32(out, (uint32_t)value);
+	WriteU32(out, (uint32_t)(value >> 32));
+}
+
+static void WriteString(std::vector<uint8_t> & out, const std::string & value)
+{
+	WriteU32(out, (uint32_t)value.size());
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+static void WriteParameters(std::vector<uint8_t> & out, const std::vector<ReflectedParameter> & parameters)
+{
+	WriteU32(out, (uint32_t)parameters.size());
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
+		WriteString(out, parameters[i].SemanticName);
+		WriteU32(out, parameters[i].SemanticIndex);
+		WriteU32(out, parameters[i].ComponentType);
+		WriteU32(out, parameters[i].Mask);
+		WriteU32(out, parameters[i].Stream);
+	}
+}
+
+#pragma endregion
+
+#pragma region Reading
+
+// --------------------------------------------------------
+// Reads values back in the order they were written.  Reading
+// past the end (or a count that can't possibly fit in what's
+// left) marks it failed and returns zeroes from then on
+// --------------------------------------------------------
+struct ReflectionReader
+{
+	const uint8_t * data;
+	size_t size;
+	size_t position;
+	bool failed;
+
+	bool Has(size_t bytes)
+	{
+		if (!failed && bytes <= size - position)
+			return true;
+		failed = true;
+		return false;
+	}
+
+	uint32_t U32()
+	{
+		if (!Has(4))
+			return 0;
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			value |= (uint32_t)data[position++] << (i * 8);
+		}
+		return value;
+	}
+
+	uint64_t U64()
+	{
+		uint64_t low = U32();
+		return low | ((uint64_t)U32() << 32);
+	}
+
+	std::string String()
+	{
+		uint32_t length = U32();
+		if (!Has(length))
+			return std::string();
+		std::string value((const char *)data + position, length);
+		position += length;
+		return value;
+	}
+
+	// Every element takes at least minSize bytes, so a count
+	// bigger than that allows for is corrupt
+	uint32_t Count(size_t minSize)
+	{
+		uint32_t count = U32();
+		if (!Has((size_t)count * minSize))
+			return 0;
+		return count;
+	}
+};
+
+static void ReadParameters(ReflectionReader & reader, std::vector<ReflectedParameter> & parameters)
+{
+	parameters.resize(reader.Count(20));
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
+		parameters[i].SemanticName = reader.String();
+		parameters[i].SemanticIndex = reader.U32();
+		parameters[i].ComponentType = reader.U32();
+		parameters[i].Mask = reader.U32();
+		parameters[i].Stream = reader.U32();
+	}
+}
+
+#pragma endregion
+
+ShaderReflectionData::ShaderReflectionData()
+{
+	Clear();
+}
+
+void ShaderReflectionData::Clear()
+{
+	ConstantBuffers.clear();
+	Resources.clear();
+	Inputs.clear();
+	Outputs.clear();
+	ThreadsX = 0;
+	ThreadsY = 0;
+	ThreadsZ = 0;
+}
+
+uint64_t ShaderReflectionData::HashBytecode(const void * code, size_t size)
+{
+	const uint8_t * bytes = (const uint8_t *)code;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Layout: magic, version, bytecode hash, then the constant
+// buffers (each with its variables), resources, input and
+// output signatures and thread group size.  Lists are
+// prefixed by their count and strings by their length
+// --------------------------------------------------------
+void ShaderReflectionData::Serialize(uint64_t bytecodeHash, std::vector<uint8_t> & out) const
+{
+	out.clear();
+	WriteU32(out, REFLECTION_FILE_MAGIC);
+	WriteU32(out, REFLECTION_FILE_VERSION);
+	WriteU64(out, bytecodeHash);
+
+	WriteU32(out, (uint32_t)ConstantBuffers.size());
+	for (size_t b = 0; b < ConstantBuffers.size(); b++)
+	{
+		const ReflectedConstantBuffer & cb = ConstantBuffers[b];
+		WriteString(out, cb.Name);
+		WriteU32(out, cb.Size);
+		WriteU32(out, cb.BindPoint);
+		WriteU32(out, (uint32_t)cb.Variables.size());
+		for (size_t v = 0; v < cb.Variables.size(); v++)
+		{
+			WriteString(out, cb.Variables[v].Name);
+			WriteU32(out, cb.Variables[v].StartOffset);
+			WriteU32(out, cb.Variables[v].Size);
+		}
+	}
+
+	WriteU32(out, (uint32_t)Resources.size());
+	for (size_t r = 0; r < Resources.size(); r++)
+	{
+		WriteString(out, Resources[r].Name);
+		WriteU32(out, Resources[r].Type);
+		WriteU32(out, Resources[r].BindPoint);
+	}
+
+	WriteParameters(out, Inputs);
+	WriteParameters(out, Outputs);
+	WriteU32(out, ThreadsX);
+	WriteU32(out, ThreadsY);
+	WriteU32(out, ThreadsZ);
+}
+
+bool ShaderReflectionData::Deserialize(const uint8_t * data, size_t size, uint64_t bytecodeHash)
+{
+	Clear();
+
+	ReflectionReader reader = { data, size, 0, false };
+	if (reader.U32() != REFLECTION_FILE_MAGIC ||
+		reader.U32() != REFLECTION_FILE_VERSION ||
+		reader.U64() != bytecodeHash)
+		return false;
+
+	ConstantBuffers.resize(reader.Count(16));
+	for (size_t b = 0; b < ConstantBuffers.size(); b++)
+	{
+		ReflectedConstantBuffer & cb = ConstantBuffers[b];
+		cb.Name = reader.String();
+		cb.Size = reader.U32();
+		cb.BindPoint = reader.U32();
+
+		// Constant buffers are whole 16 byte registers, and the
+		// shaders lay their local copies out assuming so
+		if (cb.Size % 16 != 0)
+			reader.failed = true;
+
+		cb.Variables.resize(reader.Count(12));
+		for (size_t v = 0; v < cb.Variables.size(); v++)
+		{
+			ReflectedVariable & var = cb.Variables[v];
+			var.Name = reader.String();
+			var.StartOffset = reader.U32();
+			var.Size = reader.U32();
+
+			// Setting a variable writes this range of the buffer
+			if (var.Size > cb.Size || var.StartOffset > cb.Size - var.Size)
+				reader.failed = true;
+		}
+	}
+
+	Resources.resize(reader.Count(12));
+	for (size_t r = 0; r < Resources.size(); r++)
+	{
+		Resources[r].Name = reader.String();
+		Resources[r].Type = reader.U32();
+		Resources[r].BindPoint = reader.U32();
+	}
+
+	ReadParameters(reader, Inputs);
+	ReadParameters(reader, Outputs);
+	ThreadsX = reader.U32();
+	ThreadsY = reader.U32();
+	ThreadsZ = reader.U32();
+
+	// Anything left over means it isn't what we think it is
+	if (reader.failed || reader.position != size)
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool ShaderReflectionData::SaveToFile(const char * fileName, uint64_t bytecodeHash) const
+{
+	std::vector<uint8_t> bytes;
+	Serialize(bytecodeHash, bytes);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.write((const char *)&bytes[0], bytes.size());
+	return file.good();
+}
+
+bool ShaderReflectionData::LoadFromFile(const char * fileName, uint64_t bytecodeHash)
+{
+	Clear();
+
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<uint8_t> bytes((size_t)size);
+	file.seekg(0);
+	file.read((char *)&bytes[0], size);
+	if (!file.good())
+		return false;
+
+	return Deserialize(&bytes[0], bytes.size(), bytecodeHash);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Plain copies of what the simple shaders read through
+// shader reflection.  Types are kept as the raw values of
+// the D3D enums, so nothing here depends on D3D
+// --------------------------------------------------------
+struct ReflectedVariable
+{
+	std::string Name;
+	uint32_t StartOffset;
+	uint32_t Size;
+};
+
+struct ReflectedConstantBuffer
+{
+	std::string Name;
+	uint32_t Size;
+	uint32_t BindPoint;
+	std::vector<ReflectedVariable> Variables;
+};
+
+struct ReflectedResource
+{
+	std::string Name;
+	uint32_t Type;			// D3D_SHADER_INPUT_TYPE
+	uint32_t BindPoint;
+};
+
+struct ReflectedParameter
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex;
+	uint32_t ComponentType;	// D3D_REGISTER_COMPONENT_TYPE
+	uint32_t Mask;
+	uint32_t Stream;
+};
+
+// --------------------------------------------------------
+// Everything a shader's reflection is needed for, so it can
+// be saved to a cache file keyed by the bytecode and loaded
+// on later runs instead of reflecting again.
+//
+// The file is little endian with fixed size fields whatever
+// the platform, and is rejected if it was written for other
+// bytecode or by another version of the format.
+// --------------------------------------------------------
+struct ShaderReflectionData
+{
+	std::vector<ReflectedConstantBuffer> ConstantBuffers;
+	std::vector<ReflectedResource> Resources;	// Every bound resource, buffers included
+	std::vector<ReflectedParameter> Inputs;
+	std::vector<ReflectedParameter> Outputs;
+	uint32_t ThreadsX;
+	uint32_t ThreadsY;
+	uint32_t ThreadsZ;
+
+	ShaderReflectionData();
+	void Clear();
+
+	/// 64 bit FNV-1a of compiled shader code, which cache files are keyed by
+	static uint64_t HashBytecode(const void * code, size_t size);
+
+	/// Writes the data in the cache format
+	/// @param bytecodeHash: HashBytecode() of the shader it came from
+	/// @param out: receives the bytes
+	void Serialize(uint64_t bytecodeHash, std::vector<uint8_t> & out) const;
+
+	/// Reads data written by Serialize()
+	/// @param bytecodeHash: HashBytecode() of the shader being loaded
+	/// @return: false (leaving the data empty) if it's truncated,
+	/// corrupt (including buffer sizes that aren't whole registers
+	/// and variables outside their buffer), another version, or
+	/// for different bytecode
+	bool Deserialize(const uint8_t * data, size_t size, uint64_t bytecodeHash);
+
+	/// Serialize() or Deserialize() through a file
+	/// @return: false if the file couldn't be written or read
+	bool SaveToFile(const char * fileName, uint64_t bytecodeHash) const;
+	bool LoadFromFile(const char * fileName, uint64_t bytecodeHash);
+};
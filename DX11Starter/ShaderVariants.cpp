@@ -0,0 +1,140 @@
+#include "ShaderVariants.h"
+#include <cstdio>
+
+ShaderVariantCache::ShaderVariantCache(ID3D11Device * _device, ID3D11DeviceContext * _context, std::wstring _sourceFile, std::string _target, const char * const * _defines, unsigned int defineCount)
+{
+	device = _device;
+	context = _context;
+	sourceFile = _sourceFile;
+	target = _target;
+	stateCache = 0;
+	constantRing = 0;
+
+	if (defineCount > MAX_SHADER_VARIANT_DEFINES)
+		defineCount = MAX_SHADER_VARIANT_DEFINES;
+	for (unsigned int i = 0; i < defineCount; i++)
+	{
+		defines.push_back(_defines[i]);
+	}
+	keyMask = (ShaderVariantKey)(((uint64_t)1 << defineCount) - 1);
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+	for (size_t i = 0; i < variantList.size(); i++)
+	{
+		delete variantList[i];
+	}
+}
+
+void ShaderVariantCache::SetPrecompiled(ShaderVariantKey key, std::wstring shaderFile)
+{
+	precompiled[key & keyMask] = shaderFile;
+}
+
+void ShaderVariantCache::Prewarm(const ShaderVariantKey * keys, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		GetShader(keys[i]);
+	}
+}
+
+ISimpleShader * ShaderVariantCache::GetShader(ShaderVariantKey key)
+{
+	key &= keyMask;
+	std::unordered_map<ShaderVariantKey, ISimpleShader *>::iterator found = variants.find(key);
+	if (found != variants.end())
+		return found->second;
+
+	ISimpleShader * shader = CreateShader();
+	shader->SetStateCache(stateCache);
+	shader->SetConstantBufferRing(constantRing);
+	shader->SetReflectionCacheFolder(reflectionCacheFolder);
+
+	// A precompiled file that's missing (or stale enough not to
+	// load) falls back to compiling the source
+	bool loaded = false;
+	std::unordered_map<ShaderVariantKey, std::wstring>::iterator file = precompiled.find(key);
+	if (file != precompiled.end())
+		loaded = shader->LoadShaderFile(file->second.c_str());
+
+	if (!loaded)
+	{
+		ID3DBlob * code = Compile(key);
+		if (code)
+		{
+			loaded = shader->LoadShaderBlob(code);
+			code->Release();
+		}
+	}
+
+	if (!loaded)
+	{
+		delete shader;
+		shader = 0;
+	}
+	else
+	{
+		variantList.push_back(shader);
+	}
+
+	variants[key] = shader;
+	return shader;
+}
+
+// --------------------------------------------------------
+// Each bit in the key defines the matching name as 1
+// --------------------------------------------------------
+ID3DBlob * ShaderVariantCache::Compile(ShaderVariantKey key)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (unsigned int i = 0; i < defines.size(); i++)
+	{
+		if (key & (1u << i))
+		{
+			D3D_SHADER_MACRO macro = { defines[i].c_str(), "1" };
+			macros.push_back(macro);
+		}
+	}
+	D3D_SHADER_MACRO end = { 0, 0 };
+	macros.push_back(end);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	UINT flags = D3DCOMPILE_DEBUG;
+#else
+	UINT flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	ID3DBlob * code = 0;
+	ID3DBlob * errors = 0;
+	HRESULT hr = D3DCompileFromFile(
+		sourceFile.c_str(),
+		&macros[0],
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		"main",
+		target.c_str(),
+		flags,
+		0,
+		&code,
+		&errors);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (FAILED(hr))
+	{
+		printf("Shader variant %ls (key 0x%x) failed to compile\n", sourceFile.c_str(), key);
+		if (errors)
+			printf("%s\n", (const char *)errors->GetBufferPointer());
+	}
+#endif
+
+	if (errors)
+		errors->Release();
+	if (FAILED(hr))
+	{
+		if (code)
+			code->Release();
+		return 0;
+	}
+	return code;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "SimpleShader.h"
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Which optional features a variant has: bit i turns on the
+// i'th define the variants were declared with
+typedef uint32_t ShaderVariantKey;
+
+const unsigned int MAX_SHADER_VARIANT_DEFINES = 32;
+
+// --------------------------------------------------------
+// Variants of one HLSL file, each compiled with a different
+// set of its optional defines, so shaders only contain the
+// features they're used with instead of branching on them.
+//
+// Variants are created the first time they're asked for -
+// loaded from a precompiled file if one was given for that
+// key, otherwise compiled from source - and kept until the
+// cache is deleted.  Prewarm() the ones needed straight away
+// so they don't stall the first frame they're drawn in.
+//
+// Use the typed ShaderVariants<> below.
+// --------------------------------------------------------
+class ShaderVariantCache
+{
+public:
+	/// @param _device: device to create shaders with
+	/// @param _context: context the shaders will be used with
+	/// @param _sourceFile: HLSL file variants are compiled from
+	/// @param _target: shader model to compile for, like "ps_5_0"
+	/// @param _defines: names of the optional features, up to MAX_SHADER_VARIANT_DEFINES
+	/// @param defineCount: number of names
+	ShaderVariantCache(ID3D11Device * _device, ID3D11DeviceContext * _context, std::wstring _sourceFile, std::string _target, const char * const * _defines, unsigned int defineCount);
+	virtual ~ShaderVariantCache();
+
+	/// Passed on to each variant as it's created
+	void SetStateCache(StateCache * cache) { stateCache = cache; }
+	void SetConstantBufferRing(ConstantBufferRing * ring) { constantRing = ring; }
+	void SetReflectionCacheFolder(std::string folder) { reflectionCacheFolder = folder; }
+
+	/// Loads a variant from compiled code rather than compiling it,
+	/// like the .cso the project builds.  Set before it's created
+	/// @param key: the defines the file was compiled with
+	/// @param shaderFile: the compiled shader
+	void SetPrecompiled(ShaderVariantKey key, std::wstring shaderFile);
+
+	/// Creates variants now rather than the first time they're used
+	void Prewarm(const ShaderVariantKey * keys, unsigned int count);
+
+	/// Variants created so far (not counting any that failed), in
+	/// the order they were created, for setting things on them all
+	unsigned int GetVariantCount() { return (unsigned int)variantList.size(); }
+	ISimpleShader * GetVariantByIndex(unsigned int index) { return variantList[index]; }
+
+protected:
+	/// The variant for a key, creating it if it's new
+	/// @return: null if it couldn't be loaded or compiled
+	ISimpleShader * GetShader(ShaderVariantKey key);
+
+	/// Makes a new, unloaded shader of the right type
+	virtual ISimpleShader * CreateShader() = 0;
+
+	ID3D11Device * device;
+	ID3D11DeviceContext * context;
+
+private:
+	std::wstring sourceFile;
+	std::string target;
+	std::vector<std::string> defines;
+	ShaderVariantKey keyMask;
+
+	StateCache * stateCache;
+	ConstantBufferRing * constantRing;
+	std::string reflectionCacheFolder;
+
+	std::unordered_map<ShaderVariantKey, std::wstring> precompiled;
+
+	// Failed variants map to null, so they aren't retried every frame
+	std::unordered_map<ShaderVariantKey, ISimpleShader *> variants;
+	std::vector<ISimpleShader *> variantList;
+
+	/// Compiles the source with the key's defines
+	/// @return: the compiled code, or null (errors are printed in debug)
+	ID3DBlob * Compile(ShaderVariantKey key);
+};
+
+// --------------------------------------------------------
+// Variant cache for one shader type, e.g.
+//
+//   ShaderVariants<SimplePixelShader> variants(device, context,
+//       L"PixelShader.hlsl", "ps_5_0", defines, defineCount);
+//   SimplePixelShader * ps = variants.Get(TEXTURED);
+// --------------------------------------------------------
+template<typename T>
+class ShaderVariants : public ShaderVariantCache
+{
+public:
+	ShaderVariants(ID3D11Device * _device, ID3D11DeviceContext * _context, std::wstring _sourceFile, std::string _target, const char * const * _defines, unsigned int defineCount)
+		: ShaderVariantCache(_device, _context, _sourceFile, _target, _defines, defineCount)
+	{
+	}
+
+	/// The variant with exactly the key's features, or null if it
+	/// couldn't be created.  Bits past the declared defines are ignored
+	T * Get(ShaderVariantKey key) { return static_cast<T *>(GetShader(key)); }
+
+protected:
+	ISimpleShader * CreateShader() { return new T(device, context); }
+};
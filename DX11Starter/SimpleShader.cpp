@@ -1,4 +1,7 @@
 #include "SimpleShader.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -12,11 +15,27 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
+	this->stateCache = 0;
+	this->constantRing = 0;
+	ResetUploadStats();
 
 	// Set up fields
+	metadata = 0;
 	constantBufferCount = 0;
+	variableCount = 0;
+	shaderResourceViewCount = 0;
+	samplerCount = 0;
 	constantBuffers = 0;
+	variables = 0;
+	shaderResourceViews = 0;
+	samplerStates = 0;
+	cbNames = 0;
+	varNames = 0;
+	textureNames = 0;
+	samplerNames = 0;
+	varNameCount = 0;
 	shaderBlob = 0;
+	shaderValid = false;
 }
 
 // --------------------------------------------------------
@@ -35,30 +54,132 @@ ISimpleShader::~ISimpleShader()
 // --------------------------------------------------------
 void ISimpleShader::CleanUp()
 {
-	// Handle constant buffers and local data buffers
+	// Handle constant buffers - their local data is in the metadata
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
 		constantBuffers[i].ConstantBuffer->Release();
-		delete[] constantBuffers[i].LocalDataBuffer;
-	}
 
-	if (constantBuffers)
+	// Everything else goes in one go
+	delete[] metadata;
+	metadata = 0;
+
+	constantBufferCount = 0;
+	variableCount = 0;
+	shaderResourceViewCount = 0;
+	samplerCount = 0;
+	constantBuffers = 0;
+	variables = 0;
+	shaderResourceViews = 0;
+	samplerStates = 0;
+	cbNames = 0;
+	varNames = 0;
+	textureNames = 0;
+	samplerNames = 0;
+	varNameCount = 0;
+}
+
+// --------------------------------------------------------
+// Reserves space for an array in the metadata block
+//
+// size - The block's size so far, updated to include the array
+// bytes - Size of the array
+// alignment - What the array's start needs aligning to
+//
+// Returns the array's offset into the block
+// --------------------------------------------------------
+static size_t ReserveMetadata(size_t& size, size_t bytes, size_t alignment)
+{
+	size_t offset = (size + alignment - 1) / alignment * alignment;
+	size = offset + bytes;
+	return offset;
+}
+
+// --------------------------------------------------------
+// Copies a name out of the reflection data (which doesn't
+// outlive loading) into the metadata block
+// --------------------------------------------------------
+static const char* CopyName(char*& pool, const char* name)
+{
+	size_t length = strlen(name) + 1;
+	memcpy(pool, name, length);
+	const char* copy = pool;
+	pool += length;
+	return copy;
+}
+
+static SimpleNameEntry MakeNameEntry(const char* name, unsigned int index)
+{
+	SimpleNameEntry entry;
+	entry.Hash = SimpleNameHash(name).Value;
+	entry.Index = index;
+	entry.Name = name;
+	return entry;
+}
+
+// --------------------------------------------------------
+// Orders name entries by hash, then by name, then by index
+// --------------------------------------------------------
+static bool NameEntryLess(const SimpleNameEntry& a, const SimpleNameEntry& b)
+{
+	if (a.Hash != b.Hash) return a.Hash < b.Hash;
+	int order = strcmp(a.Name, b.Name);
+	if (order != 0) return order < 0;
+	return a.Index < b.Index;
+}
+
+static bool NameEntryHashLess(const SimpleNameEntry& entry, uint32_t hash)
+{
+	return entry.Hash < hash;
+}
+
+// --------------------------------------------------------
+// Sorts a name table, keeping only the first index for
+// any name that appears more than once
+//
+// Returns the number of entries left
+// --------------------------------------------------------
+static unsigned int SortNames(SimpleNameEntry* names, unsigned int count)
+{
+	std::sort(names, names + count, NameEntryLess);
+
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < count; i++)
 	{
-		delete[] constantBuffers;
-		constantBufferCount = 0;
+		if (kept > 0 && names[kept - 1].Hash == names[i].Hash &&
+			strcmp(names[kept - 1].Name, names[i].Name) == 0)
+			continue;
+		names[kept++] = names[i];
 	}
+	return kept;
+}
 
-	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
-		delete shaderResourceViews[i];
-	
-	for (unsigned int i = 0; i < samplerStates.size(); i++)
-		delete samplerStates[i];
+// --------------------------------------------------------
+// Looks up a name in a sorted name table
+//
+// name - The name to look for, or null to go by hash alone,
+//        in which case a hash shared by two names finds nothing
+//
+// Returns the entry, or null if it isn't there
+// --------------------------------------------------------
+static const SimpleNameEntry* FindName(const SimpleNameEntry* names, unsigned int count, uint32_t hash, const char* name)
+{
+	const SimpleNameEntry* end = names + count;
+	const SimpleNameEntry* entry = std::lower_bound(names, end, hash, NameEntryHashLess);
+
+	if (!name)
+	{
+		if (entry == end || entry->Hash != hash)
+			return 0;
+		if (entry + 1 != end && entry[1].Hash == hash)
+			return 0;
+		return entry;
+	}
 
-	// Clean up tables
-	varTable.clear();
-	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	for (; entry != end && entry->Hash == hash; entry++)
+	{
+		if (strcmp(entry->Name, name) == 0)
+			return entry;
+	}
+	return 0;
 }
 
 // --------------------------------------------------------
@@ -73,141 +194,349 @@ void ISimpleShader::CleanUp()
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
 	// Load the shader to a blob and ensure it worked
-	HRESULT hr = D3DReadFileToBlob(shaderFile, &shaderBlob);
+	ID3DBlob* blob;
+	HRESULT hr = D3DReadFileToBlob(shaderFile, &blob);
 	if (hr != S_OK)
 	{
 		return false;
 	}
 
+	bool loaded = LoadShaderBlob(blob);
+	blob->Release();
+	return loaded;
+}
+
+// --------------------------------------------------------
+// Sets up the shader from already compiled code, such as
+// from D3DCompile(), and builds the variable table the same
+// way LoadShaderFile() does
+//
+// blob - The compiled shader, which this keeps a reference to
+// 
+// Returns true if shader is loaded properly, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::LoadShaderBlob(ID3DBlob* blob)
+{
+	// Hold on to the code, letting go of any from before
+	blob->AddRef();
+	if (shaderBlob)
+		shaderBlob->Release();
+	shaderBlob = blob;
+
+	// Get information about this shader and its variables,
+	// buffers, etc. - from the cache if it's been seen before
+	ShaderReflectionData reflection;
+	if (!GetReflection(reflection))
+	{
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
-	shaderValid = CreateShader(shaderBlob);
+	shaderValid = CreateShader(shaderBlob, reflection);
 	if (!shaderValid)
 	{
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
+	// Count everything first, so the metadata block can be
+	// allocated once at the right size
+	unsigned int cbCount = (unsigned int)reflection.ConstantBuffers.size();
+	unsigned int varCount = 0;
+	unsigned int srvCount = 0;
+	unsigned int sampCount = 0;
+	size_t nameBytes = 0;
+	size_t dataBytes = 0;
+
+	unsigned int resourceCount = (unsigned int)reflection.Resources.size();
+	for (unsigned int r = 0; r < resourceCount; r++)
+	{
+		const ReflectedResource& resource = reflection.Resources[r];
+		if (resource.Type == D3D_SIT_TEXTURE) srvCount++;
+		else if (resource.Type == D3D_SIT_SAMPLER) sampCount++;
+		else continue;
+
+		nameBytes += resource.Name.size() + 1;
+	}
+
+	for (unsigned int b = 0; b < cbCount; b++)
+	{
+		const ReflectedConstantBuffer& cb = reflection.ConstantBuffers[b];
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+		// Local data is kept 16 byte aligned, like the registers
+		dataBytes += (cb.Size + 15) / 16 * 16;
+		nameBytes += cb.Name.size() + 1;
+		varCount += (unsigned int)cb.Variables.size();
+
+		for (unsigned int v = 0; v < cb.Variables.size(); v++)
+			nameBytes += cb.Variables[v].Name.size() + 1;
+	}
+
+	// Lay out the block, most strictly aligned first
+	size_t size = 0;
+	size_t dataOffset = ReserveMetadata(size, dataBytes, 16);
+	size_t cbOffset = ReserveMetadata(size, sizeof(SimpleConstantBuffer) * cbCount, alignof(SimpleConstantBuffer));
+	size_t cbNameOffset = ReserveMetadata(size, sizeof(SimpleNameEntry) * cbCount, alignof(SimpleNameEntry));
+	size_t varNameOffset = ReserveMetadata(size, sizeof(SimpleNameEntry) * varCount, alignof(SimpleNameEntry));
+	size_t textureNameOffset = ReserveMetadata(size, sizeof(SimpleNameEntry) * srvCount, alignof(SimpleNameEntry));
+	size_t samplerNameOffset = ReserveMetadata(size, sizeof(SimpleNameEntry) * sampCount, alignof(SimpleNameEntry));
+	size_t varOffset = ReserveMetadata(size, sizeof(SimpleShaderVariable) * varCount, alignof(SimpleShaderVariable));
+	size_t srvOffset = ReserveMetadata(size, sizeof(SimpleSRV) * srvCount, alignof(SimpleSRV));
+	size_t sampOffset = ReserveMetadata(size, sizeof(SimpleSampler) * sampCount, alignof(SimpleSampler));
+	size_t poolOffset = ReserveMetadata(size, nameBytes, 1);
+
+	// new[] only promises alignment for the largest basic type,
+	// so over-allocate and align the start by hand
+	metadata = new unsigned char[size + 15];
+	unsigned char* block = (unsigned char*)(((uintptr_t)metadata + 15) & ~(uintptr_t)15);
+	ZeroMemory(block, size);
+
+	unsigned char* nextData = block + dataOffset;
+	char* namePool = (char*)(block + poolOffset);
+	constantBuffers = (SimpleConstantBuffer*)(block + cbOffset);
+	variables = (SimpleShaderVariable*)(block + varOffset);
+	shaderResourceViews = (SimpleSRV*)(block + srvOffset);
+	samplerStates = (SimpleSampler*)(block + sampOffset);
+	cbNames = (SimpleNameEntry*)(block + cbNameOffset);
+	varNames = (SimpleNameEntry*)(block + varNameOffset);
+	textureNames = (SimpleNameEntry*)(block + textureNameOffset);
+	samplerNames = (SimpleNameEntry*)(block + samplerNameOffset);
 	
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ReflectedResource& resource = reflection.Resources[r];
 
 		// Check the type
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
 		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
+			// Set up the SRV info
+			SimpleSRV* srv = &shaderResourceViews[shaderResourceViewCount];
+			srv->BindIndex = resource.BindPoint;	// Shader bind point
+			srv->Index = shaderResourceViewCount;	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
+			textureNames[shaderResourceViewCount] = MakeNameEntry(CopyName(namePool, resource.Name.c_str()), srv->Index);
+			shaderResourceViewCount++;
 		}
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
 		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
+			// Set up the sampler info
+			SimpleSampler* samp = &samplerStates[samplerCount];
+			samp->BindIndex = resource.BindPoint;	// Shader bind point
+			samp->Index = samplerCount;				// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
+			samplerNames[samplerCount] = MakeNameEntry(CopyName(namePool, resource.Name.c_str()), samp->Index);
+			samplerCount++;
 		}
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
+	constantBufferCount = cbCount;
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
 		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
+		const ReflectedConstantBuffer& cb = reflection.ConstantBuffers[b];
 		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		// Set up the buffer and put it in the name table
+		constantBuffers[b].BindIndex = cb.BindPoint;
+		constantBuffers[b].Name = CopyName(namePool, cb.Name.c_str());
+		cbNames[b] = MakeNameEntry(constantBuffers[b].Name, b);
 
 		// Create this constant buffer
+		//  - Dynamic, so new data can be written with a discarding map
+		//    rather than UpdateSubresource() copying it around
 		D3D11_BUFFER_DESC newBuffDesc;
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
+		newBuffDesc.Usage = D3D11_USAGE_DYNAMIC;
+		newBuffDesc.ByteWidth = cb.Size;
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].BindBuffer = constantBuffers[b].ConstantBuffer;
+		constantBuffers[b].FirstConstant = 0;
+		constantBuffers[b].ConstantCount = 0;
+		constantBuffers[b].RingFrame = 0;
+		constantBuffers[b].StructSize = 0;
+		constantBuffers[b].External = false;
+
+		// Point the buffer at its (already zeroed) local data
+		constantBuffers[b].Size = cb.Size;
+		constantBuffers[b].LocalDataBuffer = nextData;
+		nextData += (cb.Size + 15) / 16 * 16;
+
+		// Nothing's been sent yet, so it all needs to go
+		constantBuffers[b].Dirty = true;
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = cb.Size;
+
+		// This buffer's variables come next in the array
+		constantBuffers[b].Variables = &variables[variableCount];
+		constantBuffers[b].VariableCount = (unsigned int)cb.Variables.size();
 
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (unsigned int v = 0; v < cb.Variables.size(); v++)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
+			const ReflectedVariable& var = cb.Variables[v];
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct;
+			// Fill in the variable and add it to the name table
+			SimpleShaderVariable& varStruct = variables[variableCount];
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			varStruct.ByteOffset = var.StartOffset;
+			varStruct.Size = var.Size;
+
+			varNames[variableCount] = MakeNameEntry(CopyName(namePool, var.Name.c_str()), variableCount);
+			variableCount++;
 		}
 	}
 
+	// Sort the names for searching.  A variable name repeated in
+	// another buffer finds the first one, as it always has
+	SortNames(cbNames, constantBufferCount);
+	SortNames(textureNames, shaderResourceViewCount);
+	SortNames(samplerNames, samplerCount);
+	varNameCount = SortNames(varNames, variableCount);
+
 	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies a signature out of shader reflection
+// --------------------------------------------------------
+static void CopyParameter(const D3D11_SIGNATURE_PARAMETER_DESC& paramDesc, ReflectedParameter& parameter)
+{
+	parameter.SemanticName = paramDesc.SemanticName;
+	parameter.SemanticIndex = paramDesc.SemanticIndex;
+	parameter.ComponentType = paramDesc.ComponentType;
+	parameter.Mask = paramDesc.Mask;
+	parameter.Stream = paramDesc.Stream;
+}
+
+// --------------------------------------------------------
+// Reflects compiled shader code, copying out everything
+// the shaders use
+//
+// Returns false if the code couldn't be reflected
+// --------------------------------------------------------
+static bool ReflectShader(ID3DBlob* shaderBlob, ShaderReflectionData& reflection)
+{
+	ID3D11ShaderReflection* refl;
+	HRESULT hr = D3DReflect(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		IID_ID3D11ShaderReflection,
+		(void**)&refl);
+	if (FAILED(hr))
+		return false;
+
+	// Get the description of the shader
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	reflection.Clear();
+	reflection.Resources.resize(shaderDesc.BoundResources);
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+		reflection.Resources[r].Name = resourceDesc.Name;
+		reflection.Resources[r].Type = resourceDesc.Type;
+		reflection.Resources[r].BindPoint = resourceDesc.BindPoint;
+	}
+
+	reflection.ConstantBuffers.resize(shaderDesc.ConstantBuffers);
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb =
+			refl->GetConstantBufferByIndex(b);
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		// Get the description of the resource binding, so
+		// we know exactly how it's bound in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ReflectedConstantBuffer& buffer = reflection.ConstantBuffers[b];
+		buffer.Name = bufferDesc.Name;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindPoint = bindDesc.BindPoint;
+		buffer.Variables.resize(bufferDesc.Variables);
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+			buffer.Variables[v].Name = varDesc.Name;
+			buffer.Variables[v].StartOffset = varDesc.StartOffset;
+			buffer.Variables[v].Size = varDesc.Size;
+		}
+	}
+
+	reflection.Inputs.resize(shaderDesc.InputParameters);
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		CopyParameter(paramDesc, reflection.Inputs[i]);
+	}
+
+	reflection.Outputs.resize(shaderDesc.OutputParameters);
+	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetOutputParameterDesc(i, &paramDesc);
+		CopyParameter(paramDesc, reflection.Outputs[i]);
+	}
+
+	refl->GetThreadGroupSize(&reflection.ThreadsX, &reflection.ThreadsY, &reflection.ThreadsZ);
+
 	refl->Release();
 	return true;
 }
 
+// --------------------------------------------------------
+// Gets the loaded shader's reflection data, from a cache
+// file when there is one for this exact bytecode.  Otherwise
+// the shader is reflected and (if a cache folder was set)
+// the result saved for next time
+//
+// reflection - Receives the data
+//
+// Returns false if the shader couldn't be reflected
+// --------------------------------------------------------
+bool ISimpleShader::GetReflection(ShaderReflectionData& reflection)
+{
+	uint64_t hash = ShaderReflectionData::HashBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+
+	std::string cacheFile;
+	if (!reflectionCacheFolder.empty())
+	{
+		char hashName[32];
+		snprintf(hashName, sizeof(hashName), "/%016llx.refl", (unsigned long long)hash);
+		cacheFile = reflectionCacheFolder + hashName;
+
+		if (reflection.LoadFromFile(cacheFile.c_str(), hash))
+			return true;
+	}
+
+	if (!ReflectShader(shaderBlob, reflection))
+		return false;
+
+	// Not being able to save just means reflecting again next time
+	if (!cacheFile.empty())
+		reflection.SaveToFile(cacheFile.c_str(), hash);
+	return true;
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -217,16 +546,13 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // --------------------------------------------------------
 SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
-
-	// Did we find the key?
-	if (result == varTable.end())
+	// Look for the name
+	const SimpleNameEntry* entry = FindName(varNames, varNameCount, SimpleNameHash(name.c_str()).Value, name.c_str());
+	if (!entry)
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the variable it names
+	SimpleShaderVariable* var = &variables[entry->Index];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -241,16 +567,13 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
-
-	// Did we find the key?
-	if (result == cbTable.end())
+	// Look for the name
+	const SimpleNameEntry* entry = FindName(cbNames, constantBufferCount, SimpleNameHash(name.c_str()).Value, name.c_str());
+	if (!entry)
 		return 0;
 
 	// Success
-	return result->second;
+	return &constantBuffers[entry->Index];
 }
 
 // --------------------------------------------------------
@@ -264,6 +587,12 @@ void ISimpleShader::SetShader()
 	// Set the shader and any relevant constant buffers, which
 	// is an overloaded method in a subclass
 	SetShaderAndCBs();
+
+	// That put every buffer of our own back in its slot
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		constantBuffers[i].External = false;
+	}
 }
 
 // --------------------------------------------------------
@@ -280,9 +609,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -311,9 +638,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -333,9 +658,108 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU - into a fresh
+// region of the constant buffer ring if there is one, or
+// else by discarding the buffer's own contents.  Goes
+// through the state cache if there is one so the bytes
+// are counted
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// Unchanged data can stay where it is - unless it's in a
+	// part of the ring that's since been handed out again
+	bool inRing = cb->BindBuffer != cb->ConstantBuffer;
+	if (!cb->Dirty && !(inRing && (!constantRing || !constantRing->IsLive(cb->RingFrame))))
+	{
+		uploadStats.BytesSkipped += cb->Size;
+		if (cb->External)
+			RebindConstantBuffer(cb);
+		return;
+	}
+
+	// Discarding maps and ring regions both need the whole buffer,
+	// so the dirty range only decides whether to upload at all
+	uploadStats.BytesUploaded += cb->Size;
+	cb->Dirty = false;
+	cb->DirtyStart = 0;
+	cb->DirtyEnd = 0;
+
+	if (constantRing && CanBindBufferRanges() &&
+		constantRing->Upload(cb->LocalDataBuffer, cb->Size, &cb->FirstConstant, &cb->ConstantCount))
+	{
+		cb->BindBuffer = constantRing->GetBuffer();
+		cb->RingFrame = constantRing->GetFrame();
+		stateCache->RecordUpload(cb->Size);
+		RebindConstantBuffer(cb);
+		return;
+	}
+
+	// Back to the buffer's own copy (a no-op without a ring)
+	cb->BindBuffer = cb->ConstantBuffer;
+	cb->FirstConstant = 0;
+	cb->ConstantCount = 0;
+
+	if (stateCache)
+	{
+		stateCache->UpdateBuffer(cb->ConstantBuffer, cb->LocalDataBuffer, cb->Size);
+	}
+	else
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(deviceContext->Map(cb->ConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			memcpy(mapped.pData, cb->LocalDataBuffer, cb->Size);
+			deviceContext->Unmap(cb->ConstantBuffer, 0);
+		}
+	}
+
+	if (inRing || cb->External)
+		RebindConstantBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Points a buffer's slot at wherever its data went last -
+// but only while this shader is bound, otherwise it would
+// clobber another shader's buffer.  SetShader() picks up
+// the new location the next time it's called
+// --------------------------------------------------------
+void ISimpleShader::RebindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (BindConstantBuffer(cb->BindIndex, cb->BindBuffer, cb->FirstConstant, cb->ConstantCount))
+		cb->External = false;
+}
+
+// --------------------------------------------------------
+// Binds a caller's buffer in place of one of ours.  The
+// handle has to be one of this shader's buffers
+// --------------------------------------------------------
+bool ISimpleShader::BindExternalBuffer(const SimpleConstantBuffer* cb, ID3D11Buffer* buffer)
+{
+	if (!shaderValid || !buffer || cb < constantBuffers || cb >= constantBuffers + constantBufferCount)
+		return false;
+
+	SimpleConstantBuffer* own = &constantBuffers[cb - constantBuffers];
+	if (!BindConstantBuffer(own->BindIndex, buffer, 0, 0))
+		return false;
+
+	own->External = true;
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Zeroes the upload counters
+// --------------------------------------------------------
+void ISimpleShader::ResetUploadStats()
+{
+	uploadStats.BytesUploaded = 0;
+	uploadStats.BytesSkipped = 0;
+	uploadStats.RedundantWrites = 0;
 }
 
 
@@ -352,20 +776,169 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
-	SimpleShaderVariable* var = FindVariable(name, size);
-	if (var == 0)
+	return SetData(FindVariable(name, size), data, size);
+}
+
+// --------------------------------------------------------
+// Sets a variable through a handle with arbitrary data of
+// the specified size - no name lookup needed
+//
+// var - The variable, from GetVariableInfo() on this shader
+// data - The data to set in the buffer
+// size - The size of the data (this must match the variable's size)
+//
+// Returns true if data is copied, false if the handle is null,
+// belongs to another shader or the size is wrong
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const SimpleShaderVariable* var, const void* data, unsigned int size)
+{
+	// Verify the handle - one from another shader could point
+	// past the end of this shader's buffers
+	if (var < variables || var >= variables + variableCount || var->Size != size)
 		return false;
 
+	return WriteLocalData(&constantBuffers[var->ConstantBufferIndex], var->ByteOffset, data, size);
+}
+
+// --------------------------------------------------------
+// Copies data into part of a buffer's local data, tracking
+// what changed so only changed buffers get uploaded
+//
+// cb - The buffer to write to
+// offset - Where in the buffer to write
+// data - The data to write
+// size - How many bytes to write
+// --------------------------------------------------------
+bool ISimpleShader::WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size)
+{
+	// Nothing to do if the data's already there
+	unsigned char* dest = cb->LocalDataBuffer + offset;
+	if (memcmp(dest, data, size) == 0)
+	{
+		uploadStats.RedundantWrites++;
+		return true;
+	}
+
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	memcpy(dest, data, size);
+
+	// Grow the buffer's dirty range to cover it
+	unsigned int start = offset;
+	unsigned int end = offset + size;
+	if (!cb->Dirty)
+	{
+		cb->Dirty = true;
+		cb->DirtyStart = start;
+		cb->DirtyEnd = end;
+	}
+	else
+	{
+		if (start < cb->DirtyStart) cb->DirtyStart = start;
+		if (end > cb->DirtyEnd) cb->DirtyEnd = end;
+	}
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Checks a C++ struct against a constant buffer's layout,
+// so the whole struct can be copied in at once with
+// SetBufferStruct().  Every variable in the buffer needs a
+// field with the same name, offset and size - anything the
+// compiler padded differently is caught here instead of
+// corrupting the data later.
+//
+// bufferName - The name of the cbuffer in the shader
+// fields - The struct's members, see SIMPLE_BUFFER_FIELD
+// fieldCount - Number of fields
+// structSize - sizeof() the struct
+//
+// Returns a handle for SetBufferStruct(), or null if the
+// layouts don't match
+// --------------------------------------------------------
+const SimpleConstantBuffer* ISimpleShader::BindBufferStruct(std::string bufferName, const SimpleBufferField* fields, unsigned int fieldCount, unsigned int structSize)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (!cb)
+	{
+		LayoutError(bufferName, "no such buffer");
+		return 0;
+	}
+
+	unsigned int cbIndex = (unsigned int)(cb - constantBuffers);
+	if (structSize > cb->Size)
+	{
+		LayoutError(bufferName, "struct is larger than the buffer");
+		return 0;
+	}
+
+	unsigned int matched = 0;
+	for (unsigned int i = 0; i < fieldCount; i++)
+	{
+		const SimpleShaderVariable* var = FindVariable(fields[i].Name, -1);
+		if (!var || var->ConstantBufferIndex != cbIndex)
+		{
+			LayoutError(bufferName, fields[i].Name, "not in the buffer");
+			return 0;
+		}
+
+		if (var->ByteOffset != fields[i].Offset || var->Size != fields[i].Size)
+		{
+			LayoutError(bufferName, fields[i].Name, "offset or size differs from the shader");
+			return 0;
+		}
+
+		matched++;
+	}
+
+	// Anything left over would be overwritten by whatever the
+	// struct has at that offset
+	if (matched != cb->VariableCount)
+	{
+		LayoutError(bufferName, "struct is missing some of the buffer's variables");
+		return 0;
+	}
+
+	cb->StructSize = structSize;
+	return cb;
+}
+
+// --------------------------------------------------------
+// Copies a whole struct into a buffer's local data
+//
+// cb - A handle from BindBufferStruct() on this shader
+// data - The struct
+// size - sizeof() the struct, which must be what it was bound with
+//
+// Returns false if the handle is null, belongs to another
+// shader or the size is wrong
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferStruct(const SimpleConstantBuffer* cb, const void* data, unsigned int size)
+{
+	if (cb < constantBuffers || cb >= constantBuffers + constantBufferCount || cb->StructSize == 0 || cb->StructSize != size)
+		return false;
+
+	return WriteLocalData(&constantBuffers[cb - constantBuffers], 0, data, size);
+}
+
+// --------------------------------------------------------
+// Reports why BindBufferStruct() failed, in debug builds
+// --------------------------------------------------------
+void ISimpleShader::LayoutError(std::string bufferName, std::string fieldName, const char* problem)
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("\nConstant buffer %s, %s: %s", bufferName.c_str(), fieldName.c_str(), problem);
+#endif
+}
+
+void ISimpleShader::LayoutError(std::string bufferName, const char* problem)
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("\nConstant buffer %s: %s", bufferName.c_str(), problem);
+#endif
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
@@ -419,31 +992,120 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 {
-	return this->SetData(name, (void*)data, sizeof(float) * 4);
+	return this->SetData(name, (void*)data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+{
+	return this->SetData(name, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+{
+	return this->SetData(name, (void*)data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetData(name, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets data through a variable handle - see SetData()
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(const SimpleShaderVariable* var, int data)
+{
+	return this->SetData(var, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const SimpleShaderVariable* var, float data)
+{
+	return this->SetData(var, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(const SimpleShaderVariable* var, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(const SimpleShaderVariable* var, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(var, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by name
+//
+// name - The name of the texture resource in the shader
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+{
+	return SetShaderResourceView(GetShaderResourceViewInfo(name), srv);
 }
 
 // --------------------------------------------------------
-// Sets a FLOAT4 variable by name in the local data buffer
+// Sets a shader resource view through a handle from
+// GetShaderResourceViewInfo() on this shader
+//
+// Returns false if the handle is null
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv)
 {
-	return this->SetData(name, &data, sizeof(float) * 4);
+	if (srvInfo == 0)
+		return false;
+
+	BindShaderResourceView(srvInfo->BindIndex, srv);
+	return true;
 }
 
 // --------------------------------------------------------
-// Sets a MATRIX (4x4) variable by name in the local data buffer
+// Sets a sampler state by name
+//
+// name - The name of the sampler state in the shader
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
 {
-	return this->SetData(name, (void*)data, sizeof(float) * 16);
+	return SetSamplerState(GetSamplerInfo(name), samplerState);
 }
 
 // --------------------------------------------------------
-// Sets a MATRIX (4x4) variable by name in the local data buffer
+// Sets a sampler state through a handle from GetSamplerInfo()
+// on this shader
+//
+// Returns false if the handle is null
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState)
 {
-	return this->SetData(name, &data, sizeof(float) * 16);
+	if (sampInfo == 0)
+		return false;
+
+	BindSamplerState(sampInfo->BindIndex, samplerState);
+	return true;
 }
 
 // --------------------------------------------------------
@@ -454,6 +1116,15 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 	return FindVariable(name, -1);
 }
 
+// --------------------------------------------------------
+// Gets info about a shader variable by name hash (or null)
+// --------------------------------------------------------
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(SimpleNameHash name)
+{
+	const SimpleNameEntry* entry = FindName(varNames, varNameCount, name.Value, 0);
+	return entry ? &variables[entry->Index] : 0;
+}
+
 // --------------------------------------------------------
 // Gets info about an SRV in the shader (or null)
 //
@@ -461,19 +1132,25 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 // --------------------------------------------------------
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
-
-	// Did we find the key?
-	if (result == textureTable.end())
+	// Look for the name
+	const SimpleNameEntry* entry = FindName(textureNames, shaderResourceViewCount, SimpleNameHash(name.c_str()).Value, name.c_str());
+	if (!entry)
 		return 0;
 
 	// Success
-	return result->second;
+	return &shaderResourceViews[entry->Index];
 }
 
 
+// --------------------------------------------------------
+// Gets info about an SRV in the shader by name hash (or null)
+// --------------------------------------------------------
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(SimpleNameHash name)
+{
+	const SimpleNameEntry* entry = FindName(textureNames, shaderResourceViewCount, name.Value, 0);
+	return entry ? &shaderResourceViews[entry->Index] : 0;
+}
+
 // --------------------------------------------------------
 // Gets info about an SRV in the shader (or null)
 //
@@ -482,10 +1159,10 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= shaderResourceViews.size()) return 0;
+	if (index >= shaderResourceViewCount) return 0;
 
 	// Grab the bind index
-	return shaderResourceViews[index];
+	return &shaderResourceViews[index];
 }
 
 
@@ -496,16 +1173,22 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // --------------------------------------------------------
 const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
-
-	// Did we find the key?
-	if (result == samplerTable.end())
+	// Look for the name
+	const SimpleNameEntry* entry = FindName(samplerNames, samplerCount, SimpleNameHash(name.c_str()).Value, name.c_str());
+	if (!entry)
 		return 0;
 
 	// Success
-	return result->second;
+	return &samplerStates[entry->Index];
+}
+
+// --------------------------------------------------------
+// Gets info about a sampler in the shader by name hash (or null)
+// --------------------------------------------------------
+const SimpleSampler* ISimpleShader::GetSamplerInfo(SimpleNameHash name)
+{
+	const SimpleNameEntry* entry = FindName(samplerNames, samplerCount, name.Value, 0);
+	return entry ? &samplerStates[entry->Index] : 0;
 }
 
 // --------------------------------------------------------
@@ -516,10 +1199,10 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= samplerStates.size()) return 0;
+	if (index >= samplerCount) return 0;
 
 	// Grab the bind index
-	return samplerStates[index];
+	return &samplerStates[index];
 }
 
 
@@ -583,6 +1266,7 @@ SimpleVertexShader::SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext
 	// Ensure we set to zero to successfully trigger
 	// the Input Layout creation during LoadShader()
 	this->inputLayout = 0;
+	this->inputLayoutCache = 0;
 	this->shader = 0;
 	this->perInstanceCompatible = false;
 }
@@ -598,6 +1282,7 @@ SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, ID3D11DeviceContex
 {
 	// Save the custom input layout
 	this->inputLayout = inputLayout;
+	this->inputLayoutCache = 0;
 	this->shader = 0;
 
 	// Unable to determine from an input layout, require user to tell us
@@ -626,10 +1311,11 @@ void SimpleVertexShader::CleanUp()
 // Creates the DirectX vertex shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -652,32 +1338,19 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
+	// reflected input signature to create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (unsigned int i = 0; i < reflection.Inputs.size(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const ReflectedParameter& paramDesc = reflection.Inputs[i];
 
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -685,7 +1358,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -732,6 +1405,17 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
+	// Share a layout with any other shader that has the same inputs
+	if (inputLayoutCache)
+	{
+		inputLayout = inputLayoutCache->GetLayout(
+			&inputLayoutDesc[0],
+			(unsigned int)inputLayoutDesc.size(),
+			shaderBlob->GetBufferPointer(),
+			shaderBlob->GetBufferSize());
+		return true;
+	}
+
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
 		&inputLayoutDesc[0], 
@@ -740,8 +1424,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		shaderBlob->GetBufferSize(),
 		&inputLayout);
 
-	// All done, clean up
-	refl->Release();
+	// All done
 	return true;
 }
 
@@ -754,6 +1437,19 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Let the cache skip anything already bound
+	if (stateCache)
+	{
+		stateCache->SetInputLayout(inputLayout);
+		stateCache->SetVertexShader(shader);
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+		{
+			SimpleConstantBuffer& cb = constantBuffers[i];
+			stateCache->SetVSConstantBuffer(cb.BindIndex, cb.BindBuffer, cb.FirstConstant, cb.ConstantCount);
+		}
+		return;
+	}
+
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout);
 	deviceContext->VSSetShader(shader, 0, 0);
@@ -769,47 +1465,54 @@ void SimpleVertexShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the vertex shader stage
-//
-// name - The name of the texture resource in the shader
-// srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
+// Constant buffer ranges are bound through the state cache,
+// so it needs to be there and have a D3D11.1 context
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleVertexShader::CanBindBufferRanges()
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
+	return stateCache && stateCache->SupportsBufferRanges();
+}
 
-	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+// --------------------------------------------------------
+// Binds a buffer (or a range of one) in a slot - but only
+// while this shader is bound, otherwise it would clobber
+// another shader's buffer
+// --------------------------------------------------------
+bool SimpleVertexShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache || !stateCache->IsBound(shader))
+		return false;
 
-	// Success
+	stateCache->SetVSConstantBuffer(bindIndex, buffer, firstConstant, constantCount);
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the vertex shader stage
-//
-// name - The name of the sampler state in the shader
-// samplerState - The sampler state in GPU memory
+// Binds a shader resource view in the vertex shader stage
 //
-// Returns true if a sampler of the given name was found, false otherwise
+// bindIndex - The register of the texture resource
+// srv - The shader resource view of the texture in GPU memory
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleVertexShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache)
+		stateCache->SetVSShaderResource(bindIndex, srv);
+	else
+		deviceContext->VSSetShaderResources(bindIndex, 1, &srv);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a sampler state in the vertex shader stage
+//
+// bindIndex - The register of the sampler
+// samplerState - The sampler state in GPU memory
+// --------------------------------------------------------
+void SimpleVertexShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (stateCache)
+		stateCache->SetVSSampler(bindIndex, samplerState);
+	else
+		deviceContext->VSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -847,10 +1550,11 @@ void SimplePixelShader::CleanUp()
 // Creates the DirectX pixel shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimplePixelShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -876,6 +1580,18 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 	
+	// Let the cache skip anything already bound
+	if (stateCache)
+	{
+		stateCache->SetPixelShader(shader);
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+		{
+			SimpleConstantBuffer& cb = constantBuffers[i];
+			stateCache->SetPSConstantBuffer(cb.BindIndex, cb.BindBuffer, cb.FirstConstant, cb.ConstantCount);
+		}
+		return;
+	}
+
 	// Set the shader
 	deviceContext->PSSetShader(shader, 0, 0);
 
@@ -890,47 +1606,54 @@ void SimplePixelShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the pixel shader stage
-//
-// name - The name of the texture resource in the shader
-// srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
+// Constant buffer ranges are bound through the state cache,
+// so it needs to be there and have a D3D11.1 context
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimplePixelShader::CanBindBufferRanges()
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
+	return stateCache && stateCache->SupportsBufferRanges();
+}
 
-	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+// --------------------------------------------------------
+// Binds a buffer (or a range of one) in a slot - but only
+// while this shader is bound, otherwise it would clobber
+// another shader's buffer
+// --------------------------------------------------------
+bool SimplePixelShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache || !stateCache->IsBound(shader))
+		return false;
 
-	// Success
+	stateCache->SetPSConstantBuffer(bindIndex, buffer, firstConstant, constantCount);
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the pixel shader stage
+// Binds a shader resource view in the pixel shader stage
 //
-// name - The name of the sampler state in the shader
-// samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
+// bindIndex - The register of the texture resource
+// srv - The shader resource view of the texture in GPU memory
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimplePixelShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache)
+		stateCache->SetPSShaderResource(bindIndex, srv);
+	else
+		deviceContext->PSSetShaderResources(bindIndex, 1, &srv);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a sampler state in the pixel shader stage
+//
+// bindIndex - The register of the sampler
+// samplerState - The sampler state in GPU memory
+// --------------------------------------------------------
+void SimplePixelShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (stateCache)
+		stateCache->SetPSSampler(bindIndex, samplerState);
+	else
+		deviceContext->PSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -970,10 +1693,11 @@ void SimpleDomainShader::CleanUp()
 // Creates the DirectX domain shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimpleDomainShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1013,47 +1737,25 @@ void SimpleDomainShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the domain shader stage
+// Binds a shader resource view in the domain shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleDomainShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	deviceContext->DSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the domain shader stage
+// Binds a sampler state in the domain shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleDomainShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	deviceContext->DSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -1092,10 +1794,11 @@ void SimpleHullShader::CleanUp()
 // Creates the DirectX hull shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimpleHullShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1135,47 +1838,25 @@ void SimpleHullShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the hull shader stage
+// Binds a shader resource view in the hull shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleHullShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	deviceContext->HSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the hull shader stage
+// Binds a sampler state in the hull shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleHullShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	deviceContext->HSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -1217,10 +1898,11 @@ void SimpleGeometryShader::CleanUp()
 // Creates the DirectX Geometry shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1228,7 +1910,7 @@ bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
 
 	// Using stream out?
 	if (useStreamOut)
-		return this->CreateShaderWithStreamOut(shaderBlob);
+		return this->CreateShaderWithStreamOut(shaderBlob, reflection);
 
 	// Create the shader from the blob
 	HRESULT result = device->CreateGeometryShader(
@@ -1246,40 +1928,28 @@ bool SimpleGeometryShader::CreateShader(ID3DBlob* shaderBlob)
 // stream output, if possible.
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob)
+bool SimpleGeometryShader::CreateShaderWithStreamOut(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (unsigned int i = 0; i < reflection.Outputs.size(); i++)
 	{
 		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
+		const ReflectedParameter& paramDesc = reflection.Outputs[i];
 		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry;
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
+		entry.SemanticName   = paramDesc.SemanticName.c_str();
 		entry.Stream         = paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
@@ -1379,47 +2049,25 @@ void SimpleGeometryShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Geometry shader stage
+// Binds a shader resource view in the Geometry shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleGeometryShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	deviceContext->GSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Geometry shader stage
+// Binds a sampler state in the Geometry shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleGeometryShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	deviceContext->GSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 // --------------------------------------------------------
@@ -1477,10 +2125,11 @@ void SimpleComputeShader::CleanUp()
 // Creates the DirectX Compute shader
 //
 // shaderBlob - The shader's compiled code
+// reflection - What reflecting the code found
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
+bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1497,34 +2146,19 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	threadsX = reflection.ThreadsX;
+	threadsY = reflection.ThreadsY;
+	threadsZ = reflection.ThreadsZ;
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (unsigned int r = 0; r < reflection.Resources.size(); r++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ReflectedResource& resource = reflection.Resources[r];
 
 		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_UAV_APPEND_STRUCTURED:
 		case D3D_SIT_UAV_CONSUME_STRUCTURED:
@@ -1532,12 +2166,11 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 		case D3D_SIT_UAV_RWSTRUCTURED:
 		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
 		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
+			uavTable.insert(std::pair<std::string, unsigned int>(resource.Name, resource.BindPoint));
 		}
 	}
 
 	// All set
-	refl->Release();
 	return true;
 }
 
@@ -1617,47 +2250,25 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Compute shader stage
+// Binds a shader resource view in the Compute shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleComputeShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	deviceContext->CSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Compute shader stage
+// Binds a sampler state in the Compute shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleComputeShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	deviceContext->CSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 // --------------------------------------------------------
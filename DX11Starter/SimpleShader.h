@@ -6,9 +6,35 @@
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 
+#include "StateCache.h"
+#include "ConstantBufferRing.h"
+#include "ShaderReflectionData.h"
+#include "InputLayoutCache.h"
+
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------------
+// FNV-1a hash of a variable or resource name, usable at
+// compile time so lookups by hash don't need a string:
+//
+//   constexpr SimpleNameHash worldName("world");
+//   const SimpleShaderVariable* world = vs->GetVariableInfo(worldName);
+// --------------------------------------------------------
+struct SimpleNameHash
+{
+	uint32_t Value;
+
+	constexpr explicit SimpleNameHash(const char* name) : Value(Hash(name, 2166136261u)) { }
+
+	static constexpr uint32_t Hash(const char* name, uint32_t hash)
+	{
+		return *name ? Hash(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+	}
+};
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -28,14 +54,62 @@ struct SimpleShaderVariable
 // --------------------------------------------------------
 struct SimpleConstantBuffer
 {
-	std::string Name;
+	const char* Name;
 	unsigned int Size;
 	unsigned int BindIndex;
 	ID3D11Buffer* ConstantBuffer;
 	unsigned char* LocalDataBuffer;
-	std::vector<SimpleShaderVariable> Variables;
+
+	// Where the latest data went: either ConstantBuffer, or a
+	// range of a ConstantBufferRing (a count of 0 means all of it)
+	ID3D11Buffer* BindBuffer;
+	unsigned int FirstConstant;
+	unsigned int ConstantCount;
+	unsigned int RingFrame;
+
+	// Size of the C++ struct bound with BindBufferStruct(), if any
+	unsigned int StructSize;
+
+	// Someone else's buffer is bound in this one's slot, see
+	// ISimpleShader::BindExternalBuffer()
+	bool External;
+
+	// Bytes of LocalDataBuffer changed since the last upload
+	bool Dirty;
+	unsigned int DirtyStart;
+	unsigned int DirtyEnd;
+
+	// This buffer's run of the shader's variables
+	SimpleShaderVariable* Variables;
+	unsigned int VariableCount;
+};
+
+// --------------------------------------------------------
+// How much constant data a shader sent to the GPU, and how
+// much it didn't because it hadn't changed
+// --------------------------------------------------------
+struct SimpleUploadStats
+{
+	unsigned int BytesUploaded;
+	unsigned int BytesSkipped;		// Unchanged buffers not copied
+	unsigned int RedundantWrites;	// Set calls that matched what was there
+};
+
+// --------------------------------------------------------
+// One member of a C++ struct that mirrors a cbuffer, for
+// checking the struct's layout against the shader's
+// --------------------------------------------------------
+struct SimpleBufferField
+{
+	const char* Name;	// Name of the variable in the shader
+	unsigned int Offset;
+	unsigned int Size;
 };
 
+// Describes a struct member that holds the named shader variable
+#define SIMPLE_BUFFER_FIELD(name, type, member) \
+	{ name, (unsigned int)offsetof(type, member), (unsigned int)sizeof(((type*)0)->member) }
+
 // --------------------------------------------------------
 // Contains info about a single SRV in a shader
 // --------------------------------------------------------
@@ -54,6 +128,16 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// One entry in a shader's sorted name tables
+// --------------------------------------------------------
+struct SimpleNameEntry
+{
+	uint32_t Hash;		// SimpleNameHash of the name
+	unsigned int Index;	// Into the array the table is for
+	const char* Name;
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -66,11 +150,27 @@ public:
 	// Initialization method (since we can't invoke derived class
 	// overrides in the base class constructor)
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBlob(ID3DBlob* blob);
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
-	// Activating the shader and copying data
+	// Routes this shader's binds through a cache that drops
+	// redundant ones (vertex and pixel shaders only)
+	void SetStateCache(StateCache* cache) { stateCache = cache; }
+
+	// Uploads constant data into a shared ring instead of each
+	// buffer's own copy.  Only used by vertex and pixel shaders
+	// with a state cache that can bind buffer ranges
+	void SetConstantBufferRing(ConstantBufferRing* ring) { constantRing = ring; }
+
+	// Keeps what reflection finds in this folder (which must
+	// exist), keyed by the bytecode, so later loads of the same
+	// shader skip reflecting.  Set before LoadShaderFile()
+	void SetReflectionCacheFolder(std::string folder) { reflectionCacheFolder = folder; }
+
+	// Activating the shader and copying data.  Copies skip
+	// buffers nothing has changed in since the last one
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
@@ -90,20 +190,64 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
-	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	// Sets shader data through a handle from GetVariableInfo(),
+	// skipping the name lookup.  Handles only work with the
+	// shader they came from
+	bool SetData(const SimpleShaderVariable* var, const void* data, unsigned int size);
+
+	bool SetInt(const SimpleShaderVariable* var, int data);
+	bool SetFloat(const SimpleShaderVariable* var, float data);
+	bool SetFloat2(const SimpleShaderVariable* var, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const SimpleShaderVariable* var, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderVariable* var, const DirectX::XMFLOAT4X4& data);
+
+	// Whole buffers at once, from a C++ struct with the same
+	// layout.  BindBufferStruct() checks the layout and returns
+	// the handle to set through (or null if they differ).  The
+	// templates take a struct with static Fields and FieldCount
+	const SimpleConstantBuffer* BindBufferStruct(std::string bufferName, const SimpleBufferField* fields, unsigned int fieldCount, unsigned int structSize);
+	bool SetBufferStruct(const SimpleConstantBuffer* cb, const void* data, unsigned int size);
+
+	template<typename T>
+	const SimpleConstantBuffer* BindBufferStruct(std::string bufferName)
+	{
+		return BindBufferStruct(bufferName, T::Fields, T::FieldCount, sizeof(T));
+	}
+
+	template<typename T>
+	bool SetBufferStruct(const SimpleConstantBuffer* cb, const T& data)
+	{
+		return SetBufferStruct(cb, &data, sizeof(T));
+	}
+
+	// Binds a buffer the caller keeps filled (say, an immutable one
+	// per object) in this buffer's slot, so nothing is uploaded for
+	// it.  Only works while the shader is bound through a state
+	// cache.  The shader's own data goes back in the slot the next
+	// time it's copied or the shader is set
+	bool BindExternalBuffer(const SimpleConstantBuffer* cb, ID3D11Buffer* buffer);
+
+	// Setting shader resources, by name or by handle
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetShaderResourceView(const SimpleSRV* srvInfo, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetSamplerState(const SimpleSampler* sampInfo, ID3D11SamplerState* samplerState);
 
-	// Getting data about variables and resources
+	// Getting data about variables and resources.  The results
+	// double as handles for the setters above
 	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(SimpleNameHash name);
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(SimpleNameHash name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	size_t GetShaderResourceViewCount() { return textureTable.size(); }
+	size_t GetShaderResourceViewCount() { return shaderResourceViewCount; }
 	
 	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(SimpleNameHash name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	size_t GetSamplerCount() { return samplerTable.size(); }
+	size_t GetSamplerCount() { return samplerCount; }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
@@ -114,34 +258,76 @@ public:
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
 
+	// Upload counts since the last reset
+	const SimpleUploadStats& GetUploadStats() { return uploadStats; }
+	void ResetUploadStats();
+
 protected:
 	
 	bool shaderValid;
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
+	StateCache* stateCache;
+	ConstantBufferRing* constantRing;
+	SimpleUploadStats uploadStats;
+	std::string reflectionCacheFolder;
+
+	// All of the reflection data below, the names and the local
+	// data buffers live in this one block, allocated per load
+	unsigned char* metadata;
 
 	// Resource counts
 	unsigned int constantBufferCount;
+	unsigned int variableCount;
+	unsigned int shaderResourceViewCount;
+	unsigned int samplerCount;
 	
-	// Maps for variables and buffers
-	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+	// Arrays for index-based lookup
+	SimpleConstantBuffer*	constantBuffers;
+	SimpleShaderVariable*	variables;
+	SimpleSRV*				shaderResourceViews;
+	SimpleSampler*			samplerStates;
+
+	// Name tables, sorted by hash.  A name that shares its hash
+	// with another can only be found by name, not by hash
+	SimpleNameEntry* cbNames;
+	SimpleNameEntry* varNames;
+	SimpleNameEntry* textureNames;
+	SimpleNameEntry* samplerNames;
+	unsigned int varNameCount; // Variables can repeat across buffers
 
 	// Pure virtual functions for dealing with shader types
-	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
+	virtual bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv) = 0;
+	virtual void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState) = 0;
 
 	virtual void CleanUp();
 
+	// Fills in the reflection data from the cache, or by reflecting
+	bool GetReflection(ShaderReflectionData& reflection);
+
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Writes into a buffer's local data, tracking what changed
+	bool WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size);
+
+	// Sends a buffer's local data to the GPU
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
+	// Explains a BindBufferStruct() failure in debug builds
+	void LayoutError(std::string bufferName, std::string fieldName, const char* problem);
+	void LayoutError(std::string bufferName, const char* problem);
+
+	// Ring buffer and external buffer support, for stages that
+	// can bind at offsets.  BindConstantBuffer() only binds while
+	// this shader is, and says whether it did
+	virtual bool CanBindBufferRanges() { return false; }
+	virtual bool BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount) { return false; }
+	void RebindConstantBuffer(SimpleConstantBuffer* cb);
 };
 
 // --------------------------------------------------------
@@ -157,16 +343,24 @@ public:
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	// Gets the input layout from a cache shared with other vertex
+	// shaders, instead of creating one of its own.  Set before
+	// LoadShaderFile()
+	void SetInputLayoutCache(InputLayoutCache* cache) { inputLayoutCache = cache; }
+
 
 protected:
 	bool perInstanceCompatible;
 	ID3D11InputLayout* inputLayout;
+	InputLayoutCache* inputLayoutCache;
 	ID3D11VertexShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void SetShaderAndCBs();
 	void CleanUp();
+	bool CanBindBufferRanges();
+	bool BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 };
 
 
@@ -180,14 +374,16 @@ public:
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11PixelShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void SetShaderAndCBs();
 	void CleanUp();
+	bool CanBindBufferRanges();
+	bool BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 };
 
 // --------------------------------------------------------
@@ -200,12 +396,12 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11DomainShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
@@ -220,12 +416,12 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11HullShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
@@ -240,8 +436,6 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
@@ -256,8 +450,10 @@ protected:
 	bool allowStreamOutRasterization;
 	unsigned int streamOutVertexSize;
 
-	bool CreateShader(ID3DBlob* shaderBlob);
-	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 
@@ -279,8 +475,6 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -294,7 +488,9 @@ protected:
 	unsigned int threadsZ;
 	unsigned int threadsTotal;
 
-	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShader(ID3DBlob* shaderBlob, const ShaderReflectionData& reflection);
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "StateCache.h"
+#include <cstdint>
+#include <cstring>
+
+// --------------------------------------------------------
+// A pointer no real object can have, for shadows whose
+// bound value isn't known
+// --------------------------------------------------------
+template<typename T>
+static T * Unknown()
+{
+	return reinterpret_cast<T *>(~(uintptr_t)0);
+}
+
+StateCache::StateCache(ID3D11DeviceContext * _context)
+{
+	context = _context;
+
+	// Binding at offsets needs the D3D11.1 context
+	context1 = 0;
+	if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1)))
+		context1 = 0;
+
+	ResetStats();
+	Invalidate();
+}
+
+StateCache::~StateCache()
+{
+	if (context1) { context1->Release(); }
+}
+
+void StateCache::Invalidate()
+{
+	inputLayout = Unknown<ID3D11InputLayout>();
+	topology = (D3D11_PRIMITIVE_TOPOLOGY)-1;
+	for (unsigned int i = 0; i < STATE_CACHE_VERTEX_BUFFER_SLOTS; i++)
+	{
+		vertexBuffers[i] = Unknown<ID3D11Buffer>();
+		vertexStrides[i] = 0;
+		vertexOffsets[i] = 0;
+	}
+	indexBuffer = Unknown<ID3D11Buffer>();
+	indexFormat = DXGI_FORMAT_UNKNOWN;
+	indexOffset = 0;
+
+	vertexShader = Unknown<ID3D11VertexShader>();
+	pixelShader = Unknown<ID3D11PixelShader>();
+	for (unsigned int i = 0; i < STATE_CACHE_CONSTANT_BUFFER_SLOTS; i++)
+	{
+		vsConstantBuffers[i] = Unknown<ID3D11Buffer>();
+		psConstantBuffers[i] = Unknown<ID3D11Buffer>();
+		for (int r = 0; r < 2; r++)
+		{
+			vsConstantRanges[i][r] = 0;
+			psConstantRanges[i][r] = 0;
+		}
+	}
+	for (unsigned int i = 0; i < STATE_CACHE_RESOURCE_SLOTS; i++)
+	{
+		vsResources[i] = Unknown<ID3D11ShaderResourceView>();
+		psResources[i] = Unknown<ID3D11ShaderResourceView>();
+	}
+	for (unsigned int i = 0; i < STATE_CACHE_SAMPLER_SLOTS; i++)
+	{
+		vsSamplers[i] = Unknown<ID3D11SamplerState>();
+		psSamplers[i] = Unknown<ID3D11SamplerState>();
+	}
+}
+
+void StateCache::ResetStats()
+{
+	stats.Issued = 0;
+	stats.Avoided = 0;
+	stats.Uploads = 0;
+	stats.BytesUploaded = 0;
+}
+
+void StateCache::UpdateBuffer(ID3D11Buffer * buffer, const void * data, unsigned int size)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+
+	memcpy(mapped.pData, data, size);
+	context->Unmap(buffer, 0);
+	RecordUpload(size);
+}
+
+void StateCache::RecordUpload(unsigned int size)
+{
+	stats.Uploads++;
+	stats.BytesUploaded += size;
+}
+
+bool StateCache::Check(bool changed)
+{
+	if (changed)
+		stats.Issued++;
+	else
+		stats.Avoided++;
+	return changed;
+}
+
+#pragma region Input Assembler
+
+void StateCache::SetInputLayout(ID3D11InputLayout * layout)
+{
+	if (!Check(layout != inputLayout))
+		return;
+
+	inputLayout = layout;
+	context->IASetInputLayout(layout);
+}
+
+void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY value)
+{
+	if (!Check(value != topology))
+		return;
+
+	topology = value;
+	context->IASetPrimitiveTopology(value);
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot < STATE_CACHE_VERTEX_BUFFER_SLOTS)
+	{
+		if (!Check(buffer != vertexBuffers[slot] || stride != vertexStrides[slot] || offset != vertexOffsets[slot]))
+			return;
+
+		vertexBuffers[slot] = buffer;
+		vertexStrides[slot] = stride;
+		vertexOffsets[slot] = offset;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer * buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	if (!Check(buffer != indexBuffer || format != indexFormat || offset != indexOffset))
+		return;
+
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+#pragma endregion
+
+#pragma region Vertex Shader
+
+void StateCache::SetVertexShader(ID3D11VertexShader * shader)
+{
+	if (!Check(shader != vertexShader))
+		return;
+
+	vertexShader = shader;
+	context->VSSetShader(shader, 0, 0);
+}
+
+void StateCache::SetVSConstantBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (slot < STATE_CACHE_CONSTANT_BUFFER_SLOTS)
+	{
+		unsigned int * range = vsConstantRanges[slot];
+		if (!Check(buffer != vsConstantBuffers[slot] || firstConstant != range[0] || constantCount != range[1]))
+			return;
+		vsConstantBuffers[slot] = buffer;
+		range[0] = firstConstant;
+		range[1] = constantCount;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	if (constantCount > 0 && context1)
+		context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount);
+	else
+		context->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void StateCache::SetVSShaderResource(unsigned int slot, ID3D11ShaderResourceView * srv)
+{
+	if (slot < STATE_CACHE_RESOURCE_SLOTS)
+	{
+		if (!Check(srv != vsResources[slot]))
+			return;
+		vsResources[slot] = srv;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	context->VSSetShaderResources(slot, 1, &srv);
+}
+
+void StateCache::SetVSSampler(unsigned int slot, ID3D11SamplerState * sampler)
+{
+	if (slot < STATE_CACHE_SAMPLER_SLOTS)
+	{
+		if (!Check(sampler != vsSamplers[slot]))
+			return;
+		vsSamplers[slot] = sampler;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	context->VSSetSamplers(slot, 1, &sampler);
+}
+
+#pragma endregion
+
+#pragma region Pixel Shader
+
+void StateCache::SetPixelShader(ID3D11PixelShader * shader)
+{
+	if (!Check(shader != pixelShader))
+		return;
+
+	pixelShader = shader;
+	context->PSSetShader(shader, 0, 0);
+}
+
+void StateCache::SetPSConstantBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (slot < STATE_CACHE_CONSTANT_BUFFER_SLOTS)
+	{
+		unsigned int * range = psConstantRanges[slot];
+		if (!Check(buffer != psConstantBuffers[slot] || firstConstant != range[0] || constantCount != range[1]))
+			return;
+		psConstantBuffers[slot] = buffer;
+		range[0] = firstConstant;
+		range[1] = constantCount;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	if (constantCount > 0 && context1)
+		context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount);
+	else
+		context->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void StateCache::SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView * srv)
+{
+	if (slot < STATE_CACHE_RESOURCE_SLOTS)
+	{
+		if (!Check(srv != psResources[slot]))
+			return;
+		psResources[slot] = srv;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	context->PSSetShaderResources(slot, 1, &srv);
+}
+
+void StateCache::SetPSSampler(unsigned int slot, ID3D11SamplerState * sampler)
+{
+	if (slot < STATE_CACHE_SAMPLER_SLOTS)
+	{
+		if (!Check(sampler != psSamplers[slot]))
+			return;
+		psSamplers[slot] = sampler;
+	}
+	else
+	{
+		Check(true);
+	}
+
+	context->PSSetSamplers(slot, 1, &sampler);
+}
+
+#pragma endregion
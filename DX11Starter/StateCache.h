@@ -0,0 +1,116 @@
+#pragma once
+#include <d3d11_1.h>
+
+// Slots shadowed per shader stage.  Binds past these go
+// straight to the context
+const unsigned int STATE_CACHE_CONSTANT_BUFFER_SLOTS = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+const unsigned int STATE_CACHE_RESOURCE_SLOTS = 32;
+const unsigned int STATE_CACHE_SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+const unsigned int STATE_CACHE_VERTEX_BUFFER_SLOTS = 4;
+
+// --------------------------------------------------------
+// How many binds went to the context, and how many were
+// dropped for matching what was already bound, along with
+// how much buffer data went through UpdateBuffer()
+// --------------------------------------------------------
+struct StateCacheStats
+{
+	unsigned int Issued;
+	unsigned int Avoided;
+	unsigned int Uploads;
+	unsigned int BytesUploaded;
+};
+
+// --------------------------------------------------------
+// Sits in front of the device context and remembers what
+// is bound to the input assembler, vertex shader and pixel
+// shader stages, so binding the same thing again is free.
+//
+// Everything that binds these states needs to go through
+// the cache, or call Invalidate() after binding directly.
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	/// @param _context: the context binds are forwarded to
+	StateCache(ID3D11DeviceContext * _context);
+	~StateCache();
+
+	/// Forgets everything that's bound, so the next bind of each
+	/// state always reaches the context
+	void Invalidate();
+
+	// Input assembler
+	void SetInputLayout(ID3D11InputLayout * layout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(ID3D11Buffer * buffer, DXGI_FORMAT format, unsigned int offset);
+
+	// Vertex shader stage
+	void SetVertexShader(ID3D11VertexShader * shader);
+	void SetVSConstantBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int firstConstant = 0, unsigned int constantCount = 0);
+	void SetVSShaderResource(unsigned int slot, ID3D11ShaderResourceView * srv);
+	void SetVSSampler(unsigned int slot, ID3D11SamplerState * sampler);
+
+	// Pixel shader stage
+	void SetPixelShader(ID3D11PixelShader * shader);
+	void SetPSConstantBuffer(unsigned int slot, ID3D11Buffer * buffer, unsigned int firstConstant = 0, unsigned int constantCount = 0);
+	void SetPSShaderResource(unsigned int slot, ID3D11ShaderResourceView * srv);
+	void SetPSSampler(unsigned int slot, ID3D11SamplerState * sampler);
+
+	/// Whether constant buffers can be bound at an offset, by
+	/// passing a constant count to Set*ConstantBuffer().  A count
+	/// of 0 binds the whole buffer
+	bool SupportsBufferRanges() { return context1 != 0; }
+
+	/// Replaces the contents of a dynamic buffer, counting the bytes sent
+	/// @param buffer: buffer to update
+	/// @param data: new contents
+	/// @param size: size of the buffer in bytes
+	void UpdateBuffer(ID3D11Buffer * buffer, const void * data, unsigned int size);
+
+	/// Counts data sent to the GPU some other way than UpdateBuffer()
+	void RecordUpload(unsigned int size);
+
+	/// Whether a shader is the one bound right now
+	bool IsBound(ID3D11VertexShader * shader) { return shader == vertexShader; }
+	bool IsBound(ID3D11PixelShader * shader) { return shader == pixelShader; }
+
+	/// Counts since the last ResetStats()
+	const StateCacheStats & GetStats() { return stats; }
+	void ResetStats();
+
+	ID3D11DeviceContext * GetContext() { return context; }
+
+private:
+	ID3D11DeviceContext * context;
+	ID3D11DeviceContext1 * context1;
+	StateCacheStats stats;
+
+	// What's bound right now.  After Invalidate() these hold values
+	// no real bind can match
+	ID3D11InputLayout * inputLayout;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	ID3D11Buffer * vertexBuffers[STATE_CACHE_VERTEX_BUFFER_SLOTS];
+	unsigned int vertexStrides[STATE_CACHE_VERTEX_BUFFER_SLOTS];
+	unsigned int vertexOffsets[STATE_CACHE_VERTEX_BUFFER_SLOTS];
+	ID3D11Buffer * indexBuffer;
+	DXGI_FORMAT indexFormat;
+	unsigned int indexOffset;
+
+	ID3D11VertexShader * vertexShader;
+	ID3D11Buffer * vsConstantBuffers[STATE_CACHE_CONSTANT_BUFFER_SLOTS];
+	unsigned int vsConstantRanges[STATE_CACHE_CONSTANT_BUFFER_SLOTS][2];
+	ID3D11ShaderResourceView * vsResources[STATE_CACHE_RESOURCE_SLOTS];
+	ID3D11SamplerState * vsSamplers[STATE_CACHE_SAMPLER_SLOTS];
+
+	ID3D11PixelShader * pixelShader;
+	ID3D11Buffer * psConstantBuffers[STATE_CACHE_CONSTANT_BUFFER_SLOTS];
+	unsigned int psConstantRanges[STATE_CACHE_CONSTANT_BUFFER_SLOTS][2];
+	ID3D11ShaderResourceView * psResources[STATE_CACHE_RESOURCE_SLOTS];
+	ID3D11SamplerState * psSamplers[STATE_CACHE_SAMPLER_SLOTS];
+
+	/// Records whether a bind was needed
+	/// @return: true if the bind should be issued
+	bool Check(bool changed);
+};
@@ -0,0 +1,335 @@
+#include "StaticInstanceBuffer.h"
+#include "Morton.h"
+#include <cmath>
+#include <algorithm>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Largest magnitude of a quaternion component that isn't the
+// largest one is 1/sqrt(2), so that's the range we quantize
+static const float QUAT_RANGE = 0.70710678f;
+
+// --------------------------------------------------------
+// Transposes four vectors in place, turning four SoA
+// component vectors into four per-instance rows
+// --------------------------------------------------------
+static void Transpose4(XMVECTOR & a, XMVECTOR & b, XMVECTOR & c, XMVECTOR & d)
+{
+	XMVECTOR t0 = XMVectorMergeXY(a, b);
+	XMVECTOR t1 = XMVectorMergeXY(c, d);
+	XMVECTOR t2 = XMVectorMergeZW(a, b);
+	XMVECTOR t3 = XMVectorMergeZW(c, d);
+
+	a = XMVectorPermute<0, 1, 4, 5>(t0, t1);
+	b = XMVectorPermute<2, 3, 6, 7>(t0, t1);
+	c = XMVectorPermute<0, 1, 4, 5>(t2, t3);
+	d = XMVectorPermute<2, 3, 6, 7>(t2, t3);
+}
+
+StaticInstanceBuffer::StaticInstanceBuffer(float _cellSize, float _minScale, float _maxScale)
+{
+	cellSize = _cellSize;
+	minScale = _minScale;
+	maxScale = _maxScale;
+
+	// Scales are spread logarithmically, so small props get
+	// the same relative precision as large ones
+	for (int i = 0; i < 256; i++)
+	{
+		scaleTable[i] = minScale * powf(maxScale / minScale, i / 255.0f);
+	}
+}
+
+StaticInstanceBuffer::~StaticInstanceBuffer()
+{
+}
+
+uint8_t StaticInstanceBuffer::AddGroup(Mesh * mesh, Material * material)
+{
+	groupMeshes.push_back(mesh);
+	groupMaterials.push_back(material);
+	return (uint8_t)(groupMeshes.size() - 1);
+}
+
+// --------------------------------------------------------
+// Quantizes and stores a single prop
+// --------------------------------------------------------
+size_t StaticInstanceBuffer::Add(XMFLOAT3 position, XMFLOAT4 rotation, float scale, uint8_t group)
+{
+	PackedStaticInstance instance;
+
+	// Find the cell containing the prop
+	instance.Cell = FindOrAddCell(
+		(int)floorf(position.x / cellSize),
+		(int)floorf(position.y / cellSize),
+		(int)floorf(position.z / cellSize));
+	XMFLOAT3 origin = cellOrigins[instance.Cell];
+
+	// Position relative to the cell, in 1/65535ths of a cell
+	float offset[3] = { position.x - origin.x, position.y - origin.y, position.z - origin.z };
+	for (int i = 0; i < 3; i++)
+	{
+		float quantized = offset[i] / cellSize * 65535.0f + 0.5f;
+		quantized = quantized < 0.0f ? 0.0f : (quantized > 65535.0f ? 65535.0f : quantized);
+		instance.Position[i] = (uint16_t)quantized;
+	}
+
+	// Closest entry in the log scale table
+	float scaleStep = logf(scale / minScale) / logf(maxScale / minScale) * 255.0f + 0.5f;
+	scaleStep = scaleStep < 0.0f ? 0.0f : (scaleStep > 255.0f ? 255.0f : scaleStep);
+	instance.Scale = (uint8_t)scaleStep;
+
+	instance.Rotation = PackRotation(rotation);
+	instance.Group = group;
+
+	instances.push_back(instance);
+	return instances.size() - 1;
+}
+
+// --------------------------------------------------------
+// Sorts instances along a Z-order curve through the bounds
+// of every prop.  Props don't move, so this is a one time
+// full sort after loading rather than an incremental one
+// --------------------------------------------------------
+void StaticInstanceBuffer::SortSpatially()
+{
+	size_t count = instances.size();
+	if (count < 2)
+		return;
+
+	XMFLOAT3 boundsMin = GetPosition(instances[0]);
+	XMFLOAT3 boundsMax = boundsMin;
+	for (size_t i = 1; i < count; i++)
+	{
+		XMFLOAT3 position = GetPosition(instances[i]);
+		boundsMin.x = position.x < boundsMin.x ? position.x : boundsMin.x;
+		boundsMin.y = position.y < boundsMin.y ? position.y : boundsMin.y;
+		boundsMin.z = position.z < boundsMin.z ? position.z : boundsMin.z;
+		boundsMax.x = position.x > boundsMax.x ? position.x : boundsMax.x;
+		boundsMax.y = position.y > boundsMax.y ? position.y : boundsMax.y;
+		boundsMax.z = position.z > boundsMax.z ? position.z : boundsMax.z;
+	}
+
+	// Pair each instance with its code and sort the pairs
+	std::vector<std::pair<uint32_t, size_t>> keys(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		keys[i].first = MortonEncode(GetPosition(instances[i]), boundsMin, boundsMax);
+		keys[i].second = i;
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<PackedStaticInstance> sorted(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		sorted[i] = instances[keys[i].second];
+	}
+	instances.swap(sorted);
+}
+
+// --------------------------------------------------------
+// Rebuilds world matrices for a range of instances.  Bits
+// are unpacked per instance, then everything else (rotation
+// reconstruction, matrix building, transposing) runs on four
+// instances at once, one instance per SIMD lane.
+// --------------------------------------------------------
+void StaticInstanceBuffer::Decode(size_t first, size_t count, XMFLOAT4X4 * worldMatrices)
+{
+	const float positionStep = cellSize / 65535.0f;
+	const XMVECTOR quatScale = XMVectorReplicate(2.0f * QUAT_RANGE / 1023.0f);
+	const XMVECTOR quatOffset = XMVectorReplicate(-QUAT_RANGE);
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+	const XMVECTOR lastRow = XMVectorSet(0, 0, 0, 1);
+
+	for (size_t base = 0; base < count; base += 4)
+	{
+		size_t remaining = count - base;
+		size_t lanes = remaining < 4 ? remaining : 4;
+
+		// Unpack each lane's bits (short batches repeat the last instance)
+		alignas(16) float px[4], py[4], pz[4];
+		alignas(16) float qa[4], qb[4], qc[4], qi[4];
+		alignas(16) float s[4];
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			const PackedStaticInstance & instance = instances[first + base + (lane < lanes ? lane : lanes - 1)];
+			const XMFLOAT3 & origin = cellOrigins[instance.Cell];
+
+			px[lane] = origin.x + instance.Position[0] * positionStep;
+			py[lane] = origin.y + instance.Position[1] * positionStep;
+			pz[lane] = origin.z + instance.Position[2] * positionStep;
+
+			qi[lane] = (float)(instance.Rotation >> 30);
+			qa[lane] = (float)((instance.Rotation >> 20) & 1023);
+			qb[lane] = (float)((instance.Rotation >> 10) & 1023);
+			qc[lane] = (float)(instance.Rotation & 1023);
+
+			s[lane] = scaleTable[instance.Scale];
+		}
+
+		// Dequantize the three small components and rebuild the largest
+		XMVECTOR a = XMVectorMultiplyAdd(XMLoadFloat4A((const XMFLOAT4A *)qa), quatScale, quatOffset);
+		XMVECTOR b = XMVectorMultiplyAdd(XMLoadFloat4A((const XMFLOAT4A *)qb), quatScale, quatOffset);
+		XMVECTOR c = XMVectorMultiplyAdd(XMLoadFloat4A((const XMFLOAT4A *)qc), quatScale, quatOffset);
+		XMVECTOR sumSq = XMVectorMultiplyAdd(a, a, XMVectorMultiplyAdd(b, b, XMVectorMultiply(c, c)));
+		XMVECTOR d = XMVectorSqrt(XMVectorMax(XMVectorZero(), XMVectorSubtract(one, sumSq)));
+
+		// Put the largest component back in its slot, per lane
+		XMVECTOR index = XMLoadFloat4A((const XMFLOAT4A *)qi);
+		XMVECTOR is0 = XMVectorEqual(index, XMVectorZero());
+		XMVECTOR is1 = XMVectorEqual(index, one);
+		XMVECTOR is2 = XMVectorEqual(index, two);
+		XMVECTOR is3 = XMVectorEqual(index, XMVectorReplicate(3.0f));
+
+		XMVECTOR x = XMVectorSelect(a, d, is0);
+		XMVECTOR y = XMVectorSelect(XMVectorSelect(b, d, is1), a, is0);
+		XMVECTOR z = XMVectorSelect(XMVectorSelect(b, c, is3), d, is2);
+		XMVECTOR w = XMVectorSelect(c, d, is3);
+
+		// Rotation matrix terms (same layout as XMMatrixRotationQuaternion)
+		XMVECTOR xx = XMVectorMultiply(x, x), yy = XMVectorMultiply(y, y), zz = XMVectorMultiply(z, z);
+		XMVECTOR xy = XMVectorMultiply(x, y), xz = XMVectorMultiply(x, z), yz = XMVectorMultiply(y, z);
+		XMVECTOR wx = XMVectorMultiply(w, x), wy = XMVectorMultiply(w, y), wz = XMVectorMultiply(w, z);
+
+		// Fold the factor of two and the uniform scale in together
+		XMVECTOR scale = XMLoadFloat4A((const XMFLOAT4A *)s);
+		XMVECTOR scale2 = XMVectorMultiply(scale, two);
+
+		XMVECTOR r00 = XMVectorSubtract(scale, XMVectorMultiply(scale2, XMVectorAdd(yy, zz)));
+		XMVECTOR r01 = XMVectorMultiply(scale2, XMVectorAdd(xy, wz));
+		XMVECTOR r02 = XMVectorMultiply(scale2, XMVectorSubtract(xz, wy));
+		XMVECTOR r10 = XMVectorMultiply(scale2, XMVectorSubtract(xy, wz));
+		XMVECTOR r11 = XMVectorSubtract(scale, XMVectorMultiply(scale2, XMVectorAdd(xx, zz)));
+		XMVECTOR r12 = XMVectorMultiply(scale2, XMVectorAdd(yz, wx));
+		XMVECTOR r20 = XMVectorMultiply(scale2, XMVectorAdd(xz, wy));
+		XMVECTOR r21 = XMVectorMultiply(scale2, XMVectorSubtract(yz, wx));
+		XMVECTOR r22 = XMVectorSubtract(scale, XMVectorMultiply(scale2, XMVectorAdd(xx, yy)));
+
+		// Rows of the transposed (HLSL) matrix are columns of the
+		// DirectX one: rotation column, then translation in w
+		XMVECTOR row0 = r00, row0b = r10, row0c = r20, row0d = XMLoadFloat4A((const XMFLOAT4A *)px);
+		XMVECTOR row1 = r01, row1b = r11, row1c = r21, row1d = XMLoadFloat4A((const XMFLOAT4A *)py);
+		XMVECTOR row2 = r02, row2b = r12, row2c = r22, row2d = XMLoadFloat4A((const XMFLOAT4A *)pz);
+		Transpose4(row0, row0b, row0c, row0d);
+		Transpose4(row1, row1b, row1c, row1d);
+		Transpose4(row2, row2b, row2c, row2d);
+
+		XMFLOAT4X4 * out = worldMatrices + base;
+		if (lanes == 4)
+		{
+			// Straight stores for full groups, keeping the rows in registers
+			XMStoreFloat4((XMFLOAT4 *)&out[0].m[0][0], row0);
+			XMStoreFloat4((XMFLOAT4 *)&out[0].m[1][0], row1);
+			XMStoreFloat4((XMFLOAT4 *)&out[0].m[2][0], row2);
+			XMStoreFloat4((XMFLOAT4 *)&out[0].m[3][0], lastRow);
+			XMStoreFloat4((XMFLOAT4 *)&out[1].m[0][0], row0b);
+			XMStoreFloat4((XMFLOAT4 *)&out[1].m[1][0], row1b);
+			XMStoreFloat4((XMFLOAT4 *)&out[1].m[2][0], row2b);
+			XMStoreFloat4((XMFLOAT4 *)&out[1].m[3][0], lastRow);
+			XMStoreFloat4((XMFLOAT4 *)&out[2].m[0][0], row0c);
+			XMStoreFloat4((XMFLOAT4 *)&out[2].m[1][0], row1c);
+			XMStoreFloat4((XMFLOAT4 *)&out[2].m[2][0], row2c);
+			XMStoreFloat4((XMFLOAT4 *)&out[2].m[3][0], lastRow);
+			XMStoreFloat4((XMFLOAT4 *)&out[3].m[0][0], row0d);
+			XMStoreFloat4((XMFLOAT4 *)&out[3].m[1][0], row1d);
+			XMStoreFloat4((XMFLOAT4 *)&out[3].m[2][0], row2d);
+			XMStoreFloat4((XMFLOAT4 *)&out[3].m[3][0], lastRow);
+			continue;
+		}
+
+		XMVECTOR rows0[4] = { row0, row0b, row0c, row0d };
+		XMVECTOR rows1[4] = { row1, row1b, row1c, row1d };
+		XMVECTOR rows2[4] = { row2, row2b, row2c, row2d };
+		for (size_t lane = 0; lane < lanes; lane++)
+		{
+			XMFLOAT4X4 & out = worldMatrices[base + lane];
+			XMStoreFloat4((XMFLOAT4 *)&out.m[0][0], rows0[lane]);
+			XMStoreFloat4((XMFLOAT4 *)&out.m[1][0], rows1[lane]);
+			XMStoreFloat4((XMFLOAT4 *)&out.m[2][0], rows2[lane]);
+			XMStoreFloat4((XMFLOAT4 *)&out.m[3][0], lastRow);
+		}
+	}
+}
+
+size_t StaticInstanceBuffer::GetMemoryUsage()
+{
+	return instances.size() * sizeof(PackedStaticInstance) +
+		cellOrigins.size() * sizeof(XMFLOAT3);
+}
+
+// --------------------------------------------------------
+// Looks up a cell by its integer coordinates, creating it
+// the first time a prop lands in it
+// --------------------------------------------------------
+uint32_t StaticInstanceBuffer::FindOrAddCell(int x, int y, int z)
+{
+	// 21 bits per axis is far more cells than we'll ever use
+	uint64_t key =
+		((uint64_t)(x & 0x1FFFFF) << 42) |
+		((uint64_t)(y & 0x1FFFFF) << 21) |
+		(uint64_t)(z & 0x1FFFFF);
+
+	std::unordered_map<uint64_t, uint32_t>::iterator result = cellLookup.find(key);
+	if (result != cellLookup.end())
+		return result->second;
+
+	uint32_t cell = (uint32_t)cellOrigins.size();
+	cellOrigins.push_back(XMFLOAT3(x * cellSize, y * cellSize, z * cellSize));
+	cellLookup.insert(std::pair<uint64_t, uint32_t>(key, cell));
+	return cell;
+}
+
+// --------------------------------------------------------
+// Packs a quaternion as "smallest three".  q and -q are the
+// same rotation, so we flip the sign until the largest
+// component is positive and then don't need to store it.
+// --------------------------------------------------------
+uint32_t StaticInstanceBuffer::PackRotation(XMFLOAT4 rotation)
+{
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+	float components[4] = { q.x, q.y, q.z, q.w };
+
+	// Find the largest component
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; i++)
+	{
+		if (fabsf(components[i]) > fabsf(components[largest]))
+			largest = i;
+	}
+	float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+	// Quantize the other three in order
+	uint32_t packed = largest << 30;
+	int shift = 20;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		float normalized = (components[i] * sign + QUAT_RANGE) / (2.0f * QUAT_RANGE);
+		float quantized = normalized * 1023.0f + 0.5f;
+		quantized = quantized < 0.0f ? 0.0f : (quantized > 1023.0f ? 1023.0f : quantized);
+
+		packed |= (uint32_t)quantized << shift;
+		shift -= 10;
+	}
+
+	return packed;
+}
+
+// --------------------------------------------------------
+// Dequantized world position of a single instance
+// --------------------------------------------------------
+XMFLOAT3 StaticInstanceBuffer::GetPosition(const PackedStaticInstance & instance)
+{
+	const float positionStep = cellSize / 65535.0f;
+	const XMFLOAT3 & origin = cellOrigins[instance.Cell];
+
+	return XMFLOAT3(
+		origin.x + instance.Position[0] * positionStep,
+		origin.y + instance.Position[1] * positionStep,
+		origin.z + instance.Position[2] * positionStep);
+}
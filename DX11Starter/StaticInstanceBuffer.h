@@ -0,0 +1,91 @@
+#pragma once
+#include "Mesh.h"
+#include "Material.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// --------------------------------------------------------
+// A static prop's transform packed into 16 bytes
+//  - Position is quantized to 16 bits per axis inside a cell
+//  - Rotation is a "smallest three" quaternion: the index of
+//    the largest component in 2 bits, then the other three
+//    components in 10 bits each
+//  - Scale is uniform and stored on a log scale in one byte
+// --------------------------------------------------------
+struct PackedStaticInstance
+{
+	uint16_t Position[3];	// Offset from the cell origin
+	uint8_t Scale;			// Index into the scale table
+	uint8_t Group;			// Which mesh/material pair to draw with
+	uint32_t Rotation;		// Smallest three quaternion
+	uint32_t Cell;			// Index of the cell origin
+};
+
+// --------------------------------------------------------
+// Compact storage for large numbers of static props.  World
+// matrices are never stored - they're rebuilt in batches
+// when the props are culled or drawn.
+// --------------------------------------------------------
+class StaticInstanceBuffer
+{
+public:
+	/// @param _cellSize: world size of a quantization cell, larger
+	/// cells mean fewer cells but less position precision
+	/// @param _minScale: smallest representable uniform scale
+	/// @param _maxScale: largest representable uniform scale
+	StaticInstanceBuffer(float _cellSize, float _minScale, float _maxScale);
+	~StaticInstanceBuffer();
+
+	/// Registers a mesh/material pair instances can be drawn with
+	/// @return: the group index to pass to Add()
+	uint8_t AddGroup(Mesh * mesh, Material * material);
+
+	/// Packs and stores a static prop
+	/// @param position: world space position
+	/// @param rotation: rotation quaternion
+	/// @param scale: uniform scale
+	/// @param group: group index from AddGroup()
+	/// @return: the index of the new instance
+	size_t Add(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation, float scale, uint8_t group);
+
+	/// Rebuilds world matrices (transposed for HLSL, like
+	/// Entity's) four instances at a time
+	/// @param first: index of the first instance to decode
+	/// @param count: number of instances to decode
+	/// @param worldMatrices: receives count matrices
+	void Decode(size_t first, size_t count, DirectX::XMFLOAT4X4 * worldMatrices);
+
+	/// Reorders instances by the Morton code of their positions, so
+	/// props near each other in the world are decoded together.
+	/// Invalidates instance indices returned by Add().
+	void SortSpatially();
+
+	// Getters
+	size_t GetCount() { return instances.size(); }
+	const PackedStaticInstance & GetInstance(size_t index) { return instances[index]; }
+	size_t GetGroupCount() { return groupMeshes.size(); }
+	Mesh * GetGroupMesh(uint8_t group) { return groupMeshes[group]; }
+	Material * GetGroupMaterial(uint8_t group) { return groupMaterials[group]; }
+
+	/// Bytes used by instance and cell data
+	size_t GetMemoryUsage();
+
+private:
+	float cellSize;
+	float scaleTable[256];
+	float minScale;
+	float maxScale;
+
+	std::vector<PackedStaticInstance> instances;
+	std::vector<DirectX::XMFLOAT3> cellOrigins;
+	std::unordered_map<uint64_t, uint32_t> cellLookup;
+
+	std::vector<Mesh *> groupMeshes;
+	std::vector<Material *> groupMaterials;
+
+	uint32_t FindOrAddCell(int x, int y, int z);
+	DirectX::XMFLOAT3 GetPosition(const PackedStaticInstance & instance);
+	static uint32_t PackRotation(DirectX::XMFLOAT4 rotation);
+};
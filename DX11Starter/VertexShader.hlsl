@@ -4,14 +4,22 @@
 //    which will (eventually) hold data from our C++ code
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
-// - The name of the cbuffer itself is unimportant
-cbuffer externalData : register(b0)
+// - Buffers are grouped by how often they change, so each
+//    one is only uploaded when its own data does.  The C++
+//    side copies them by name, so keep the names in sync
+//    with RenderState.h
+// Mirrored by VertexPerFrameConstants in ShaderConstants.h
+cbuffer perFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 };
 
+cbuffer perObject : register(b1)
+{
+	matrix world;
+};
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -0,0 +1,65 @@
+
+// Constant Buffer
+// - Same as VertexShader.hlsl, except the world matrix comes
+//    from the instance data instead
+// Mirrored by VertexPerFrameConstants in ShaderConstants.h
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+// Struct representing a single vertex worth of data
+// - The first three members come from the mesh's vertex buffer (slot 0)
+// - Anything with a semantic ending in "_PER_INSTANCE" comes from the
+//    instance buffer (slot 1) instead, advancing once per instance.
+//    SimpleVertexShader sets that up when it builds the input layout
+struct VertexShaderInput
+{ 
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float3 position		: POSITION;     // XYZ position
+	float3 normal		: NORMAL;
+	float2 uv			: UV;
+
+	// World matrix rows, transposed like the C++ side stores it
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+};
+
+// Struct representing the data we're sending down the pipeline
+// - Should match our pixel shader's input (hence the name: Vertex to Pixel)
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;	// XYZW position (System Value Position)
+	float3 normal		: NORMAL;
+	float2 uv			: TEXCOORD;
+};
+
+// --------------------------------------------------------
+// The entry point (main method) for our instanced vertex shader
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	// The uploaded matrix is transposed (that's what the constant
+	// buffer path wants), so flip it back
+	matrix world = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+	matrix worldViewProj = mul(mul(world, view), projection);
+
+	// Position to homogenous screen space, and normal to world space
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.normal = mul(input.normal, (float3x3)world);
+
+	// Assign output UV
+	output.uv = input.uv;
+
+	return output;
+}
@@ -0,0 +1,234 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "InstanceBuffer.h"
+#include "StateCache.h"
+#include "RingAllocator.h"
+#include "ConstantBufferRing.h"
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+static const std::string MAP_DISCARD = "Map " + std::to_string(D3D11_MAP_WRITE_DISCARD);
+static const std::string MAP_NO_OVERWRITE = "Map " + std::to_string(D3D11_MAP_WRITE_NO_OVERWRITE);
+
+TEST(InstancesAppendAfterEachOther)
+{
+	FakeDevice device;
+	FakeContext context;
+	StateCache stateCache(&context);
+	InstanceBuffer instances(&device, 10);
+	XMFLOAT4X4 matrices[10];
+
+	// The first append of a frame discards, later ones don't
+	CHECK(instances.Append(matrices, 4, &stateCache) == 0);
+	CHECK(instances.Append(matrices, 4, &stateCache) == 4);
+	CHECK(context.CountCalls(MAP_DISCARD) == 1);
+	CHECK(context.CountCalls(MAP_NO_OVERWRITE) == 1);
+
+	// Too many to fit, so it starts over at the front
+	CHECK(instances.Append(matrices, 3, &stateCache) == 0);
+	CHECK(context.CountCalls(MAP_DISCARD) == 2);
+	CHECK(context.CountCalls("Unmap") == 3);
+	CHECK(stateCache.GetStats().Uploads == 3);
+	CHECK(stateCache.GetStats().BytesUploaded == 11 * sizeof(XMFLOAT4X4));
+}
+
+TEST(FailedMapsAreReported)
+{
+	FakeDevice device;
+	FakeContext context;
+	StateCache stateCache(&context);
+	InstanceBuffer instances(&device, 10);
+	XMFLOAT4X4 matrices[10];
+
+	CHECK(instances.Append(matrices, 4, &stateCache) == 0);
+	context.FailMap = true;
+	CHECK(instances.Append(matrices, 4, &stateCache) == INSTANCE_APPEND_FAILED);
+	CHECK(context.CountCalls("Unmap") == 1);
+
+	// Nothing was written, so the next append goes where the
+	// failed one would have
+	context.FailMap = false;
+	CHECK(instances.Append(matrices, 4, &stateCache) == 4);
+}
+
+TEST(MissingBufferIsReported)
+{
+	FakeDevice device;
+	device.FailCreateBuffer = true;
+	FakeContext context;
+	StateCache stateCache(&context);
+	InstanceBuffer instances(&device, 10);
+	XMFLOAT4X4 matrices[1];
+
+	CHECK(instances.GetCapacity() == 0);
+	CHECK(instances.Append(matrices, 1, &stateCache) == INSTANCE_APPEND_FAILED);
+	CHECK(context.Calls.empty());
+}
+
+TEST(RingAllocatesFramesInOrder)
+{
+	RingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(64) == 0);
+	CHECK(ring.Allocate(300) == 256);
+	CHECK(ring.GetUsed() == 768);
+	CHECK(ring.Allocate(512) == RING_ALLOCATION_FAILED);
+
+	// The next frame fills the ring to its end
+	ring.EndFrame();
+	CHECK(ring.Allocate(256) == 768);
+	CHECK(ring.Allocate(1) == RING_ALLOCATION_FAILED);
+
+	// Freeing the first frame makes room at the front again
+	ring.EndFrame();
+	CHECK(ring.RetireFrame());
+	CHECK(ring.GetUsed() == 256);
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.Allocate(512) == 256);
+	CHECK(ring.Allocate(256) == RING_ALLOCATION_FAILED);
+}
+
+// --------------------------------------------------------
+// Random sized allocations with frames retired at random,
+// checking no region overlaps one still in use
+// --------------------------------------------------------
+TEST(RingRegionsNeverOverlap)
+{
+	typedef std::vector<std::pair<unsigned int, unsigned int> > Regions;
+
+	RingAllocator ring(64 * 1024, 256);
+	std::mt19937 random(1);
+	std::deque<Regions> frames;
+	Regions current;
+	int overlaps = 0;
+	int allocations = 0;
+
+	for (int frame = 0; frame < 5000; frame++)
+	{
+		while (ring.GetPendingFrames() >= random() % RING_MAX_FRAMES + 1)
+		{
+			ring.RetireFrame();
+			frames.pop_front();
+		}
+
+		int count = random() % 40;
+		for (int i = 0; i < count; i++)
+		{
+			unsigned int size = 1 + random() % 2000;
+			unsigned int offset = ring.Allocate(size);
+			if (offset == RING_ALLOCATION_FAILED)
+				continue;
+
+			allocations++;
+			size = ring.AlignSize(size);
+			CHECK(offset % 256 == 0 && offset + size <= ring.GetCapacity());
+			for (size_t f = 0; f < frames.size(); f++)
+			{
+				for (size_t r = 0; r < frames[f].size(); r++)
+					overlaps += offset + size > frames[f][r].first && frames[f][r].first + frames[f][r].second > offset;
+			}
+			for (size_t r = 0; r < current.size(); r++)
+				overlaps += offset + size > current[r].first && current[r].first + current[r].second > offset;
+			current.push_back(std::make_pair(offset, size));
+		}
+
+		ring.EndFrame();
+		frames.push_back(current);
+		current.clear();
+	}
+
+	CHECK(overlaps == 0);
+	CHECK(allocations > 0);
+	while (ring.RetireFrame()) {}
+	CHECK(ring.GetUsed() == 0);
+}
+
+TEST(ConstantRingNeedsOffsetBinding)
+{
+	FakeDevice device;
+	FakeContext context;
+	device.ConstantBufferOffsetting = false;
+	ConstantBufferRing ring(&device, &context, 4096);
+	CHECK(!ring.IsAvailable());
+}
+
+TEST(ConstantRingUploadsAtConstantOffsets)
+{
+	FakeDevice device;
+	FakeContext context;
+	ConstantBufferRing ring(&device, &context, 1024);
+	CHECK(ring.IsAvailable());
+
+	unsigned int firstConstant;
+	unsigned int constantCount;
+	float data[16] = { 1, 2, 3 };
+
+	// Regions are 256 bytes apart, which is 16 constants
+	ring.BeginFrame();
+	CHECK(ring.Upload(data, 64, &firstConstant, &constantCount));
+	CHECK(firstConstant == 0 && constantCount == 16);
+	CHECK(ring.Upload(data, 300, &firstConstant, &constantCount));
+	CHECK(firstConstant == 16 && constantCount == 32);
+	CHECK(context.CountCalls(MAP_DISCARD) == 1);
+	CHECK(context.CountCalls(MAP_NO_OVERWRITE) == 1);
+
+	FakeBuffer * buffer = static_cast<FakeBuffer *>(ring.GetBuffer());
+	CHECK(memcmp(&buffer->Data[256], data, sizeof(data)) == 0);
+
+	ring.EndFrame();
+	CHECK(context.CountCalls("End") == 1);
+}
+
+TEST(ConstantRingWaitsOnlyWhenFull)
+{
+	FakeDevice device;
+	FakeContext context;
+	ConstantBufferRing ring(&device, &context, 1024);
+	unsigned int firstConstant;
+	unsigned int constantCount;
+	float data[128] = {};
+
+	ring.BeginFrame();
+	ring.Upload(data, 64, &firstConstant, &constantCount);
+	ring.Upload(data, 300, &firstConstant, &constantCount);
+	ring.EndFrame();
+
+	// The GPU isn't done with the last frame.  BeginFrame() only
+	// polls once, and uploads go after the last frame's
+	context.PendingQueryPolls = 1000;
+	ring.BeginFrame();
+	CHECK(context.PendingQueryPolls == 999);
+	CHECK(ring.Upload(data, 64, &firstConstant, &constantCount));
+	CHECK(firstConstant == 48);
+
+	// Once the ring is full an upload waits for the GPU
+	context.PendingQueryPolls = 3;
+	CHECK(ring.Upload(data, 64, &firstConstant, &constantCount));
+	CHECK(firstConstant == 0);
+	CHECK(context.PendingQueryPolls == 0);
+
+	// A frame that overflows the ring on its own fails
+	CHECK(ring.Upload(data, 512, &firstConstant, &constantCount));
+	CHECK(!ring.Upload(data, 512, &firstConstant, &constantCount));
+	ring.EndFrame();
+}
+
+TEST(ConstantRingWaitsWhenEveryFrameIsInFlight)
+{
+	FakeDevice device;
+	FakeContext context;
+	ConstantBufferRing ring(&device, &context, 1024);
+
+	// The GPU never catches up.  BeginFrame() only polls until
+	// every frame slot is in use, then waits on the oldest
+	for (unsigned int frame = 0; frame <= RING_MAX_FRAMES; frame++)
+	{
+		context.PendingQueryPolls = 1000;
+		ring.BeginFrame();
+		CHECK((context.PendingQueryPolls == 0) == (frame == RING_MAX_FRAMES));
+		ring.EndFrame();
+	}
+}
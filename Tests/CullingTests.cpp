@@ -0,0 +1,212 @@
+#include "Test.h"
+#include "AABBTree.h"
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Frustum planes for a camera placement, built the same way
+// Game::Update() builds them for the previous tick's view
+// --------------------------------------------------------
+static void GetPlanes(XMFLOAT3 position, float yaw, XMFLOAT4 * planes)
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0, yaw, 0));
+	XMFLOAT4X4 view = Camera::BuildViewMatrix(position, rotation);
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 100.0f);
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMMatrixTranspose(XMLoadFloat4x4(&view)) * projection));
+	Camera::ExtractFrustumPlanes(viewProjection, planes);
+}
+
+static AABB MakeBox(float x, float y, float z, float extent)
+{
+	AABB box;
+	box.Min = XMFLOAT3(x - extent, y - extent, z - extent);
+	box.Max = XMFLOAT3(x + extent, y + extent, z + extent);
+	return box;
+}
+
+static bool BoxTouchesFrustum(const AABB & box, const XMFLOAT4 * planes)
+{
+	float center[3] = { (box.Min.x + box.Max.x) * 0.5f, (box.Min.y + box.Max.y) * 0.5f, (box.Min.z + box.Max.z) * 0.5f };
+	float extent[3] = { (box.Max.x - box.Min.x) * 0.5f, (box.Max.y - box.Min.y) * 0.5f, (box.Max.z - box.Min.z) * 0.5f };
+	for (int p = 0; p < 6; p++)
+	{
+		float distance = planes[p].x * center[0] + planes[p].y * center[1] + planes[p].z * center[2] + planes[p].w;
+		float radius = fabsf(planes[p].x) * extent[0] + fabsf(planes[p].y) * extent[1] + fabsf(planes[p].z) * extent[2];
+		if (distance + radius < 0)
+			return false;
+	}
+	return true;
+}
+
+TEST(TreeQueryMatchesBruteForce)
+{
+	AABBTree tree(0.1f);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	const int count = 5000;
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; i++)
+		proxies[i] = tree.CreateProxy(MakeBox(coordinate(random), coordinate(random), coordinate(random), size(random)), i);
+
+	// Move some a little and some a long way
+	for (int i = 0; i < count; i += 3)
+	{
+		AABB box = tree.GetFatAABB(proxies[i]);
+		float shift = (i % 2) ? 0.01f : 50.0f;
+		box.Min.x += shift;
+		box.Max.x += shift;
+		tree.MoveProxy(proxies[i], box);
+	}
+
+	XMFLOAT4 planes[6];
+	GetPlanes(XMFLOAT3(0, 0, -50), 0.3f, planes);
+	std::vector<unsigned int> inside;
+	std::vector<unsigned int> intersecting;
+	tree.QueryFrustum(planes, inside, intersecting);
+
+	std::vector<int> found(count, 0);
+	for (size_t i = 0; i < inside.size(); i++)
+		found[inside[i]]++;
+	for (size_t i = 0; i < intersecting.size(); i++)
+		found[intersecting[i]]++;
+
+	int wrong = 0;
+	for (int i = 0; i < count; i++)
+	{
+		bool expected = BoxTouchesFrustum(tree.GetFatAABB(proxies[i]), planes);
+		if (found[i] != (expected ? 1 : 0))
+			wrong++;
+	}
+	CHECK(wrong == 0);
+	CHECK(!inside.empty());
+}
+
+TEST(CullingKeepsWhatEitherTickSees)
+{
+	// The camera turns a quarter turn in one tick, from looking
+	// down +Z to looking down +X.  Draw shows it part way round,
+	// so boxes ahead of either placement must survive
+	XMFLOAT4 current[6];
+	XMFLOAT4 previous[6];
+	GetPlanes(XMFLOAT3(0, 0, 0), XM_PIDIV2, current);
+	GetPlanes(XMFLOAT3(0, 0, 0), 0.0f, previous);
+	const XMFLOAT4 * planeSets[2] = { current, previous };
+
+	AABBTree tree(0.1f);
+	tree.CreateProxy(MakeBox(20, 0, 0, 1), 0);		// Ahead now
+	tree.CreateProxy(MakeBox(0, 0, 20, 1), 1);		// Ahead last tick
+	tree.CreateProxy(MakeBox(-20, 0, 0, 1), 2);		// Behind both
+
+	std::vector<MultiViewResult> results;
+	tree.QueryFrustums(planeSets, 2, results);
+
+	uint32_t masks[3] = { 0, 0, 0 };
+	for (size_t i = 0; i < results.size(); i++)
+		masks[results[i].UserData] = results[i].InsideMask | results[i].IntersectMask;
+	CHECK(masks[0] == 1);
+	CHECK(masks[1] == 2);
+	CHECK(masks[2] == 0);
+
+	// Tight bounds of boxes the tree left undecided go through
+	// the culler with the same two views
+	FrustumCuller culler;
+	culler.AddBox(XMFLOAT3(20, 0, 0), XMFLOAT3(1, 1, 1));
+	culler.AddBox(XMFLOAT3(0, 0, 20), XMFLOAT3(1, 1, 1));
+	culler.AddBox(XMFLOAT3(-20, 0, 0), XMFLOAT3(1, 1, 1));
+	culler.CullViews(planeSets, 2);
+	CHECK(culler.GetViewMask(0) == 1);
+	CHECK(culler.GetViewMask(1) == 2);
+	CHECK(culler.GetViewMask(2) == 0);
+
+	// A single view would have lost the box the previous tick saw
+	CHECK(culler.Cull(current) == 1);
+}
+
+TEST(MultiViewQueriesMatchSeparateQueries)
+{
+	AABBTree tree(0.1f);
+	std::mt19937 random(36);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::uniform_real_distribution<float> yaw(-XM_PI, XM_PI);
+
+	const int count = 4000;
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; i++)
+		proxies[i] = tree.CreateProxy(MakeBox(coordinate(random), coordinate(random), coordinate(random), size(random)), i);
+
+	// Nine cameras scattered around, like split-screen players
+	// plus shadow views
+	const int VIEW_COUNT = 9;
+	std::vector<XMFLOAT4> planes(VIEW_COUNT * 6);
+	const XMFLOAT4 * planeSets[VIEW_COUNT];
+	for (int v = 0; v < VIEW_COUNT; v++)
+	{
+		GetPlanes(XMFLOAT3(coordinate(random) * 0.5f, 0, coordinate(random) * 0.5f), yaw(random), &planes[v * 6]);
+		planeSets[v] = &planes[v * 6];
+	}
+
+	// What each view sees on its own, one bit per view
+	std::vector<uint32_t> insideMasks(count, 0);
+	std::vector<uint32_t> intersectMasks(count, 0);
+	for (int v = 0; v < VIEW_COUNT; v++)
+	{
+		std::vector<unsigned int> inside;
+		std::vector<unsigned int> intersecting;
+		tree.QueryFrustum(planeSets[v], inside, intersecting);
+		for (size_t i = 0; i < inside.size(); i++)
+			insideMasks[inside[i]] |= 1u << v;
+		for (size_t i = 0; i < intersecting.size(); i++)
+			intersectMasks[intersecting[i]] |= 1u << v;
+	}
+
+	std::vector<MultiViewResult> results;
+	tree.QueryFrustums(planeSets, VIEW_COUNT, results);
+
+	// Every proxy some view sees comes back once, inside and
+	// crossing the same views as in the separate queries
+	std::vector<int> found(count, 0);
+	int wrong = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		unsigned int index = results[i].UserData;
+		found[index]++;
+		if (results[i].InsideMask != insideMasks[index] || results[i].IntersectMask != intersectMasks[index])
+			wrong++;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		if (found[i] != ((insideMasks[i] | intersectMasks[i]) ? 1 : 0))
+			wrong++;
+	}
+	CHECK(wrong == 0);
+	CHECK(results.size() > 100);
+
+	// The culler agrees on the same boxes
+	FrustumCuller culler;
+	for (int i = 0; i < count; i++)
+	{
+		const AABB & box = tree.GetFatAABB(proxies[i]);
+		culler.AddBox(
+			XMFLOAT3((box.Min.x + box.Max.x) * 0.5f, (box.Min.y + box.Max.y) * 0.5f, (box.Min.z + box.Max.z) * 0.5f),
+			XMFLOAT3((box.Max.x - box.Min.x) * 0.5f, (box.Max.y - box.Min.y) * 0.5f, (box.Max.z - box.Min.z) * 0.5f));
+	}
+	culler.CullViews(planeSets, VIEW_COUNT);
+
+	int different = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (culler.GetViewMask(i) != (insideMasks[i] | intersectMasks[i]))
+			different++;
+	}
+	CHECK(different == 0);
+}
@@ -0,0 +1,201 @@
+#include "Test.h"
+#include "EntityCommandBuffer.h"
+#include "PotentiallyVisibleSet.h"
+#include "TestCube.h"
+#include <thread>
+
+using namespace DirectX;
+
+TEST(HandlesFindTheirEntities)
+{
+	CubeFixture cube;
+	EntityPool pool;
+
+	std::vector<EntityHandle> handles;
+	std::vector<Entity *> added;
+	for (int i = 0; i < 10; i++)
+	{
+		handles.push_back(pool.ReserveHandle());
+		added.push_back(cube.MakeEntity((float)i));
+		pool.Add(handles[i], added[i]);
+	}
+
+	CHECK(pool.Size() == 10);
+	for (int i = 0; i < 10; i++)
+		CHECK(pool.Get(handles[i]) == added[i]);
+	for (size_t i = 0; i < pool.Size(); i++)
+		CHECK(pool.Get(pool.GetHandle(i)) == pool[i]);
+	CHECK(pool.Get(INVALID_ENTITY_HANDLE) == 0);
+}
+
+TEST(RemovedHandlesStayInvalidWhenTheSlotIsReused)
+{
+	CubeFixture cube;
+	EntityPool pool;
+
+	EntityHandle first = pool.ReserveHandle();
+	pool.Add(first, cube.MakeEntity(0));
+	pool.Remove(std::vector<EntityHandle>(1, first));
+	CHECK(pool.Get(first) == 0);
+
+	// Same slot, new generation
+	EntityHandle second = pool.ReserveHandle();
+	Entity * entity = cube.MakeEntity(1);
+	pool.Add(second, entity);
+	CHECK(GetEntitySlot(second) == GetEntitySlot(first));
+	CHECK(second != first);
+	CHECK(pool.Get(second) == entity);
+	CHECK(pool.Get(first) == 0);
+
+	// Removing through the stale handle leaves the new entity alone
+	pool.Remove(std::vector<EntityHandle>(1, first));
+	CHECK(pool.Size() == 1);
+	CHECK(pool.Get(second) == entity);
+}
+
+TEST(RemoveKeepsOtherHandlesValid)
+{
+	CubeFixture cube;
+	EntityPool pool;
+
+	std::vector<EntityHandle> handles;
+	for (int i = 0; i < 20; i++)
+	{
+		handles.push_back(pool.ReserveHandle());
+		pool.Add(handles[i], cube.MakeEntity((float)i));
+	}
+
+	std::vector<EntityHandle> removed;
+	for (int i = 0; i < 20; i += 3)
+		removed.push_back(handles[i]);
+	pool.Remove(removed);
+
+	CHECK(pool.Size() == 20 - removed.size());
+	for (int i = 0; i < 20; i++)
+	{
+		Entity * entity = pool.Get(handles[i]);
+		if (i % 3 == 0)
+			CHECK(entity == 0);
+		else
+			CHECK(entity && entity->GetPosition().x == (float)i);
+	}
+}
+
+TEST(PlaybackIgnoresStaleHandles)
+{
+	CubeFixture cube;
+	EntityPool pool;
+	EntityCommandBuffer commands(&pool);
+
+	EntityHandle old = commands.Create(cube.mesh, 0);
+	commands.Playback();
+	commands.Destroy(old);
+	commands.Playback();
+
+	EntityHandle reused = commands.Create(cube.mesh, 0);
+	commands.Playback();
+	CHECK(GetEntitySlot(reused) == GetEntitySlot(old));
+
+	// A late command aimed at the destroyed entity
+	commands.SetTransform(old, XMFLOAT3(5, 5, 5), XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+	commands.Destroy(old);
+	commands.Playback();
+
+	Entity * entity = pool.Get(reused);
+	CHECK(entity != 0);
+	CHECK(entity && entity->GetPosition().x == 0.0f);
+}
+
+TEST(CommandCountWhileRecording)
+{
+	EntityPool pool;
+	EntityCommandBuffer commands(&pool);
+
+	std::thread recorder([&commands]()
+	{
+		for (int i = 0; i < 10000; i++)
+			commands.SetMesh((EntityHandle)i, 0);
+	});
+
+	size_t seen = 0;
+	while (seen < 10000)
+	{
+		size_t count = commands.GetCommandCount();
+		CHECK(count >= seen);
+		seen = count;
+	}
+	recorder.join();
+	CHECK(commands.GetCommandCount() == 10000);
+}
+
+TEST(MovingEndsBeingStatic)
+{
+	CubeFixture cube;
+	EntityPool pool;
+
+	// A static entity baked as hidden behind a static wall
+	Entity * wall = cube.MakeEntity(10, XMFLOAT3(2, 200, 200));
+	wall->SetStaticId(0);
+	wall->SetOccluder(true);
+	pool.Add(pool.ReserveHandle(), wall);
+
+	Entity * entity = cube.MakeEntity(50);
+	entity->SetStaticId(1);
+	pool.Add(pool.ReserveHandle(), entity);
+	CHECK(entity->GetStatic());
+
+	PotentiallyVisibleSet pvs;
+	pvs.Bake(&pool, XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1), 2.0f);
+	pvs.SetViewPosition(XMFLOAT3(0, 0, 0));
+	CHECK(!pvs.IsVisible(entity->GetStaticId()));
+
+	// Once it moves in front of the wall the baked bit is wrong,
+	// so it stops being static and the set stops judging it
+	entity->Move(-45, 0, 0, 0, 0, 0);
+	CHECK(!entity->GetStatic());
+	CHECK(entity->GetStaticId() == NO_STATIC_ID);
+	CHECK(pvs.IsVisible(entity->GetStaticId()));
+
+	// Every other way of changing its world matrix or mesh too
+	Entity * other = cube.MakeEntity(0);
+	other->SetStaticId(2);
+	other->SetWorldMatrix(wall->GetWorldMatrix());
+	CHECK(!other->GetStatic());
+
+	other->SetStaticId(2);
+	other->SetPosition(XMFLOAT3(3, 0, 0));
+	CHECK(other->GetStatic());
+	other->UpdateWorldMatrix();
+	CHECK(!other->GetStatic());
+
+	other->SetStaticId(2);
+	other->SetMesh(cube.mesh);
+	CHECK(!other->GetStatic());
+	delete other;
+}
+
+TEST(PlacedEntitiesDoNotSweep)
+{
+	CubeFixture cube;
+	EntityPool pool;
+	EntityCommandBuffer commands(&pool);
+
+	// Created and placed in the same tick
+	EntityHandle handle = commands.Create(cube.mesh, 0);
+	commands.SetTransform(handle, XMFLOAT3(20, 0, 0), XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+	commands.Playback();
+
+	Entity * entity = pool.Get(handle);
+	XMFLOAT4X4 world = entity->GetWorldMatrix();
+	XMFLOAT4X4 previous = entity->GetPreviousWorldMatrix();
+	CHECK(memcmp(&world, &previous, sizeof(XMFLOAT4X4)) == 0);
+
+	// Teleported a tick later
+	entity->StorePreviousWorldMatrix();
+	commands.SetTransform(handle, XMFLOAT3(-20, 5, 0), XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+	commands.Playback();
+	world = entity->GetWorldMatrix();
+	previous = entity->GetPreviousWorldMatrix();
+	CHECK(world._14 == -20.0f);
+	CHECK(memcmp(&world, &previous, sizeof(XMFLOAT4X4)) == 0);
+}
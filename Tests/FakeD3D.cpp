@@ -0,0 +1,528 @@
+#include "FakeD3D.h"
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+const IID IID_ID3D11ShaderReflection = { 0x8d536ca1, 0x0cca, 0x4956, { 0xa8, 0x37, 0x78, 0x69, 0x63, 0x75, 0x55, 0x84 } };
+const IID IID_ID3D11DeviceContext1 = { 0xbb2c6faa, 0xb5fb, 0x4082, { 0x8e, 0x6b, 0x38, 0x8b, 0x8c, 0xfa, 0x90, 0xe1 } };
+
+static std::atomic<int> liveFakeObjects(0);
+
+int GetLiveFakeObjects()
+{
+	return liveFakeObjects;
+}
+
+void CountLiveFakeObject(int change)
+{
+	liveFakeObjects += change;
+}
+
+// --------------------------------------------------------
+// Objects that are only ever bound, never looked inside
+// --------------------------------------------------------
+class FakeInputLayout : public FakeObject<ID3D11InputLayout> { };
+class FakeVertexShader : public FakeObject<ID3D11VertexShader> { };
+class FakePixelShader : public FakeObject<ID3D11PixelShader> { };
+class FakeDomainShader : public FakeObject<ID3D11DomainShader> { };
+class FakeHullShader : public FakeObject<ID3D11HullShader> { };
+class FakeGeometryShader : public FakeObject<ID3D11GeometryShader> { };
+class FakeComputeShader : public FakeObject<ID3D11ComputeShader> { };
+class FakeQuery : public FakeObject<ID3D11Query> { };
+
+FakeBuffer::FakeBuffer(const D3D11_BUFFER_DESC & _desc, const void * initialData)
+{
+	Desc = _desc;
+	Data.resize(Desc.ByteWidth);
+	if (initialData && Desc.ByteWidth > 0)
+		memcpy(&Data[0], initialData, Desc.ByteWidth);
+}
+
+// --------------------------------------------------------
+// Device
+// --------------------------------------------------------
+FakeDevice::FakeDevice()
+	: BuffersCreated(0), InputLayoutsCreated(0), ShadersCreated(0)
+{
+	FailCreateBuffer = false;
+	FailCreateShader = false;
+	ConstantBufferOffsetting = true;
+}
+
+HRESULT FakeDevice::CreateBuffer(const D3D11_BUFFER_DESC * desc, const D3D11_SUBRESOURCE_DATA * initialData, ID3D11Buffer ** buffer)
+{
+	if (FailCreateBuffer || desc->ByteWidth == 0)
+		return E_FAIL;
+	if (desc->Usage == D3D11_USAGE_IMMUTABLE && !initialData)
+		return E_INVALIDARG;
+
+	*buffer = new FakeBuffer(*desc, initialData ? initialData->pSysMem : 0);
+	BuffersCreated++;
+	return S_OK;
+}
+
+HRESULT FakeDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *, UINT, const void *, SIZE_T, ID3D11InputLayout ** layout)
+{
+	*layout = new FakeInputLayout();
+	InputLayoutsCreated++;
+	return S_OK;
+}
+
+template <class Fake, class Interface>
+static HRESULT CreateFakeShader(bool fail, std::atomic<int> & count, Interface ** shader)
+{
+	if (fail)
+		return E_FAIL;
+	*shader = new Fake();
+	count++;
+	return S_OK;
+}
+
+HRESULT FakeDevice::CreateVertexShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11VertexShader ** shader)
+{
+	return CreateFakeShader<FakeVertexShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreatePixelShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11PixelShader ** shader)
+{
+	return CreateFakeShader<FakePixelShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateDomainShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11DomainShader ** shader)
+{
+	return CreateFakeShader<FakeDomainShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateHullShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11HullShader ** shader)
+{
+	return CreateFakeShader<FakeHullShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateGeometryShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11GeometryShader ** shader)
+{
+	return CreateFakeShader<FakeGeometryShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateGeometryShaderWithStreamOutput(const void *, SIZE_T, const D3D11_SO_DECLARATION_ENTRY *, UINT,
+	const UINT *, UINT, UINT, ID3D11ClassLinkage *, ID3D11GeometryShader ** shader)
+{
+	return CreateFakeShader<FakeGeometryShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateComputeShader(const void *, SIZE_T, ID3D11ClassLinkage *, ID3D11ComputeShader ** shader)
+{
+	return CreateFakeShader<FakeComputeShader>(FailCreateShader, ShadersCreated, shader);
+}
+
+HRESULT FakeDevice::CreateQuery(const D3D11_QUERY_DESC *, ID3D11Query ** query)
+{
+	*query = new FakeQuery();
+	return S_OK;
+}
+
+HRESULT FakeDevice::CheckFeatureSupport(D3D11_FEATURE feature, void * data, UINT dataSize)
+{
+	if (feature != D3D11_FEATURE_D3D11_OPTIONS || dataSize != sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS))
+		return E_INVALIDARG;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS * options = (D3D11_FEATURE_DATA_D3D11_OPTIONS *)data;
+	memset(options, 0, sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS));
+	options->ConstantBufferOffsetting = ConstantBufferOffsetting;
+	options->ConstantBufferPartialUpdate = ConstantBufferOffsetting;
+	options->MapNoOverwriteOnDynamicConstantBuffer = ConstantBufferOffsetting;
+	return S_OK;
+}
+
+// --------------------------------------------------------
+// Context
+// --------------------------------------------------------
+FakeContext::FakeContext()
+{
+	memset(VSConstantBuffers, 0, sizeof(VSConstantBuffers));
+	memset(PSConstantBuffers, 0, sizeof(PSConstantBuffers));
+	memset(VSFirstConstants, 0, sizeof(VSFirstConstants));
+	memset(PSFirstConstants, 0, sizeof(PSFirstConstants));
+	FailMap = false;
+	PendingQueryPolls = 0;
+	SupportsContext1 = true;
+}
+
+HRESULT FakeContext::QueryInterface(REFIID riid, void ** object)
+{
+	*object = 0;
+	if (!SupportsContext1 || memcmp(&riid, &IID_ID3D11DeviceContext1, sizeof(IID)) != 0)
+		return E_FAIL;
+
+	AddRef();
+	*object = static_cast<ID3D11DeviceContext1 *>(this);
+	return S_OK;
+}
+
+void FakeContext::Record(const char * call, UINT a)
+{
+	Calls.push_back(std::string(call) + " " + std::to_string(a));
+}
+
+void FakeContext::Record(const char * call, UINT a, UINT b)
+{
+	Calls.push_back(std::string(call) + " " + std::to_string(a) + " " + std::to_string(b));
+}
+
+void FakeContext::Record(const char * call, UINT a, UINT b, UINT c)
+{
+	Calls.push_back(std::string(call) + " " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c));
+}
+
+int FakeContext::CountCalls(const std::string & prefix) const
+{
+	int count = 0;
+	for (size_t i = 0; i < Calls.size(); i++)
+	{
+		if (Calls[i].compare(0, prefix.size(), prefix) == 0)
+			count++;
+	}
+	return count;
+}
+
+HRESULT FakeContext::Map(ID3D11Resource * resource, UINT, D3D11_MAP mapType, UINT, D3D11_MAPPED_SUBRESOURCE * mapped)
+{
+	Record("Map", mapType);
+	if (FailMap)
+		return E_FAIL;
+
+	FakeBuffer * buffer = static_cast<FakeBuffer *>(static_cast<ID3D11Buffer *>(resource));
+	mapped->pData = buffer->Data.empty() ? 0 : &buffer->Data[0];
+	mapped->RowPitch = (UINT)buffer->Data.size();
+	mapped->DepthPitch = (UINT)buffer->Data.size();
+	return S_OK;
+}
+
+void FakeContext::Unmap(ID3D11Resource *, UINT)
+{
+	Calls.push_back("Unmap");
+}
+
+void FakeContext::End(ID3D11Asynchronous *)
+{
+	Calls.push_back("End");
+}
+
+HRESULT FakeContext::GetData(ID3D11Asynchronous *, void *, UINT, UINT)
+{
+	Calls.push_back("GetData");
+	if (PendingQueryPolls > 0)
+	{
+		PendingQueryPolls--;
+		return S_FALSE;
+	}
+	return S_OK;
+}
+
+void FakeContext::IASetInputLayout(ID3D11InputLayout *) { Calls.push_back("IASetInputLayout"); }
+void FakeContext::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer * const *, const UINT *, const UINT *) { Record("IASetVertexBuffers", startSlot, count); }
+void FakeContext::IASetIndexBuffer(ID3D11Buffer *, DXGI_FORMAT, UINT) { Calls.push_back("IASetIndexBuffer"); }
+void FakeContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) { Record("IASetPrimitiveTopology", topology); }
+
+void FakeContext::VSSetShader(ID3D11VertexShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("VSSetShader"); }
+void FakeContext::PSSetShader(ID3D11PixelShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("PSSetShader"); }
+void FakeContext::DSSetShader(ID3D11DomainShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("DSSetShader"); }
+void FakeContext::HSSetShader(ID3D11HullShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("HSSetShader"); }
+void FakeContext::GSSetShader(ID3D11GeometryShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("GSSetShader"); }
+void FakeContext::CSSetShader(ID3D11ComputeShader *, ID3D11ClassInstance * const *, UINT) { Calls.push_back("CSSetShader"); }
+
+void FakeContext::VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers)
+{
+	Record("VSSetConstantBuffers", startSlot);
+	for (UINT i = 0; i < count; i++)
+	{
+		VSConstantBuffers[startSlot + i] = buffers[i];
+		VSFirstConstants[startSlot + i] = 0;
+	}
+}
+
+void FakeContext::PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers)
+{
+	Record("PSSetConstantBuffers", startSlot);
+	for (UINT i = 0; i < count; i++)
+	{
+		PSConstantBuffers[startSlot + i] = buffers[i];
+		PSFirstConstants[startSlot + i] = 0;
+	}
+}
+
+void FakeContext::DSSetConstantBuffers(UINT startSlot, UINT, ID3D11Buffer * const *) { Record("DSSetConstantBuffers", startSlot); }
+void FakeContext::HSSetConstantBuffers(UINT startSlot, UINT, ID3D11Buffer * const *) { Record("HSSetConstantBuffers", startSlot); }
+void FakeContext::GSSetConstantBuffers(UINT startSlot, UINT, ID3D11Buffer * const *) { Record("GSSetConstantBuffers", startSlot); }
+void FakeContext::CSSetConstantBuffers(UINT startSlot, UINT, ID3D11Buffer * const *) { Record("CSSetConstantBuffers", startSlot); }
+
+void FakeContext::VSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants)
+{
+	Record("VSSetConstantBuffers1", startSlot, firstConstant[0], numConstants[0]);
+	for (UINT i = 0; i < count; i++)
+	{
+		VSConstantBuffers[startSlot + i] = buffers[i];
+		VSFirstConstants[startSlot + i] = firstConstant[i];
+	}
+}
+
+void FakeContext::PSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants)
+{
+	Record("PSSetConstantBuffers1", startSlot, firstConstant[0], numConstants[0]);
+	for (UINT i = 0; i < count; i++)
+	{
+		PSConstantBuffers[startSlot + i] = buffers[i];
+		PSFirstConstants[startSlot + i] = firstConstant[i];
+	}
+}
+
+void FakeContext::VSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("VSSetShaderResources", startSlot); }
+void FakeContext::PSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("PSSetShaderResources", startSlot); }
+void FakeContext::DSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("DSSetShaderResources", startSlot); }
+void FakeContext::HSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("HSSetShaderResources", startSlot); }
+void FakeContext::GSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("GSSetShaderResources", startSlot); }
+void FakeContext::CSSetShaderResources(UINT startSlot, UINT, ID3D11ShaderResourceView * const *) { Record("CSSetShaderResources", startSlot); }
+
+void FakeContext::VSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("VSSetSamplers", startSlot); }
+void FakeContext::PSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("PSSetSamplers", startSlot); }
+void FakeContext::DSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("DSSetSamplers", startSlot); }
+void FakeContext::HSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("HSSetSamplers", startSlot); }
+void FakeContext::GSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("GSSetSamplers", startSlot); }
+void FakeContext::CSSetSamplers(UINT startSlot, UINT, ID3D11SamplerState * const *) { Record("CSSetSamplers", startSlot); }
+
+void FakeContext::CSSetUnorderedAccessViews(UINT startSlot, UINT, ID3D11UnorderedAccessView * const *, const UINT *) { Record("CSSetUnorderedAccessViews", startSlot); }
+void FakeContext::SOSetTargets(UINT count, ID3D11Buffer * const *, const UINT *) { Record("SOSetTargets", count); }
+
+void FakeContext::DrawIndexed(UINT indexCount, UINT, int) { Record("DrawIndexed", indexCount); }
+void FakeContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT, int, UINT) { Record("DrawIndexedInstanced", indexCountPerInstance, instanceCount); }
+void FakeContext::Dispatch(UINT x, UINT y, UINT z) { Record("Dispatch", x, y, z); }
+
+// --------------------------------------------------------
+// Fake compiled shaders.  The "bytecode" is text naming the
+// registered shader, plus the defines it was compiled with
+// so every permutation hashes differently.
+// --------------------------------------------------------
+static std::mutex fakeShaderLock;
+static std::map<std::wstring, int> fakeShaderFiles;
+static std::vector<FakeShader> fakeShaders;
+static std::atomic<int> fakeReflectCount(0);
+static std::atomic<int> fakeCompileCount(0);
+
+void AddFakeShaderFile(const std::wstring & file, const FakeShader & shader)
+{
+	std::lock_guard<std::mutex> guard(fakeShaderLock);
+	fakeShaderFiles[file] = (int)fakeShaders.size();
+	fakeShaders.push_back(shader);
+}
+
+void ClearFakeShaderFiles()
+{
+	std::lock_guard<std::mutex> guard(fakeShaderLock);
+	fakeShaderFiles.clear();
+	fakeShaders.clear();
+	fakeReflectCount = 0;
+	fakeCompileCount = 0;
+}
+
+int GetFakeReflectCount()
+{
+	return fakeReflectCount;
+}
+
+int GetFakeCompileCount()
+{
+	return fakeCompileCount;
+}
+
+static bool FindFakeShader(LPCWSTR file, int & index)
+{
+	std::lock_guard<std::mutex> guard(fakeShaderLock);
+	std::map<std::wstring, int>::iterator found = fakeShaderFiles.find(file);
+	if (found == fakeShaderFiles.end())
+		return false;
+	index = found->second;
+	return true;
+}
+
+class FakeBlob : public FakeObject<ID3DBlob>
+{
+public:
+	FakeBlob(const std::string & _bytes) : bytes(_bytes) { }
+	void * GetBufferPointer() { return &bytes[0]; }
+	SIZE_T GetBufferSize() { return bytes.size(); }
+private:
+	std::string bytes;
+};
+
+HRESULT D3DReadFileToBlob(LPCWSTR fileName, ID3DBlob ** contents)
+{
+	int index;
+	if (!FindFakeShader(fileName, index))
+		return E_FAIL;
+
+	*contents = new FakeBlob("fake shader " + std::to_string(index) + ";");
+	return S_OK;
+}
+
+HRESULT D3DCompileFromFile(LPCWSTR fileName, const D3D_SHADER_MACRO * defines, ID3DInclude *,
+	LPCSTR entryPoint, LPCSTR target, UINT, UINT, ID3DBlob ** code, ID3DBlob ** errorMessages)
+{
+	fakeCompileCount++;
+	*code = 0;
+	if (errorMessages)
+		*errorMessages = 0;
+
+	int index;
+	if (!FindFakeShader(fileName, index))
+	{
+		if (errorMessages)
+			*errorMessages = new FakeBlob(std::string("file not found"));
+		return E_FAIL;
+	}
+
+	std::string bytes = "fake shader " + std::to_string(index) + ";" + entryPoint + ";" + target + ";";
+	for (const D3D_SHADER_MACRO * define = defines; define && define->Name; define++)
+		bytes += std::string(define->Name) + "=" + define->Definition + ";";
+	*code = new FakeBlob(bytes);
+	return S_OK;
+}
+
+// --------------------------------------------------------
+// Reflection over a registered FakeShader
+// --------------------------------------------------------
+class FakeReflectionVariable : public ID3D11ShaderReflectionVariable
+{
+public:
+	const FakeShaderVariable * Variable;
+
+	HRESULT GetDesc(D3D11_SHADER_VARIABLE_DESC * desc)
+	{
+		memset(desc, 0, sizeof(D3D11_SHADER_VARIABLE_DESC));
+		desc->Name = Variable->Name.c_str();
+		desc->StartOffset = Variable->StartOffset;
+		desc->Size = Variable->Size;
+		return S_OK;
+	}
+};
+
+class FakeReflectionBuffer : public ID3D11ShaderReflectionConstantBuffer
+{
+public:
+	const FakeShaderBuffer * Buffer;
+	std::vector<FakeReflectionVariable> Variables;
+
+	HRESULT GetDesc(D3D11_SHADER_BUFFER_DESC * desc)
+	{
+		memset(desc, 0, sizeof(D3D11_SHADER_BUFFER_DESC));
+		desc->Name = Buffer->Name.c_str();
+		desc->Type = D3D_CT_CBUFFER;
+		desc->Variables = (UINT)Buffer->Variables.size();
+		desc->Size = Buffer->Size;
+		return S_OK;
+	}
+
+	ID3D11ShaderReflectionVariable * GetVariableByIndex(UINT index) { return &Variables[index]; }
+};
+
+class FakeReflection : public FakeObject<ID3D11ShaderReflection>
+{
+public:
+	FakeReflection(const FakeShader & _shader)
+		: shader(_shader)
+	{
+		buffers.resize(shader.ConstantBuffers.size());
+		for (size_t b = 0; b < buffers.size(); b++)
+		{
+			const FakeShaderBuffer & buffer = shader.ConstantBuffers[b];
+			buffers[b].Buffer = &buffer;
+			buffers[b].Variables.resize(buffer.Variables.size());
+			for (size_t v = 0; v < buffer.Variables.size(); v++)
+				buffers[b].Variables[v].Variable = &buffer.Variables[v];
+
+			FakeShaderResource resource = { buffer.Name, D3D_SIT_CBUFFER, buffer.BindPoint };
+			resources.push_back(resource);
+		}
+		resources.insert(resources.end(), shader.Resources.begin(), shader.Resources.end());
+	}
+
+	HRESULT GetDesc(D3D11_SHADER_DESC * desc)
+	{
+		memset(desc, 0, sizeof(D3D11_SHADER_DESC));
+		desc->ConstantBuffers = (UINT)shader.ConstantBuffers.size();
+		desc->BoundResources = (UINT)resources.size();
+		desc->InputParameters = (UINT)shader.Inputs.size();
+		return S_OK;
+	}
+
+	ID3D11ShaderReflectionConstantBuffer * GetConstantBufferByIndex(UINT index) { return &buffers[index]; }
+
+	HRESULT GetResourceBindingDesc(UINT index, D3D11_SHADER_INPUT_BIND_DESC * desc)
+	{
+		if (index >= resources.size())
+			return E_INVALIDARG;
+		memset(desc, 0, sizeof(D3D11_SHADER_INPUT_BIND_DESC));
+		desc->Name = resources[index].Name.c_str();
+		desc->Type = resources[index].Type;
+		desc->BindPoint = resources[index].BindPoint;
+		desc->BindCount = 1;
+		return S_OK;
+	}
+
+	HRESULT GetResourceBindingDescByName(LPCSTR name, D3D11_SHADER_INPUT_BIND_DESC * desc)
+	{
+		for (UINT i = 0; i < resources.size(); i++)
+		{
+			if (resources[i].Name == name)
+				return GetResourceBindingDesc(i, desc);
+		}
+		return E_INVALIDARG;
+	}
+
+	HRESULT GetInputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC * desc)
+	{
+		if (index >= shader.Inputs.size())
+			return E_INVALIDARG;
+		memset(desc, 0, sizeof(D3D11_SIGNATURE_PARAMETER_DESC));
+		desc->SemanticName = shader.Inputs[index].SemanticName.c_str();
+		desc->SemanticIndex = shader.Inputs[index].SemanticIndex;
+		desc->Register = index;
+		desc->ComponentType = shader.Inputs[index].ComponentType;
+		desc->Mask = shader.Inputs[index].Mask;
+		return S_OK;
+	}
+
+	HRESULT GetOutputParameterDesc(UINT, D3D11_SIGNATURE_PARAMETER_DESC *) { return E_INVALIDARG; }
+
+	UINT GetThreadGroupSize(UINT * x, UINT * y, UINT * z)
+	{
+		*x = *y = *z = 0;
+		return 0;
+	}
+
+private:
+	FakeShader shader;
+	std::vector<FakeReflectionBuffer> buffers;
+	std::vector<FakeShaderResource> resources;
+};
+
+HRESULT D3DReflect(const void * srcData, SIZE_T srcDataSize, REFIID, void ** reflector)
+{
+	*reflector = 0;
+
+	std::string bytes((const char *)srcData, srcDataSize);
+	const std::string prefix = "fake shader ";
+	if (bytes.compare(0, prefix.size(), prefix) != 0)
+		return E_FAIL;
+
+	int index = atoi(bytes.c_str() + prefix.size());
+	FakeShader shader;
+	{
+		std::lock_guard<std::mutex> guard(fakeShaderLock);
+		if (index < 0 || index >= (int)fakeShaders.size())
+			return E_FAIL;
+		shader = fakeShaders[index];
+	}
+
+	fakeReflectCount++;
+	*reflector = static_cast<ID3D11ShaderReflection *>(new FakeReflection(shader));
+	return S_OK;
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <d3d11_1.h>
+#include <d3dcompiler.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Fake Direct3D objects for the host tests.  The device
+// hands out fakes that count what was created, and the
+// context records every call so tests can check exactly
+// what the engine would have sent to the GPU.
+// --------------------------------------------------------
+
+// Number of fake COM objects created and not yet released,
+// for catching leaks
+int GetLiveFakeObjects();
+void CountLiveFakeObject(int change);
+
+// --------------------------------------------------------
+// Reference counted base for the fakes.  Starts with one
+// reference, like a freshly created D3D object.
+// --------------------------------------------------------
+template <class Interface>
+class FakeObject : public Interface
+{
+public:
+	FakeObject() : refs(1) { CountLiveFakeObject(1); }
+	virtual ~FakeObject() { CountLiveFakeObject(-1); }
+
+	HRESULT QueryInterface(REFIID, void ** object) { *object = 0; return E_FAIL; }
+	unsigned long AddRef() { return ++refs; }
+	unsigned long Release()
+	{
+		unsigned long count = --refs;
+		if (count == 0)
+			delete this;
+		return count;
+	}
+
+	unsigned long GetRefCount() { return refs; }
+
+private:
+	std::atomic<unsigned long> refs;
+};
+
+// --------------------------------------------------------
+// A buffer with real memory behind it, so whatever is
+// mapped and written can be read back
+// --------------------------------------------------------
+class FakeBuffer : public FakeObject<ID3D11Buffer>
+{
+public:
+	FakeBuffer(const D3D11_BUFFER_DESC & _desc, const void * initialData);
+
+	void GetDesc(D3D11_BUFFER_DESC * desc) { *desc = Desc; }
+
+	D3D11_BUFFER_DESC Desc;
+	std::vector<unsigned char> Data;
+};
+
+// --------------------------------------------------------
+// Device that creates fakes, with switches to make creation
+// fail and to choose which 11.1 features it reports
+// --------------------------------------------------------
+class FakeDevice : public FakeObject<ID3D11Device>
+{
+public:
+	FakeDevice();
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC * desc, const D3D11_SUBRESOURCE_DATA * initialData, ID3D11Buffer ** buffer);
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC * elements, UINT elementCount, const void * bytecode, SIZE_T bytecodeLength, ID3D11InputLayout ** layout);
+	HRESULT CreateVertexShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11VertexShader ** shader);
+	HRESULT CreatePixelShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11PixelShader ** shader);
+	HRESULT CreateDomainShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11DomainShader ** shader);
+	HRESULT CreateHullShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11HullShader ** shader);
+	HRESULT CreateGeometryShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11GeometryShader ** shader);
+	HRESULT CreateGeometryShaderWithStreamOutput(const void * bytecode, SIZE_T bytecodeLength,
+		const D3D11_SO_DECLARATION_ENTRY * entries, UINT entryCount, const UINT * strides, UINT stridesCount,
+		UINT rasterizedStream, ID3D11ClassLinkage * linkage, ID3D11GeometryShader ** shader);
+	HRESULT CreateComputeShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11ComputeShader ** shader);
+	HRESULT CreateQuery(const D3D11_QUERY_DESC * desc, ID3D11Query ** query);
+	HRESULT CheckFeatureSupport(D3D11_FEATURE feature, void * data, UINT dataSize);
+
+	// Make the next creations fail
+	bool FailCreateBuffer;
+	bool FailCreateShader;
+
+	// Reported through D3D11_FEATURE_D3D11_OPTIONS
+	bool ConstantBufferOffsetting;
+
+	std::atomic<int> BuffersCreated;
+	std::atomic<int> InputLayoutsCreated;
+	std::atomic<int> ShadersCreated;
+};
+
+// --------------------------------------------------------
+// Context that records its calls as strings such as
+// "VSSetConstantBuffers 1" or "DrawIndexed 36", and tracks
+// the constant buffers bound to each vertex and pixel shader
+// slot
+// --------------------------------------------------------
+class FakeContext : public FakeObject<ID3D11DeviceContext1>
+{
+public:
+	FakeContext();
+
+	HRESULT QueryInterface(REFIID riid, void ** object);
+
+	HRESULT Map(ID3D11Resource * resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE * mapped);
+	void Unmap(ID3D11Resource * resource, UINT subresource);
+	void End(ID3D11Asynchronous * async);
+	HRESULT GetData(ID3D11Asynchronous * async, void * data, UINT dataSize, UINT flags);
+
+	void IASetInputLayout(ID3D11InputLayout * layout);
+	void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * strides, const UINT * offsets);
+	void IASetIndexBuffer(ID3D11Buffer * buffer, DXGI_FORMAT format, UINT offset);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	void VSSetShader(ID3D11VertexShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+	void PSSetShader(ID3D11PixelShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+	void DSSetShader(ID3D11DomainShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+	void HSSetShader(ID3D11HullShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+	void GSSetShader(ID3D11GeometryShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+	void CSSetShader(ID3D11ComputeShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount);
+
+	void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void CSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers);
+	void VSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants);
+	void PSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants);
+
+	void VSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+	void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+	void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+	void HSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+	void GSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+	void CSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views);
+
+	void VSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+	void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+	void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+	void HSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+	void GSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+	void CSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers);
+
+	void CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView * const * views, const UINT * initialCounts);
+	void SOSetTargets(UINT count, ID3D11Buffer * const * targets, const UINT * offsets);
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance);
+	void Dispatch(UINT x, UINT y, UINT z);
+
+	/// Number of recorded calls starting with the given text
+	int CountCalls(const std::string & prefix) const;
+
+	std::vector<std::string> Calls;
+
+	// Constant buffer (and first constant) bound to each slot
+	ID3D11Buffer * VSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	ID3D11Buffer * PSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	UINT VSFirstConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	UINT PSFirstConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+
+	// Make Map() fail
+	bool FailMap;
+
+	// GetData() says a query is still pending this many times
+	// before reporting it done
+	int PendingQueryPolls;
+
+	// Whether QueryInterface() hands out the 11.1 interface
+	bool SupportsContext1;
+
+private:
+	void Record(const char * call, UINT a);
+	void Record(const char * call, UINT a, UINT b);
+	void Record(const char * call, UINT a, UINT b, UINT c);
+};
+
+// --------------------------------------------------------
+// Fake compiled shaders.  Tests describe a shader's
+// reflection and register it under a file name; then
+// D3DReadFileToBlob() and D3DCompileFromFile() on that name
+// give bytecode that D3DReflect() maps back to the
+// description.
+// --------------------------------------------------------
+struct FakeShaderVariable
+{
+	std::string Name;
+	UINT StartOffset;
+	UINT Size;
+};
+
+struct FakeShaderBuffer
+{
+	std::string Name;
+	UINT BindPoint;
+	UINT Size;
+	std::vector<FakeShaderVariable> Variables;
+};
+
+struct FakeShaderResource
+{
+	std::string Name;
+	D3D_SHADER_INPUT_TYPE Type;
+	UINT BindPoint;
+};
+
+struct FakeShaderInput
+{
+	std::string SemanticName;
+	UINT SemanticIndex;
+	D3D_REGISTER_COMPONENT_TYPE ComponentType;
+	BYTE Mask;
+};
+
+struct FakeShader
+{
+	std::vector<FakeShaderBuffer> ConstantBuffers;
+	std::vector<FakeShaderResource> Resources;	// Not including the constant buffers
+	std::vector<FakeShaderInput> Inputs;
+};
+
+/// Makes a shader available under a file name, replacing any
+/// shader already registered under it
+void AddFakeShaderFile(const std::wstring & file, const FakeShader & shader);
+void ClearFakeShaderFiles();
+
+/// Number of D3DReflect() and D3DCompileFromFile() calls so far
+int GetFakeReflectCount();
+int GetFakeCompileCount();
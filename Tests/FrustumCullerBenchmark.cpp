@@ -0,0 +1,92 @@
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times FrustumCuller::Cull() against one view and
+// CullViews() against the two Game::PrepareFrame() uses,
+// for growing numbers of boxes.  Reports which SIMD path
+// this build took
+// --------------------------------------------------------
+
+static const size_t BOX_COUNTS[] = { 10000, 100000, 1000000 };
+static const int RUNS = 20;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static void GetPlanes(XMFLOAT3 position, float yaw, XMFLOAT4 * planes)
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0, yaw, 0));
+	XMFLOAT4X4 view = Camera::BuildViewMatrix(position, rotation);
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMMatrixTranspose(XMLoadFloat4x4(&view)) * projection));
+	Camera::ExtractFrustumPlanes(viewProjection, planes);
+}
+
+int main()
+{
+#if defined(__AVX__)
+	printf("FrustumCuller, AVX path (8 boxes at a time)\n");
+#else
+	printf("FrustumCuller, SSE path (4 boxes at a time)\n");
+#endif
+
+	// The camera mid turn, like a tick where it moved
+	XMFLOAT4 current[6];
+	XMFLOAT4 previous[6];
+	GetPlanes(XMFLOAT3(0, 0, 0), 0.0f, current);
+	GetPlanes(XMFLOAT3(0, 0, -0.1f), -0.05f, previous);
+	const XMFLOAT4 * planeSets[2] = { current, previous };
+
+	for (size_t c = 0; c < sizeof(BOX_COUNTS) / sizeof(BOX_COUNTS[0]); c++)
+	{
+		size_t boxCount = BOX_COUNTS[c];
+
+		// Boxes scattered through a 1km cube
+		FrustumCuller culler;
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+		for (size_t i = 0; i < boxCount; i++)
+		{
+			culler.AddBox(
+				XMFLOAT3(coordinate(random), coordinate(random), coordinate(random)),
+				XMFLOAT3(size(random), size(random), size(random)));
+		}
+
+		double bestCull = 1e30;
+		size_t visibleCount = 0;
+		for (int run = 0; run < RUNS; run++)
+		{
+			Clock::time_point start = Clock::now();
+			visibleCount = culler.Cull(current);
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			if (ms < bestCull)
+				bestCull = ms;
+		}
+
+		double bestViews = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			Clock::time_point start = Clock::now();
+			culler.CullViews(planeSets, 2);
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			if (ms < bestViews)
+				bestViews = ms;
+		}
+
+		printf("%7zu boxes, %6zu visible: Cull best %.4f ms (%.2f ns/box), CullViews x2 best %.4f ms (%.2f ns/box)\n",
+			boxCount, visibleCount,
+			bestCull, bestCull * 1e6 / boxCount,
+			bestViews, bestViews * 1e6 / boxCount);
+	}
+	return 0;
+}
@@ -0,0 +1,181 @@
+#include "Test.h"
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Boxes and views with a fixed seed.  Tests here run in the
+// AVX build and in FrustumCullerTestsSSE, built without it,
+// so both SIMD paths are held to the same plain C++ answer
+// --------------------------------------------------------
+struct RandomScene
+{
+	std::vector<XMFLOAT3> centers;
+	std::vector<XMFLOAT3> extents;
+	std::vector<std::vector<XMFLOAT4>> views;
+
+	RandomScene(size_t boxCount, int viewCount, unsigned int seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.05f, 5.0f);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+
+		for (size_t i = 0; i < boxCount; i++)
+		{
+			centers.push_back(XMFLOAT3(coordinate(random), coordinate(random), coordinate(random)));
+			extents.push_back(XMFLOAT3(size(random), size(random), size(random)));
+		}
+
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 100.0f);
+		for (int v = 0; v < viewCount; v++)
+		{
+			XMFLOAT3 position(coordinate(random) * 0.5f, coordinate(random) * 0.5f, coordinate(random) * 0.5f);
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(angle(random) * 0.5f, angle(random), 0));
+			XMFLOAT4X4 view = Camera::BuildViewMatrix(position, rotation);
+
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMMatrixTranspose(XMLoadFloat4x4(&view)) * projection));
+			views.push_back(std::vector<XMFLOAT4>(6));
+			Camera::ExtractFrustumPlanes(viewProjection, &views.back()[0]);
+		}
+	}
+
+	void Fill(FrustumCuller & culler)
+	{
+		culler.Clear();
+		for (size_t i = 0; i < centers.size(); i++)
+			culler.AddBox(centers[i], extents[i]);
+	}
+
+	// The test one box at a time.  Returns how far inside the
+	// frustum the box is, negative when it's outside
+	float Margin(size_t box, int view)
+	{
+		const XMFLOAT4 * planes = &views[view][0];
+		float margin = FLT_MAX;
+		for (int p = 0; p < 6; p++)
+		{
+			float distance = planes[p].x * centers[box].x + planes[p].y * centers[box].y + planes[p].z * centers[box].z + planes[p].w;
+			float radius = fabsf(planes[p].x) * extents[box].x + fabsf(planes[p].y) * extents[box].y + fabsf(planes[p].z) * extents[box].z;
+			if (distance + radius < margin)
+				margin = distance + radius;
+		}
+		return margin;
+	}
+
+	// Boxes within rounding of a plane can go either way
+	bool Ambiguous(float margin) { return fabsf(margin) < 1.0e-3f; }
+};
+
+TEST(CullMatchesScalarReference)
+{
+	// Not a multiple of eight, so the last group is padding
+	RandomScene scene(10007, 6, 31);
+	FrustumCuller culler;
+	scene.Fill(culler);
+
+	for (int v = 0; v < (int)scene.views.size(); v++)
+	{
+		size_t visibleCount = culler.Cull(&scene.views[v][0]);
+		CHECK(culler.GetCount() == scene.centers.size());
+
+		size_t flagged = 0;
+		int wrong = 0;
+		for (size_t i = 0; i < scene.centers.size(); i++)
+		{
+			float margin = scene.Margin(i, v);
+			flagged += culler.IsVisible(i) ? 1 : 0;
+			if (!scene.Ambiguous(margin) && culler.IsVisible(i) != (margin >= 0.0f))
+				wrong++;
+		}
+		CHECK(wrong == 0);
+		CHECK(visibleCount == flagged);
+		CHECK(visibleCount > 0 && visibleCount < scene.centers.size());
+	}
+}
+
+TEST(CullViewsMatchesScalarReference)
+{
+	RandomScene scene(5001, 32, 36);
+	FrustumCuller culler;
+	scene.Fill(culler);
+
+	int viewCounts[] = { 1, 2, 9, 32 };
+	for (int c = 0; c < 4; c++)
+	{
+		std::vector<const XMFLOAT4 *> planeSets;
+		for (int v = 0; v < viewCounts[c]; v++)
+			planeSets.push_back(&scene.views[v][0]);
+		culler.CullViews(&planeSets[0], viewCounts[c]);
+
+		int wrong = 0;
+		for (size_t i = 0; i < scene.centers.size(); i++)
+		{
+			uint32_t mask = culler.GetViewMask(i);
+			if (viewCounts[c] < 32 && (mask >> viewCounts[c]) != 0)
+				wrong++;
+
+			for (int v = 0; v < viewCounts[c]; v++)
+			{
+				float margin = scene.Margin(i, v);
+				bool seen = ((mask >> v) & 1) != 0;
+				if (!scene.Ambiguous(margin) && seen != (margin >= 0.0f))
+					wrong++;
+			}
+		}
+		CHECK(wrong == 0);
+	}
+
+	// Each view's bit agrees with culling that view on its own
+	std::vector<const XMFLOAT4 *> planeSets;
+	for (int v = 0; v < 9; v++)
+		planeSets.push_back(&scene.views[v][0]);
+	culler.CullViews(&planeSets[0], 9);
+	std::vector<uint32_t> masks(scene.centers.size());
+	for (size_t i = 0; i < masks.size(); i++)
+		masks[i] = culler.GetViewMask(i);
+
+	int different = 0;
+	for (int v = 0; v < 9; v++)
+	{
+		culler.Cull(planeSets[v]);
+		for (size_t i = 0; i < masks.size(); i++)
+		{
+			if (culler.IsVisible(i) != (((masks[i] >> v) & 1) != 0))
+				different++;
+		}
+	}
+	CHECK(different == 0);
+}
+
+TEST(AddingAfterCullingKeepsEveryBox)
+{
+	RandomScene scene(13, 1, 7);
+	FrustumCuller culler;
+
+	// Cull with a partly filled group, then keep adding - the
+	// padding must not end up between the old and new boxes
+	for (size_t i = 0; i < 5; i++)
+		culler.AddBox(scene.centers[i], scene.extents[i]);
+	culler.Cull(&scene.views[0][0]);
+	for (size_t i = 5; i < scene.centers.size(); i++)
+		culler.AddBox(scene.centers[i], scene.extents[i]);
+	culler.Cull(&scene.views[0][0]);
+
+	FrustumCuller fresh;
+	scene.Fill(fresh);
+	fresh.Cull(&scene.views[0][0]);
+
+	CHECK(culler.GetCount() == 13);
+	int different = 0;
+	for (size_t i = 0; i < 13; i++)
+		different += culler.IsVisible(i) != fresh.IsVisible(i) ? 1 : 0;
+	CHECK(different == 0);
+}
@@ -0,0 +1,483 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host stand-in for DirectXMath, implementing the functions
+// the engine uses with the same conventions (row vectors,
+// left-handed, XMVECTOR in an SSE register) so the engine's
+// math gives the same answers in tests as in the game.
+// --------------------------------------------------------
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cmath>
+#include <cstdint>
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+	const float XM_PIDIV4 = 0.785398163f;
+
+	typedef __m128 XMVECTOR;
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMVECTOR GXMVECTOR;
+	typedef const XMVECTOR HXMVECTOR;
+	typedef const XMVECTOR & CXMVECTOR;
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+
+		XMMATRIX() = default;
+		XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, CXMVECTOR r3) { r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3; }
+		XMMATRIX operator*(const XMMATRIX & m) const;
+	};
+	typedef const XMMATRIX FXMMATRIX;
+	typedef const XMMATRIX & CXMMATRIX;
+
+	struct XMFLOAT2
+	{
+		float x, y;
+		XMFLOAT2() = default;
+		XMFLOAT2(float _x, float _y) : x(_x), y(_y) { }
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+		XMFLOAT3() = default;
+		XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) { }
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) { }
+	};
+
+	struct alignas(16) XMFLOAT4A : public XMFLOAT4
+	{
+		XMFLOAT4A() = default;
+		XMFLOAT4A(float _x, float _y, float _z, float _w) : XMFLOAT4(_x, _y, _z, _w) { }
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		XMFLOAT4X4() = default;
+		XMFLOAT4X4(float m00, float m01, float m02, float m03,
+			float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23,
+			float m30, float m31, float m32, float m33)
+			: _11(m00), _12(m01), _13(m02), _14(m03),
+			_21(m10), _22(m11), _23(m12), _24(m13),
+			_31(m20), _32(m21), _33(m22), _34(m23),
+			_41(m30), _42(m31), _43(m32), _44(m33) { }
+	};
+
+	// --------------------------------------------------------
+	// Component access (helpers first, as everything uses them)
+	// --------------------------------------------------------
+	namespace Internal
+	{
+		union Floats { XMVECTOR v; float f[4]; uint32_t u[4]; };
+
+		inline Floats Unpack(FXMVECTOR v) { Floats f; f.v = v; return f; }
+	}
+
+	inline float XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+	inline float XMVectorGetY(FXMVECTOR v) { return Internal::Unpack(v).f[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return Internal::Unpack(v).f[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return Internal::Unpack(v).f[3]; }
+
+	// --------------------------------------------------------
+	// Construction
+	// --------------------------------------------------------
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+	inline XMVECTOR XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+	inline XMVECTOR XMVectorZero() { return _mm_setzero_ps(); }
+	inline XMVECTOR XMVectorSplatOne() { return _mm_set1_ps(1.0f); }
+	inline XMVECTOR XMVectorTrueInt() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+	inline XMVECTOR XMVectorFalseInt() { return _mm_setzero_ps(); }
+	inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+	inline XMVECTOR XMVectorSplatY(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+	inline XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+	inline XMVECTOR XMVectorSplatW(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+	inline XMVECTOR XMVectorMergeXY(FXMVECTOR a, FXMVECTOR b) { return _mm_unpacklo_ps(a, b); }
+	inline XMVECTOR XMVectorMergeZW(FXMVECTOR a, FXMVECTOR b) { return _mm_unpackhi_ps(a, b); }
+
+	template<uint32_t PermuteX, uint32_t PermuteY, uint32_t PermuteZ, uint32_t PermuteW>
+	inline XMVECTOR XMVectorPermute(FXMVECTOR a, FXMVECTOR b)
+	{
+		static_assert(PermuteX <= 7 && PermuteY <= 7 && PermuteZ <= 7 && PermuteW <= 7, "Permute index out of range");
+		Internal::Floats fa = Internal::Unpack(a);
+		Internal::Floats fb = Internal::Unpack(b);
+		const float * source[8] = { &fa.f[0], &fa.f[1], &fa.f[2], &fa.f[3], &fb.f[0], &fb.f[1], &fb.f[2], &fb.f[3] };
+		return _mm_set_ps(*source[PermuteW], *source[PermuteZ], *source[PermuteY], *source[PermuteX]);
+	}
+
+	// --------------------------------------------------------
+	// Arithmetic and comparison
+	// --------------------------------------------------------
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return _mm_add_ps(a, b); }
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return _mm_sub_ps(a, b); }
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+	inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return _mm_div_ps(a, b); }
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return _mm_mul_ps(v, _mm_set1_ps(scale)); }
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+	inline XMVECTOR XMVectorAbs(FXMVECTOR v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return _mm_min_ps(a, b); }
+	inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return _mm_max_ps(a, b); }
+	inline XMVECTOR XMVectorSqrt(FXMVECTOR v) { return _mm_sqrt_ps(v); }
+	inline XMVECTOR XMVectorReciprocalSqrtEst(FXMVECTOR v) { return _mm_rsqrt_ps(v); }
+	inline XMVECTOR XMVectorLerp(FXMVECTOR a, FXMVECTOR b, float t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t))); }
+
+	inline XMVECTOR XMVectorEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpeq_ps(a, b); }
+	inline XMVECTOR XMVectorLess(FXMVECTOR a, FXMVECTOR b) { return _mm_cmplt_ps(a, b); }
+	inline XMVECTOR XMVectorGreater(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpgt_ps(a, b); }
+	inline XMVECTOR XMVectorGreaterOrEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpge_ps(a, b); }
+	inline XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b) { return _mm_and_ps(a, b); }
+	inline XMVECTOR XMVectorOrInt(FXMVECTOR a, FXMVECTOR b) { return _mm_or_ps(a, b); }
+	inline XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control) { return _mm_or_ps(_mm_andnot_ps(control, a), _mm_and_ps(control, b)); }
+
+	// --------------------------------------------------------
+	// Loads and stores
+	// --------------------------------------------------------
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3 * source) { return _mm_set_ps(0.0f, source->z, source->y, source->x); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4 * source) { return _mm_loadu_ps(&source->x); }
+	inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A * source) { return _mm_load_ps(&source->x); }
+	inline void XMStoreFloat3(XMFLOAT3 * dest, FXMVECTOR v)
+	{
+		Internal::Floats f = Internal::Unpack(v);
+		dest->x = f.f[0];
+		dest->y = f.f[1];
+		dest->z = f.f[2];
+	}
+	inline void XMStoreFloat4(XMFLOAT4 * dest, FXMVECTOR v) { _mm_storeu_ps(&dest->x, v); }
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4 * source)
+	{
+		return XMMATRIX(_mm_loadu_ps(source->m[0]), _mm_loadu_ps(source->m[1]), _mm_loadu_ps(source->m[2]), _mm_loadu_ps(source->m[3]));
+	}
+	inline void XMStoreFloat4x4(XMFLOAT4X4 * dest, CXMMATRIX m)
+	{
+		for (int i = 0; i < 4; i++)
+			_mm_storeu_ps(dest->m[i], m.r[i]);
+	}
+
+	// --------------------------------------------------------
+	// 3D vectors and planes
+	// --------------------------------------------------------
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		Internal::Floats fa = Internal::Unpack(a), fb = Internal::Unpack(b);
+		return _mm_set1_ps(fa.f[0] * fb.f[0] + fa.f[1] * fb.f[1] + fa.f[2] * fb.f[2]);
+	}
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector3Dot(v, v)); }
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		return length > 0.0f ? _mm_div_ps(v, _mm_set1_ps(length)) : _mm_setzero_ps();
+	}
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		Internal::Floats fa = Internal::Unpack(a), fb = Internal::Unpack(b);
+		return XMVectorSet(
+			fa.f[1] * fb.f[2] - fa.f[2] * fb.f[1],
+			fa.f[2] * fb.f[0] - fa.f[0] * fb.f[2],
+			fa.f[0] * fb.f[1] - fa.f[1] * fb.f[0],
+			0.0f);
+	}
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, CXMMATRIX m)
+	{
+		XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+		return _mm_add_ps(result, m.r[3]);
+	}
+	inline XMVECTOR XMPlaneNormalize(FXMVECTOR plane)
+	{
+		float length = XMVectorGetX(XMVector3Length(plane));
+		return length > 0.0f ? _mm_div_ps(plane, _mm_set1_ps(length)) : _mm_setzero_ps();
+	}
+
+	// --------------------------------------------------------
+	// Quaternions (x, y, z, w)
+	// --------------------------------------------------------
+	inline XMVECTOR XMQuaternionIdentity()
+	{
+		return _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q)
+	{
+		Internal::Floats f = Internal::Unpack(q);
+		float length = sqrtf(f.f[0] * f.f[0] + f.f[1] * f.f[1] + f.f[2] * f.f[2] + f.f[3] * f.f[3]);
+		return length > 0.0f ? _mm_div_ps(q, _mm_set1_ps(length)) : _mm_setzero_ps();
+	}
+
+	// Roll about Z, then pitch about X, then yaw about Y
+	inline XMVECTOR XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		float sp = sinf(pitch * 0.5f), cp = cosf(pitch * 0.5f);
+		float sy = sinf(yaw * 0.5f), cy = cosf(yaw * 0.5f);
+		float sr = sinf(roll * 0.5f), cr = cosf(roll * 0.5f);
+		return XMVectorSet(
+			sp * cy * cr + cp * sy * sr,
+			cp * sy * cr - sp * cy * sr,
+			cp * cy * sr - sp * sy * cr,
+			cp * cy * cr + sp * sy * sr);
+	}
+
+	inline XMVECTOR XMQuaternionSlerp(FXMVECTOR q0, FXMVECTOR q1, float t)
+	{
+		Internal::Floats a = Internal::Unpack(q0), b = Internal::Unpack(q1);
+		float cosOmega = a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2] + a.f[3] * b.f[3];
+		float sign = 1.0f;
+		if (cosOmega < 0.0f)
+		{
+			cosOmega = -cosOmega;
+			sign = -1.0f;
+		}
+
+		float s0, s1;
+		if (1.0f - cosOmega > 0.00001f)
+		{
+			float omega = acosf(cosOmega);
+			float invSinOmega = 1.0f / sinf(omega);
+			s0 = sinf((1.0f - t) * omega) * invSinOmega;
+			s1 = sinf(t * omega) * invSinOmega;
+		}
+		else
+		{
+			s0 = 1.0f - t;
+			s1 = t;
+		}
+		s1 *= sign;
+		return _mm_add_ps(_mm_mul_ps(q0, _mm_set1_ps(s0)), _mm_mul_ps(q1, _mm_set1_ps(s1)));
+	}
+
+	inline XMVECTOR XMVector3Rotate(FXMVECTOR v, FXMVECTOR q)
+	{
+		// v + 2w(u x v) + 2u x (u x v), with u the vector part of q
+		XMVECTOR u = _mm_and_ps(q, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		XMVECTOR uv = XMVector3Cross(u, v);
+		XMVECTOR uuv = XMVector3Cross(u, uv);
+		XMVECTOR result = _mm_add_ps(v, _mm_mul_ps(uv, _mm_set1_ps(2.0f * XMVectorGetW(q))));
+		return _mm_add_ps(result, _mm_mul_ps(uuv, _mm_set1_ps(2.0f)));
+	}
+
+	// --------------------------------------------------------
+	// Matrices
+	// --------------------------------------------------------
+	inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+	{
+		return XMMATRIX(
+			XMVectorSet(m00, m01, m02, m03),
+			XMVectorSet(m10, m11, m12, m13),
+			XMVectorSet(m20, m21, m22, m23),
+			XMVectorSet(m30, m31, m32, m33));
+	}
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(CXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX result;
+		for (int i = 0; i < 4; i++)
+		{
+			XMVECTOR row = _mm_mul_ps(XMVectorSplatX(a.r[i]), b.r[0]);
+			row = _mm_add_ps(row, _mm_mul_ps(XMVectorSplatY(a.r[i]), b.r[1]));
+			row = _mm_add_ps(row, _mm_mul_ps(XMVectorSplatZ(a.r[i]), b.r[2]));
+			result.r[i] = _mm_add_ps(row, _mm_mul_ps(XMVectorSplatW(a.r[i]), b.r[3]));
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMATRIX::operator*(const XMMATRIX & m) const { return XMMatrixMultiply(*this, m); }
+
+	inline XMMATRIX XMMatrixTranspose(CXMMATRIX m)
+	{
+		XMMATRIX t = m;
+		_MM_TRANSPOSE4_PS(t.r[0], t.r[1], t.r[2], t.r[3]);
+		return t;
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1);
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		return XMMatrixSet(x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationX(float angle)
+	{
+		float s = sinf(angle), c = cosf(angle);
+		return XMMatrixSet(1, 0, 0, 0, 0, c, s, 0, 0, -s, c, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle)
+	{
+		float s = sinf(angle), c = cosf(angle);
+		return XMMatrixSet(c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationZ(float angle)
+	{
+		float s = sinf(angle), c = cosf(angle);
+		return XMMatrixSet(c, s, 0, 0, -s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q)
+	{
+		Internal::Floats f = Internal::Unpack(q);
+		float x = f.f[0], y = f.f[1], z = f.f[2], w = f.f[3];
+		return XMMatrixSet(
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+			0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		return XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+	}
+
+	// Scale, then rotate about an origin, then translate
+	inline XMMATRIX XMMatrixAffineTransformation(FXMVECTOR scaling, FXMVECTOR rotationOrigin, FXMVECTOR rotationQuaternion, GXMVECTOR translation)
+	{
+		Internal::Floats s = Internal::Unpack(scaling);
+		XMVECTOR xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		XMVECTOR origin = _mm_and_ps(rotationOrigin, xyz);
+
+		XMMATRIX m = XMMatrixScaling(s.f[0], s.f[1], s.f[2]);
+		m.r[3] = _mm_sub_ps(m.r[3], origin);
+		m = XMMatrixMultiply(m, XMMatrixRotationQuaternion(rotationQuaternion));
+		m.r[3] = _mm_add_ps(m.r[3], origin);
+		m.r[3] = _mm_add_ps(m.r[3], _mm_and_ps(translation, xyz));
+		return m;
+	}
+
+	inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eyePosition, FXMVECTOR eyeDirection, FXMVECTOR upDirection)
+	{
+		XMVECTOR r2 = XMVector3Normalize(eyeDirection);
+		XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(upDirection, r2));
+		XMVECTOR r1 = XMVector3Cross(r2, r0);
+		XMVECTOR negEye = XMVectorNegate(eyePosition);
+
+		XMMATRIX m(
+			XMVectorSet(XMVectorGetX(r0), XMVectorGetY(r0), XMVectorGetZ(r0), XMVectorGetX(XMVector3Dot(r0, negEye))),
+			XMVectorSet(XMVectorGetX(r1), XMVectorGetY(r1), XMVectorGetZ(r1), XMVectorGetX(XMVector3Dot(r1, negEye))),
+			XMVectorSet(XMVectorGetX(r2), XMVectorGetY(r2), XMVectorGetZ(r2), XMVectorGetX(XMVector3Dot(r2, negEye))),
+			XMVectorSet(0, 0, 0, 1));
+		return XMMatrixTranspose(m);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = 1.0f / tanf(fovAngleY * 0.5f);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+		return XMMatrixSet(
+			width, 0, 0, 0,
+			0, height, 0, 0,
+			0, 0, range, 1,
+			0, 0, -range * nearZ, 0);
+	}
+
+	// Splits an affine matrix into scale, rotation quaternion and
+	// translation.  Fails on a (near) zero scale.
+	inline bool XMMatrixDecompose(XMVECTOR * outScale, XMVECTOR * outRotQuat, XMVECTOR * outTrans, CXMMATRIX m)
+	{
+		Internal::Floats rows[3] = { Internal::Unpack(m.r[0]), Internal::Unpack(m.r[1]), Internal::Unpack(m.r[2]) };
+		float scale[3];
+		for (int i = 0; i < 3; i++)
+		{
+			scale[i] = sqrtf(rows[i].f[0] * rows[i].f[0] + rows[i].f[1] * rows[i].f[1] + rows[i].f[2] * rows[i].f[2]);
+			if (scale[i] < 1e-6f)
+				return false;
+		}
+
+		float r[3][3];
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				r[i][j] = rows[i].f[j] / scale[i];
+
+		// A reflection shows up as a negative X scale
+		float det =
+			r[0][0] * (r[1][1] * r[2][2] - r[1][2] * r[2][1]) -
+			r[0][1] * (r[1][0] * r[2][2] - r[1][2] * r[2][0]) +
+			r[0][2] * (r[1][0] * r[2][1] - r[1][1] * r[2][0]);
+		if (det < 0.0f)
+		{
+			scale[0] = -scale[0];
+			for (int j = 0; j < 3; j++)
+				r[0][j] = -r[0][j];
+		}
+
+		// Quaternion from the (row vector) rotation matrix
+		float x, y, z, w;
+		float trace = r[0][0] + r[1][1] + r[2][2];
+		if (trace > 0.0f)
+		{
+			float s = sqrtf(trace + 1.0f) * 2.0f;
+			w = 0.25f * s;
+			x = (r[1][2] - r[2][1]) / s;
+			y = (r[2][0] - r[0][2]) / s;
+			z = (r[0][1] - r[1][0]) / s;
+		}
+		else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+		{
+			float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+			w = (r[1][2] - r[2][1]) / s;
+			x = 0.25f * s;
+			y = (r[0][1] + r[1][0]) / s;
+			z = (r[2][0] + r[0][2]) / s;
+		}
+		else if (r[1][1] > r[2][2])
+		{
+			float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+			w = (r[2][0] - r[0][2]) / s;
+			x = (r[0][1] + r[1][0]) / s;
+			y = 0.25f * s;
+			z = (r[1][2] + r[2][1]) / s;
+		}
+		else
+		{
+			float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+			w = (r[0][1] - r[1][0]) / s;
+			x = (r[2][0] + r[0][2]) / s;
+			y = (r[1][2] + r[2][1]) / s;
+			z = 0.25f * s;
+		}
+
+		*outScale = XMVectorSet(scale[0], scale[1], scale[2], 0.0f);
+		*outRotQuat = XMQuaternionNormalize(XMVectorSet(x, y, z, w));
+		*outTrans = m.r[3];
+		return true;
+	}
+}
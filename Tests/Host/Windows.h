@@ -0,0 +1,71 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host stand-in for the parts of the Windows headers the
+// engine's platform-independent code uses, so it can be
+// built and tested without the Windows SDK.  Only for the
+// tests - the game itself builds against the real thing.
+// --------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#define WINAPI
+#define CALLBACK
+#define TRUE 1
+#define FALSE 0
+#define __int64 long long
+
+typedef void * HINSTANCE;
+typedef void * HWND;
+typedef void * HANDLE;
+typedef unsigned char BYTE;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t DWORD;
+typedef int32_t HRESULT;
+typedef float FLOAT;
+typedef size_t SIZE_T;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef const char * LPCSTR;
+typedef const wchar_t * LPCWSTR;
+
+struct GUID { uint32_t Data1; uint16_t Data2; uint16_t Data3; uint8_t Data4[8]; };
+typedef GUID IID;
+#define REFIID const IID &
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define sscanf_s sscanf
+
+#define VK_SPACE 0x20
+
+struct IUnknown
+{
+	virtual HRESULT QueryInterface(REFIID riid, void ** object) = 0;
+	virtual unsigned long AddRef() = 0;
+	virtual unsigned long Release() = 0;
+	virtual ~IUnknown() { }
+};
+
+// Windows.h has min and max macros.  Functions do the same job
+// here without breaking the standard library headers.
+template <class A, class B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+template <class A, class B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+
+// No keyboard on the host - every key is up
+inline short GetAsyncKeyState(int) { return 0; }
@@ -0,0 +1,380 @@
+#pragma once
+#include "Windows.h"
+
+// --------------------------------------------------------
+// Host stand-in for d3d11.h.  Declares the Direct3D 11 types
+// and the interface methods the engine calls, nothing more,
+// so tests can implement them with fakes (see FakeD3D.h).
+// The interfaces are not binary compatible with real D3D.
+// --------------------------------------------------------
+
+#define D3D11_APPEND_ALIGNED_ELEMENT 0xffffffff
+#define D3D11_SO_NO_RASTERIZED_STREAM 0xffffffff
+#define D3D11_ASYNC_GETDATA_DONOTFLUSH 0x1
+#define D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT 14
+#define D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT 128
+#define D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT 16
+#define D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT 32
+#define D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT 4096
+
+enum D3D_FEATURE_LEVEL
+{
+	D3D_FEATURE_LEVEL_10_0 = 0xa000,
+	D3D_FEATURE_LEVEL_10_1 = 0xa100,
+	D3D_FEATURE_LEVEL_11_0 = 0xb000,
+	D3D_FEATURE_LEVEL_11_1 = 0xb100
+};
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32A32_UINT = 3,
+	DXGI_FORMAT_R32G32B32A32_SINT = 4,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32B32_UINT = 7,
+	DXGI_FORMAT_R32G32B32_SINT = 8,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R32G32_UINT = 17,
+	DXGI_FORMAT_R32G32_SINT = 18,
+	DXGI_FORMAT_R32_FLOAT = 41,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R32_SINT = 43
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+	D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D11_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D11_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT = 0,
+	D3D11_USAGE_IMMUTABLE = 1,
+	D3D11_USAGE_DYNAMIC = 2,
+	D3D11_USAGE_STAGING = 3
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_STREAM_OUTPUT = 0x10
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ = 0x20000
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+	D3D11_MAP_WRITE_NO_OVERWRITE = 5
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1
+};
+
+enum D3D11_FEATURE
+{
+	D3D11_FEATURE_D3D11_OPTIONS = 7
+};
+
+enum D3D11_QUERY
+{
+	D3D11_QUERY_EVENT = 0
+};
+
+enum D3D_SHADER_INPUT_TYPE
+{
+	D3D_SIT_CBUFFER = 0,
+	D3D_SIT_TBUFFER,
+	D3D_SIT_TEXTURE,
+	D3D_SIT_SAMPLER,
+	D3D_SIT_UAV_RWTYPED,
+	D3D_SIT_STRUCTURED,
+	D3D_SIT_UAV_RWSTRUCTURED,
+	D3D_SIT_BYTEADDRESS,
+	D3D_SIT_UAV_RWBYTEADDRESS,
+	D3D_SIT_UAV_APPEND_STRUCTURED,
+	D3D_SIT_UAV_CONSUME_STRUCTURED,
+	D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER
+};
+
+enum D3D_REGISTER_COMPONENT_TYPE
+{
+	D3D_REGISTER_COMPONENT_UNKNOWN = 0,
+	D3D_REGISTER_COMPONENT_UINT32 = 1,
+	D3D_REGISTER_COMPONENT_SINT32 = 2,
+	D3D_REGISTER_COMPONENT_FLOAT32 = 3
+};
+
+enum D3D_CBUFFER_TYPE
+{
+	D3D_CT_CBUFFER = 0,
+	D3D_CT_TBUFFER
+};
+
+struct D3D11_BUFFER_DESC
+{
+	UINT ByteWidth;
+	D3D11_USAGE Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+	UINT StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void * pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void * pData;
+	UINT RowPitch;
+	UINT DepthPitch;
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+};
+
+struct D3D11_SO_DECLARATION_ENTRY
+{
+	UINT Stream;
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	BYTE StartComponent;
+	BYTE ComponentCount;
+	BYTE OutputSlot;
+};
+
+struct D3D11_QUERY_DESC
+{
+	D3D11_QUERY Query;
+	UINT MiscFlags;
+};
+
+struct D3D11_FEATURE_DATA_D3D11_OPTIONS
+{
+	BOOL OutputMergerLogicOp;
+	BOOL UAVOnlyRenderingForcedSampleCount;
+	BOOL DiscardAPIsSeenByDriver;
+	BOOL FlagsForUpdateAndCopySeenByDriver;
+	BOOL ClearView;
+	BOOL CopyWithOverlap;
+	BOOL ConstantBufferPartialUpdate;
+	BOOL ConstantBufferOffsetting;
+	BOOL MapNoOverwriteOnDynamicConstantBuffer;
+	BOOL MapNoOverwriteOnDynamicBufferSRV;
+	BOOL MultisampleRTVWithForcedSampleCountOne;
+	BOOL SAD4ShaderInstructions;
+	BOOL ExtendedDoublesShaderInstructions;
+	BOOL ExtendedResourceSharing;
+};
+
+// --------------------------------------------------------
+// Resources and views
+// --------------------------------------------------------
+struct ID3D11DeviceChild : IUnknown { };
+struct ID3D11Resource : ID3D11DeviceChild { };
+struct ID3D11Buffer : ID3D11Resource
+{
+	virtual void GetDesc(D3D11_BUFFER_DESC * desc) = 0;
+};
+struct ID3D11Texture2D : ID3D11Resource { };
+struct ID3D11ShaderResourceView : ID3D11DeviceChild { };
+struct ID3D11UnorderedAccessView : ID3D11DeviceChild { };
+struct ID3D11RenderTargetView : ID3D11DeviceChild { };
+struct ID3D11DepthStencilView : ID3D11DeviceChild { };
+struct IDXGISwapChain : IUnknown { };
+struct ID3D11SamplerState : ID3D11DeviceChild { };
+struct ID3D11InputLayout : ID3D11DeviceChild { };
+struct ID3D11Asynchronous : ID3D11DeviceChild { };
+struct ID3D11Query : ID3D11Asynchronous { };
+
+struct ID3D11VertexShader : ID3D11DeviceChild { };
+struct ID3D11PixelShader : ID3D11DeviceChild { };
+struct ID3D11DomainShader : ID3D11DeviceChild { };
+struct ID3D11HullShader : ID3D11DeviceChild { };
+struct ID3D11GeometryShader : ID3D11DeviceChild { };
+struct ID3D11ComputeShader : ID3D11DeviceChild { };
+struct ID3D11ClassLinkage;
+struct ID3D11ClassInstance;
+
+struct ID3D10Blob : IUnknown
+{
+	virtual void * GetBufferPointer() = 0;
+	virtual SIZE_T GetBufferSize() = 0;
+};
+typedef ID3D10Blob ID3DBlob;
+
+// --------------------------------------------------------
+// Device and context
+// --------------------------------------------------------
+struct ID3D11Device : IUnknown
+{
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC * desc, const D3D11_SUBRESOURCE_DATA * initialData, ID3D11Buffer ** buffer) = 0;
+	virtual HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC * elements, UINT elementCount, const void * bytecode, SIZE_T bytecodeLength, ID3D11InputLayout ** layout) = 0;
+	virtual HRESULT CreateVertexShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11VertexShader ** shader) = 0;
+	virtual HRESULT CreatePixelShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11PixelShader ** shader) = 0;
+	virtual HRESULT CreateDomainShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11DomainShader ** shader) = 0;
+	virtual HRESULT CreateHullShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11HullShader ** shader) = 0;
+	virtual HRESULT CreateGeometryShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11GeometryShader ** shader) = 0;
+	virtual HRESULT CreateGeometryShaderWithStreamOutput(const void * bytecode, SIZE_T bytecodeLength,
+		const D3D11_SO_DECLARATION_ENTRY * entries, UINT entryCount, const UINT * strides, UINT stridesCount,
+		UINT rasterizedStream, ID3D11ClassLinkage * linkage, ID3D11GeometryShader ** shader) = 0;
+	virtual HRESULT CreateComputeShader(const void * bytecode, SIZE_T bytecodeLength, ID3D11ClassLinkage * linkage, ID3D11ComputeShader ** shader) = 0;
+	virtual HRESULT CreateQuery(const D3D11_QUERY_DESC * desc, ID3D11Query ** query) = 0;
+	virtual HRESULT CheckFeatureSupport(D3D11_FEATURE feature, void * data, UINT dataSize) = 0;
+};
+
+struct ID3D11DeviceContext : ID3D11DeviceChild
+{
+	virtual HRESULT Map(ID3D11Resource * resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE * mapped) = 0;
+	virtual void Unmap(ID3D11Resource * resource, UINT subresource) = 0;
+	virtual void End(ID3D11Asynchronous * async) = 0;
+	virtual HRESULT GetData(ID3D11Asynchronous * async, void * data, UINT dataSize, UINT flags) = 0;
+
+	virtual void IASetInputLayout(ID3D11InputLayout * layout) = 0;
+	virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * strides, const UINT * offsets) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer * buffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+
+	virtual void VSSetShader(ID3D11VertexShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+	virtual void PSSetShader(ID3D11PixelShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+	virtual void DSSetShader(ID3D11DomainShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+	virtual void HSSetShader(ID3D11HullShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+	virtual void GSSetShader(ID3D11GeometryShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+	virtual void CSSetShader(ID3D11ComputeShader * shader, ID3D11ClassInstance * const * instances, UINT instanceCount) = 0;
+
+	virtual void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+	virtual void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+	virtual void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+	virtual void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+	virtual void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+	virtual void CSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer * const * buffers) = 0;
+
+	virtual void VSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+	virtual void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+	virtual void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+	virtual void HSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+	virtual void GSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+	virtual void CSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView * const * views) = 0;
+
+	virtual void VSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+	virtual void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+	virtual void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+	virtual void HSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+	virtual void GSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+	virtual void CSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState * const * samplers) = 0;
+
+	virtual void CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView * const * views, const UINT * initialCounts) = 0;
+	virtual void SOSetTargets(UINT count, ID3D11Buffer * const * targets, const UINT * offsets) = 0;
+
+	virtual void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance) = 0;
+	virtual void Dispatch(UINT x, UINT y, UINT z) = 0;
+};
+
+// --------------------------------------------------------
+// Shader reflection (d3d11shader.h)
+// --------------------------------------------------------
+struct D3D11_SHADER_DESC
+{
+	UINT Version;
+	LPCSTR Creator;
+	UINT Flags;
+	UINT ConstantBuffers;
+	UINT BoundResources;
+	UINT InputParameters;
+	UINT OutputParameters;
+};
+
+struct D3D11_SHADER_BUFFER_DESC
+{
+	LPCSTR Name;
+	D3D_CBUFFER_TYPE Type;
+	UINT Variables;
+	UINT Size;
+	UINT uFlags;
+};
+
+struct D3D11_SHADER_VARIABLE_DESC
+{
+	LPCSTR Name;
+	UINT StartOffset;
+	UINT Size;
+	UINT uFlags;
+	void * DefaultValue;
+};
+
+struct D3D11_SHADER_INPUT_BIND_DESC
+{
+	LPCSTR Name;
+	D3D_SHADER_INPUT_TYPE Type;
+	UINT BindPoint;
+	UINT BindCount;
+	UINT uFlags;
+};
+
+struct D3D11_SIGNATURE_PARAMETER_DESC
+{
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	UINT Register;
+	UINT SystemValueType;
+	D3D_REGISTER_COMPONENT_TYPE ComponentType;
+	BYTE Mask;
+	BYTE ReadWriteMask;
+	UINT Stream;
+};
+
+struct ID3D11ShaderReflectionVariable
+{
+	virtual HRESULT GetDesc(D3D11_SHADER_VARIABLE_DESC * desc) = 0;
+};
+
+struct ID3D11ShaderReflectionConstantBuffer
+{
+	virtual HRESULT GetDesc(D3D11_SHADER_BUFFER_DESC * desc) = 0;
+	virtual ID3D11ShaderReflectionVariable * GetVariableByIndex(UINT index) = 0;
+};
+
+struct ID3D11ShaderReflection : IUnknown
+{
+	virtual HRESULT GetDesc(D3D11_SHADER_DESC * desc) = 0;
+	virtual ID3D11ShaderReflectionConstantBuffer * GetConstantBufferByIndex(UINT index) = 0;
+	virtual HRESULT GetResourceBindingDesc(UINT index, D3D11_SHADER_INPUT_BIND_DESC * desc) = 0;
+	virtual HRESULT GetResourceBindingDescByName(LPCSTR name, D3D11_SHADER_INPUT_BIND_DESC * desc) = 0;
+	virtual HRESULT GetInputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC * desc) = 0;
+	virtual HRESULT GetOutputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC * desc) = 0;
+	virtual UINT GetThreadGroupSize(UINT * x, UINT * y, UINT * z) = 0;
+};
+
+extern const IID IID_ID3D11ShaderReflection;
+#define __uuidof(type) IID_##type
@@ -0,0 +1,14 @@
+#pragma once
+#include "d3d11.h"
+
+// --------------------------------------------------------
+// Host stand-in for d3d11_1.h - the 11.1 context methods
+// the engine uses for constant buffer ranges
+// --------------------------------------------------------
+struct ID3D11DeviceContext1 : ID3D11DeviceContext
+{
+	virtual void VSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants) = 0;
+	virtual void PSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer * const * buffers, const UINT * firstConstant, const UINT * numConstants) = 0;
+};
+
+extern const IID IID_ID3D11DeviceContext1;
@@ -0,0 +1,25 @@
+#pragma once
+#include "d3d11.h"
+
+// --------------------------------------------------------
+// Host stand-in for d3dcompiler.h.  The functions are
+// implemented by the tests' fakes (FakeD3D.cpp), which serve
+// registered fake shaders instead of real bytecode.
+// --------------------------------------------------------
+
+#define D3DCOMPILE_DEBUG (1 << 0)
+#define D3DCOMPILE_OPTIMIZATION_LEVEL3 (1 << 15)
+
+struct D3D_SHADER_MACRO
+{
+	LPCSTR Name;
+	LPCSTR Definition;
+};
+
+struct ID3DInclude;
+#define D3D_COMPILE_STANDARD_FILE_INCLUDE ((ID3DInclude *)(size_t)1)
+
+HRESULT D3DReadFileToBlob(LPCWSTR fileName, ID3DBlob ** contents);
+HRESULT D3DReflect(const void * srcData, SIZE_T srcDataSize, REFIID iface, void ** reflector);
+HRESULT D3DCompileFromFile(LPCWSTR fileName, const D3D_SHADER_MACRO * defines, ID3DInclude * include,
+	LPCSTR entryPoint, LPCSTR target, UINT flags1, UINT flags2, ID3DBlob ** code, ID3DBlob ** errorMessages);
@@ -0,0 +1,96 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "InputLayoutCache.h"
+#include "SimpleShader.h"
+#include "StateCache.h"
+#include <string>
+
+static FakeShaderInput Input(const char * semanticName, UINT semanticIndex, BYTE mask)
+{
+	FakeShaderInput input = { semanticName, semanticIndex, D3D_REGISTER_COMPONENT_FLOAT32, mask };
+	return input;
+}
+
+// Position, normal and UV, like VertexShader.hlsl
+static FakeShader MeshShader(const char * positionName)
+{
+	FakeShader shader;
+	shader.Inputs.push_back(Input(positionName, 0, 7));
+	shader.Inputs.push_back(Input("NORMAL", 0, 7));
+	shader.Inputs.push_back(Input("TEXCOORD", 0, 3));
+	return shader;
+}
+
+TEST(ShadersWithTheSameInputsShareALayout)
+{
+	FakeShader instanced = MeshShader("POSITION");
+	instanced.Inputs.push_back(Input("WORLD_PER_INSTANCE", 0, 15));
+	FakeShader secondUV = MeshShader("POSITION");
+	secondUV.Inputs[2].SemanticIndex = 1;
+
+	// Semantic names aren't case sensitive
+	AddFakeShaderFile(L"Mesh.cso", MeshShader("POSITION"));
+	AddFakeShaderFile(L"MeshLowerCase.cso", MeshShader("position"));
+	AddFakeShaderFile(L"Instanced.cso", instanced);
+	AddFakeShaderFile(L"SecondUV.cso", secondUV);
+
+	FakeDevice device;
+	FakeContext context;
+	int liveBefore = GetLiveFakeObjects();
+	{
+		InputLayoutCache cache(&device);
+		const wchar_t * files[] = { L"Mesh.cso", L"MeshLowerCase.cso", L"Instanced.cso", L"SecondUV.cso", L"Mesh.cso" };
+		SimpleVertexShader * shaders[5];
+		for (int i = 0; i < 5; i++)
+		{
+			shaders[i] = new SimpleVertexShader(&device, &context);
+			shaders[i]->SetInputLayoutCache(&cache);
+			CHECK(shaders[i]->LoadShaderFile(files[i]));
+		}
+
+		ID3D11InputLayout * mesh = shaders[0]->GetInputLayout();
+		CHECK(mesh && mesh == shaders[1]->GetInputLayout() && mesh == shaders[4]->GetInputLayout());
+		CHECK(mesh != shaders[2]->GetInputLayout() && mesh != shaders[3]->GetInputLayout());
+		CHECK(shaders[2]->GetInputLayout() != shaders[3]->GetInputLayout());
+		CHECK(device.InputLayoutsCreated == 3);
+		CHECK(cache.GetLayoutCount() == 3 && cache.GetSharedCount() == 2);
+
+		// So switching between them doesn't rebind the layout
+		StateCache stateCache(&context);
+		stateCache.SetInputLayout(shaders[0]->GetInputLayout());
+		stateCache.SetInputLayout(shaders[1]->GetInputLayout());
+		stateCache.SetInputLayout(shaders[4]->GetInputLayout());
+		CHECK(context.CountCalls("IASetInputLayout") == 1);
+
+		// The cache keeps its layouts alive past the shaders
+		int live = GetLiveFakeObjects();
+		for (int i = 0; i < 5; i++)
+			delete shaders[i];
+		CHECK(GetLiveFakeObjects() < live);
+		CHECK(static_cast<FakeObject<ID3D11InputLayout> *>(mesh)->GetRefCount() == 1);
+	}
+
+	// And releases them with itself
+	CHECK(GetLiveFakeObjects() == liveBefore);
+}
+
+TEST(CachedLayoutsDontPointAtCallersNames)
+{
+	FakeDevice device;
+	InputLayoutCache cache(&device);
+	const char code[] = "vertex shader";
+
+	// The cache has to copy the names, not keep the pointers
+	std::string name = "POSITION";
+	D3D11_INPUT_ELEMENT_DESC element = { name.c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	ID3D11InputLayout * first = cache.GetLayout(&element, 1, code, sizeof(code));
+	name = "XXXXXXXX";
+
+	D3D11_INPUT_ELEMENT_DESC again = { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	ID3D11InputLayout * second = cache.GetLayout(&again, 1, code, sizeof(code));
+	CHECK(first && first == second);
+	CHECK(cache.GetLayoutCount() == 1);
+
+	first->Release();
+	second->Release();
+}
@@ -0,0 +1,91 @@
+#include "LODSelector.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times LODSelector::Select() the way Game::Update() drives
+// it - every frame the objects are added again with the LODs
+// picked the frame before, then selected - and run again and
+// again on one frame's objects, with them all in cache
+// --------------------------------------------------------
+
+static const size_t OBJECT_COUNT = 100000;
+static const int FRAMES = 100;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+int main()
+{
+	LODSelector selector;
+	const float thresholds[] = { 240.0f, 120.0f, 60.0f, 4.0f };
+	selector.SetThresholds(thresholds, 4, 0.1f);
+
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 100.0f));
+
+	// Objects scattered through a 1km cube, the camera moving
+	// slowly through it
+	std::vector<XMFLOAT3> centers(OBJECT_COUNT);
+	std::vector<float> radii(OBJECT_COUNT);
+	std::vector<int> lods(OBJECT_COUNT, 0);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+	for (size_t i = 0; i < OBJECT_COUNT; i++)
+	{
+		centers[i] = XMFLOAT3(coordinate(random), coordinate(random), coordinate(random));
+		radii[i] = 1.0f + fabsf(coordinate(random)) / 100.0f;
+	}
+
+	double best = 1e30;
+	double total = 0.0;
+	for (int frame = 0; frame < FRAMES; frame++)
+	{
+		selector.SetView(XMFLOAT3(0, 0, frame * 0.5f), projection, 720.0f);
+		selector.Clear();
+		for (size_t i = 0; i < OBJECT_COUNT; i++)
+			selector.Add(centers[i], radii[i], lods[i]);
+
+		Clock::time_point start = Clock::now();
+		selector.Select();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		// The first frame starts everything at LOD 0, so it's all
+		// changes - keep it out of the steady state numbers
+		if (frame > 0)
+		{
+			total += ms;
+			if (ms < best)
+				best = ms;
+		}
+
+		for (size_t i = 0; i < OBJECT_COUNT; i++)
+			lods[i] = selector.GetLOD(i);
+	}
+
+	// Nothing changes after the first of these, so it's the cost
+	// of checking every object is still inside its dead band
+	double repeated = 1e30;
+	for (int run = 0; run < FRAMES; run++)
+	{
+		Clock::time_point start = Clock::now();
+		selector.Select();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (ms < repeated)
+			repeated = ms;
+	}
+
+	int histogram[5] = { 0, 0, 0, 0, 0 };
+	for (size_t i = 0; i < OBJECT_COUNT; i++)
+		histogram[lods[i] == LOD_CULLED ? 4 : lods[i]]++;
+
+	printf("%zu objects, LODs 0-3: %d %d %d %d, culled: %d\n",
+		OBJECT_COUNT, histogram[0], histogram[1], histogram[2], histogram[3], histogram[4]);
+	printf("Select after adding: best %.4f ms, average %.4f ms\n", best, total / (FRAMES - 1));
+	printf("Select again:        best %.4f ms\n", repeated);
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include "Test.h"
+#include "LODSelector.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+static const float THRESHOLDS[] = { 240.0f, 120.0f, 60.0f, 4.0f, 3.0f, 2.0f, 1.5f, 1.0f };
+static const float HYSTERESIS = 0.1f;
+
+// A 90 degree vertical field of view on a 720 pixel screen
+static void SetTestView(LODSelector & selector)
+{
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.1f, 1000.0f));
+	selector.SetView(XMFLOAT3(0, 0, 0), projection, 720.0f);
+}
+
+// --------------------------------------------------------
+// Picks a LOD the slow way, from the square rooted screen
+// size.  Sets nearThreshold when rounding could tip it
+// --------------------------------------------------------
+static int ReferenceLOD(float pixels, int currentLOD, int thresholdCount, bool & nearThreshold)
+{
+	int lod = currentLOD == LOD_CULLED ? thresholdCount : currentLOD;
+	int coarserLOD = 0;
+	int finerLOD = 0;
+	for (int t = 0; t < thresholdCount; t++)
+	{
+		float coarser = THRESHOLDS[t] * (1.0f - HYSTERESIS);
+		float finer = THRESHOLDS[t] * (1.0f + HYSTERESIS);
+		coarserLOD += pixels < coarser;
+		finerLOD += pixels < finer;
+		if (fabsf(pixels / coarser - 1.0f) < 1e-4f || fabsf(pixels / finer - 1.0f) < 1e-4f)
+			nearThreshold = true;
+	}
+
+	if (lod < coarserLOD)
+		lod = coarserLOD;
+	if (lod > finerLOD)
+		lod = finerLOD;
+	return lod >= thresholdCount ? LOD_CULLED : lod;
+}
+
+TEST(LODHoldsInsideTheDeadBand)
+{
+	LODSelector selector;
+	selector.SetThresholds(THRESHOLDS, 4, HYSTERESIS);
+	SetTestView(selector);
+
+	// A unit sphere is 720 / d pixels tall, so 240 at d = 3.  It
+	// has to pass 216 to drop to LOD 1 and 264 to climb back
+	const float distances[] = { 2.9f, 3.2f, 3.3f, 3.4f, 3.0f, 2.8f, 2.7f, 1000.0f, 100.0f };
+	const int expected[] = { 0, 0, 0, 1, 1, 1, 0, LOD_CULLED, 3 };
+
+	int lod = 0;
+	for (int i = 0; i < 9; i++)
+	{
+		selector.Clear();
+		selector.Add(XMFLOAT3(0, 0, distances[i]), 1.0f, lod);
+		selector.Select();
+		lod = selector.GetLOD(0);
+		CHECK(lod == expected[i]);
+	}
+}
+
+TEST(LODMatchesReference)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(-300.0f, 300.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+
+	// Every threshold count, including all eight in use, and
+	// object counts that leave partial groups
+	for (int thresholdCount = 0; thresholdCount <= MAX_LOD_THRESHOLDS; thresholdCount++)
+	{
+		LODSelector selector;
+		selector.SetThresholds(THRESHOLDS, thresholdCount, HYSTERESIS);
+		SetTestView(selector);
+		std::uniform_int_distribution<int> currentLOD(-1, thresholdCount);
+
+		const size_t count = 1000 + thresholdCount;
+		std::vector<XMFLOAT3> centers(count);
+		std::vector<float> radii(count);
+		std::vector<int> lods(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			centers[i] = XMFLOAT3(coordinate(random), coordinate(random), coordinate(random));
+			radii[i] = radius(random);
+			lods[i] = currentLOD(random);
+		}
+
+		// Half of them start out all at one LOD, so whole groups do
+		for (size_t i = count / 2; i < count; i++)
+			lods[i] = (thresholdCount % 2) ? LOD_CULLED : 0;
+
+		// A few frames with the objects drifting, so LODs carry over
+		int wrong = 0;
+		for (int frame = 0; frame < 4; frame++)
+		{
+			selector.Clear();
+			for (size_t i = 0; i < count; i++)
+			{
+				centers[i].x *= 0.7f;
+				CHECK(selector.Add(centers[i], radii[i], lods[i]) == i);
+			}
+			selector.Select();
+			CHECK(selector.GetCount() == count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const XMFLOAT3 & c = centers[i];
+				float pixels = radii[i] * 720.0f / sqrtf(c.x * c.x + c.y * c.y + c.z * c.z);
+				bool nearThreshold = false;
+				int expected = ReferenceLOD(pixels, lods[i], thresholdCount, nearThreshold);
+				lods[i] = selector.GetLOD(i);
+				if (!nearThreshold && lods[i] != expected)
+					wrong++;
+			}
+		}
+		CHECK(wrong == 0);
+	}
+}
+
+TEST(AddAfterSelectKeepsAppending)
+{
+	LODSelector selector;
+	selector.SetThresholds(THRESHOLDS, 4, HYSTERESIS);
+	SetTestView(selector);
+
+	// Three objects, so Select() pads and trims
+	for (int i = 0; i < 3; i++)
+		selector.Add(XMFLOAT3(0, 0, 1000), 1.0f, 0);
+	selector.Select();
+	CHECK(selector.Add(XMFLOAT3(0, 0, 1), 1.0f, LOD_CULLED) == 3);
+	selector.Select();
+
+	CHECK(selector.GetCount() == 4);
+	for (int i = 0; i < 3; i++)
+		CHECK(selector.GetLOD(i) == LOD_CULLED);
+	CHECK(selector.GetLOD(3) == 0);
+}
+
+TEST(CulledObjectsComeBackWithEveryThresholdInUse)
+{
+	LODSelector selector;
+	selector.SetThresholds(THRESHOLDS, MAX_LOD_THRESHOLDS, HYSTERESIS);
+	SetTestView(selector);
+
+	// A group of eight where only the last one changes: it was
+	// culled, and at 3.5 pixels is now past the 4 pixel threshold
+	for (int i = 0; i < 7; i++)
+		selector.Add(XMFLOAT3(0, 0, 1), 1.0f, 0);
+	selector.Add(XMFLOAT3(0, 0, 720.0f / 3.5f), 1.0f, LOD_CULLED);
+	selector.Select();
+
+	for (int i = 0; i < 7; i++)
+		CHECK(selector.GetLOD(i) == 0);
+	CHECK(selector.GetLOD(7) == 4);
+}
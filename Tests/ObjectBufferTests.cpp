@@ -0,0 +1,293 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "TestCube.h"
+#include "ObjectBufferCache.h"
+#include "Material.h"
+#include "RenderState.h"
+#include "ShaderConstants.h"
+#include "SimpleShader.h"
+#include "StateCache.h"
+#include <cstring>
+
+using namespace DirectX;
+
+// A transposed world matrix placing the object at x
+static XMFLOAT4X4 WorldAt(float x)
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	world._14 = x;
+	return world;
+}
+
+static float GetBufferX(ID3D11Buffer * buffer)
+{
+	float x;
+	memcpy(&x, &static_cast<FakeBuffer *>(buffer)->Data[3 * sizeof(float)], sizeof(float));
+	return x;
+}
+
+TEST(ObjectsGetABufferOnceSettled)
+{
+	FakeDevice device;
+	FakeContext context;
+	StateCache stateCache(&context);
+	int liveBefore = GetLiveFakeObjects();
+	{
+		ObjectBufferCache cache(&device, 3, 10);
+
+		// New, then still for three frames
+		ID3D11Buffer * buffer = 0;
+		int frames = 0;
+		for (int frame = 0; frame < 5; frame++)
+		{
+			cache.BeginFrame();
+			buffer = cache.GetBuffer(7, WorldAt(1.0f), &stateCache);
+			frames += buffer != 0;
+		}
+		CHECK(frames == 2);
+		CHECK(buffer && cache.GetBufferCount() == 1);
+		CHECK(static_cast<FakeBuffer *>(buffer)->Desc.Usage == D3D11_USAGE_IMMUTABLE);
+		CHECK(GetBufferX(buffer) == 1.0f);
+		CHECK(stateCache.GetStats().Uploads == 1 && stateCache.GetStats().BytesUploaded == 64);
+
+		cache.BeginFrame();
+		CHECK(cache.GetBuffer(7, WorldAt(1.0f), &stateCache) == buffer);
+
+		// Moving loses it straight away
+		cache.BeginFrame();
+		CHECK(cache.GetBuffer(7, WorldAt(2.0f), &stateCache) == 0);
+		CHECK(cache.GetBufferCount() == 0 && cache.GetReleasedCount() == 1);
+		CHECK(GetLiveFakeObjects() == liveBefore);
+
+		// Until it settles again, at the new place
+		for (int frame = 0; frame < 2; frame++)
+		{
+			cache.BeginFrame();
+			CHECK(cache.GetBuffer(7, WorldAt(2.0f), &stateCache) == 0);
+		}
+		cache.BeginFrame();
+		buffer = cache.GetBuffer(7, WorldAt(2.0f), &stateCache);
+		CHECK(buffer && GetBufferX(buffer) == 2.0f);
+		CHECK(cache.GetCreatedCount() == 1);
+	}
+	CHECK(GetLiveFakeObjects() == liveBefore);
+}
+
+TEST(FailedBuffersAreRetriedAndUnusedOnesReleased)
+{
+	FakeDevice device;
+	FakeContext context;
+	StateCache stateCache(&context);
+	int liveBefore = GetLiveFakeObjects();
+	{
+		ObjectBufferCache cache(&device, 3, 10);
+		for (int frame = 0; frame < 4; frame++)
+		{
+			cache.BeginFrame();
+			cache.GetBuffer(7, WorldAt(1.0f), &stateCache);
+		}
+		CHECK(cache.GetBufferCount() == 1);
+
+		// Objects are independent, and failing to create a buffer
+		// just means trying again once it's been still as long again
+		device.FailCreateBuffer = true;
+		for (int frame = 0; frame < 4; frame++)
+		{
+			cache.BeginFrame();
+			CHECK(cache.GetBuffer(9, WorldAt(5.0f), &stateCache) == 0);
+			CHECK(cache.GetBuffer(7, WorldAt(1.0f), &stateCache) != 0);
+		}
+		CHECK(cache.GetBufferCount() == 1);
+
+		device.FailCreateBuffer = false;
+		ID3D11Buffer * buffer = 0;
+		for (int frame = 0; frame < 3; frame++)
+		{
+			cache.BeginFrame();
+			buffer = cache.GetBuffer(9, WorldAt(5.0f), &stateCache);
+			CHECK((buffer != 0) == (frame == 2));
+		}
+		CHECK(cache.GetBufferCount() == 2);
+
+		// Object 7 stops being drawn
+		for (int frame = 0; frame < 25; frame++)
+		{
+			cache.BeginFrame();
+			cache.GetBuffer(9, WorldAt(5.0f), &stateCache);
+		}
+		CHECK(cache.GetBufferCount() == 1);
+		CHECK(GetLiveFakeObjects() == liveBefore + 1);
+	}
+	CHECK(GetLiveFakeObjects() == liveBefore);
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl's buffers: view and projection per
+// frame, the world matrix per object
+// --------------------------------------------------------
+static FakeShader VertexShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 128;
+	FakeShaderVariable view = { "view", 0, 64 };
+	FakeShaderVariable projection = { "projection", 64, 64 };
+	perFrame.Variables.push_back(view);
+	perFrame.Variables.push_back(projection);
+
+	FakeShaderBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.BindPoint = 1;
+	perObject.Size = 64;
+	FakeShaderVariable world = { "world", 0, 64 };
+	perObject.Variables.push_back(world);
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	shader.ConstantBuffers.push_back(perObject);
+	return shader;
+}
+
+TEST(ExternalBuffersTakeTheSlotUntilTheShadersOwnIsCopied)
+{
+	AddFakeShaderFile(L"ObjectVertexShader.cso", VertexShader());
+	FakeDevice device;
+	FakeContext context;
+	StateCache stateCache(&context);
+	SimpleVertexShader shader(&device, &context);
+	SimpleVertexShader other(&device, &context);
+	shader.SetStateCache(&stateCache);
+	other.SetStateCache(&stateCache);
+	CHECK(shader.LoadShaderFile(L"ObjectVertexShader.cso"));
+	CHECK(other.LoadShaderFile(L"ObjectVertexShader.cso"));
+
+	const SimpleConstantBuffer * perObject = shader.BindBufferStruct<VertexPerObjectConstants>("perObject");
+	CHECK(perObject && perObject->BindIndex == 1);
+	ID3D11Buffer * own = perObject->ConstantBuffer;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = 64;
+	FakeBuffer * external = new FakeBuffer(desc, 0);
+
+	// Only while the shader is bound, and only its own buffers
+	CHECK(!shader.BindExternalBuffer(perObject, external));
+	shader.SetShader();
+	CHECK(shader.SetMatrix4x4("world", WorldAt(3.0f)));
+	shader.CopyBufferData("perObject");
+	CHECK(shader.BindExternalBuffer(perObject, external));
+	CHECK(context.VSConstantBuffers[1] == external);
+	CHECK(!shader.BindExternalBuffer(other.GetBufferInfo("perObject"), external));
+
+	// Copying puts the shader's own data back, even unchanged
+	CHECK(shader.SetMatrix4x4("world", WorldAt(3.0f)));
+	shader.CopyBufferData("perObject");
+	CHECK(context.VSConstantBuffers[1] == own);
+
+	// Without rebinding when it's already there
+	int binds = context.CountCalls("VSSetConstantBuffers");
+	shader.CopyBufferData("perObject");
+	CHECK(context.CountCalls("VSSetConstantBuffers") == binds);
+
+	// Changed data is uploaded and rebound too
+	CHECK(shader.BindExternalBuffer(perObject, external));
+	CHECK(shader.SetMatrix4x4("world", WorldAt(4.0f)));
+	shader.CopyBufferData("perObject");
+	CHECK(context.VSConstantBuffers[1] == own);
+
+	// And so is setting the shader again
+	CHECK(shader.BindExternalBuffer(perObject, external));
+	other.SetShader();
+	shader.SetShader();
+	CHECK(context.VSConstantBuffers[1] == own);
+	CHECK(!shader.GetBufferInfo("perObject")->External);
+	binds = context.CountCalls("VSSetConstantBuffers");
+	shader.CopyBufferData("perObject");
+	CHECK(context.CountCalls("VSSetConstantBuffers") == binds);
+
+	external->Release();
+}
+
+// --------------------------------------------------------
+// A pixel shader with only a per-frame buffer
+// --------------------------------------------------------
+static FakeShader PixelShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 16;
+	FakeShaderVariable color = { "color", 0, 16 };
+	perFrame.Variables.push_back(color);
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	return shader;
+}
+
+TEST(FramesUploadFrameDataOnceAndOneMatrixPerDraw)
+{
+	AddFakeShaderFile(L"ObjectVertexShader.cso", VertexShader());
+	AddFakeShaderFile(L"FramePixelShader.cso", PixelShader());
+	CubeFixture cube;
+	FakeContext context;
+	StateCache stateCache(&context);
+	SimpleVertexShader vertexShader(&cube.device, &context);
+	SimplePixelShader pixelShader(&cube.device, &context);
+	vertexShader.SetStateCache(&stateCache);
+	pixelShader.SetStateCache(&stateCache);
+	CHECK(vertexShader.LoadShaderFile(L"ObjectVertexShader.cso"));
+	CHECK(pixelShader.LoadShaderFile(L"FramePixelShader.cso"));
+	const SimpleConstantBuffer * perFrame = vertexShader.BindBufferStruct<VertexPerFrameConstants>(CBUFFER_PER_FRAME);
+	CHECK(perFrame != 0);
+
+	Material material(&pixelShader, &vertexShader, 0, 0);
+	ObjectBufferCache objectBuffers(&cube.device, 3, 10);
+
+	// Four static items and four that move every frame, drawn
+	// the way Game::Draw() draws a non-instanced material
+	const int ITEM_COUNT = 8;
+	RenderItem items[ITEM_COUNT];
+	for (int i = 0; i < ITEM_COUNT; i++)
+	{
+		items[i].ItemMesh = cube.mesh;
+		items[i].ItemMaterial = &material;
+		items[i].Visible = true;
+		items[i].ObjectId = i < 4 ? (unsigned int)i : NO_OBJECT_ID;
+	}
+
+	for (int frame = 0; frame < 6; frame++)
+	{
+		stateCache.ResetStats();
+		objectBuffers.BeginFrame();
+
+		VertexPerFrameConstants frameConstants;
+		XMStoreFloat4x4(&frameConstants.View, XMMatrixTranslation(0, 0, (float)frame));
+		XMStoreFloat4x4(&frameConstants.Projection, XMMatrixIdentity());
+		vertexShader.SetBufferStruct(perFrame, frameConstants);
+		vertexShader.CopyBufferData(CBUFFER_PER_FRAME);
+		pixelShader.SetFloat4("color", XMFLOAT4((float)frame, 0, 0, 1));
+		pixelShader.CopyBufferData(CBUFFER_PER_FRAME);
+
+		items[0].BindMaterial();
+		items[0].BindMesh(&stateCache);
+		for (int i = 0; i < ITEM_COUNT; i++)
+		{
+			XMFLOAT4X4 world = WorldAt(items[i].ObjectId != NO_OBJECT_ID ? (float)i : (float)(i + frame * 10));
+			ID3D11Buffer * objectBuffer = 0;
+			if (items[i].ObjectId != NO_OBJECT_ID)
+				objectBuffer = objectBuffers.GetBuffer(items[i].ObjectId, world, &stateCache);
+			if (!objectBuffer || !items[i].BindObjectBuffer(objectBuffer))
+				items[i].SetWorldMatrix(world);
+			items[i].Submit(&context);
+		}
+
+		// Both per-frame buffers once, then a matrix per draw until
+		// the static items settle - they upload one last time into
+		// their own buffers, and then only the moving ones do
+		unsigned int matrices = frame <= 3 ? 8 : 4;
+		CHECK(stateCache.GetStats().Uploads == 2 + matrices);
+		CHECK(stateCache.GetStats().BytesUploaded == 128 + 16 + 64 * matrices);
+	}
+}
@@ -0,0 +1,98 @@
+#include "Test.h"
+#include "OcclusionCuller.h"
+#include "Camera.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// A 256x128 depth buffer looking down +Z from the origin,
+// with a 10x10 wall across the view at z = 10.  The wall is
+// taller than the view there and covers the middle of it
+// from side to side (x/z within +-0.5)
+// --------------------------------------------------------
+struct WallFixture
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection;
+
+	WallFixture(int threadCount)
+		: culler(256, 128, threadCount)
+	{
+		XMFLOAT4X4 view = Camera::BuildViewMatrix(XMFLOAT3(0, 0, 0), XMFLOAT4(0, 0, 0, 1));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 2.0f, 0.1f, 100.0f);
+		XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(XMMatrixTranspose(XMLoadFloat4x4(&view)) * projection));
+		culler.BeginFrame(viewProjection);
+	}
+
+	void AddWall()
+	{
+		std::vector<XMFLOAT3> positions;
+		positions.push_back(XMFLOAT3(-5, -5, 10));
+		positions.push_back(XMFLOAT3(-5, 5, 10));
+		positions.push_back(XMFLOAT3(5, 5, 10));
+		positions.push_back(XMFLOAT3(5, -5, 10));
+		unsigned int quad[] = { 0, 1, 2, 0, 2, 3 };
+		std::vector<unsigned int> indices(quad, quad + 6);
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+		culler.AddOccluder(positions, indices, world);
+		culler.RasterizeOccluders();
+	}
+};
+
+static void CheckAgainstWall(int threadCount)
+{
+	WallFixture wall(threadCount);
+	wall.AddWall();
+
+	CHECK(!wall.culler.IsVisible(XMFLOAT3(0, 0, 20), XMFLOAT3(1, 1, 1)));		// Behind the wall
+	CHECK(wall.culler.IsVisible(XMFLOAT3(0, 0, 5), XMFLOAT3(1, 1, 1)));		// In front of it
+	CHECK(wall.culler.IsVisible(XMFLOAT3(12, 0, 20), XMFLOAT3(1, 1, 1)));		// Beside it
+	CHECK(wall.culler.IsVisible(XMFLOAT3(10, 0, 20), XMFLOAT3(1, 1, 1)));		// Straddling its edge
+	CHECK(wall.culler.IsVisible(XMFLOAT3(0, 0, 0.05f), XMFLOAT3(1, 1, 1)));	// Crossing the near plane
+
+	const OcclusionStats & stats = wall.culler.GetStats();
+	CHECK(stats.OccluderTriangles == 2);
+	CHECK(stats.OccludeesTested == 5);
+	CHECK(stats.OccludeesCulled == 1);
+	CHECK(stats.GetCulledPercent() == 20.0f);
+}
+
+TEST(WallHidesOnlyWhatIsBehindIt)
+{
+	CheckAgainstWall(1);
+}
+
+TEST(ThreadedRasterizingGivesTheSameAnswers)
+{
+	CheckAgainstWall(4);
+}
+
+TEST(WallDepthIsWrittenWhereItCovers)
+{
+	WallFixture wall(1);
+	wall.AddWall();
+
+	// Middle of the screen is the wall, the far left edge isn't
+	const float * depth = wall.culler.GetDepthBuffer();
+	int width = wall.culler.GetWidth();
+	CHECK(depth[64 * width + 128] < 1.0f);
+	CHECK(depth[64 * width + 0] == 1.0f);
+}
+
+TEST(BeginFrameClearsOccludersAndStats)
+{
+	WallFixture wall(1);
+	wall.AddWall();
+	CHECK(!wall.culler.IsVisible(XMFLOAT3(0, 0, 20), XMFLOAT3(1, 1, 1)));
+
+	// Next frame has no occluders
+	wall.culler.BeginFrame(wall.viewProjection);
+	CHECK(wall.culler.GetStats().OccluderTriangles == 0);
+	CHECK(wall.culler.GetStats().OccludeesTested == 0);
+
+	wall.culler.RasterizeOccluders();
+	CHECK(wall.culler.IsVisible(XMFLOAT3(0, 0, 20), XMFLOAT3(1, 1, 1)));
+	CHECK(wall.culler.GetStats().OccludeesCulled == 0);
+}
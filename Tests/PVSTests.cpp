@@ -0,0 +1,246 @@
+#include "Test.h"
+#include "PotentiallyVisibleSet.h"
+#include "TestCube.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Hand built files in SaveToFile()'s layout, so each field
+// can be broken on its own
+// --------------------------------------------------------
+struct PVSFile
+{
+	uint32_t Magic;
+	XMFLOAT3 BoundsMin;
+	float CellSize;
+	int Cells[3];
+	std::vector<unsigned int> Objects;
+	std::vector<uint32_t> Offsets;
+	std::vector<uint8_t> Compressed;
+
+	// Two cells along x, three objects.  The first cell sees all
+	// of them, the second only the middle one
+	PVSFile()
+	{
+		Magic = 0x32535650;
+		BoundsMin = XMFLOAT3(0, 0, 0);
+		CellSize = 1.0f;
+		Cells[0] = 2;
+		Cells[1] = 1;
+		Cells[2] = 1;
+		Objects.push_back(0);
+		Objects.push_back(1);
+		Objects.push_back(2);
+		uint8_t data[4] = { 0x00, 0x07, 0x00, 0x02 };
+		Compressed.assign(data, data + 4);
+		Offsets.push_back(0);
+		Offsets.push_back(2);
+		Offsets.push_back(4);
+	}
+
+	std::vector<uint8_t> Bytes() const
+	{
+		std::vector<uint8_t> out;
+		Append(out, &Magic, 4);
+		Append(out, &BoundsMin, 12);
+		Append(out, &CellSize, 4);
+		Append(out, Cells, 12);
+		AppendArray(out, Objects.empty() ? 0 : &Objects[0], (uint32_t)Objects.size(), sizeof(uint32_t));
+		AppendArray(out, Offsets.empty() ? 0 : &Offsets[0], (uint32_t)Offsets.size(), sizeof(uint32_t));
+		AppendArray(out, Compressed.empty() ? 0 : &Compressed[0], (uint32_t)Compressed.size(), 1);
+		return out;
+	}
+
+	static void Append(std::vector<uint8_t> & out, const void * data, size_t size)
+	{
+		out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+	}
+
+	static void AppendArray(std::vector<uint8_t> & out, const void * data, uint32_t count, size_t elementSize)
+	{
+		Append(out, &count, 4);
+		if (count)
+			Append(out, data, count * elementSize);
+	}
+};
+
+static bool Load(PotentiallyVisibleSet & pvs, const std::vector<uint8_t> & bytes)
+{
+	return pvs.Deserialize(bytes.empty() ? 0 : &bytes[0], bytes.size());
+}
+
+TEST(HandBuiltFileLoads)
+{
+	PotentiallyVisibleSet pvs;
+	CHECK(Load(pvs, PVSFile().Bytes()));
+	CHECK(pvs.GetCellCount() == 2);
+	CHECK(pvs.GetObjectCount() == 3);
+
+	pvs.SetViewPosition(XMFLOAT3(0.5f, 0.5f, 0.5f));
+	CHECK(pvs.IsVisible(0) && pvs.IsVisible(1) && pvs.IsVisible(2));
+	pvs.SetViewPosition(XMFLOAT3(1.5f, 0.5f, 0.5f));
+	CHECK(!pvs.IsVisible(0) && pvs.IsVisible(1) && !pvs.IsVisible(2));
+}
+
+TEST(BakedSetSurvivesSaveAndLoad)
+{
+	CubeFixture cube;
+	EntityPool pool;
+
+	// A wall on the boundary between two cells, with a box on
+	// the far side
+	Entity * wall = cube.MakeEntity(4, XMFLOAT3(0.1f, 200, 200));
+	wall->SetStaticId(0);
+	wall->SetOccluder(true);
+	pool.Add(pool.ReserveHandle(), wall);
+
+	const unsigned int hidden = 1;
+	Entity * box = cube.MakeEntity(10);
+	box->SetStaticId(hidden);
+	pool.Add(pool.ReserveHandle(), box);
+
+	PotentiallyVisibleSet baked;
+	baked.Bake(&pool, XMFLOAT3(0, -1, -1), XMFLOAT3(8, 1, 1), 2.0f);
+	CHECK(baked.SaveToFile("PVSTests.pvs"));
+
+	PotentiallyVisibleSet loaded;
+	CHECK(loaded.LoadFromFile("PVSTests.pvs"));
+	remove("PVSTests.pvs");
+
+	CHECK(loaded.GetCellCount() == baked.GetCellCount());
+	CHECK(loaded.GetObjectCount() == baked.GetObjectCount());
+	CHECK(loaded.GetCompressedSize() == baked.GetCompressedSize());
+
+	// The box is hidden from the near cell and seen from the far one
+	for (float x = 1.0f; x < 8.0f; x += 2.0f)
+	{
+		baked.SetViewPosition(XMFLOAT3(x, 0, 0));
+		loaded.SetViewPosition(XMFLOAT3(x, 0, 0));
+		CHECK(baked.IsVisible(hidden) == loaded.IsVisible(hidden));
+		CHECK(loaded.IsVisible(hidden) == (x > 4.0f));
+	}
+}
+
+TEST(TruncatedFilesAreRejected)
+{
+	std::vector<uint8_t> bytes = PVSFile().Bytes();
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		PotentiallyVisibleSet pvs;
+		CHECK(!pvs.Deserialize(&bytes[0], size));
+		CHECK(pvs.GetCellCount() == 0 && pvs.GetObjectCount() == 0);
+	}
+
+	// So are files with extra bytes on the end
+	bytes.push_back(0);
+	PotentiallyVisibleSet pvs;
+	CHECK(!Load(pvs, bytes));
+}
+
+TEST(BadGridsAreRejected)
+{
+	PotentiallyVisibleSet pvs;
+
+	PVSFile zeroCells;
+	zeroCells.Cells[1] = 0;
+	CHECK(!Load(pvs, zeroCells.Bytes()));
+
+	PVSFile negativeCells;
+	negativeCells.Cells[0] = -2;
+	CHECK(!Load(pvs, negativeCells.Bytes()));
+
+	PVSFile badCellSize;
+	badCellSize.CellSize = -1.0f;
+	CHECK(!Load(pvs, badCellSize.Bytes()));
+
+	// Offsets must cover exactly the grid's cells
+	PVSFile wrongCellCount;
+	wrongCellCount.Cells[0] = 3;
+	CHECK(!Load(pvs, wrongCellCount.Bytes()));
+
+	PVSFile badMagic;
+	badMagic.Magic = 0;
+	CHECK(!Load(pvs, badMagic.Bytes()));
+}
+
+TEST(HugeCountsAreRejectedBeforeAllocating)
+{
+	std::vector<uint8_t> bytes = PVSFile().Bytes();
+
+	// The object count sits right after the 32 byte header
+	uint32_t huge = 0xFFFFFFFF;
+	memcpy(&bytes[32], &huge, 4);
+
+	PotentiallyVisibleSet pvs;
+	CHECK(!Load(pvs, bytes));
+	CHECK(pvs.GetObjectCount() == 0);
+}
+
+TEST(BadStaticIdsAreRejected)
+{
+	PotentiallyVisibleSet pvs;
+
+	// Would wrap the id table resize
+	PVSFile invalid;
+	invalid.Objects[1] = NO_STATIC_ID;
+	CHECK(!Load(pvs, invalid.Bytes()));
+
+	PVSFile tooBig;
+	tooBig.Objects[1] = PVS_MAX_STATIC_IDS;
+	CHECK(!Load(pvs, tooBig.Bytes()));
+
+	// Two bits for the same entity
+	PVSFile duplicate;
+	duplicate.Objects[2] = duplicate.Objects[0];
+	CHECK(!Load(pvs, duplicate.Bytes()));
+
+	// Ids don't have to be dense or in order
+	PVSFile sparse;
+	sparse.Objects[0] = 900;
+	sparse.Objects[1] = PVS_MAX_STATIC_IDS - 1;
+	CHECK(Load(pvs, sparse.Bytes()));
+	pvs.SetViewPosition(XMFLOAT3(1.5f, 0.5f, 0.5f));
+	CHECK(!pvs.IsVisible(900) && pvs.IsVisible(PVS_MAX_STATIC_IDS - 1) && !pvs.IsVisible(2));
+}
+
+TEST(BadCellOffsetsAreRejected)
+{
+	PotentiallyVisibleSet pvs;
+
+	PVSFile pastTheEnd;
+	pastTheEnd.Offsets[2] = 5;
+	CHECK(!Load(pvs, pastTheEnd.Bytes()));
+
+	PVSFile backwards;
+	backwards.Offsets[1] = 4;
+	backwards.Offsets[2] = 2;
+	CHECK(!Load(pvs, backwards.Bytes()));
+
+	PVSFile hugeOffset;
+	hugeOffset.Offsets[1] = 0xFFFFFFFF;
+	CHECK(!Load(pvs, hugeOffset.Bytes()));
+}
+
+TEST(CutOffCompressedDataCountsAsVisible)
+{
+	PotentiallyVisibleSet pvs;
+
+	// A run with no value byte, then a literal that promises more
+	// bytes than the cell has.  Offsets are in range, so the file
+	// loads, but decompressing must stop at the cell's end
+	PVSFile cutOff;
+	uint8_t data[3] = { 0x80, 0x05, 0x00 };
+	cutOff.Compressed.assign(data, data + 3);
+	cutOff.Offsets[1] = 1;
+	cutOff.Offsets[2] = 3;
+	CHECK(Load(pvs, cutOff.Bytes()));
+
+	pvs.SetViewPosition(XMFLOAT3(0.5f, 0.5f, 0.5f));
+	CHECK(pvs.IsVisible(0) && pvs.IsVisible(1) && pvs.IsVisible(2));
+
+	// The second cell's one literal byte is still used
+	pvs.SetViewPosition(XMFLOAT3(1.5f, 0.5f, 0.5f));
+	CHECK(!pvs.IsVisible(0) && !pvs.IsVisible(1) && !pvs.IsVisible(2));
+}
@@ -0,0 +1,199 @@
+#include "Test.h"
+#include "ShaderReflectionData.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static ReflectedVariable Variable(const char * name, uint32_t startOffset, uint32_t size)
+{
+	ReflectedVariable variable = { name, startOffset, size };
+	return variable;
+}
+
+static ReflectedParameter Parameter(const char * semanticName, uint32_t semanticIndex, uint32_t mask)
+{
+	ReflectedParameter parameter = { semanticName, semanticIndex, 3, mask, 0 };
+	return parameter;
+}
+
+// --------------------------------------------------------
+// Some of everything the format holds: the instanced vertex
+// shader's buffers and inputs, plus a texture, a sampler and
+// a thread group size
+// --------------------------------------------------------
+static ShaderReflectionData MakeReflection()
+{
+	ShaderReflectionData reflection;
+
+	ReflectedConstantBuffer perFrame = { "perFrame", 128, 0 };
+	perFrame.Variables.push_back(Variable("view", 0, 64));
+	perFrame.Variables.push_back(Variable("projection", 64, 64));
+	reflection.ConstantBuffers.push_back(perFrame);
+
+	ReflectedConstantBuffer perObject = { "perObject", 64, 1 };
+	perObject.Variables.push_back(Variable("world", 0, 64));
+	reflection.ConstantBuffers.push_back(perObject);
+
+	ReflectedResource texture = { "diffuseTexture", 2, 0 };
+	ReflectedResource sampler = { "basicSampler", 3, 0 };
+	reflection.Resources.push_back(texture);
+	reflection.Resources.push_back(sampler);
+
+	reflection.Inputs.push_back(Parameter("POSITION", 0, 7));
+	reflection.Inputs.push_back(Parameter("WORLD_PER_INSTANCE", 3, 15));
+	reflection.Outputs.push_back(Parameter("SV_POSITION", 0, 15));
+	reflection.ThreadsX = 8;
+	reflection.ThreadsY = 4;
+	reflection.ThreadsZ = 1;
+	return reflection;
+}
+
+static const uint64_t HASH = ShaderReflectionData::HashBytecode("abc", 3);
+
+TEST(BytecodeHashIsFNV1a)
+{
+	CHECK(HASH == 0xe71fa2190541574bull);
+}
+
+TEST(ReflectionSurvivesSaveAndLoad)
+{
+	std::vector<uint8_t> bytes;
+	MakeReflection().Serialize(HASH, bytes);
+
+	// Little endian "REFL", then version 1
+	CHECK(memcmp(&bytes[0], "REFL", 4) == 0);
+	CHECK(bytes[4] == 1 && bytes[5] == 0);
+
+	ShaderReflectionData loaded;
+	CHECK(loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+	CHECK(loaded.ConstantBuffers.size() == 2);
+	CHECK(loaded.ConstantBuffers[0].Variables[1].Name == "projection");
+	CHECK(loaded.ConstantBuffers[0].Variables[1].StartOffset == 64);
+	CHECK(loaded.Inputs[1].SemanticName == "WORLD_PER_INSTANCE" && loaded.Inputs[1].SemanticIndex == 3);
+	CHECK(loaded.ThreadsX == 8 && loaded.ThreadsY == 4 && loaded.ThreadsZ == 1);
+
+	std::vector<uint8_t> again;
+	loaded.Serialize(HASH, again);
+	CHECK(again == bytes);
+
+	// Through a file too
+	CHECK(MakeReflection().SaveToFile("ReflectionCacheTests.refl", HASH));
+	ShaderReflectionData fromFile;
+	CHECK(fromFile.LoadFromFile("ReflectionCacheTests.refl", HASH));
+	remove("ReflectionCacheTests.refl");
+	fromFile.Serialize(HASH, again);
+	CHECK(again == bytes);
+	CHECK(!fromFile.LoadFromFile("ReflectionCacheTests.missing", HASH));
+
+	// And with nothing in it
+	ShaderReflectionData empty;
+	empty.Serialize(HASH, bytes);
+	CHECK(loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+	CHECK(loaded.ConstantBuffers.empty() && loaded.Resources.empty());
+}
+
+TEST(OtherBytecodeIsRejected)
+{
+	std::vector<uint8_t> bytes;
+	MakeReflection().Serialize(HASH, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH + 1));
+	CHECK(loaded.ConstantBuffers.empty());
+}
+
+TEST(TruncatedReflectionIsRejected)
+{
+	std::vector<uint8_t> bytes;
+	MakeReflection().Serialize(HASH, bytes);
+
+	ShaderReflectionData loaded;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		CHECK(!loaded.Deserialize(&bytes[0], size, HASH));
+		CHECK(loaded.ConstantBuffers.empty() && loaded.Inputs.empty());
+	}
+
+	// So is anything extra on the end
+	bytes.push_back(0);
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+}
+
+TEST(BuffersMustBeWholeRegisters)
+{
+	ShaderReflectionData reflection = MakeReflection();
+	reflection.ConstantBuffers[1].Size = 72;
+	std::vector<uint8_t> bytes;
+	reflection.Serialize(HASH, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+	CHECK(loaded.ConstantBuffers.empty());
+}
+
+TEST(VariablesMustFitTheirBuffer)
+{
+	ShaderReflectionData loaded;
+	std::vector<uint8_t> bytes;
+
+	ShaderReflectionData pastTheEnd = MakeReflection();
+	pastTheEnd.ConstantBuffers[0].Variables[1].StartOffset = 80;
+	pastTheEnd.Serialize(HASH, bytes);
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+
+	ShaderReflectionData tooBig = MakeReflection();
+	tooBig.ConstantBuffers[1].Variables[0].Size = 80;
+	tooBig.Serialize(HASH, bytes);
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+
+	// Offset plus size wrapping around to something small
+	ShaderReflectionData wraps = MakeReflection();
+	wraps.ConstantBuffers[1].Variables[0].StartOffset = 0xFFFFFFF0;
+	wraps.ConstantBuffers[1].Variables[0].Size = 16;
+	wraps.Serialize(HASH, bytes);
+	CHECK(!loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+
+	// Right up to the end is fine
+	ShaderReflectionData fits = MakeReflection();
+	fits.ConstantBuffers[0].Variables[0].StartOffset = 112;
+	fits.ConstantBuffers[0].Variables[0].Size = 16;
+	fits.Serialize(HASH, bytes);
+	CHECK(loaded.Deserialize(&bytes[0], bytes.size(), HASH));
+}
+
+// --------------------------------------------------------
+// Random bytes changed after the header.  Loading must not
+// crash or allocate wildly, and whatever it does accept has
+// to be consistent
+// --------------------------------------------------------
+TEST(CorruptReflectionIsRejectedOrConsistent)
+{
+	std::vector<uint8_t> bytes;
+	MakeReflection().Serialize(HASH, bytes);
+
+	std::mt19937 random(1);
+	int inconsistent = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		std::vector<uint8_t> corrupt = bytes;
+		int changes = 1 + random() % 4;
+		for (int c = 0; c < changes; c++)
+			corrupt[16 + random() % (corrupt.size() - 16)] = (uint8_t)random();
+
+		ShaderReflectionData loaded;
+		if (!loaded.Deserialize(&corrupt[0], corrupt.size(), HASH))
+		{
+			inconsistent += !loaded.ConstantBuffers.empty();
+			continue;
+		}
+
+		for (size_t b = 0; b < loaded.ConstantBuffers.size(); b++)
+		{
+			const ReflectedConstantBuffer & cb = loaded.ConstantBuffers[b];
+			inconsistent += cb.Size % 16 != 0;
+			for (size_t v = 0; v < cb.Variables.size(); v++)
+				inconsistent += (uint64_t)cb.Variables[v].StartOffset + cb.Variables[v].Size > cb.Size;
+		}
+	}
+	CHECK(inconsistent == 0);
+}
@@ -0,0 +1,161 @@
+#include "Test.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+// --------------------------------------------------------
+// Sorts the same packets with the queue and with
+// std::stable_sort, and compares the results
+// --------------------------------------------------------
+static bool SortsLikeStableSort(const std::vector<RenderPacket> & input)
+{
+	RenderQueue queue;
+	queue.Begin(1);
+	for (size_t i = 0; i < input.size(); i++)
+		queue.Add(0, input[i].Key, input[i].Item);
+	queue.Sort();
+
+	std::vector<RenderPacket> expected = input;
+	std::stable_sort(expected.begin(), expected.end(),
+		[](const RenderPacket & a, const RenderPacket & b) { return a.Key < b.Key; });
+
+	if (queue.GetCount() != expected.size())
+		return false;
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		if (queue.GetPacket(i).Key != expected[i].Key || queue.GetPacket(i).Item != expected[i].Item)
+			return false;
+	}
+	return true;
+}
+
+TEST(RandomKeysSortLikeStdSort)
+{
+	std::mt19937_64 random(37);
+	std::vector<RenderPacket> packets(20000);
+
+	// Every byte differs, so all eight passes run
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		packets[i].Key = random();
+		packets[i].Item = (uint32_t)i;
+	}
+	CHECK(SortsLikeStableSort(packets));
+
+	// Only the low byte differs: one pass, leaving the result in
+	// the scratch buffer.  Plenty of equal keys check stability
+	for (size_t i = 0; i < packets.size(); i++)
+		packets[i].Key = 0xABCD000000000000ull | (random() & 0xFF);
+	CHECK(SortsLikeStableSort(packets));
+
+	// Keys from MakeKey(), differing only in their state ids
+	for (size_t i = 0; i < packets.size(); i++)
+		packets[i].Key = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, (unsigned int)(random() % 4), (unsigned int)(random() % 8), 0, 10.0f);
+	CHECK(SortsLikeStableSort(packets));
+
+	// Nothing to sort
+	CHECK(SortsLikeStableSort(std::vector<RenderPacket>()));
+	CHECK(SortsLikeStableSort(std::vector<RenderPacket>(1, packets[0])));
+}
+
+TEST(ThreadListsAreMerged)
+{
+	RenderQueue queue;
+	queue.Begin(4);
+	uint32_t item = 0;
+	for (int thread = 3; thread >= 0; thread--)
+	{
+		for (int i = 0; i < 100; i++, item++)
+			queue.Add(thread, (uint64_t)((item * 7919) % 400), item);
+	}
+	queue.Sort();
+
+	CHECK(queue.GetCount() == 400);
+	std::vector<int> seen(400, 0);
+	bool sorted = true;
+	for (size_t i = 0; i < queue.GetCount(); i++)
+	{
+		seen[queue.GetPacket(i).Item]++;
+		if (i > 0 && queue.GetPacket(i - 1).Key > queue.GetPacket(i).Key)
+			sorted = false;
+	}
+	CHECK(sorted);
+	CHECK(std::count(seen.begin(), seen.end(), 1) == 400);
+
+	// Begin() empties every list, even ones the new frame won't use
+	queue.Begin(2);
+	queue.Add(1, 5, 0);
+	queue.Add(0, 3, 1);
+	queue.Sort();
+	CHECK(queue.GetCount() == 2);
+	CHECK(queue.GetPacket(0).Item == 1);
+	CHECK(queue.GetPacket(1).Item == 0);
+}
+
+TEST(OpaqueGroupsByStateThenFrontToBack)
+{
+	uint64_t nearA = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 1, 2, 3, 1.0f);
+	uint64_t farA = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 1, 2, 3, 50.0f);
+	uint64_t nearB = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 2, 0, 0, 0.5f);
+
+	CHECK(nearA < farA);
+	CHECK(farA < nearB);
+
+	// Each state id outranks the ones below it
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 1, 0, 0, 1.0f) > RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 9, 9, 1.0f));
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 1, 0, 1.0f) > RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 9, 1.0f));
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 1, 1.0f) > RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 0, 90.0f));
+
+	// Depths a percent apart still order
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 0, 10.0f) < RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, 0, 0, 10.1f));
+}
+
+TEST(TransparentSortsBackToFrontRegardlessOfState)
+{
+	uint64_t far = RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 5, 5, 5, 20.0f);
+	uint64_t middle = RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 0, 0, 0, 10.0f);
+	uint64_t near = RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 9, 1, 2, 1.0f);
+	CHECK(far < middle);
+	CHECK(middle < near);
+
+	// Every opaque draw comes before every transparent one
+	uint64_t farOpaque = RenderQueue::MakeKey(RENDER_PASS_OPAQUE, RENDER_KEY_MAX_SHADER, RENDER_KEY_MAX_MATERIAL, RENDER_KEY_MAX_MESH, 1.0e30f);
+	CHECK(farOpaque < near);
+	CHECK(farOpaque < RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 0, 0, 0, 1.0e30f));
+
+	// Same depth falls back to state
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 1, 0, 0, 3.0f) < RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 2, 0, 0, 3.0f));
+}
+
+TEST(BadDepthsClampToZero)
+{
+	float bad[] = { -1.0f, -0.0f, std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::infinity() };
+	for (int pass = RENDER_PASS_OPAQUE; pass <= RENDER_PASS_TRANSPARENT; pass++)
+	{
+		uint64_t zero = RenderQueue::MakeKey((RenderPass)pass, 3, 4, 5, 0.0f);
+		for (int i = 0; i < 4; i++)
+			CHECK(RenderQueue::MakeKey((RenderPass)pass, 3, 4, 5, bad[i]) == zero);
+	}
+
+	// Nearest opaque, furthest transparent
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 3, 4, 5, std::nanf("")) < RenderQueue::MakeKey(RENDER_PASS_OPAQUE, 3, 4, 5, 0.001f));
+	CHECK(RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 3, 4, 5, std::nanf("")) > RenderQueue::MakeKey(RENDER_PASS_TRANSPARENT, 3, 4, 5, 0.001f));
+}
+
+TEST(IdsPastTheKeyLimitsWrap)
+{
+	for (int pass = RENDER_PASS_OPAQUE; pass <= RENDER_PASS_TRANSPARENT; pass++)
+	{
+		RenderPass p = (RenderPass)pass;
+		CHECK(RenderQueue::MakeKey(p, RENDER_KEY_MAX_SHADER + 1, 2, 3, 4.0f) == RenderQueue::MakeKey(p, 0, 2, 3, 4.0f));
+		CHECK(RenderQueue::MakeKey(p, 1, RENDER_KEY_MAX_MATERIAL + 3, 3, 4.0f) == RenderQueue::MakeKey(p, 1, 2, 3, 4.0f));
+		CHECK(RenderQueue::MakeKey(p, 1, 2, RENDER_KEY_MAX_MESH + 4, 4.0f) == RenderQueue::MakeKey(p, 1, 2, 3, 4.0f));
+
+		// The largest ids stay inside their own fields
+		uint64_t largest = RenderQueue::MakeKey(p, RENDER_KEY_MAX_SHADER, RENDER_KEY_MAX_MATERIAL, RENDER_KEY_MAX_MESH, 4.0f);
+		CHECK((largest >> 62) == (uint64_t)pass);
+		CHECK(largest != RenderQueue::MakeKey(p, 0, 0, 0, 4.0f));
+	}
+}
@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "RenderState.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+
+using namespace DirectX;
+
+// Items per frame - enough that a frame takes a while to write
+static const unsigned int ITEMS_PER_FRAME = 256;
+
+// --------------------------------------------------------
+// What Game::Update() does to the render state, with every
+// item tagged with the frame it belongs to
+// --------------------------------------------------------
+static void WriteFrame(RenderStateBuffer & buffer)
+{
+	RenderFrame & frame = buffer.BeginWrite();
+	for (unsigned int i = 0; i < ITEMS_PER_FRAME; i++)
+	{
+		RenderItem item = {};
+		item.ObjectId = frame.FrameNumber;
+		frame.Items.push_back(item);
+
+		// Give the reader a chance to run in the middle
+		if (i % 64 == 0)
+			std::this_thread::yield();
+	}
+	buffer.EndWrite();
+}
+
+// --------------------------------------------------------
+// What Game::Draw() does: reads a frame and checks every
+// item came from the same frame
+// @return: false if the frame was torn
+// --------------------------------------------------------
+static bool ReadFrame(RenderStateBuffer & buffer, unsigned int & lastFrame)
+{
+	bool consistent = true;
+	const RenderFrame & frame = buffer.BeginRead();
+	unsigned int frameNumber = frame.FrameNumber;
+	for (unsigned int i = 0; i < frame.Items.size(); i++)
+	{
+		if (frame.Items[i].ObjectId != frameNumber)
+			consistent = false;
+		if (i % 64 == 0)
+			std::this_thread::yield();
+	}
+
+	if (frame.FrameNumber != frameNumber || frameNumber < lastFrame)
+		consistent = false;
+	lastFrame = frameNumber;
+
+	buffer.EndRead();
+	return consistent;
+}
+
+TEST(OverlappedUpdateAndDrawSeeWholeFrames)
+{
+	// The DXCore frame loop: update and draw run at the same
+	// time, and the swap happens once both are done
+	RenderStateBuffer buffer;
+	unsigned int lastFrame = 0;
+	int tornFrames = 0;
+	for (int frame = 0; frame < 2000; frame++)
+	{
+		std::future<void> update = std::async(std::launch::async, [&buffer]() { WriteFrame(buffer); });
+		if (!ReadFrame(buffer, lastFrame))
+			tornFrames++;
+		update.wait();
+
+		CHECK(buffer.Swap());
+	}
+
+	CHECK(tornFrames == 0);
+	CHECK(lastFrame == 1999);
+}
+
+TEST(SwapDuringUseIsRefused)
+{
+	// Misuse: the writer swaps as soon as it's done, without
+	// waiting for the reader.  Swaps that would pull a frame out
+	// from under the reader must be refused
+	RenderStateBuffer buffer;
+	std::atomic<bool> done(false);
+
+	std::thread writer([&]()
+	{
+		for (int frame = 0; frame < 5000; frame++)
+		{
+			WriteFrame(buffer);
+			buffer.Swap();
+		}
+		done = true;
+	});
+
+	unsigned int lastFrame = 0;
+	int tornFrames = 0;
+	int reads = 0;
+	while (!done)
+	{
+		if (!ReadFrame(buffer, lastFrame))
+			tornFrames++;
+		reads++;
+	}
+	writer.join();
+
+	CHECK(tornFrames == 0);
+	CHECK(reads > 0);
+}
+
+TEST(SwapWithoutNewFrameKeepsShowingTheLastOne)
+{
+	RenderStateBuffer buffer;
+	WriteFrame(buffer);
+	CHECK(buffer.Swap());
+
+	// No update ticked this frame
+	CHECK(buffer.Swap());
+	unsigned int lastFrame = 0;
+	CHECK(ReadFrame(buffer, lastFrame));
+	CHECK(lastFrame == 1);
+}
+
+TEST(SwapRefusedWhileReadingOrWriting)
+{
+	RenderStateBuffer buffer;
+	WriteFrame(buffer);
+	CHECK(buffer.Swap());
+
+	buffer.BeginRead();
+	WriteFrame(buffer);
+	CHECK(!buffer.Swap());
+	buffer.EndRead();
+
+	buffer.BeginWrite();
+	CHECK(!buffer.Swap());
+	buffer.EndWrite();
+	CHECK(buffer.Swap());
+	CHECK(buffer.BeginRead().FrameNumber == 3);
+	buffer.EndRead();
+}
+
+TEST(InterpolatedViewBlendsCameraPlacement)
+{
+	// A quarter turn while moving sideways.  Halfway through the
+	// eye must be halfway along the move, facing halfway round
+	RenderFrame frame;
+	frame.PreviousCameraPosition = XMFLOAT3(0, 0, 0);
+	frame.CameraPosition = XMFLOAT3(10, 0, 0);
+	XMStoreFloat4(&frame.PreviousCameraRotation, XMQuaternionIdentity());
+	XMStoreFloat4(&frame.CameraRotation, XMQuaternionRotationRollPitchYaw(0, XM_PIDIV2, 0));
+	frame.ViewMatrix = Camera::BuildViewMatrix(frame.CameraPosition, frame.CameraRotation);
+
+	XMFLOAT4X4 view = RenderStateBuffer::InterpolateView(frame, 0.5f);
+	XMMATRIX viewMatrix = XMMatrixTranspose(XMLoadFloat4x4(&view));
+
+	// The eye lands on the view space origin
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, XMVector3Transform(XMVectorSet(5, 0, 0, 1), viewMatrix));
+	CHECK(fabsf(eye.x) < 0.0001f && fabsf(eye.y) < 0.0001f && fabsf(eye.z) < 0.0001f);
+
+	// A point 45 degrees round is straight ahead
+	XMFLOAT3 ahead;
+	XMStoreFloat3(&ahead, XMVector3Transform(XMVectorSet(5 + 0.70710678f, 0, 0.70710678f, 1), viewMatrix));
+	CHECK(fabsf(ahead.x) < 0.0001f && fabsf(ahead.y) < 0.0001f && fabsf(ahead.z - 1.0f) < 0.0001f);
+
+	// The ends match the ticks exactly
+	XMFLOAT4X4 end = RenderStateBuffer::InterpolateView(frame, 1.0f);
+	CHECK(memcmp(&end, &frame.ViewMatrix, sizeof(XMFLOAT4X4)) == 0);
+}
@@ -0,0 +1,103 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "ShaderLibrary.h"
+#include "InputLayoutCache.h"
+#include <string>
+
+static FakeShader MeshShader()
+{
+	FakeShaderInput position = { "POSITION", 0, D3D_REGISTER_COMPONENT_FLOAT32, 7 };
+	FakeShaderInput normal = { "NORMAL", 0, D3D_REGISTER_COMPONENT_FLOAT32, 7 };
+	FakeShaderInput uv = { "TEXCOORD", 0, D3D_REGISTER_COMPONENT_FLOAT32, 3 };
+
+	FakeShader shader;
+	shader.Inputs.push_back(position);
+	shader.Inputs.push_back(normal);
+	shader.Inputs.push_back(uv);
+	return shader;
+}
+
+static std::wstring ShaderFile(int i)
+{
+	return L"Library" + std::to_wstring(i) + L".cso";
+}
+
+TEST(EverythingLoadsAcrossThreads)
+{
+	ClearFakeShaderFiles();
+	for (int i = 0; i < 64; i++)
+		AddFakeShaderFile(ShaderFile(i), MeshShader());
+
+	FakeDevice device;
+	FakeContext context;
+	InputLayoutCache layouts(&device);
+	ShaderLibrary library(&device, &context);
+	library.SetInputLayoutCache(&layouts);
+
+	// Alternating vertex and pixel shaders
+	ShaderHandle handles[64];
+	for (int i = 0; i < 64; i++)
+		handles[i] = library.Add(i % 2 ? SHADER_STAGE_PIXEL : SHADER_STAGE_VERTEX, ShaderFile(i));
+	library.StartLoading(8);
+
+	CHECK(library.GetVertexShader(handles[0]) && library.GetVertexShader(handles[0])->IsShaderValid());
+	CHECK(library.GetPixelShader(handles[0]) == 0);
+	CHECK(library.GetPixelShader(handles[1]) && library.GetPixelShader(handles[1])->IsShaderValid());
+
+	int invalid = 0;
+	for (int i = 0; i < 64; i++)
+		invalid += !library.Get(handles[i])->IsShaderValid() || library.GetLoadTime(handles[i]) < 0.0f;
+	CHECK(invalid == 0);
+	CHECK(GetFakeReflectCount() == 64);
+
+	// The vertex shaders all share one layout, made once
+	CHECK(device.InputLayoutsCreated == 1);
+	CHECK(layouts.GetSharedCount() == 31);
+}
+
+TEST(LaterBatchesOnlyLoadWhatsNew)
+{
+	ClearFakeShaderFiles();
+	for (int i = 0; i < 3; i++)
+		AddFakeShaderFile(ShaderFile(i), MeshShader());
+
+	FakeDevice device;
+	FakeContext context;
+	ShaderLibrary library(&device, &context);
+	library.Add(SHADER_STAGE_VERTEX, ShaderFile(0));
+	library.Add(SHADER_STAGE_PIXEL, ShaderFile(1));
+	library.StartLoading(2);
+	library.Wait();
+	CHECK(GetFakeReflectCount() == 2);
+
+	// Zero threads means one per core, however many that turns out to be
+	ShaderHandle more = library.Add(SHADER_STAGE_VERTEX, ShaderFile(2));
+	library.StartLoading(0);
+	CHECK(library.GetVertexShader(more)->IsShaderValid());
+	CHECK(library.GetShaderCount() == 3);
+	CHECK(GetFakeReflectCount() == 3);
+
+	// Added but not started yet
+	ShaderHandle pending = library.Add(SHADER_STAGE_VERTEX, ShaderFile(0));
+	CHECK(!library.Get(pending)->IsShaderValid());
+	library.StartLoading(1);
+	CHECK(library.Get(pending)->IsShaderValid());
+
+	// Nothing new to load
+	library.StartLoading(0);
+	library.Wait();
+	CHECK(GetFakeReflectCount() == 4);
+}
+
+TEST(MissingFilesLoadAsInvalidShaders)
+{
+	ClearFakeShaderFiles();
+	FakeDevice device;
+	FakeContext context;
+	ShaderLibrary library(&device, &context);
+
+	ShaderHandle missing = library.Add(SHADER_STAGE_PIXEL, L"Missing.cso");
+	library.StartLoading();
+	CHECK(library.GetPixelShader(missing) && !library.GetPixelShader(missing)->IsShaderValid());
+	CHECK(library.Get(missing + 1) == 0);
+}
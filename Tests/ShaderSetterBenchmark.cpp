@@ -0,0 +1,120 @@
+#include "FakeD3D.h"
+#include "SimpleShader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times SimpleShader::SetMatrix4x4() the three ways a
+// variable can be found - by name, by SimpleNameHash on each
+// call, and through a handle looked up once like Material
+// does - on a vertex shader with the engine's usual buffers
+// --------------------------------------------------------
+
+static const int CALLS = 10000000;
+static const int RUNS = 5;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static FakeShaderVariable Variable(const char * name, UINT startOffset, UINT size)
+{
+	FakeShaderVariable variable = { name, startOffset, size };
+	return variable;
+}
+
+static FakeShader VertexShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 192;
+	perFrame.Variables.push_back(Variable("view", 0, 64));
+	perFrame.Variables.push_back(Variable("projection", 64, 64));
+	perFrame.Variables.push_back(Variable("previousViewProjection", 128, 64));
+
+	FakeShaderBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.BindPoint = 1;
+	perObject.Size = 64;
+	perObject.Variables.push_back(Variable("world", 0, 64));
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	shader.ConstantBuffers.push_back(perObject);
+	return shader;
+}
+
+// Runs a batch of calls RUNS times, printing the best time
+template<typename Batch>
+static void Time(const char * label, Batch batch)
+{
+	double best = 1e30;
+	for (int run = 0; run < RUNS; run++)
+	{
+		Clock::time_point start = Clock::now();
+		batch();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (ms < best)
+			best = ms;
+	}
+	printf("%-28s best %8.2f ms (%.2f ns/call)\n", label, best, best * 1e6 / CALLS);
+}
+
+int main()
+{
+	AddFakeShaderFile(L"Benchmark.cso", VertexShader());
+	FakeDevice device;
+	FakeContext context;
+	SimpleVertexShader shader(&device, &context);
+	if (!shader.LoadShaderFile(L"Benchmark.cso"))
+	{
+		printf("Couldn't load the fake shader\n");
+		return 1;
+	}
+
+	XMFLOAT4X4 matrix;
+	memset(&matrix, 0, sizeof(matrix));
+	printf("SetMatrix4x4(), %d calls\n", CALLS);
+
+	// The matrix changes every call, so the setter can't skip
+	// the copy, and the results are checked so it isn't removed
+	int failed = 0;
+	Time("std::string name", [&]()
+	{
+		for (int i = 0; i < CALLS; i++)
+		{
+			matrix._11 = (float)i;
+			failed += shader.SetMatrix4x4("world", matrix) ? 0 : 1;
+		}
+	});
+
+	constexpr SimpleNameHash worldName("world");
+	Time("SimpleNameHash per call", [&]()
+	{
+		for (int i = 0; i < CALLS; i++)
+		{
+			matrix._11 = (float)i;
+			failed += shader.SetMatrix4x4(shader.GetVariableInfo(worldName), matrix) ? 0 : 1;
+		}
+	});
+
+	const SimpleShaderVariable * world = shader.GetVariableInfo(worldName);
+	Time("Handle looked up once", [&]()
+	{
+		for (int i = 0; i < CALLS; i++)
+		{
+			matrix._11 = (float)i;
+			failed += shader.SetMatrix4x4(world, matrix) ? 0 : 1;
+		}
+	});
+
+	if (failed > 0)
+	{
+		printf("%d calls failed\n", failed);
+		return 1;
+	}
+	return 0;
+}
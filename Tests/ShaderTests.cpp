@@ -0,0 +1,459 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "SimpleShader.h"
+#include "ShaderConstants.h"
+#include "ConstantBufferRing.h"
+#include "ShaderReflectionData.h"
+#include "StateCache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace DirectX;
+
+static FakeShaderVariable Variable(const char * name, UINT startOffset, UINT size)
+{
+	FakeShaderVariable variable = { name, startOffset, size };
+	return variable;
+}
+
+// --------------------------------------------------------
+// One 64 byte buffer at b0 holding a float4 "a" at 16 and a
+// float2 "b" at 48
+// --------------------------------------------------------
+static FakeShader PerFrameShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 64;
+	perFrame.Variables.push_back(Variable("a", 16, 16));
+	perFrame.Variables.push_back(Variable("b", 48, 8));
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	return shader;
+}
+
+static FakeBuffer * GetFakeBuffer(ISimpleShader & shader, unsigned int index)
+{
+	return static_cast<FakeBuffer *>(shader.GetBufferInfo(index)->ConstantBuffer);
+}
+
+TEST(UnchangedBuffersAreNotUploaded)
+{
+	AddFakeShaderFile(L"PerFrame.cso", PerFrameShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"PerFrame.cso"));
+
+	// New buffers start out dirty
+	shader.CopyAllBufferData();
+	CHECK(context.CountCalls("Map") == 1);
+	CHECK(shader.GetUploadStats().BytesUploaded == 64);
+	CHECK(!shader.GetBufferInfo(0u)->Dirty);
+
+	shader.CopyAllBufferData();
+	CHECK(context.CountCalls("Map") == 1);
+	CHECK(shader.GetUploadStats().BytesSkipped == 64);
+}
+
+TEST(WritesTrackTheChangedRange)
+{
+	AddFakeShaderFile(L"PerFrame.cso", PerFrameShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"PerFrame.cso"));
+	shader.CopyAllBufferData();
+
+	// Writing what's already there changes nothing
+	float a[4] = { 0, 0, 0, 0 };
+	CHECK(shader.SetData("a", a, 16));
+	CHECK(shader.GetUploadStats().RedundantWrites == 1);
+	CHECK(!shader.GetBufferInfo(0u)->Dirty);
+
+	a[1] = 1.0f;
+	float b[2] = { 1.0f, 2.0f };
+	CHECK(shader.SetData("a", a, 16));
+	CHECK(shader.SetData("b", b, 8));
+	const SimpleConstantBuffer * cb = shader.GetBufferInfo(0u);
+	CHECK(cb->Dirty && cb->DirtyStart == 16 && cb->DirtyEnd == 56);
+
+	shader.CopyBufferData("perFrame");
+	CHECK(context.CountCalls("Map") == 2);
+	CHECK(memcmp(&GetFakeBuffer(shader, 0)->Data[16], a, 16) == 0);
+	CHECK(memcmp(&GetFakeBuffer(shader, 0)->Data[48], b, 8) == 0);
+}
+
+TEST(CleanBuffersLeaveTheRingWithTheirFrame)
+{
+	AddFakeShaderFile(L"PerFrame.cso", PerFrameShader());
+	FakeDevice device;
+	FakeContext context;
+	StateCache cache(&context);
+	ConstantBufferRing ring(&device, &context, 1024);
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"PerFrame.cso"));
+	shader.SetStateCache(&cache);
+	shader.SetConstantBufferRing(&ring);
+
+	ring.BeginFrame();
+	shader.CopyAllBufferData();
+	CHECK(shader.GetBufferInfo(0u)->BindBuffer == ring.GetBuffer());
+	CHECK(shader.GetBufferInfo(0u)->ConstantCount == 16);	// Ring regions are 256 bytes
+	int maps = context.CountCalls("Map");
+	shader.CopyAllBufferData();
+	CHECK(context.CountCalls("Map") == maps);
+	ring.EndFrame();
+
+	// The GPU hasn't finished the frame, so the data is still there
+	context.PendingQueryPolls = 1000;
+	ring.BeginFrame();
+	shader.CopyAllBufferData();
+	CHECK(context.CountCalls("Map") == maps);
+	ring.EndFrame();
+
+	// Now it has, and the region may be handed out again
+	context.PendingQueryPolls = 0;
+	ring.BeginFrame();
+	CHECK(!ring.IsLive(shader.GetBufferInfo(0u)->RingFrame));
+	shader.CopyAllBufferData();
+	CHECK(context.CountCalls("Map") == maps + 1);
+}
+
+// --------------------------------------------------------
+// A vertex shader with two buffers of two matrices, so most
+// of them lie past the end of PerFrameShader()'s buffer
+// --------------------------------------------------------
+static FakeShader TwoBufferShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 128;
+	perFrame.Variables.push_back(Variable("view", 0, 64));
+	perFrame.Variables.push_back(Variable("projection", 64, 64));
+
+	FakeShaderBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.BindPoint = 1;
+	perObject.Size = 128;
+	perObject.Variables.push_back(Variable("padding", 0, 64));
+	perObject.Variables.push_back(Variable("world", 64, 64));
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	shader.ConstantBuffers.push_back(perObject);
+	return shader;
+}
+
+TEST(HandlesFindTheSameVariableAsNames)
+{
+	AddFakeShaderFile(L"TwoBuffers.cso", TwoBufferShader());
+	FakeDevice device;
+	FakeContext context;
+	SimpleVertexShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"TwoBuffers.cso"));
+
+	constexpr SimpleNameHash worldName("world");
+	const SimpleShaderVariable * world = shader.GetVariableInfo(worldName);
+	CHECK(world && world == shader.GetVariableInfo(std::string("world")));
+	CHECK(world->ConstantBufferIndex == 1 && world->ByteOffset == 64);
+	CHECK(shader.GetVariableInfo(SimpleNameHash("nope")) == 0);
+
+	XMFLOAT4X4 matrix;
+	memset(&matrix, 0, sizeof(matrix));
+	matrix._11 = 2.0f;
+	CHECK(shader.SetMatrix4x4(world, matrix));
+	CHECK(memcmp(shader.GetBufferInfo(1)->LocalDataBuffer + 64, &matrix, sizeof(matrix)) == 0);
+
+	// Sizes still have to match
+	CHECK(!shader.SetFloat4(world, XMFLOAT4(1, 2, 3, 4)));
+	CHECK(!shader.SetMatrix4x4((const SimpleShaderVariable *)0, matrix));
+}
+
+TEST(HandlesFromOtherShadersAreRejected)
+{
+	AddFakeShaderFile(L"TwoBuffers.cso", TwoBufferShader());
+	AddFakeShaderFile(L"PerFrame.cso", PerFrameShader());
+	FakeDevice device;
+	FakeContext context;
+	SimpleVertexShader vertexShader(&device, &context);
+	SimplePixelShader pixelShader(&device, &context);
+	CHECK(vertexShader.LoadShaderFile(L"TwoBuffers.cso"));
+	CHECK(pixelShader.LoadShaderFile(L"PerFrame.cso"));
+
+	// Both would write past the end of the pixel shader's only
+	// buffer, one in the wrong buffer and one at a bad offset
+	XMFLOAT4X4 matrix;
+	memset(&matrix, 0, sizeof(matrix));
+	CHECK(!pixelShader.SetMatrix4x4(vertexShader.GetVariableInfo("world"), matrix));
+	CHECK(!pixelShader.SetMatrix4x4(vertexShader.GetVariableInfo("projection"), matrix));
+
+	// Even one that happens to fit
+	SimpleShaderVariable copy = *pixelShader.GetVariableInfo("a");
+	CHECK(!pixelShader.SetFloat4(&copy, XMFLOAT4(1, 2, 3, 4)));
+	CHECK(pixelShader.SetFloat4(pixelShader.GetVariableInfo("a"), XMFLOAT4(1, 2, 3, 4)));
+}
+
+// --------------------------------------------------------
+// PixelShader.hlsl's perFrame buffer: two lights of 44 bytes,
+// the second starting on a new 16 byte row
+// --------------------------------------------------------
+static FakeShader LightShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 96;
+	perFrame.Variables.push_back(Variable("light1", 0, 44));
+	perFrame.Variables.push_back(Variable("light2", 48, 44));
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	return shader;
+}
+
+// Forgets the padding, so the second light is 4 bytes early
+struct UnpaddedLights
+{
+	DirectionalLight Light1;
+	DirectionalLight Light2;
+
+	static const SimpleBufferField Fields[];
+	static const unsigned int FieldCount;
+};
+
+const SimpleBufferField UnpaddedLights::Fields[] =
+{
+	SIMPLE_BUFFER_FIELD("light1", UnpaddedLights, Light1),
+	SIMPLE_BUFFER_FIELD("light2", UnpaddedLights, Light2),
+};
+const unsigned int UnpaddedLights::FieldCount = 2;
+
+// Leaves out a variable the buffer has
+struct OneLight
+{
+	DirectionalLight Light1;
+
+	static const SimpleBufferField Fields[];
+	static const unsigned int FieldCount;
+};
+
+const SimpleBufferField OneLight::Fields[] =
+{
+	SIMPLE_BUFFER_FIELD("light1", OneLight, Light1),
+};
+const unsigned int OneLight::FieldCount = 1;
+
+TEST(StructsMustMatchTheBufferLayout)
+{
+	AddFakeShaderFile(L"Lights.cso", LightShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"Lights.cso"));
+
+	CHECK(!shader.BindBufferStruct<UnpaddedLights>("perFrame"));
+	CHECK(!shader.BindBufferStruct<OneLight>("perFrame"));
+	CHECK(!shader.BindBufferStruct<PixelPerFrameConstants>("lights"));
+	CHECK(!shader.BindBufferStruct<VertexPerFrameConstants>("perFrame"));
+	CHECK(shader.BindBufferStruct<PixelPerFrameConstants>("perFrame"));
+}
+
+TEST(StructsAreCopiedWhole)
+{
+	AddFakeShaderFile(L"Lights.cso", LightShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"Lights.cso"));
+
+	const SimpleConstantBuffer * perFrame = shader.BindBufferStruct<PixelPerFrameConstants>("perFrame");
+	PixelPerFrameConstants constants = {};
+	constants.Light2.Direction.z = 7.0f;
+	CHECK(shader.SetBufferStruct(perFrame, constants));
+	CHECK(*(float *)(perFrame->LocalDataBuffer + 48 + 40) == 7.0f);
+	CHECK(perFrame->Dirty);
+
+	// The size has to be the bound struct's
+	CHECK(!shader.SetBufferStruct(perFrame, &constants, 10));
+
+	// And the handle this shader's
+	SimplePixelShader other(&device, &context);
+	CHECK(other.LoadShaderFile(L"Lights.cso"));
+	CHECK(!other.SetBufferStruct(perFrame, constants));
+	CHECK(!other.SetBufferStruct(other.GetBufferInfo(0u), constants));
+}
+
+static FakeShaderResource Resource(const char * name, D3D_SHADER_INPUT_TYPE type, UINT bindPoint)
+{
+	FakeShaderResource resource = { name, type, bindPoint };
+	return resource;
+}
+
+// --------------------------------------------------------
+// Three buffers, a name used in two of them, two names with
+// the same hash and enough variables that the sorted name
+// tables get some depth
+// --------------------------------------------------------
+static FakeShader ManyVariableShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 96;
+	perFrame.Variables.push_back(Variable("light1", 0, 44));
+	perFrame.Variables.push_back(Variable("light2", 48, 44));
+
+	FakeShaderBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.BindPoint = 1;
+	perObject.Size = 80;
+	perObject.Variables.push_back(Variable("world", 0, 64));
+	perObject.Variables.push_back(Variable("light1", 64, 16));
+
+	// "n512789" and "n749192" share an FNV-1a hash
+	FakeShaderBuffer big;
+	big.Name = "big";
+	big.BindPoint = 2;
+	big.Size = 16 * 200;
+	big.Variables.push_back(Variable("n512789", 0, 4));
+	big.Variables.push_back(Variable("n749192", 16, 4));
+	for (int i = 2; i < 200; i++)
+	{
+		std::string name = "v" + std::to_string(i);
+		big.Variables.push_back(Variable(name.c_str(), 16 * i, 4));
+	}
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	shader.ConstantBuffers.push_back(perObject);
+	shader.ConstantBuffers.push_back(big);
+	shader.Resources.push_back(Resource("diffuseTexture", D3D_SIT_TEXTURE, 3));
+	shader.Resources.push_back(Resource("normalMap", D3D_SIT_TEXTURE, 5));
+	shader.Resources.push_back(Resource("basicSampler", D3D_SIT_SAMPLER, 2));
+	return shader;
+}
+
+// --------------------------------------------------------
+// Checks everything ManyVariableShader() describes can be
+// found by name, by hash and by index
+// --------------------------------------------------------
+static void CheckManyVariables(ISimpleShader & shader)
+{
+	CHECK(shader.GetBufferCount() == 3);
+	CHECK(shader.GetShaderResourceViewCount() == 2);
+	CHECK(shader.GetSamplerCount() == 1);
+
+	// A name in two buffers finds the first
+	const SimpleShaderVariable * light1 = shader.GetVariableInfo("light1");
+	CHECK(light1 && light1->ConstantBufferIndex == 0 && light1->Size == 44);
+	CHECK(shader.GetVariableInfo(SimpleNameHash("light1")) == light1);
+	CHECK(shader.GetVariableInfo("world") && shader.GetVariableInfo("world")->ConstantBufferIndex == 1);
+	CHECK(shader.GetVariableInfo("nope") == 0);
+	CHECK(shader.GetVariableInfo(SimpleNameHash("nope")) == 0);
+
+	// Names sharing a hash are found by name, but not by hash
+	CHECK(shader.GetVariableInfo("n512789")->ByteOffset == 0);
+	CHECK(shader.GetVariableInfo("n749192")->ByteOffset == 16);
+	CHECK(shader.GetVariableInfo(SimpleNameHash("n749192")) == 0);
+
+	int wrong = 0;
+	for (int i = 2; i < 200; i++)
+	{
+		std::string name = "v" + std::to_string(i);
+		const SimpleShaderVariable * var = shader.GetVariableInfo(name);
+		if (!var || var->ByteOffset != 16u * i || var->ConstantBufferIndex != 2 ||
+			shader.GetVariableInfo(SimpleNameHash(name.c_str())) != var)
+			wrong++;
+	}
+	CHECK(wrong == 0);
+
+	const SimpleSRV * normalMap = shader.GetShaderResourceViewInfo("normalMap");
+	CHECK(normalMap && normalMap->BindIndex == 5 && normalMap->Index == 1);
+	CHECK(shader.GetShaderResourceViewInfo(1) == normalMap);
+	CHECK(shader.GetShaderResourceViewInfo(SimpleNameHash("diffuseTexture"))->BindIndex == 3);
+	CHECK(shader.GetSamplerInfo("basicSampler")->BindIndex == 2);
+	CHECK(shader.GetSamplerInfo(0) == shader.GetSamplerInfo(SimpleNameHash("basicSampler")));
+	CHECK(shader.GetSamplerInfo("diffuseTexture") == 0);
+
+	const SimpleConstantBuffer * perObject = shader.GetBufferInfo("perObject");
+	CHECK(perObject && perObject->BindIndex == 1 && strcmp(perObject->Name, "perObject") == 0);
+	CHECK(perObject->VariableCount == 2 && perObject->Variables[0].Size == 64);
+	CHECK(shader.GetBufferInfo(std::string("perFrame")) == shader.GetBufferInfo(0u));
+}
+
+TEST(ReflectionTablesFindEverything)
+{
+	AddFakeShaderFile(L"ManyVariables.cso", ManyVariableShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"ManyVariables.cso"));
+	CheckManyVariables(shader);
+
+	float value = 3.0f;
+	CHECK(shader.SetFloat("v7", value));
+	CHECK(*(float *)(shader.GetBufferInfo(2)->LocalDataBuffer + 112) == 3.0f);
+}
+
+TEST(LocalDataIsOneAlignedBlock)
+{
+	AddFakeShaderFile(L"ManyVariables.cso", ManyVariableShader());
+	FakeDevice device;
+	FakeContext context;
+	SimplePixelShader shader(&device, &context);
+	CHECK(shader.LoadShaderFile(L"ManyVariables.cso"));
+
+	for (unsigned int i = 0; i < 3; i++)
+		CHECK(((uintptr_t)shader.GetBufferInfo(i)->LocalDataBuffer & 15) == 0);
+	CHECK(shader.GetBufferInfo(1)->LocalDataBuffer - shader.GetBufferInfo(0u)->LocalDataBuffer == 96);
+	CHECK(shader.GetBufferInfo(2)->LocalDataBuffer - shader.GetBufferInfo(1)->LocalDataBuffer == 80);
+}
+
+TEST(CachedReflectionSkipsReflecting)
+{
+	AddFakeShaderFile(L"ManyVariables.cso", ManyVariableShader());
+	FakeDevice device;
+	FakeContext context;
+	std::string cacheFile;
+
+	for (int load = 0; load < 3; load++)
+	{
+		int reflections = GetFakeReflectCount();
+		SimplePixelShader shader(&device, &context);
+		shader.SetReflectionCacheFolder(".");
+		CHECK(shader.LoadShaderFile(L"ManyVariables.cso"));
+		CheckManyVariables(shader);
+
+		char name[32];
+		ID3DBlob * blob = shader.GetShaderBlob();
+		snprintf(name, sizeof(name), "./%016llx.refl",
+			(unsigned long long)ShaderReflectionData::HashBytecode(blob->GetBufferPointer(), blob->GetBufferSize()));
+		cacheFile = name;
+
+		// Only the first load reflects
+		CHECK(GetFakeReflectCount() - reflections == (load == 0 ? 1 : 0));
+	}
+
+	// A broken cache file is reflected over and replaced
+	FILE * file = fopen(cacheFile.c_str(), "wb");
+	fputs("REFL", file);
+	fclose(file);
+
+	int reflections = GetFakeReflectCount();
+	SimplePixelShader shader(&device, &context);
+	shader.SetReflectionCacheFolder(".");
+	CHECK(shader.LoadShaderFile(L"ManyVariables.cso"));
+	CheckManyVariables(shader);
+	CHECK(GetFakeReflectCount() == reflections + 1);
+
+	ShaderReflectionData saved;
+	ID3DBlob * blob = shader.GetShaderBlob();
+	CHECK(saved.LoadFromFile(cacheFile.c_str(), ShaderReflectionData::HashBytecode(blob->GetBufferPointer(), blob->GetBufferSize())));
+	remove(cacheFile.c_str());
+}
@@ -0,0 +1,86 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "ShaderVariants.h"
+#include <string>
+
+static const char * const DEFINES[] = { "TEXTURED", "SECOND_LIGHT" };
+static const ShaderVariantKey TEXTURED = 1;
+static const ShaderVariantKey SECOND_LIGHT = 2;
+
+// Whatever the fake compiler was given, from the variant's code
+static std::string GetCode(ISimpleShader * shader)
+{
+	ID3DBlob * blob = shader->GetShaderBlob();
+	return std::string((const char *)blob->GetBufferPointer(), blob->GetBufferSize());
+}
+
+static bool Contains(const std::string & text, const char * part)
+{
+	return text.find(part) != std::string::npos;
+}
+
+static FakeShader PerFrameShader()
+{
+	FakeShaderBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.BindPoint = 0;
+	perFrame.Size = 96;
+
+	FakeShader shader;
+	shader.ConstantBuffers.push_back(perFrame);
+	return shader;
+}
+
+TEST(VariantsCompileWithTheirDefines)
+{
+	ClearFakeShaderFiles();
+	AddFakeShaderFile(L"PixelShader.hlsl", PerFrameShader());
+	AddFakeShaderFile(L"PixelShader.cso", PerFrameShader());
+	FakeDevice device;
+	FakeContext context;
+
+	ShaderVariants<SimplePixelShader> variants(&device, &context, L"PixelShader.hlsl", "ps_5_0", DEFINES, 2);
+	variants.SetPrecompiled(TEXTURED | SECOND_LIGHT, L"PixelShader.cso");
+
+	// The precompiled one loads, the other is compiled
+	ShaderVariantKey keys[] = { TEXTURED | SECOND_LIGHT, SECOND_LIGHT };
+	variants.Prewarm(keys, 2);
+	CHECK(GetFakeCompileCount() == 1);
+	CHECK(variants.GetVariantCount() == 2);
+
+	SimplePixelShader * full = variants.Get(TEXTURED | SECOND_LIGHT);
+	CHECK(full && full->IsShaderValid());
+	CHECK(variants.GetVariantByIndex(0) == full);
+	CHECK(!Contains(GetCode(full), "ps_5_0"));
+
+	std::string secondLight = GetCode(variants.Get(SECOND_LIGHT));
+	CHECK(Contains(secondLight, "SECOND_LIGHT=1;") && !Contains(secondLight, "TEXTURED"));
+
+	// Undeclared bits are ignored, and nothing is compiled twice
+	CHECK(variants.Get(SECOND_LIGHT | 8) == variants.Get(SECOND_LIGHT));
+	CHECK(GetFakeCompileCount() == 1);
+
+	std::string textured = GetCode(variants.Get(TEXTURED));
+	CHECK(Contains(textured, "TEXTURED=1;") && !Contains(textured, "SECOND_LIGHT"));
+	std::string plain = GetCode(variants.Get(0));
+	CHECK(!Contains(plain, "=1;"));
+	CHECK(GetFakeCompileCount() == 3);
+	CHECK(variants.GetVariantCount() == 4);
+}
+
+TEST(FailedVariantsAreNotRetried)
+{
+	ClearFakeShaderFiles();
+	FakeDevice device;
+	FakeContext context;
+
+	// No source and a precompiled file that isn't there
+	ShaderVariants<SimplePixelShader> variants(&device, &context, L"Missing.hlsl", "ps_5_0", DEFINES, 2);
+	variants.SetPrecompiled(TEXTURED | SECOND_LIGHT, L"Missing.cso");
+
+	CHECK(variants.Get(TEXTURED | SECOND_LIGHT) == 0);
+	CHECK(GetFakeCompileCount() == 1);
+	CHECK(variants.Get(TEXTURED | SECOND_LIGHT) == 0);
+	CHECK(GetFakeCompileCount() == 1);
+	CHECK(variants.GetVariantCount() == 0);
+}
@@ -0,0 +1,172 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include "StateCache.h"
+
+// Stand-ins for bound objects - the cache only compares pointers
+static ID3D11VertexShader * const vertexShader = (ID3D11VertexShader *)0x10;
+static ID3D11PixelShader * const pixelShader = (ID3D11PixelShader *)0x20;
+static ID3D11InputLayout * const inputLayout = (ID3D11InputLayout *)0x30;
+static ID3D11Buffer * const bufferA = (ID3D11Buffer *)0x40;
+static ID3D11Buffer * const bufferB = (ID3D11Buffer *)0x50;
+static ID3D11ShaderResourceView * const textureA = (ID3D11ShaderResourceView *)0x60;
+static ID3D11ShaderResourceView * const textureB = (ID3D11ShaderResourceView *)0x61;
+static ID3D11SamplerState * const sampler = (ID3D11SamplerState *)0x70;
+
+TEST(FirstBindAlwaysReachesContext)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	// Null is a real value to bind, not "unknown"
+	cache.SetVertexShader(0);
+	cache.SetVertexShader(0);
+	CHECK(context.CountCalls("VSSetShader") == 1);
+	CHECK(cache.GetStats().Issued == 1);
+	CHECK(cache.GetStats().Avoided == 1);
+}
+
+TEST(RepeatedBindsAreDropped)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	// 100 draws of two materials, sorted so each material's
+	// draws are together, all with the same shaders
+	for (int i = 0; i < 100; i++)
+	{
+		ID3D11Buffer * mesh = i < 50 ? bufferA : bufferB;
+		cache.SetInputLayout(inputLayout);
+		cache.SetVertexShader(vertexShader);
+		cache.SetVSConstantBuffer(0, bufferA);
+		cache.SetPixelShader(pixelShader);
+		cache.SetPSConstantBuffer(0, bufferB);
+		cache.SetPSShaderResource(0, i < 50 ? textureA : textureB);
+		cache.SetPSSampler(0, sampler);
+		cache.SetVertexBuffer(0, mesh, 32, 0);
+		cache.SetIndexBuffer(mesh, DXGI_FORMAT_R32_UINT, 0);
+		cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	}
+
+	// Ten states bound once, then the texture and mesh
+	// buffers again for the second material
+	CHECK(cache.GetStats().Issued == 13);
+	CHECK(cache.GetStats().Issued + cache.GetStats().Avoided == 1000);
+	CHECK(context.Calls.size() == 13);
+}
+
+TEST(ChangedStrideOrOffsetRebinds)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	cache.SetVertexBuffer(0, bufferA, 32, 0);
+	cache.SetVertexBuffer(0, bufferA, 32, 0);
+	cache.SetVertexBuffer(0, bufferA, 16, 0);
+	cache.SetVertexBuffer(0, bufferA, 16, 64);
+	CHECK(context.CountCalls("IASetVertexBuffers") == 3);
+
+	cache.SetIndexBuffer(bufferA, DXGI_FORMAT_R32_UINT, 0);
+	cache.SetIndexBuffer(bufferA, DXGI_FORMAT_R32_UINT, 12);
+	CHECK(context.CountCalls("IASetIndexBuffer") == 2);
+}
+
+TEST(SlotsPastTheShadowPassThrough)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	cache.SetPSShaderResource(STATE_CACHE_RESOURCE_SLOTS, textureA);
+	cache.SetPSShaderResource(STATE_CACHE_RESOURCE_SLOTS, textureA);
+	CHECK(context.CountCalls("PSSetShaderResources") == 2);
+}
+
+TEST(InvalidateForcesRebind)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	cache.SetVertexShader(vertexShader);
+	cache.SetPixelShader(pixelShader);
+	cache.Invalidate();
+	cache.SetVertexShader(vertexShader);
+	cache.SetPixelShader(pixelShader);
+	CHECK(context.CountCalls("VSSetShader") == 2);
+	CHECK(context.CountCalls("PSSetShader") == 2);
+}
+
+TEST(StagesAreShadowedSeparately)
+{
+	FakeContext context;
+	StateCache cache(&context);
+
+	cache.SetVSShaderResource(0, textureA);
+	cache.SetPSShaderResource(0, textureA);
+	cache.SetVSSampler(0, sampler);
+	cache.SetVSSampler(0, sampler);
+	cache.SetPSSampler(0, sampler);
+	CHECK(context.CountCalls("VSSetShaderResources") == 1);
+	CHECK(context.CountCalls("PSSetShaderResources") == 1);
+	CHECK(context.CountCalls("VSSetSamplers") == 1);
+	CHECK(context.CountCalls("PSSetSamplers") == 1);
+}
+
+TEST(BufferRangesUseContext1)
+{
+	FakeContext context;
+	StateCache cache(&context);
+	CHECK(cache.SupportsBufferRanges());
+
+	cache.SetVSConstantBuffer(1, bufferA, 16, 4);
+	cache.SetVSConstantBuffer(1, bufferA, 16, 4);
+	cache.SetVSConstantBuffer(1, bufferA, 32, 4);
+	CHECK(context.CountCalls("VSSetConstantBuffers1") == 2);
+	CHECK(context.VSConstantBuffers[1] == bufferA);
+	CHECK(context.VSFirstConstants[1] == 32);
+
+	// The whole buffer again is a different binding
+	cache.SetVSConstantBuffer(1, bufferA);
+	CHECK(context.CountCalls("VSSetConstantBuffers 1") == 1);
+	CHECK(context.VSFirstConstants[1] == 0);
+}
+
+TEST(NoContext1MeansNoRanges)
+{
+	FakeContext context;
+	context.SupportsContext1 = false;
+	StateCache cache(&context);
+	CHECK(!cache.SupportsBufferRanges());
+
+	cache.SetPSConstantBuffer(0, bufferA, 16, 4);
+	CHECK(context.CountCalls("PSSetConstantBuffers 0") == 1);
+	CHECK(context.CountCalls("PSSetConstantBuffers1") == 0);
+}
+
+TEST(UpdateBufferCountsUploads)
+{
+	FakeDevice device;
+	FakeContext context;
+	StateCache cache(&context);
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = 64;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ID3D11Buffer * buffer = 0;
+	CHECK(SUCCEEDED(device.CreateBuffer(&desc, 0, &buffer)));
+
+	float data[16];
+	for (int i = 0; i < 16; i++)
+		data[i] = (float)i;
+	cache.UpdateBuffer(buffer, data, sizeof(data));
+	CHECK(memcmp(&static_cast<FakeBuffer *>(buffer)->Data[0], data, sizeof(data)) == 0);
+	CHECK(cache.GetStats().Uploads == 1);
+	CHECK(cache.GetStats().BytesUploaded == sizeof(data));
+
+	// Nothing is counted when the map fails
+	context.FailMap = true;
+	cache.UpdateBuffer(buffer, data, sizeof(data));
+	CHECK(cache.GetStats().Uploads == 1);
+
+	buffer->Release();
+}
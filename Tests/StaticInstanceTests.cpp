@@ -0,0 +1,74 @@
+#include "Test.h"
+#include "StaticInstanceBuffer.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+TEST(DecodeMatchesWhatWasAdded)
+{
+	StaticInstanceBuffer buffer(64.0f, 0.01f, 100.0f);
+
+	// Not a multiple of four, so the last group is short
+	const size_t count = 1003;
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT4> rotations;
+	std::vector<float> scales;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (size_t i = 0; i < count; i++)
+	{
+		positions.push_back(XMFLOAT3(unit(random) * 500.0f, unit(random) * 50.0f, unit(random) * 500.0f));
+		XMFLOAT4 rotation;
+		XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI));
+		rotations.push_back(rotation);
+		scales.push_back(powf(10.0f, unit(random)));
+		buffer.Add(positions[i], rotations[i], scales[i], 0);
+	}
+
+	std::vector<XMFLOAT4X4> matrices(count);
+	buffer.Decode(0, count, &matrices[0]);
+
+	float worstPosition = 0.0f;
+	float worstRotation = 0.0f;
+	float worstScale = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, XMMatrixTranspose(XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[i]))));
+		const XMFLOAT4X4 & m = matrices[i];
+
+		worstPosition = fmaxf(worstPosition, fabsf(m._14 - positions[i].x));
+		worstPosition = fmaxf(worstPosition, fabsf(m._24 - positions[i].y));
+		worstPosition = fmaxf(worstPosition, fabsf(m._34 - positions[i].z));
+
+		float scale = sqrtf(m._11 * m._11 + m._21 * m._21 + m._31 * m._31);
+		worstScale = fmaxf(worstScale, fabsf(scale / scales[i] - 1.0f));
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+				worstRotation = fmaxf(worstRotation, fabsf(m.m[r][c] / scale - expected.m[r][c]));
+		}
+
+		CHECK(m._41 == 0 && m._42 == 0 && m._43 == 0 && m._44 == 1);
+	}
+
+	// Quantization error bounds: 64 / 65535 per axis, 10 bit
+	// quaternion components, 256 log steps of scale
+	CHECK(worstPosition < 0.001f);
+	CHECK(worstRotation < 0.005f);
+	CHECK(worstScale < 0.05f);
+}
+
+TEST(DecodeCanStartAnywhere)
+{
+	StaticInstanceBuffer buffer(64.0f, 0.01f, 100.0f);
+	for (int i = 0; i < 10; i++)
+		buffer.Add(XMFLOAT3((float)i, 0, 0), XMFLOAT4(0, 0, 0, 1), 1.0f, 0);
+
+	XMFLOAT4X4 matrices[3];
+	buffer.Decode(5, 3, matrices);
+	for (int i = 0; i < 3; i++)
+		CHECK(fabsf(matrices[i]._14 - (5.0f + i)) < 0.001f);
+}
@@ -0,0 +1,65 @@
+#include "Test.h"
+#include "FakeD3D.h"
+#include <cstring>
+#include <vector>
+
+struct RegisteredTest
+{
+	const char * Name;
+	TestFunction Function;
+};
+
+static std::vector<RegisteredTest> & Tests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+static int failedChecks = 0;
+
+bool RegisterTest(const char * name, TestFunction function)
+{
+	RegisteredTest test = { name, function };
+	Tests().push_back(test);
+	return true;
+}
+
+void FailCheck(const char * file, int line, const char * condition)
+{
+	printf("%s(%d): CHECK(%s) failed\n", file, line, condition);
+	failedChecks++;
+}
+
+// --------------------------------------------------------
+// Runs every test, or just those whose names contain the
+// first argument
+// --------------------------------------------------------
+int main(int argc, char * argv[])
+{
+	const char * filter = argc > 1 ? argv[1] : 0;
+	int failedTests = 0;
+	int run = 0;
+
+	for (size_t i = 0; i < Tests().size(); i++)
+	{
+		const RegisteredTest & test = Tests()[i];
+		if (filter && !strstr(test.Name, filter))
+			continue;
+
+		int failedBefore = failedChecks;
+		int liveBefore = GetLiveFakeObjects();
+		test.Function();
+		run++;
+
+		if (GetLiveFakeObjects() != liveBefore)
+			FailCheck(__FILE__, __LINE__, "no fake D3D objects leaked");
+
+		bool passed = failedChecks == failedBefore;
+		if (!passed)
+			failedTests++;
+		printf("%s %s\n", passed ? "[ pass ]" : "[ FAIL ]", test.Name);
+	}
+
+	printf("%d of %d tests passed\n", run - failedTests, run);
+	return failedTests == 0 ? 0 : 1;
+}
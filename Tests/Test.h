@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdio>
+
+// --------------------------------------------------------
+// A very small test runner.  Each TEST() registers itself,
+// and Test.cpp's main() runs them all, returning non-zero
+// if any CHECK() failed.
+// --------------------------------------------------------
+
+typedef void (*TestFunction)();
+
+/// Adds a test to the list main() runs
+bool RegisterTest(const char * name, TestFunction function);
+
+/// Counts a failed check against the running test
+void FailCheck(const char * file, int line, const char * condition);
+
+#define TEST(name) \
+	static void name(); \
+	static const bool name##Registered = RegisterTest(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) FailCheck(__FILE__, __LINE__, #condition); } while (0)
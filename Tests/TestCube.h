@@ -0,0 +1,52 @@
+#pragma once
+#include "FakeD3D.h"
+#include "Entity.h"
+#include "Mesh.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A unit cube on a fake device - entities need a mesh for
+// their bounds
+// --------------------------------------------------------
+struct CubeFixture
+{
+	FakeDevice device;
+	Mesh * mesh;
+
+	CubeFixture()
+	{
+		Vertex vertices[8];
+		for (int i = 0; i < 8; i++)
+		{
+			vertices[i].Position = DirectX::XMFLOAT3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+			vertices[i].Normal = DirectX::XMFLOAT3(0, 1, 0);
+			vertices[i].UV = DirectX::XMFLOAT2(0, 0);
+		}
+
+		// Both windings of each face, so it occludes from any side
+		std::vector<unsigned int> indices;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			int b = 1 << ((axis + 1) % 3);
+			int c = 1 << ((axis + 2) % 3);
+			for (int side = 0; side < 2; side++)
+			{
+				int base = side << axis;
+				unsigned int quad[4] = { (unsigned)base, (unsigned)(base | b), (unsigned)(base | b | c), (unsigned)(base | c) };
+				unsigned int faces[12] = { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3], quad[0], quad[2], quad[1], quad[0], quad[3], quad[2] };
+				indices.insert(indices.end(), faces, faces + 12);
+			}
+		}
+		mesh = new Mesh(vertices, 8, &indices[0], (int)indices.size(), &device);
+	}
+
+	~CubeFixture() { delete mesh; }
+
+	Entity * MakeEntity(float x, DirectX::XMFLOAT3 scale = DirectX::XMFLOAT3(1, 1, 1))
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixTranspose(DirectX::XMMatrixScaling(scale.x, scale.y, scale.z) * DirectX::XMMatrixTranslation(x, 0, 0)));
+		return new Entity(mesh, 0, world, DirectX::XMFLOAT3(x, 0, 0), DirectX::XMFLOAT3(0, 0, 0), scale);
+	}
+};